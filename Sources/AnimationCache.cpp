@@ -0,0 +1,201 @@
+#include <cstring>
+#include "Frog.h"
+#include "AnimationCache.h"
+
+using namespace Webfoot;
+
+AnimationCache AnimationCache::instance;
+
+//------------------------------------------------------------------------------
+
+AnimationCache::AnimationCache()
+{
+   atlasCount = 0;
+   for(int i = 0; i < ANIMATION_CACHE_ANIMATIONS_MAX; i++)
+   {
+      animations[i].animation = NULL;
+      animations[i].atlasEntry = NULL;
+      animations[i].refCount = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationCache::Init()
+{
+   atlasCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationCache::Deinit()
+{
+   for(int i = 0; i < atlasCount; i++)
+   {
+      if(atlases[i].refCount > 0)
+         atlases[i].atlas.Deinit();
+      atlases[i].refCount = 0;
+   }
+   atlasCount = 0;
+   for(int i = 0; i < ANIMATION_CACHE_ANIMATIONS_MAX; i++)
+   {
+      animations[i].animation = NULL;
+      animations[i].atlasEntry = NULL;
+      animations[i].refCount = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationCache::AtlasAdd(const char* file, const AtlasDefinition* definition)
+{
+   if(atlasCount >= ANIMATION_CACHE_ATLASES_MAX)
+      return;
+   AtlasEntry& entry = atlases[atlasCount++];
+   entry.file = file;
+   entry.definition = definition;
+   entry.refCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+const AtlasAnimation* AnimationCache::Acquire(const char* file, const char* name, TextureAtlas** atlas)
+{
+   AtlasEntry* atlasEntry = NULL;
+   for(int i = 0; i < atlasCount && !atlasEntry; i++)
+   {
+      if(!strcmp(atlases[i].file, file))
+         atlasEntry = &atlases[i];
+   }
+   if(!atlasEntry)
+      return NULL;
+
+   // Someone may already be playing it.
+   AnimationEntry* freeEntry = NULL;
+   for(int i = 0; i < ANIMATION_CACHE_ANIMATIONS_MAX; i++)
+   {
+      AnimationEntry& entry = animations[i];
+      if(!entry.animation)
+      {
+         if(!freeEntry)
+            freeEntry = &entry;
+      }
+      else if(entry.atlasEntry == atlasEntry && !strcmp(entry.animation->name, name))
+      {
+         entry.refCount++;
+         atlasEntry->refCount++;
+         *atlas = &atlasEntry->atlas;
+         return entry.animation;
+      }
+   }
+
+   // Otherwise, look it up in the atlas, loading the atlas if it's the first
+   // thing anyone wants from it.
+   const AtlasAnimation* animation = NULL;
+   const AtlasDefinition* definition = atlasEntry->definition;
+   for(int i = 0; i < definition->animationCount && !animation; i++)
+   {
+      if(!strcmp(definition->animations[i].name, name))
+         animation = &definition->animations[i];
+   }
+   if(!animation || !freeEntry)
+      return NULL;
+
+   if(atlasEntry->refCount == 0)
+      atlasEntry->atlas.Init(definition);
+   atlasEntry->refCount++;
+
+   freeEntry->animation = animation;
+   freeEntry->atlasEntry = atlasEntry;
+   freeEntry->refCount = 1;
+   *atlas = &atlasEntry->atlas;
+   return animation;
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationCache::Release(const AtlasAnimation* animation)
+{
+   for(int i = 0; i < ANIMATION_CACHE_ANIMATIONS_MAX; i++)
+   {
+      AnimationEntry& entry = animations[i];
+      if(entry.animation != animation)
+         continue;
+
+      AtlasEntry* atlasEntry = entry.atlasEntry;
+      if(--entry.refCount == 0)
+      {
+         entry.animation = NULL;
+         entry.atlasEntry = NULL;
+      }
+      if(--atlasEntry->refCount == 0)
+         atlasEntry->atlas.Deinit();
+      return;
+   }
+}
+
+//==============================================================================
+
+AnimationPlayhead::AnimationPlayhead()
+{
+   atlas = NULL;
+   animation = NULL;
+   time = 0;
+   frame = -1;
+   position = Point2F::Create(0.0f, 0.0f);
+   scale = Point2F::Create(1.0f, 1.0f);
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationPlayhead::Init(const char* file, const char* name)
+{
+   animation = theAnimationCache->Acquire(file, name, &atlas);
+   time = 0;
+   frame = -1;
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationPlayhead::Deinit()
+{
+   if(animation)
+   {
+      theAnimationCache->Release(animation);
+      animation = NULL;
+   }
+   atlas = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationPlayhead::Update(unsigned int dt)
+{
+   if(animation && frame < 0)
+      time = (time + dt) % TextureAtlas::DurationGet(animation);
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationPlayhead::FrameSet(int index)
+{
+   if(!animation)
+      return;
+   if(index < 0)
+      index = 0;
+   if(index >= animation->frameCount)
+      index = animation->frameCount - 1;
+   frame = index;
+}
+
+//------------------------------------------------------------------------------
+
+void AnimationPlayhead::Draw(RenderQueue* queue, int layer)
+{
+   if(!animation)
+      return;
+   const AtlasFrame* atlasFrame = frame >= 0 ? &animation->frames[frame] : TextureAtlas::FrameGet(animation, time);
+   queue->AtlasFrameAdd(layer, atlas, atlasFrame, position, scale);
+}
+
+//------------------------------------------------------------------------------
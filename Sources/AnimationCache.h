@@ -0,0 +1,113 @@
+#ifndef __ANIMATIONCACHE_H__
+#define __ANIMATIONCACHE_H__
+
+#include "Frog.h"
+#include "TextureAtlas.h"
+#include "RenderQueue.h"
+
+namespace Webfoot {
+
+/// Most atlases the cache can know about.
+#define ANIMATION_CACHE_ATLASES_MAX 4
+/// Most different animations that can be in use at once.
+#define ANIMATION_CACHE_ANIMATIONS_MAX 32
+
+//==============================================================================
+
+/// Hands out animations from the packed atlases by sprite resource file and
+/// animation name, keeping count of who's using each one.  An atlas's pages
+/// are loaded when the first of its animations is asked for and unloaded when
+/// the last is given back, so no matter how many things play an animation,
+/// or how many times they're set up again, its frames are only loaded once.
+class AnimationCache
+{
+public:
+   AnimationCache();
+
+   void Init();
+   /// Unload everything that's still in use.
+   void Deinit();
+
+   /// Make the atlas 'definition' available under the sprite resource file
+   /// name 'file', like "Sprites/Sprites".  'file' must stay valid.
+   void AtlasAdd(const char* file, const AtlasDefinition* definition);
+
+   /// Returns the animation called 'name' from 'file' and sets 'atlas' to
+   /// the atlas it's drawn from, loading the atlas if need be.  Returns NULL
+   /// if there's no such animation.  Give it back with Release when done.
+   const AtlasAnimation* Acquire(const char* file, const char* name, TextureAtlas** atlas);
+   /// Give back an animation from Acquire.
+   void Release(const AtlasAnimation* animation);
+
+   static AnimationCache instance;
+
+protected:
+   struct AtlasEntry
+   {
+      const char* file;
+      const AtlasDefinition* definition;
+      TextureAtlas atlas;
+      /// Number of animations from this atlas in use.  The pages are loaded
+      /// while this is more than 0.
+      int refCount;
+   };
+
+   struct AnimationEntry
+   {
+      /// NULL if this entry is free.
+      const AtlasAnimation* animation;
+      AtlasEntry* atlasEntry;
+      int refCount;
+   };
+
+   AtlasEntry atlases[ANIMATION_CACHE_ATLASES_MAX];
+   int atlasCount;
+   AnimationEntry animations[ANIMATION_CACHE_ANIMATIONS_MAX];
+};
+
+AnimationCache* const theAnimationCache = &AnimationCache::instance;
+
+//==============================================================================
+
+/// Plays an animation from the AnimationCache.  This is just where the
+/// animation is up to and where to draw it; the frames are shared with
+/// everything else playing the same animation.
+class AnimationPlayhead
+{
+public:
+   AnimationPlayhead();
+
+   /// Start playing animation 'name' from the sprite resource file 'file'.
+   void Init(const char* file, const char* name);
+   void Deinit();
+
+   /// Advance the animation by 'dt' milliseconds.
+   void Update(unsigned int dt);
+   /// Show whatever frame is 'time' milliseconds into the animation.
+   void TimeSet(unsigned int _time) { time = _time; frame = -1; }
+   /// Show frame 'index' and stop advancing, for animations whose frames are
+   /// picked by hand.
+   void FrameSet(int index);
+   /// Where the center of the frame is drawn.
+   void PositionSet(const Point2F& _position) { position = _position; }
+   void ScaleSet(const Point2F& _scale) { scale = _scale; }
+
+   /// Queue the current frame to be drawn on 'layer'.
+   void Draw(RenderQueue* queue, int layer);
+
+protected:
+   TextureAtlas* atlas;
+   const AtlasAnimation* animation;
+   /// Milliseconds into the animation.
+   unsigned int time;
+   /// Frame picked with FrameSet, or -1 to go by 'time'.
+   int frame;
+   Point2F position;
+   Point2F scale;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __ANIMATIONCACHE_H__
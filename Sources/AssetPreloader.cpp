@@ -0,0 +1,136 @@
+#include <chrono>
+#include "Frog.h"
+#include "AssetPreloader.h"
+#include "MainUpdate.h"
+
+using namespace Webfoot;
+
+/// Number of threads reading files ahead of the main thread.
+#define PRELOADER_THREAD_COUNT 2
+
+AssetPreloader AssetPreloader::instance;
+
+//------------------------------------------------------------------------------
+
+AssetPreloader::AssetPreloader()
+{
+   nextAsset = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::Init()
+{
+   assets.clear();
+   nextAsset = 0;
+   prefetcher.Init(PRELOADER_THREAD_COUNT);
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::Deinit()
+{
+   prefetcher.Deinit();
+
+   for(size_t i = 0; i < assets.size(); i++)
+   {
+      Asset& asset = assets[i];
+      if(asset.image)
+      {
+         theImages->Unload(asset.image);
+         asset.image = NULL;
+      }
+   }
+   assets.clear();
+   nextAsset = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::ImageAdd(const char* name, const char* path, int priority)
+{
+   AssetAdd(name, path, priority);
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::Update(unsigned int budget)
+{
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   std::chrono::milliseconds budgetDuration(budget);
+
+   // Go in priority order, but don't wait on a file that isn't read yet.
+   // Something further down the list may be ready.
+   for(size_t i = nextAsset; i < assets.size(); i++)
+   {
+      Asset& asset = assets[i];
+      if(asset.loaded || !prefetcher.DoneCheck(asset.ticket))
+         continue;
+
+      AssetLoad(&asset);
+      if(std::chrono::steady_clock::now() - start >= budgetDuration)
+         break;
+   }
+
+   while(nextAsset < assets.size() && assets[nextAsset].loaded)
+      nextAsset++;
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::Finish()
+{
+   for(size_t i = nextAsset; i < assets.size(); i++)
+   {
+      if(!assets[i].loaded)
+         AssetLoad(&assets[i]);
+   }
+   nextAsset = assets.size();
+}
+
+//------------------------------------------------------------------------------
+
+bool AssetPreloader::DoneCheck()
+{
+   return nextAsset >= assets.size();
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::AssetAdd(const char* name, const char* path, int priority)
+{
+   for(size_t i = 0; i < assets.size(); i++)
+   {
+      if(assets[i].name == name)
+         return;
+   }
+
+   Asset asset;
+   asset.name = name;
+   asset.priority = priority;
+   asset.ticket = -1;
+   if(path)
+   {
+      char filePath[512];
+      theMainUpdate->FilePathGet(path, filePath, sizeof(filePath));
+      asset.ticket = prefetcher.Request(filePath, priority);
+   }
+   asset.image = NULL;
+   asset.loaded = false;
+
+   // Keep the list sorted, highest priority first.
+   size_t index = assets.size();
+   while(index > nextAsset && assets[index - 1].priority < asset.priority)
+      index--;
+   assets.insert(assets.begin() + index, asset);
+}
+
+//------------------------------------------------------------------------------
+
+void AssetPreloader::AssetLoad(Asset* asset)
+{
+   asset->image = theImages->Load(asset->name.c_str());
+   asset->loaded = true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,75 @@
+#ifndef __ASSETPRELOADER_H__
+#define __ASSETPRELOADER_H__
+
+#include <string>
+#include <vector>
+#include "Frog.h"
+#include "FilePrefetcher.h"
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// Loads assets ahead of time, a little on each frame, so that a state can
+/// start without a hitch.  Worker threads read the files first so the loads
+/// on the main thread don't wait on the disk.  Frog hands out the same image
+/// again when something already loaded is loaded a second time, so a state
+/// that loads what was preloaded gets it right away.  Sounds are preloaded by
+/// adding them to theAudioMixer instead, since only its thread may use them.
+class AssetPreloader
+{
+public:
+   AssetPreloader();
+
+   void Init();
+   /// Unload everything that was preloaded.
+   void Deinit();
+
+   /// Queue an image to be preloaded.  'path' is its file in Frog's file
+   /// system, like "Graphics/ball.png", for the worker threads to read ahead.
+   /// Higher priorities load first.  Asking for something that's already
+   /// queued does nothing.
+   void ImageAdd(const char* name, const char* path, int priority);
+
+   /// Load whatever is ready, for up to 'budget' milliseconds.  Call this on
+   /// every frame while waiting.
+   void Update(unsigned int budget);
+   /// Load everything that's left, waiting on the disk if need be.
+   void Finish();
+
+   /// Returns true if everything queued has been loaded.
+   bool DoneCheck();
+
+   static AssetPreloader instance;
+
+protected:
+   struct Asset
+   {
+      std::string name;
+      int priority;
+      /// Ticket from the FilePrefetcher, or -1 if there's no file to read.
+      int ticket;
+      Image* image;
+      bool loaded;
+   };
+
+   /// Add an asset, keeping the list sorted by priority, and have its file
+   /// read ahead if it has a 'path' in Frog's file system.
+   void AssetAdd(const char* name, const char* path, int priority);
+   /// Load the given asset on the main thread.
+   static void AssetLoad(Asset* asset);
+
+   FilePrefetcher prefetcher;
+   /// Everything queued, highest priority first.
+   std::vector<Asset> assets;
+   /// Index of the first asset that might not be loaded yet.
+   size_t nextAsset;
+};
+
+AssetPreloader* const theAssetPreloader = &AssetPreloader::instance;
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __ASSETPRELOADER_H__
@@ -0,0 +1,175 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "Frog.h"
+#include "AudioMixer.h"
+#include "Profiler.h"
+
+using namespace Webfoot;
+
+/// Milliseconds the mixer thread sleeps when there's nothing to do.  Sounds
+/// start at most this late.
+#define AUDIO_MIXER_IDLE_SLEEP 2
+
+AudioMixer AudioMixer::instance;
+
+//------------------------------------------------------------------------------
+
+AudioMixer::AudioMixer()
+   : stopping(false)
+{
+   droppedCount = 0;
+   soundCount = 0;
+   for(int i = 0; i < AUDIO_MIXER_SOUNDS_MAX; i++)
+   {
+      names[i][0] = '\0';
+      sounds[i] = NULL;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int AudioMixer::SoundAdd(const char* name)
+{
+   for(int i = 0; i < soundCount; i++)
+   {
+      if(strcmp(names[i], name) == 0)
+         return i;
+   }
+   if(soundCount >= AUDIO_MIXER_SOUNDS_MAX)
+      return -1;
+   snprintf(names[soundCount], AUDIO_MIXER_NAME_SIZE, "%s", name);
+   soundCount++;
+   // Posting the load publishes the name to the mixer thread.  Before Init,
+   // it just waits in the queue for the thread to start.
+   Post(AUDIO_COMMAND_LOAD, soundCount - 1, 0, false);
+   return soundCount - 1;
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::Init()
+{
+   droppedCount = 0;
+   stopping.store(false, std::memory_order_relaxed);
+   thread = std::thread(&AudioMixer::ThreadRun, this);
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::Deinit()
+{
+   if(thread.joinable())
+   {
+      stopping.store(true, std::memory_order_release);
+      thread.join();
+   }
+   for(int i = 0; i < soundCount; i++)
+      names[i][0] = '\0';
+   soundCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::Play(int sound, bool loop, int volume)
+{
+   Post(AUDIO_COMMAND_PLAY, sound, volume, loop);
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::Stop(int sound)
+{
+   Post(AUDIO_COMMAND_STOP, sound, 0, false);
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::VolumeSet(int sound, int volume)
+{
+   Post(AUDIO_COMMAND_VOLUME, sound, volume, false);
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::Post(AudioCommandType type, int sound, int volume, bool loop)
+{
+   if(sound < 0 || sound >= soundCount)
+      return;
+
+   AudioCommand command;
+   command.type = type;
+   command.sound = sound;
+   command.volume = volume;
+   command.loop = loop;
+   // A sound that doesn't get played is better than a frame that waits.
+   if(!queue.Push(command))
+      droppedCount++;
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::ThreadRun()
+{
+   // Keep going until told to stop and everything posted before then is done.
+   for(;;)
+   {
+      bool stopRequested = stopping.load(std::memory_order_acquire);
+      AudioCommand command;
+      bool ranAny = false;
+      while(queue.Pop(&command))
+      {
+         CommandRun(command);
+         ranAny = true;
+      }
+      if(stopRequested)
+         break;
+      if(!ranAny)
+         std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_MIXER_IDLE_SLEEP));
+   }
+
+   for(int i = 0; i < AUDIO_MIXER_SOUNDS_MAX; i++)
+   {
+      if(sounds[i])
+      {
+         sounds[i]->Stop();
+         theSounds->Unload(sounds[i]);
+         sounds[i] = NULL;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void AudioMixer::CommandRun(const AudioCommand& command)
+{
+   if(command.type == AUDIO_COMMAND_LOAD)
+   {
+      PROFILE_SCOPE("AudioMixer::Load");
+      if(!sounds[command.sound])
+         sounds[command.sound] = theSounds->Load(names[command.sound]);
+      return;
+   }
+
+   Sound* sound = sounds[command.sound];
+   if(!sound)
+      return;
+
+   PROFILE_SCOPE("AudioMixer::Command");
+   switch(command.type)
+   {
+      case AUDIO_COMMAND_PLAY:
+         sound->Play(0, command.loop, Sound::USAGE_DEFAULT, command.volume);
+         break;
+      case AUDIO_COMMAND_STOP:
+         sound->Stop();
+         break;
+      case AUDIO_COMMAND_VOLUME:
+         sound->VolumeSet(command.volume);
+         break;
+      case AUDIO_COMMAND_LOAD:
+         break;
+   }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+#ifndef __AUDIOMIXER_H__
+#define __AUDIOMIXER_H__
+
+#include <atomic>
+#include <thread>
+#include "Frog.h"
+#include "AudioQueue.h"
+
+namespace Webfoot {
+
+/// Most sounds the mixer can have.
+#define AUDIO_MIXER_SOUNDS_MAX 16
+/// Longest name a sound can have, including the NUL.
+#define AUDIO_MIXER_NAME_SIZE 64
+
+//==============================================================================
+
+/// Plays sounds on a thread of its own, so that loading and starting them
+/// never holds up a frame.  The game thread only posts commands to an
+/// AudioQueue, which takes a few stores and never waits.  The mixer thread
+/// carries out the commands as they come in, and unloads everything when it
+/// stops.
+///
+/// Frog doesn't promise that its sounds can be used from more than one
+/// thread, so this is the game's only way to use them.  While the mixer is
+/// running, nothing else may call theSounds or a Sound.  All the functions
+/// here are safe to call from the main thread at any time, and only the
+/// mixer thread touches Frog.  Call them from one thread only, since the
+/// queue has just the one producer.
+class AudioMixer
+{
+public:
+   AudioMixer();
+
+   /// Have a sound loaded by name on the mixer thread.  Adding a sound that
+   /// was already added just returns it again, so this doubles as a way to
+   /// preload sounds.  Returns its number for the commands below, or -1 if
+   /// there's no room.
+   int SoundAdd(const char* name);
+
+   /// Start the mixer thread.  Call this once, when the program starts.
+   void Init();
+   /// Let the mixer thread finish the commands already posted, then stop it,
+   /// unload the sounds, and forget them.
+   void Deinit();
+
+   /// Play 'sound' at 'volume', from 0 to 100.
+   void Play(int sound, bool loop, int volume);
+   void Stop(int sound);
+   void VolumeSet(int sound, int volume);
+
+   /// Returns the number of commands dropped because the queue was full.
+   int DroppedCountGet() const { return droppedCount; }
+
+   static AudioMixer instance;
+
+protected:
+   /// Post 'command' to the mixer thread, or drop it if the queue is full.
+   void Post(AudioCommandType type, int sound, int volume, bool loop);
+   /// Main function of the mixer thread.
+   void ThreadRun();
+   /// Carry out 'command' on the mixer thread.
+   void CommandRun(const AudioCommand& command);
+
+   AudioQueue queue;
+   std::thread thread;
+   std::atomic<bool> stopping;
+   int droppedCount;
+
+   /// Names of the sounds.  The game thread writes each one before posting
+   /// the command to load it, and never changes it after that.
+   char names[AUDIO_MIXER_SOUNDS_MAX][AUDIO_MIXER_NAME_SIZE];
+   /// The loaded sounds.  Only the mixer thread uses these.  Any that
+   /// couldn't be loaded are NULL, and commands for them are ignored.
+   Sound* sounds[AUDIO_MIXER_SOUNDS_MAX];
+   /// Number of sounds added.  Only the game thread uses this.
+   int soundCount;
+};
+
+AudioMixer* const theAudioMixer = &AudioMixer::instance;
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __AUDIOMIXER_H__
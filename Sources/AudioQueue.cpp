@@ -0,0 +1,42 @@
+#include "AudioQueue.h"
+
+using namespace Webfoot;
+
+//------------------------------------------------------------------------------
+
+AudioQueue::AudioQueue()
+   : pushCount(0), popCount(0)
+{
+}
+
+//------------------------------------------------------------------------------
+
+bool AudioQueue::Push(const AudioCommand& command)
+{
+   // The counts only ever go up, and wrap around together, so their
+   // difference is always how many commands are waiting.
+   unsigned int pushed = pushCount.load(std::memory_order_relaxed);
+   if(pushed - popCount.load(std::memory_order_acquire) >= AUDIO_QUEUE_CAPACITY)
+      return false;
+
+   commands[pushed & (AUDIO_QUEUE_CAPACITY - 1)] = command;
+   // Publish the command only once it's written.
+   pushCount.store(pushed + 1, std::memory_order_release);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool AudioQueue::Pop(AudioCommand* command)
+{
+   unsigned int popped = popCount.load(std::memory_order_relaxed);
+   if(popped == pushCount.load(std::memory_order_acquire))
+      return false;
+
+   *command = commands[popped & (AUDIO_QUEUE_CAPACITY - 1)];
+   // Only give the slot back once it's been read.
+   popCount.store(popped + 1, std::memory_order_release);
+   return true;
+}
+
+//------------------------------------------------------------------------------
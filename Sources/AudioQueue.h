@@ -0,0 +1,72 @@
+#ifndef __AUDIOQUEUE_H__
+#define __AUDIOQUEUE_H__
+
+#include <atomic>
+
+namespace Webfoot {
+
+/// Most commands that can be waiting at once.  This must be a power of 2.
+#define AUDIO_QUEUE_CAPACITY 256
+/// Bytes to keep between what the game thread writes and what the mixer
+/// thread writes, so they aren't on the same cache line.
+#define AUDIO_QUEUE_CACHE_LINE_SIZE 64
+
+//==============================================================================
+
+/// Things the game can ask the mixer to do.
+enum AudioCommandType
+{
+   /// Load a sound by the name it was added with.
+   AUDIO_COMMAND_LOAD,
+   /// Start playing a sound from the beginning.
+   AUDIO_COMMAND_PLAY,
+   /// Stop a sound.
+   AUDIO_COMMAND_STOP,
+   /// Change how loud a sound is.
+   AUDIO_COMMAND_VOLUME
+};
+
+struct AudioCommand
+{
+   AudioCommandType type;
+   /// Which sound, as returned by AudioMixer::SoundAdd.
+   int sound;
+   /// 0 to 100.
+   int volume;
+   /// For AUDIO_COMMAND_PLAY, whether to keep playing it over and over.
+   bool loop;
+};
+
+//==============================================================================
+
+/// A fixed-size ring of AudioCommands going from exactly one thread to exactly
+/// one other.  Neither side ever waits on the other: each only writes its own
+/// index, and reads the other's to see how much room or how many commands
+/// there are.  This has no dependency on Frog.
+class AudioQueue
+{
+public:
+   AudioQueue();
+
+   /// Add a command.  Only call this from the producing thread.  Returns
+   /// false, and drops the command, if the queue is full.
+   bool Push(const AudioCommand& command);
+   /// Take the oldest command.  Only call this from the consuming thread.
+   /// Returns false if there aren't any.
+   bool Pop(AudioCommand* command);
+
+protected:
+   AudioCommand commands[AUDIO_QUEUE_CAPACITY];
+   /// Number of commands ever pushed.  Only the producer writes this.
+   std::atomic<unsigned int> pushCount;
+   char pushPadding[AUDIO_QUEUE_CACHE_LINE_SIZE];
+   /// Number of commands ever popped.  Only the consumer writes this.
+   std::atomic<unsigned int> popCount;
+   char popPadding[AUDIO_QUEUE_CACHE_LINE_SIZE];
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __AUDIOQUEUE_H__
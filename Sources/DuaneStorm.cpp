@@ -0,0 +1,120 @@
+#include <cstddef>
+#include "DuaneStorm.h"
+#include "PongSim.h"
+
+using namespace Webfoot;
+
+/// Speed of a full-size Duane, in pixels per second.  Smaller ones are faster.
+#define DUANE_SPEED -100.0f
+/// Largest a Duane can be drawn.
+#define DUANE_MAX_SCALE 2.0f
+/// Smallest a Duane can be drawn.  Keeps tiny Duanes from going infinitely
+/// fast.
+#define DUANE_MIN_SCALE 0.05f
+
+//------------------------------------------------------------------------------
+
+DuaneStorm::DuaneStorm()
+{
+   count = 0;
+   screenWidth = 0.0f;
+   screenHeight = 0.0f;
+   positionX = NULL;
+   positionY = NULL;
+   velocityY = NULL;
+   scale = NULL;
+   animationPhase = NULL;
+   animationTime = 0;
+   animationLength = 1;
+   randomState = 1;
+}
+
+//------------------------------------------------------------------------------
+
+void DuaneStorm::Init(int _count, float _screenWidth, float _screenHeight,
+   unsigned int _animationLength, unsigned int seed)
+{
+   Deinit();
+
+   count = _count > 0 ? _count : 0;
+   screenWidth = _screenWidth;
+   screenHeight = _screenHeight;
+   animationLength = _animationLength ? _animationLength : 1;
+   animationTime = 0;
+   randomState = seed ? seed : 1;
+
+   positionX = new float[count];
+   positionY = new float[count];
+   velocityY = new float[count];
+   scale = new float[count];
+   animationPhase = new unsigned int[count];
+
+   for(int i = 0; i < count; i++)
+   {
+      Respawn(i);
+      // Start them spread over the screen rather than all at the bottom.
+      positionY[i] = screenHeight * PongSim::RandomF(&randomState);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void DuaneStorm::Deinit()
+{
+   delete[] positionX;
+   delete[] positionY;
+   delete[] velocityY;
+   delete[] scale;
+   delete[] animationPhase;
+   positionX = NULL;
+   positionY = NULL;
+   velocityY = NULL;
+   scale = NULL;
+   animationPhase = NULL;
+   count = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void DuaneStorm::Update(unsigned int dt)
+{
+   float dtSeconds = (float)dt / 1000.0f;
+   animationTime = (animationTime + dt) % animationLength;
+
+   // Keep this loop simple so the compiler can vectorize it.
+   float* y = positionY;
+   const float* vy = velocityY;
+   for(int i = 0; i < count; i++)
+      y[i] += vy[i] * dtSeconds;
+
+   // Only the few that went off the top of the screen need more work.
+   for(int i = 0; i < count; i++)
+   {
+      if(y[i] <= 0.0f)
+         Respawn(i);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int DuaneStorm::AnimationTimeGet(int index) const
+{
+   return (animationTime + animationPhase[index]) % animationLength;
+}
+
+//------------------------------------------------------------------------------
+
+void DuaneStorm::Respawn(int index)
+{
+   float newScale = PongSim::RandomF(&randomState) * DUANE_MAX_SCALE;
+   if(newScale < DUANE_MIN_SCALE)
+      newScale = DUANE_MIN_SCALE;
+
+   positionX[index] = PongSim::RandomF(&randomState) * screenWidth;
+   positionY[index] = screenHeight;
+   scale[index] = newScale;
+   velocityY[index] = DUANE_SPEED / newScale;
+   animationPhase[index] = (unsigned int)(PongSim::RandomF(&randomState) * animationLength);
+}
+
+//------------------------------------------------------------------------------
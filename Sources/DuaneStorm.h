@@ -0,0 +1,67 @@
+#ifndef __DUANESTORM_H__
+#define __DUANESTORM_H__
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// The swarm of Duanes shown when the game ends.  Each Duane is just a few
+/// numbers kept in separate contiguous arrays, so the update loops run
+/// straight through memory and they can all be drawn with one shared sprite.
+/// This has no dependency on Frog.
+class DuaneStorm
+{
+public:
+   DuaneStorm();
+
+   /// Set up 'count' Duanes on a screen of the given size.  'animationLength'
+   /// is the length of the Duane animation in milliseconds.
+   void Init(int count, float screenWidth, float screenHeight,
+      unsigned int animationLength, unsigned int seed);
+   /// Clean up.
+   void Deinit();
+
+   /// Move the Duanes.  'dt' is in milliseconds.
+   void Update(unsigned int dt);
+
+   /// Number of Duanes.
+   int CountGet() const { return count; }
+   /// Positions of the Duanes.
+   const float* PositionXGet() const { return positionX; }
+   const float* PositionYGet() const { return positionY; }
+   /// Scales of the Duanes.
+   const float* ScaleGet() const { return scale; }
+   /// Returns how far into its animation the given Duane is, in milliseconds.
+   unsigned int AnimationTimeGet(int index) const;
+
+protected:
+   /// Send the given Duane back to the bottom of the screen at a new random
+   /// spot, size and speed.
+   void Respawn(int index);
+
+   int count;
+   float screenWidth;
+   float screenHeight;
+
+   float* positionX;
+   float* positionY;
+   /// Duanes only move vertically, in pixels per second.
+   float* velocityY;
+   float* scale;
+   /// Where in the animation each Duane is, in milliseconds, relative to
+   /// 'animationTime'.
+   unsigned int* animationPhase;
+
+   /// Time shared by all the Duanes' animations, in milliseconds.
+   unsigned int animationTime;
+   unsigned int animationLength;
+
+   /// Random number generator state.
+   unsigned int randomState;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __DUANESTORM_H__
@@ -0,0 +1,129 @@
+#include <cstdio>
+#include "FilePrefetcher.h"
+#include "Profiler.h"
+
+using namespace Webfoot;
+
+/// Size of the chunks files are read in.
+#define PREFETCH_CHUNK_SIZE 65536
+
+//------------------------------------------------------------------------------
+
+FilePrefetcher::FilePrefetcher()
+{
+   pendingCount = 0;
+   stopping = false;
+}
+
+//------------------------------------------------------------------------------
+
+void FilePrefetcher::Init(int threadCount)
+{
+   stopping = false;
+   for(int i = 0; i < threadCount; i++)
+      workers.push_back(std::thread(&FilePrefetcher::WorkerRun, this));
+}
+
+//------------------------------------------------------------------------------
+
+void FilePrefetcher::Deinit()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      while(!jobs.empty())
+      {
+         done[jobs.top().ticket] = true;
+         jobs.pop();
+         pendingCount--;
+      }
+   }
+   wake.notify_all();
+
+   for(size_t i = 0; i < workers.size(); i++)
+      workers[i].join();
+   workers.clear();
+}
+
+//------------------------------------------------------------------------------
+
+int FilePrefetcher::Request(const char* path, int priority)
+{
+   Job job;
+   job.path = path;
+   job.priority = priority;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      job.ticket = (int)done.size();
+      done.push_back(false);
+      if(stopping || workers.empty())
+      {
+         // Nobody to read it, so don't make anyone wait on it.
+         done[job.ticket] = true;
+         return job.ticket;
+      }
+      jobs.push(job);
+      pendingCount++;
+   }
+   wake.notify_one();
+   return job.ticket;
+}
+
+//------------------------------------------------------------------------------
+
+bool FilePrefetcher::DoneCheck(int ticket)
+{
+   std::lock_guard<std::mutex> lock(mutex);
+   return ticket < 0 || ticket >= (int)done.size() || done[ticket];
+}
+
+//------------------------------------------------------------------------------
+
+int FilePrefetcher::PendingCountGet()
+{
+   std::lock_guard<std::mutex> lock(mutex);
+   return pendingCount;
+}
+
+//------------------------------------------------------------------------------
+
+void FilePrefetcher::WorkerRun()
+{
+   for(;;)
+   {
+      Job job;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         while(!stopping && jobs.empty())
+            wake.wait(lock);
+         if(stopping)
+            return;
+         job = jobs.top();
+         jobs.pop();
+      }
+
+      FileRead(job.path);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      done[job.ticket] = true;
+      pendingCount--;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void FilePrefetcher::FileRead(const std::string& path)
+{
+   PROFILE_SCOPE("FileRead");
+   FILE* file = fopen(path.c_str(), "rb");
+   if(!file)
+      return;
+   static const size_t chunkSize = PREFETCH_CHUNK_SIZE;
+   std::vector<char> buffer(chunkSize);
+   while(fread(&buffer[0], 1, chunkSize, file) == chunkSize)
+   {
+   }
+   fclose(file);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+#ifndef __FILEPREFETCHER_H__
+#define __FILEPREFETCHER_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Webfoot {
+
+//==============================================================================
+
+/// Reads files on background threads, highest priority first, so that they're
+/// in the operating system's file cache by the time the main thread loads
+/// them.  This has no dependency on Frog.
+class FilePrefetcher
+{
+public:
+   FilePrefetcher();
+
+   /// Start 'threadCount' worker threads.
+   void Init(int threadCount);
+   /// Stop the worker threads.  Files that haven't been read yet are skipped.
+   void Deinit();
+
+   /// Queue 'path' to be read.  Returns a ticket for checking on it.
+   int Request(const char* path, int priority);
+   /// Returns true once the file for 'ticket' has been read, or couldn't be.
+   bool DoneCheck(int ticket);
+   /// Returns the number of requests that haven't been read yet.
+   int PendingCountGet();
+
+protected:
+   struct Job
+   {
+      std::string path;
+      int priority;
+      int ticket;
+
+      /// Higher priorities first, then first come, first served.
+      bool operator<(const Job& other) const
+      {
+         if(priority != other.priority)
+            return priority < other.priority;
+         return ticket > other.ticket;
+      }
+   };
+
+   /// Main function of each worker thread.
+   void WorkerRun();
+   /// Read the whole file at 'path' and throw the contents away.
+   static void FileRead(const std::string& path);
+
+   std::vector<std::thread> workers;
+   std::mutex mutex;
+   std::condition_variable wake;
+   std::priority_queue<Job> jobs;
+   /// Whether each ticket is done.
+   std::vector<bool> done;
+   int pendingCount;
+   bool stopping;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FILEPREFETCHER_H__
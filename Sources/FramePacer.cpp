@@ -0,0 +1,232 @@
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+#include <thread>
+#include "FramePacer.h"
+
+using namespace Webfoot;
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+FramePacer FramePacer::instance;
+
+/// Frames per second for each policy, in the order of FramePacePolicy.  The
+/// waiting screens only have the background and Duane moving, which don't
+/// need more than this to look smooth.
+static const int policyRates[FRAME_PACE_COUNT] = {0, 30, 20, 30};
+static const char* const policyNames[FRAME_PACE_COUNT] = {"Playing", "Waiting", "Game over", "Menu"};
+
+//------------------------------------------------------------------------------
+
+FramePacer::FramePacer()
+{
+   policy = FRAME_PACE_PLAYING;
+   redrawRequested = true;
+   deadlineSet = false;
+   spinMargin = FRAME_PACER_SPIN_MIN * 1000;
+   oversleepWorst = 0;
+   statsCpuStart = 0;
+   statsFrames = 0;
+   statsDraws = 0;
+   statsWaiting = 0;
+   statsLateness = 0;
+   stats.frameRate = 0.0f;
+   stats.drawRate = 0.0f;
+   stats.mainThreadBusy = 0.0f;
+   stats.processCpu = 0.0f;
+   stats.lateness = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+
+void FramePacer::Init()
+{
+#ifdef _WIN32
+   // Sleeps are rounded up to the next scheduler tick, which is 15.6 ms
+   // unless someone asks for better.
+   timeBeginPeriod(1);
+#endif
+
+   policy = FRAME_PACE_PLAYING;
+   redrawRequested = true;
+   lastDraw = Clock::now();
+   deadlineSet = false;
+   spinMargin = FRAME_PACER_SPIN_MIN * 1000;
+   oversleepWorst = 0;
+
+   statsStart = Clock::now();
+   statsCpuStart = ProcessCpuTimeGet();
+   statsFrames = 0;
+   statsDraws = 0;
+   statsWaiting = 0;
+   statsLateness = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void FramePacer::Deinit()
+{
+#ifdef _WIN32
+   timeEndPeriod(1);
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+const char* FramePacer::PolicyNameGet(FramePacePolicy policy)
+{
+   return policyNames[policy];
+}
+
+//------------------------------------------------------------------------------
+
+int FramePacer::RateGet(FramePacePolicy policy)
+{
+   return policyRates[policy];
+}
+
+//------------------------------------------------------------------------------
+
+bool FramePacer::RedrawCheck()
+{
+   Clock::time_point now = Clock::now();
+   bool redraw = redrawRequested || RateGet(policy) <= 0 ||
+      now - lastDraw >= milliseconds(FRAME_PACER_REDRAW_INTERVAL_MAX);
+   redrawRequested = false;
+   if(redraw)
+   {
+      lastDraw = now;
+      statsDraws++;
+   }
+   return redraw;
+}
+
+//------------------------------------------------------------------------------
+
+void FramePacer::FrameEnd()
+{
+   Clock::time_point now = Clock::now();
+   statsFrames++;
+
+   int rate = RateGet(policy);
+   if(rate <= 0)
+   {
+      // Nothing to wait for, and the next limited frame starts counting
+      // from whenever it ends.
+      deadlineSet = false;
+      StatsUpdate(now);
+      return;
+   }
+   Clock::duration period = microseconds(1000000 / rate);
+
+   // Frames are counted from the last deadline rather than from when they
+   // ended, so they stay evenly spaced.  If one ran more than a whole frame
+   // over, start counting again rather than rushing to catch up.
+   if(!deadlineSet)
+   {
+      deadline = now;
+      deadlineSet = true;
+   }
+   else if(now > deadline)
+   {
+      statsLateness += duration_cast<microseconds>(now - deadline).count();
+      if(now - deadline > period)
+         deadline = now;
+   }
+
+   WaitUntil(deadline);
+   Clock::time_point end = Clock::now();
+   statsWaiting += duration_cast<microseconds>(end - now).count();
+   deadline += period;
+
+   StatsUpdate(end);
+}
+
+//------------------------------------------------------------------------------
+
+void FramePacer::WaitUntil(Clock::time_point until)
+{
+   // Sleep for most of it, since that's what saves the power.
+   Clock::time_point wake = until - microseconds(spinMargin);
+   if(Clock::now() < wake)
+   {
+      std::this_thread::sleep_until(wake);
+
+      // Keep the margin a little over the worst recent oversleep.  The worst
+      // falls back slowly, so one bad wake up doesn't keep the margin up
+      // for good.
+      long long oversleep = duration_cast<microseconds>(Clock::now() - wake).count();
+      oversleepWorst -= oversleepWorst / 16;
+      if(oversleep > oversleepWorst)
+         oversleepWorst = oversleep;
+      spinMargin = oversleepWorst + oversleepWorst / 4;
+      if(spinMargin < FRAME_PACER_SPIN_MIN * 1000)
+         spinMargin = FRAME_PACER_SPIN_MIN * 1000;
+      if(spinMargin > FRAME_PACER_SPIN_MAX * 1000)
+         spinMargin = FRAME_PACER_SPIN_MAX * 1000;
+   }
+
+   // Then give up the rest of the time slice until it's time, which lands
+   // much closer than a sleep does.
+   while(Clock::now() < until)
+      std::this_thread::yield();
+}
+
+//------------------------------------------------------------------------------
+
+void FramePacer::StatsUpdate(Clock::time_point now)
+{
+   long long elapsed = duration_cast<microseconds>(now - statsStart).count();
+   if(elapsed < FRAME_PACER_STATS_INTERVAL * 1000)
+      return;
+
+   long long cpu = ProcessCpuTimeGet();
+   float seconds = (float)elapsed / 1000000.0f;
+   stats.frameRate = (float)statsFrames / seconds;
+   stats.drawRate = (float)statsDraws / seconds;
+   stats.mainThreadBusy = 1.0f - (float)statsWaiting / (float)elapsed;
+   stats.processCpu = (float)(cpu - statsCpuStart) / (float)elapsed;
+   stats.lateness = statsFrames ? (float)statsLateness / (1000.0f * statsFrames) : 0.0f;
+
+   statsStart = now;
+   statsCpuStart = cpu;
+   statsFrames = 0;
+   statsDraws = 0;
+   statsWaiting = 0;
+   statsLateness = 0;
+}
+
+//------------------------------------------------------------------------------
+
+long long FramePacer::ProcessCpuTimeGet()
+{
+#ifdef _WIN32
+   FILETIME creation, exit, kernel, user;
+   if(!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+      return 0;
+   // FILETIMEs are in 100 nanosecond units.
+   ULARGE_INTEGER kernelTime, userTime;
+   kernelTime.LowPart = kernel.dwLowDateTime;
+   kernelTime.HighPart = kernel.dwHighDateTime;
+   userTime.LowPart = user.dwLowDateTime;
+   userTime.HighPart = user.dwHighDateTime;
+   return (long long)((kernelTime.QuadPart + userTime.QuadPart) / 10);
+#else
+   struct rusage usage;
+   if(getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+   return (long long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+      usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+}
+
+//------------------------------------------------------------------------------
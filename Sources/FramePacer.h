@@ -0,0 +1,130 @@
+#ifndef __FRAMEPACER_H__
+#define __FRAMEPACER_H__
+
+#include <chrono>
+
+namespace Webfoot {
+
+/// Longest a frame that's being skipped can go without being drawn anyway,
+/// in milliseconds, in case something changed that nobody said so about.
+#define FRAME_PACER_REDRAW_INTERVAL_MAX 250
+/// Milliseconds between updates of the measured rates and CPU use.
+#define FRAME_PACER_STATS_INTERVAL 1000
+/// Range of milliseconds before the end of a frame to stop sleeping and start
+/// yielding instead.  Within it, the margin follows how late sleeps have
+/// been waking up.
+#define FRAME_PACER_SPIN_MIN 1
+#define FRAME_PACER_SPIN_MAX 4
+
+//==============================================================================
+
+/// How fast to run the main loop, chosen from what's on screen.
+enum FramePacePolicy
+{
+   /// A match is being played.  Run as fast as the screen allows.
+   FRAME_PACE_PLAYING,
+   /// Waiting for a key to serve.
+   FRAME_PACE_WAITING,
+   /// The match is over.
+   FRAME_PACE_GAME_OVER,
+   /// The main menu.
+   FRAME_PACE_MENU,
+   FRAME_PACE_COUNT
+};
+
+/// What the FramePacer measured over the last FRAME_PACER_STATS_INTERVAL.
+struct FramePacerStats
+{
+   /// Main loop iterations per second.
+   float frameRate;
+   /// Frames actually drawn per second.
+   float drawRate;
+   /// Fraction of the time the main thread spent on frames rather than
+   /// waiting for the next one.
+   float mainThreadBusy;
+   /// CPU time used by the whole process, including other threads, as a
+   /// fraction of one core.
+   float processCpu;
+   /// Average milliseconds frames ended past when they should have.
+   float lateness;
+};
+
+//==============================================================================
+
+/// Keeps the main loop from running flat out when it doesn't need to.  Each
+/// policy has a target rate, and FrameEnd waits out the rest of each frame
+/// by sleeping until shortly before it's over and yielding for the last bit,
+/// which is much more precise than sleeping the whole way.  Frames where
+/// nothing visible changed don't have to be drawn at all.  This has no
+/// dependency on Frog.
+class FramePacer
+{
+public:
+   FramePacer();
+
+   void Init();
+   void Deinit();
+
+   /// Set how fast to run, usually once a frame by whatever state is showing.
+   void PolicySet(FramePacePolicy _policy) { policy = _policy; }
+   FramePacePolicy PolicyGet() { return policy; }
+   /// Returns the name of 'policy', for showing on screen.
+   static const char* PolicyNameGet(FramePacePolicy policy);
+   /// Returns the frames per second to run at under 'policy', or 0 to not
+   /// wait at all.
+   static int RateGet(FramePacePolicy policy);
+
+   /// Say that something visible has changed, so this frame has to be drawn.
+   void RedrawRequest() { redrawRequested = true; }
+   /// Returns true if this frame should be drawn.  That's when a redraw was
+   /// requested, when the policy doesn't limit the rate, or when it's been
+   /// FRAME_PACER_REDRAW_INTERVAL_MAX since the last one.
+   bool RedrawCheck();
+
+   /// Call this from the main thread at the end of every frame.  Waits until
+   /// it's time for the next one.
+   void FrameEnd();
+
+   const FramePacerStats& StatsGet() { return stats; }
+
+   static FramePacer instance;
+
+protected:
+   typedef std::chrono::steady_clock Clock;
+
+   /// Wait until 'until'.
+   void WaitUntil(Clock::time_point until);
+   /// Update 'stats' if it's been long enough.
+   void StatsUpdate(Clock::time_point now);
+   /// Returns the CPU time the process has used so far, in microseconds.
+   static long long ProcessCpuTimeGet();
+
+   FramePacePolicy policy;
+   bool redrawRequested;
+   Clock::time_point lastDraw;
+
+   /// When the current frame should end, if 'deadlineSet'.
+   Clock::time_point deadline;
+   bool deadlineSet;
+   /// Microseconds before a deadline to stop sleeping.
+   long long spinMargin;
+   /// Most microseconds a sleep has woken up late by, recently.
+   long long oversleepWorst;
+
+   /// Counts since 'statsStart', for working out 'stats'.
+   Clock::time_point statsStart;
+   long long statsCpuStart;
+   int statsFrames;
+   int statsDraws;
+   long long statsWaiting;
+   long long statsLateness;
+   FramePacerStats stats;
+};
+
+FramePacer* const theFramePacer = &FramePacer::instance;
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __FRAMEPACER_H__
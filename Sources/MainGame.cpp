@@ -1,23 +1,96 @@
+#include <cstdio>
+#include <cstring>
 #include "Frog.h"
 #include "MainGame.h"
 #include "MainUpdate.h"
 #include "Paddle.h"
+#include "SpritesAtlas.h"
+#include "AssetPreloader.h"
+#include "Profiler.h"
+#include "FramePacer.h"
+#include "ResourceBlob.h"
 
 
 using namespace Webfoot;
 
-/// Speed of the ball along a given axis in pixels per second.
-#define BALL_AXIS_SPEED 400.0f
-#define BALL_MIN_SPEED 300.0f
-#define BALL_MAX_SPEED 900.0f
-
-// Percentage of how far inward the goal is on the screen.
-#define LEFT_GOAL 0.02f
-#define RIGHT_GOAL 0.98f
-
 // A buffer to give the player some extra space when going for the ball.
 #define GOAL_BUFFER 40
 
+// Number of Duanes in the Duane Storm.
+#define DUANE_STORM_COUNT 10
+
+// Sprite resource file the Duane and number animations come from.
+#define SPRITES_FILE "Sprites/Sprites"
+
+// Folder in Frog's file system that image files are in, for reading them ahead
+// of time.
+#define GRAPHICS_FOLDER "Graphics/"
+
+// Where the most recent match is recorded. Press F5 during a game to play it
+// back.
+#define REPLAY_PATH "LastMatch.replay"
+
+// Number of balls, obstacles and pickups in chaos mode. Press F6 during a game
+// to turn it on.
+#define CHAOS_BALL_COUNT 200
+#define CHAOS_OBSTACLE_COUNT 4
+#define CHAOS_PICKUP_COUNT 8
+// Size the Duanes are drawn at as pickups.
+#define CHAOS_PICKUP_SCALE 0.5f
+
+// Size the Duanes are drawn at as power-ups. The power-ups are this big in the
+// simulation too.
+#define POWER_UP_SCALE 0.5f
+
+// Number of draws the render queue has room for before it has to grow. (The
+// Duane Storm, chaos mode, the power-ups, plus everything else)
+#define RENDER_QUEUE_CAPACITY (DUANE_STORM_COUNT + CHAOS_BALL_COUNT + CHAOS_OBSTACLE_COUNT + CHAOS_PICKUP_COUNT + PONG_POWER_UP_MAX + 16)
+
+// The animated background: how many frames it has, how fast it plays, how many
+// of them are decoded at once, and where and how big it's drawn. These are read
+// from the compiled Sprites.json and background.json, and these are only used
+// if the resource blob is missing.
+#define BACKGROUND_SPRITES_FILE "Graphics/Sprites/Sprites.json"
+#define BACKGROUND_FILE "Graphics/AnimatedBackgrounds/background.json"
+#define BACKGROUND_NAME "AnimatedBackgrounds/bg"
+#define BACKGROUND_FRAME_COUNT 29
+#define BACKGROUND_FRAME_RATE 15
+#define BACKGROUND_RING_SIZE 4
+#define BACKGROUND_OFFSET_X -80.0f
+#define BACKGROUND_OFFSET_Y -70.0f
+#define BACKGROUND_SCALE 1.25f
+
+// Name of the music, and how loud it plays, from 0 to 100.
+#define MUSIC_NAME "Duane's Song"
+#define MUSIC_VOLUME 50
+
+// Online versus. Press F7 during a game to start or stop it. The host listens
+// on NET_PORT and plays on the right. The other copy joins: it listens on the
+// next port up and plays on the left. Each finds the other at
+// NET_PEER_ADDRESS. These are read from "Net" in Consts.json, and these are
+// only used if it isn't there. With the role left on "auto", whichever copy
+// gets NET_PORT first hosts, which only works with both copies on one machine.
+#define NET_PORT 7777
+#define NET_PEER_ADDRESS "127.0.0.1"
+#define NET_ROLE "auto"
+
+// How hard the AI on the left is to beat: "easy", "medium", "hard" or
+// "expert", which also looks ahead. This is read from "Difficulty" in
+// Consts.json.
+#define AI_DIFFICULTY PONG_AI_MEDIUM
+
+// Spectating. Press F8 during a game to start or stop sending it to the relay
+// at BROADCAST_RELAY_ADDRESS and BROADCAST_RELAY_PORT for anyone to watch, and
+// F9 to watch whatever the relay is sending instead of playing.
+#define BROADCAST_RELAY_PORT 7790
+#define BROADCAST_RELAY_ADDRESS "127.0.0.1"
+
+// Where the profiler writes its trace. Press F4 during a game to write it.
+#define PROFILE_TRACE_PATH "Profile.json"
+
+// Milliseconds between refreshes of the profiler's report. Press F3 to show it.
+#define PERF_HUD_REFRESH_INTERVAL 250
+
 // Debug mode
 #define DEBUG_MODE false
 
@@ -26,6 +99,7 @@ MainGame MainGame::instance;
 
 //==============================================================================
 
+
 /// Main GUI
 #define GUI_LAYER_NAME "MainGame"
 
@@ -36,10 +110,24 @@ MainGame::MainGame()
    ball = NULL;
    paddle = NULL;
    aiPaddle = NULL;
-   p1ScoreSprite = NULL;
-   p2ScoreSprite = NULL;
-   music = NULL;
+   spritesAtlas = NULL;
+   musicSound = -1;
    background = NULL;
+   theDuane = NULL;
+   duanePowerUp = NULL;
+   duaneAnimation = NULL;
+   endGameText = NULL;
+   readyText = NULL;
+   winText = NULL;
+   loseText = NULL;
+   perfHud = NULL;
+   perfHudVisible = false;
+   perfHudRefreshTime = 0;
+   chaosMode = false;
+   netMode = false;
+   broadcasting = false;
+   spectating = false;
+   broadcastTick = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -47,13 +135,12 @@ MainGame::MainGame()
 void MainGame::Init()
 {
    Inherited::Init();
-  
-   gameState = STATE_PAUSED;
 
-   powerUpState = PWR_UP_STATE_NONE;
+   // Anything the menu didn't get to preloading gets loaded now, so the loads
+   // below are all quick.
+   theAssetPreloader->Finish();
 
-   rightGoal = theScreen->SizeGet().x * RIGHT_GOAL;
-   leftGoal = theScreen->SizeGet().x * LEFT_GOAL;
+   renderQueue.Init(RENDER_QUEUE_CAPACITY);
 
    // Create and initialize the ball.
    ball = frog_new Ball();
@@ -66,41 +153,77 @@ void MainGame::Init()
    // Create and initialize the AI paddle.
    aiPaddle = frog_new AiPaddle();
    aiPaddle->Init(0, DEBUG_MODE);
-  
-   // Set the positions of the player and AI paddles.
-   // They should be just in front of the goal, with enough space to give the player time to react if the ball has gone a little past the ball. (That's what the GOAL_BUFFER is for)
-   rightPaddlePosition = Point2F::Create(rightGoal - paddle->GetImage()->SizeGet().x - GOAL_BUFFER, (theScreen->SizeGet().y / 2.0f) - (paddle->GetImage()->HeightGet() / 2));
-   leftPaddlePosition = Point2F::Create(leftGoal + GOAL_BUFFER, (theScreen->SizeGet().y / 2.0f) - (aiPaddle->GetImage()->HeightGet() / 2));
-
-   // Set the paddle positions
-   paddle->SetPosition(rightPaddlePosition);
-   aiPaddle->SetPosition(leftPaddlePosition);
-
-   // Create the score sprites
-   p1ScoreSprite = frog_new Sprite();
-   p2ScoreSprite = frog_new Sprite();
-
-   // Initialize the score sprites
-   InitializeScores(rightPaddlePosition, leftPaddlePosition);
-
-   // Initialize the duane storm powerup sprites.
-   for (int i = 0; i < 10; i++){
-	   duaneSprite[i] = frog_new Duane();
-	   duaneSprite[i]->Init();
-   }
+
+   // The Duanes are all drawn from the atlas.
+   duaneAnimation = theAnimationCache->Acquire(SPRITES_FILE, "Duane", &spritesAtlas);
+
+   // Set up the rules of the game for this screen and these images.
+   PongVector paddleSizes[PONG_PADDLE_COUNT];
+   paddleSizes[PONG_PADDLE_LEFT].x = (float)aiPaddle->GetImage()->WidthGet();
+   paddleSizes[PONG_PADDLE_LEFT].y = (float)aiPaddle->GetImage()->HeightGet();
+   paddleSizes[PONG_PADDLE_RIGHT].x = (float)paddle->GetImage()->WidthGet();
+   paddleSizes[PONG_PADDLE_RIGHT].y = (float)paddle->GetImage()->HeightGet();
+   PongConfig config;
+   PongSim::ConfigDefaultsSet(&config, (float)theScreen->WidthGet(), (float)theScreen->HeightGet(),
+      (float)ball->GetImage()->WidthGet(), paddleSizes);
+   config.powerUpSize.x = duaneAnimation->frames[0].sourceWidth * POWER_UP_SCALE;
+   config.powerUpSize.y = duaneAnimation->frames[0].sourceHeight * POWER_UP_SCALE;
+   const char* difficulty = ConstsStringGet(theConsts, "Difficulty", NULL);
+   PongSim::DifficultySet(&config, PONG_PADDLE_LEFT, PongSim::DifficultyFind(difficulty, AI_DIFFICULTY));
+   unsigned int seed = theClock->RandomSeedGet();
+   MatchStart(config, seed);
+
+   // Record the match from the start.
+   replaying = false;
+   replayWriter.Open(REPLAY_PATH, config, seed);
+
+   // Load the overlay text up front. Which one is shown only changes when the
+   // game's state does.
+   readyText = theImages->Load("readytext");
+   winText = theImages->Load("wintext");
+   loseText = theImages->Load("losetext");
+   overlayState = sim.StateGet().gameState;
+   endGameText = readyText;
+
+   // Initialize the score sprites. These only need to be set up once; ResetGame
+   // just puts them back.
+   p1ScoreSprite.Init(SPRITES_FILE, "Numbers");
+   p2ScoreSprite.Init(SPRITES_FILE, "Numbers");
+   const PongVector* paddleStart = sim.ConfigGet().paddleStart;
+   InitializeScores(Point2F::Create(paddleStart[PONG_PADDLE_RIGHT].x, paddleStart[PONG_PADDLE_RIGHT].y),
+      Point2F::Create(paddleStart[PONG_PADDLE_LEFT].x, paddleStart[PONG_PADDLE_LEFT].y));
+
+   // Initialize the duane storm and the powerups that bring it on.
+   duaneStorm.Init(DUANE_STORM_COUNT, (float)theScreen->WidthGet(), (float)theScreen->HeightGet(), TextureAtlas::DurationGet(duaneAnimation), theClock->RandomSeedGet());
 
    // Initialize THE Duane.
    theDuane = frog_new Duane();
    theDuane->Init();
-   
-   // Initialize the background.
-   background = frog_new AnimatedBackground();
-   background->Init("AnimatedBackgrounds/background");
 
-   // Initialize the song playing.
-   music = theSounds->Load("Duane's Song");
-   music->Play(0,true,Sound::USAGE_DEFAULT,50);
+   duanePowerUp = frog_new DuanePowerUp();
+   duanePowerUp->Init(spritesAtlas, duaneAnimation);
    
+   // Initialize the background, the way its sprite and background files
+   // describe it.
+   ResourceNode backgroundSprite = theResources->FileGet(BACKGROUND_SPRITES_FILE).ChildGet("Background");
+   ResourceNode backgroundItem = theResources->FileGet(BACKGROUND_FILE).ChildGet("Items").ChildGet(0);
+   const char* backgroundName = backgroundSprite.ChildGet("Filename").StringGet(BACKGROUND_NAME);
+   char backgroundFolder[256];
+   snprintf(backgroundFolder, sizeof(backgroundFolder), GRAPHICS_FOLDER "%s", backgroundName);
+   char backgroundPath[512];
+   theMainUpdate->FilePathGet(backgroundFolder, backgroundPath, sizeof(backgroundPath));
+   Point2F backgroundOffset = Point2F::Create(BACKGROUND_OFFSET_X, BACKGROUND_OFFSET_Y);
+   backgroundSprite.ChildGet("Offset").PointGet(&backgroundOffset.x, &backgroundOffset.y);
+   Point2F backgroundScale = Point2F::Create(BACKGROUND_SCALE, BACKGROUND_SCALE);
+   backgroundItem.ChildGet("Scale").PointGet(&backgroundScale.x, &backgroundScale.y);
+   background = frog_new StreamingBackground();
+   background->Init(backgroundName, backgroundPath, backgroundSprite.ChildGet("FrameCount").IntGet(BACKGROUND_FRAME_COUNT),
+      backgroundSprite.ChildGet("FrameRate").IntGet(BACKGROUND_FRAME_RATE), BACKGROUND_RING_SIZE, backgroundOffset, backgroundScale);
+
+   // Get the song, which the mixer has been loading on its own thread since it
+   // was preloaded, and get it playing.
+   musicSound = theAudioMixer->SoundAdd(MUSIC_NAME);
+   theAudioMixer->Play(musicSound, true, MUSIC_VOLUME);
 }
 
 //-----------------------------------------------------------------------------
@@ -108,17 +231,23 @@ void MainGame::Init()
 void MainGame::Deinit()
 {
 
-	// Deinitialize the end game text ("WIN" or "LOSE" text)
-	if (endGameText){
-		theImages->Unload(endGameText);
-		endGameText = NULL;
+	// Deinitialize the overlay text ("READY", "WIN" or "LOSE" text)
+	endGameText = NULL;
+	if (loseText){
+		theImages->Unload(loseText);
+		loseText = NULL;
 	}
-
-	// Deinitialize the music
-	if (music){
-		theSounds->Unload(music);
-		music = NULL;
+	if (winText){
+		theImages->Unload(winText);
+		winText = NULL;
+	}
+	if (readyText){
+		theImages->Unload(readyText);
+		readyText = NULL;
 	}
+
+	// Stop the music.  The mixer keeps it loaded for the next game.
+	theAudioMixer->Stop(musicSound);
 	
 	// Deinitialize the animated background
 	if (background){
@@ -134,27 +263,24 @@ void MainGame::Deinit()
 		theDuane = NULL;
 	}
 
-	// Deinitialize all the Duanes
-	for (int i = 0; i < 10; i++){
-		if (duaneSprite[i]){
-			duaneSprite[i]->Deinit();
-			frog_delete duaneSprite[i];
-			duaneSprite[i] = NULL;
-		}
+	// Deinitialize the powerups
+	if (duanePowerUp){
+		duanePowerUp->Deinit();
+		frog_delete duanePowerUp;
+		duanePowerUp = NULL;
 	}
 
-	// Deinitializing the player score sprites
-	if (p2ScoreSprite){
-		p2ScoreSprite->Deinit();
-		frog_delete p2ScoreSprite;
-		p2ScoreSprite = NULL;
+	// Deinitialize all the Duanes
+	duaneStorm.Deinit();
+	if (duaneAnimation){
+		theAnimationCache->Release(duaneAnimation);
+		duaneAnimation = NULL;
 	}
+	spritesAtlas = NULL;
 
-	if (p1ScoreSprite){
-		p1ScoreSprite->Deinit();
-		frog_delete p1ScoreSprite;
-		p1ScoreSprite = NULL;
-	}
+	// Deinitializing the player score sprites
+	p2ScoreSprite.Deinit();
+	p1ScoreSprite.Deinit();
 
    // Deinitialize and delete the ball.
    if(ball)
@@ -179,11 +305,51 @@ void MainGame::Deinit()
    }
  
 
+   replayReader.Close();
+   replayWriter.Close();
+
+   netSession.Deinit();
+   netSocket.Deinit();
+   netMode = false;
+
+   broadcastWriter.Deinit();
+   broadcastViewer.Deinit();
+   broadcastSocket.Deinit();
+   broadcasting = false;
+   spectating = false;
+
+   ChaosStop();
+
+   perfHud = NULL;
+
+   renderQueue.Deinit();
+
    Inherited::Deinit();
 }
 
 //-----------------------------------------------------------------------------
 
+void MainGame::AssetsPreload()
+{
+   // What's needed to draw the first frame comes first. The background isn't
+   // here, since it streams its own frames.
+   theAssetPreloader->ImageAdd("Ball", GRAPHICS_FOLDER "ball.png", 3);
+   theAssetPreloader->ImageAdd("paddle1", GRAPHICS_FOLDER "paddle1.png", 3);
+   theAssetPreloader->ImageAdd("paddle2", GRAPHICS_FOLDER "paddle2.png", 3);
+   theAssetPreloader->ImageAdd("readytext", GRAPHICS_FOLDER "readytext.png", 3);
+   theAssetPreloader->ImageAdd("wintext", GRAPHICS_FOLDER "wintext.png", 2);
+   theAssetPreloader->ImageAdd("losetext", GRAPHICS_FOLDER "losetext.png", 2);
+   for (int i = 0; i < SpritesAtlas.pageCount; i++){
+	   char path[256];
+	   snprintf(path, sizeof(path), GRAPHICS_FOLDER "%s.png", SpritesAtlas.pageNames[i]);
+	   theAssetPreloader->ImageAdd(SpritesAtlas.pageNames[i], path, 2);
+   }
+   // The mixer loads sounds on its own thread as soon as they're added.
+   theAudioMixer->SoundAdd(MUSIC_NAME);
+}
+
+//-----------------------------------------------------------------------------
+
 const char* MainGame::GUILayerNameGet()
 {
    return GUI_LAYER_NAME;
@@ -191,56 +357,184 @@ const char* MainGame::GUILayerNameGet()
 
 //-----------------------------------------------------------------------------
 
+void MainGame::OnGUILayerInit(LayerWidget*)
+{
+   // The profiler's report starts out hidden.
+   perfHud = (LabelWidget*)theGUI->WidgetGetByPath(GUI_LAYER_NAME ".PerfHud");
+   if(perfHud)
+   {
+      perfHud->TextSet("");
+      perfHud->VisibleSet(perfHudVisible);
+   }
+   perfHudRefreshTime = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void MainGame::PerfHudToggle()
+{
+   perfHudVisible = !perfHudVisible;
+   perfHudRefreshTime = 0;
+   if(perfHud)
+      perfHud->VisibleSet(perfHudVisible);
+}
+
+//-----------------------------------------------------------------------------
+
 void MainGame::Update()
 {
    Inherited::Update();
    unsigned int dt = theClock->LoopDurationGet();
 
-   // Update the animated background
+   PROFILE_SCOPE("MainGame::Update");
+
+   // Remember what was on screen, so the frame is only drawn again if something
+   // changed.
+   PongState drawnState = sim.StateGet();
+   bool redraw = false;
+
+   // Update the animated background. THE Duane, the Duane Storm and the
+   // power-ups move on every frame, but they're only drawn again when the
+   // background moves on to its next frame. Whenever the frame rate is capped,
+   // that keeps everything that moves on its own to the background's rate, and
+   // the frames in between are skipped.
+   int backgroundFrame = background->FrameGet();
    background->Update(dt);
+   if (background->FrameGet() != backgroundFrame){
+	   redraw = true;
+   }
 
    // Update THE Duane
    theDuane->Update(dt);
 
+   duanePowerUp->Update(dt);
+
    // Update the Duane Storm only if the power up is active
-   if (powerUpState == PWR_UP_STATE_DUANE){
-	   for (int i = 0; i < 10; i++){
-		   duaneSprite[i]->Update(dt);
-	   }
+   if (DuaneStormActiveCheck()){
+	   PROFILE_SCOPE("DuaneStorm");
+	   duaneStorm.Update(dt);
+   }
+
+   // Run the rules of the game for this frame.
+   unsigned int events;
+   {
+	   PROFILE_SCOPE("Simulation");
+	   events = StepSimulation(dt);
    }
 
-   CheckEndGame();
+   if (broadcasting){
+	   BroadcastSend();
+   }
+
+   if (events & PONG_EVENT_GOAL){
+	   UpdateScores();
+   }
+
+   if (events & PONG_EVENT_RESET){
+	   ResetGame();
+   }
+
+   if (sim.StateGet().gameState != overlayState){
+	   OverlayUpdate();
+   }
 
-   if (gameState == STATE_SCORED || gameState == STATE_PAUSED){
-	   endGameText = theImages->Load("readytext");
-	   if (theKeyboard->KeyJustPressed(KEY_W) || theKeyboard->KeyJustPressed(KEY_S) || theKeyboard->KeyJustPressed(KEY_UP) || theKeyboard->KeyJustPressed(KEY_DOWN)){
-		   endGameText = NULL;
-		   gameState = STATE_PLAYING;
+   // Play back the last match, or go back to playing if a playback is already
+   // going. Online matches aren't recorded.
+   if (!netMode && !spectating && theKeyboard->KeyJustPressed(KEY_F5)){
+	   if (replaying){
+		   ReplayStop();
+	   }
+	   else {
+		   ReplayStart();
 	   }
    }
 
-   // If we're currently playing the game...
-   if (gameState == STATE_PLAYING){
+   // Fill the screen with balls, or go back to just the one.
+   if (theKeyboard->KeyJustPressed(KEY_F6)){
+	   if (chaosMode){
+		   ChaosStop();
+	   }
+	   else {
+		   ChaosStart();
+	   }
+   }
 
-	   ball->Update(dt);
+   // Play someone else online, or go back to playing the AI.
+   if (!spectating && theKeyboard->KeyJustPressed(KEY_F7)){
+	   if (netMode){
+		   NetStop();
+	   }
+	   else {
+		   NetStart();
+	   }
+   }
 
-	   // After we've updated the ball's position, let's check if it's hitting the paddles...
-	   CheckCollision(paddle);
-	   CheckCollision(aiPaddle);
+   // Let others watch this match, or watch someone else's.
+   if (!spectating && theKeyboard->KeyJustPressed(KEY_F8)){
+	   if (broadcasting){
+		   BroadcastStop();
+	   }
+	   else {
+		   BroadcastStart();
+	   }
+   }
+   if (theKeyboard->KeyJustPressed(KEY_F9)){
+	   if (spectating){
+		   SpectateStop();
+	   }
+	   else {
+		   SpectateStart();
+	   }
+   }
 
-	   aiPaddle->Update(dt, ball->GetPosition(), ball->GetVelocity());
-	   // Check to see if the ball has passed the goals.
-	   CheckGoal(dt);
+   // F3 shows where the frame time goes, and F4 writes it all out for
+   // chrome://tracing.
+   if (theKeyboard->KeyJustPressed(KEY_F3)){
+	   PerfHudToggle();
+   }
+   if (theKeyboard->KeyJustPressed(KEY_F4)){
+	   if (!theProfiler->TraceWrite(PROFILE_TRACE_PATH)){
+		   DebugPrintf("Unable to write %s\n", PROFILE_TRACE_PATH);
+	   }
+   }
+   if (perfHudVisible && perfHud){
+	   perfHudRefreshTime -= (int)dt;
+	   if (perfHudRefreshTime <= 0){
+		   char report[1024];
+		   theProfiler->ReportWrite(report, sizeof(report));
+		   perfHud->TextSet(report);
+		   perfHudRefreshTime = PERF_HUD_REFRESH_INTERVAL;
+		   redraw = true;
+	   }
    }
 
-   // Free the player to move unless the game is not paused (they can move even when the state is scored of game over)
-   if (gameState != STATE_PAUSED){
-	   paddle->Update(dt);
+   // Only run flat out while the ball is in play, or while something else that
+   // keeps moving is on. Waiting for a serve or looking at the result doesn't
+   // need more than a few frames a second. The match ending always sets off the
+   // Duane Storm, so the end is checked first; a storm picked up during play
+   // counts as playing while the ball is.
+   const PongState& state = sim.StateGet();
+   if (netMode || spectating || broadcasting || chaosMode){
+	   theFramePacer->PolicySet(FRAME_PACE_PLAYING);
+   }
+   else if (state.gameState == STATE_END){
+	   theFramePacer->PolicySet(FRAME_PACE_GAME_OVER);
+   }
+   else if (state.gameState == STATE_PLAYING){
+	   theFramePacer->PolicySet(FRAME_PACE_PLAYING);
+   }
+   else {
+	   theFramePacer->PolicySet(FRAME_PACE_WAITING);
    }
 
-   // Check for post-game input. Leaving this outside of an if statement
-   // In case of further key presses needing to be called.
-   GetInput();
+   // Anything the simulation moved has to be drawn again, and so does anything
+   // still being drawn between two steps.
+   if (PongSim::VisibleChangeCheck(drawnState, state) || PongSim::VisibleChangeCheck(previousState, state)){
+	   redraw = true;
+   }
+   if (redraw){
+	   theFramePacer->RedrawRequest();
+   }
 
    // Return to the previous menu if the escape key is pressed.
    if(!theStates->StateChangeCheck() && theKeyboard->KeyJustPressed(KEY_ESCAPE))
@@ -255,153 +549,571 @@ void MainGame::Update()
 
 void MainGame::Draw()
 {
-	background->Draw();
+	PROFILE_SCOPE("MainGame::Draw");
 
-	if (powerUpState == PWR_UP_STATE_DUANE){
-		for (int i = 0; i < 10; i++){
-			duaneSprite[i]->Draw();
-		}
+	const PongState& state = sim.StateGet();
+	const PongConfig& config = sim.ConfigGet();
+
+	// Draw between the last two simulation steps by however far we are into the
+	// next one. If the ball was just put back in the middle, there's nothing
+	// sensible in between.
+	float alpha = simAccumulator * PONG_TICK_RATE;
+	if (alpha > 1.0f || !PongSim::ContinuousCheck(previousState, state)){
+		alpha = 1.0f;
 	}
 
-	theDuane->Draw();
+	// Queue everything up, then draw it all sorted by layer.
+	renderQueue.Begin();
 
-	p1ScoreSprite->Draw();
-	p2ScoreSprite->Draw();
+	renderQueue.CallbackAdd(RENDER_LAYER_BACKGROUND, background, BackgroundDraw, background);
+
+	if (DuaneStormActiveCheck()){
+		DrawDuaneStorm();
+	}
 
+	theDuane->Draw(&renderQueue);
 
-	paddle->Draw();
-	aiPaddle->Draw(ball->GetVelocity(),ball->GetPosition());
+	duanePowerUp->Draw(&renderQueue, state.powerUps, PONG_POWER_UP_MAX);
+
+	p1ScoreSprite.Draw(&renderQueue, RENDER_LAYER_SCORES);
+	p2ScoreSprite.Draw(&renderQueue, RENDER_LAYER_SCORES);
+
+	paddle->Draw(&renderQueue, previousState.paddles[PONG_PADDLE_RIGHT], state.paddles[PONG_PADDLE_RIGHT], config, alpha);
+	aiPaddle->Draw(&renderQueue, previousState.paddles[PONG_PADDLE_LEFT], state.paddles[PONG_PADDLE_LEFT], config, alpha);
 	
-	ball->Draw();
+	ball->Draw(&renderQueue, previousState.ball, state.ball, alpha);
+
+	if (chaosMode){
+		DrawChaos(alpha);
+	}
 	
 	if (endGameText){
-		endGameText->Draw(Point2F::Create((theScreen->SizeGet().x / 2) - (endGameText->SizeGet().x / 2), (theScreen->SizeGet().y / 2) - 1.5*(endGameText->SizeGet().y)));
+		renderQueue.ImageAdd(RENDER_LAYER_OVERLAY, endGameText, Point2F::Create((theScreen->SizeGet().x / 2) - (endGameText->SizeGet().x / 2), (theScreen->SizeGet().y / 2) - 1.5*(endGameText->SizeGet().y)));
+	}
+
+	{
+		PROFILE_SCOPE("Submit");
+		renderQueue.Submit();
 	}
+	theProfiler->CounterSet("Draws", renderQueue.DrawCountGet());
+	theProfiler->CounterSet("Batches", renderQueue.BatchCountGet());
 
+	// Debug lines go on top of everything.
 	if (DEBUG_MODE){
+		paddle->DebugDraw(state.paddles[PONG_PADDLE_RIGHT], config);
+		aiPaddle->DebugDraw(state.paddles[PONG_PADDLE_LEFT], config, state.aiPlans[PONG_PADDLE_LEFT]);
+		ball->DebugDraw(state.ball);
 		DebugDrawGoals();
 	}
 }
 
-// This function will check to see if the ball has passed the goal points of both players
-// If it has, it will update the game's state accordingly, and reset the game.
-void MainGame::CheckGoal(unsigned int dt){
+// Draws the background through the render queue.
+void MainGame::BackgroundDraw(void* background){
+	((StreamingBackground*)background)->Draw();
+}
+
+// Starts a new match in the simulation from the given config and seed.
+void MainGame::MatchStart(const PongConfig& config, unsigned int seed){
+	sim.Init(config, seed);
+	previousState = sim.StateGet();
+	simAccumulator = 0.0f;
+	GetInput(&pendingInput);
+	pendingInput.serve = false;
+	pendingInput.restart = false;
+}
+
+// Finishes recording the current match, and starts playing it back from the
+// beginning.
+void MainGame::ReplayStart(){
+	replayWriter.Close();
+	if (!replayReader.Open(REPLAY_PATH)){
+		DebugPrintf("Unable to play back %s\n", REPLAY_PATH);
+		ReplayStop();
+		return;
+	}
+
+	replaying = true;
+	MatchStart(replayReader.ConfigGet(), replayReader.SeedGet());
+	ResetGame();
+	OverlayUpdate();
+}
+
+// Stops playing back, and starts a new match that's recorded.
+void MainGame::ReplayStop(){
+	replayReader.Close();
+	replaying = false;
+
+	unsigned int seed = theClock->RandomSeedGet();
+	MatchStart(sim.ConfigGet(), seed);
+	replayWriter.Open(REPLAY_PATH, sim.ConfigGet(), seed);
+	ResetGame();
+	OverlayUpdate();
+}
+
+// Runs as many fixed-length simulation steps as fit in the time that has
+// passed, carrying the rest over to the next frame. Returns all the PongEvent
+// flags from the steps that were run.
+unsigned int MainGame::StepSimulation(unsigned int dt){
+	const float tickSeconds = 1.0f / PONG_TICK_RATE;
+
+	if (spectating){
+		return StepSpectatorSimulation(dt);
+	}
+
+	// Add this frame's input to what's waiting. Key presses stay until a step
+	// sees them.
+	PongInput input;
+	GetInput(&input);
+	pendingInput.paddleDirection[PONG_PADDLE_LEFT] = input.paddleDirection[PONG_PADDLE_LEFT];
+	pendingInput.paddleDirection[PONG_PADDLE_RIGHT] = input.paddleDirection[PONG_PADDLE_RIGHT];
+	pendingInput.serve = pendingInput.serve || input.serve;
+	pendingInput.restart = pendingInput.restart || input.restart;
+
+	// Don't let a long frame make us run an unbounded number of steps.
+	simAccumulator += (float)dt / 1000.0f;
+	if (simAccumulator > tickSeconds * PONG_MAX_TICKS_PER_FRAME){
+		simAccumulator = tickSeconds * PONG_MAX_TICKS_PER_FRAME;
+	}
+
+	if (netMode){
+		return StepNetSimulation();
+	}
+
+	unsigned int events = PONG_EVENT_NONE;
+	while (simAccumulator >= tickSeconds){
+		// During a playback, the recording stands in for the keyboard.
+		PongInput tickInput = pendingInput;
+		if (replaying && !replayReader.TickGet(&tickInput)){
+			ReplayStop();
+			return events;
+		}
+		replayWriter.TickAdd(tickInput);
+
+		previousState = sim.StateGet();
+		events |= sim.Step(tickInput, tickSeconds);
+		if (chaosMode){
+			chaos.Step(sim.StateGet().paddles, tickSeconds);
+		}
+		if (broadcasting){
+			broadcastWriter.TickAdd(sim.StateGet());
+		}
+		pendingInput.serve = false;
+		pendingInput.restart = false;
+		simAccumulator -= tickSeconds;
+	}
+	return events;
+}
+
+// Runs the steps that fit in the time that has passed for an online match. The
+// session guesses what the other player is doing, so it doesn't have to wait
+// for them, and steps back over anything it guessed wrong once their input
+// arrives. Events from the steps it goes back over aren't returned again, so
+// the scores are also updated whenever it does.
+unsigned int MainGame::StepNetSimulation(){
+	const float tickSeconds = 1.0f / PONG_TICK_RATE;
+	unsigned int events = PONG_EVENT_NONE;
+
+	// Take in everything the other player has sent.
+	netSocket.Update();
+	unsigned char packet[PONG_NET_PACKET_SIZE_MAX];
+	int size;
+	bool started = netSession.StartedCheck();
+	while ((size = netSocket.Receive(packet, sizeof(packet))) > 0){
+		netSession.PacketRead(packet, size);
+	}
+	if (netSession.MismatchCheck()){
+		DebugPrintf("The other player's game doesn't have the same rules.\n");
+		NetStop();
+		return events;
+	}
+	if (!started && netSession.StartedCheck()){
+		previousState = sim.StateGet();
+		simAccumulator = 0.0f;
+		events |= PONG_EVENT_RESET;
+	}
+	if (netSession.Update()){
+		UpdateScores();
+	}
 
-	if (playerScore1 < 10 && playerScore2 < 10){
-		// Check to see if the ball has passed the left player's goal.
-		// If it has, update the right player's score.
-		if (ball->GetPosition().x <= leftGoal){
-			playerScore1++;
-			p1ScoreSprite->TimeSet(30 * (playerScore1+1));
-			if (DEBUG_MODE){
-				DebugPrintf("Player 2 scored! \nP1: %d | P2: %d || %d\n", playerScore1, playerScore2, p1ScoreSprite->TimeGet());
+	// The keyboard always plays this side's paddle.
+	int localPaddle = netSession.LocalPaddleGet();
+	PongInput localInput = pendingInput;
+	localInput.paddleDirection[PONG_PADDLE_COUNT - 1 - localPaddle] = 0;
+	localInput.paddleDirection[localPaddle] = pendingInput.paddleDirection[PONG_PADDLE_RIGHT];
+
+	while (simAccumulator >= tickSeconds){
+		// If we're too far ahead of the other player, this step's time is
+		// dropped so they can catch up.
+		if (netSession.AdvanceCheck()){
+			events |= netSession.Advance(localInput);
+			if (chaosMode){
+				chaos.Step(sim.StateGet().paddles, tickSeconds);
 			}
-			
-			gameState = STATE_SCORED;
-			ResetRound();
+			localInput.serve = false;
+			localInput.restart = false;
+			pendingInput.serve = false;
+			pendingInput.restart = false;
 		}
+		simAccumulator -= tickSeconds;
+	}
+	if (netSession.StartedCheck()){
+		previousState = netSession.PreviousStateGet();
+	}
 
-		// Check to see if the ball has passed the right player's goal.
-		// If it has, update the left player's score.
-		if (ball->GetPosition().x >= rightGoal){
-			playerScore2++;
-			p2ScoreSprite->TimeSet(30 * (playerScore2+1));
-			if (DEBUG_MODE){
-				DebugPrintf("Player 1 scored! \nP1: %d | P2: %d || %d\n", playerScore1, playerScore2, p2ScoreSprite->TimeGet());
+	// Spectators only get the ticks both sides agree on, so they never see a
+	// guess that turned out wrong.
+	if (broadcasting){
+		while (broadcastTick < netSession.ConfirmedTickGet()){
+			broadcastTick++;
+			const PongState* confirmed = netSession.StateAtGet(broadcastTick);
+			if (confirmed){
+				broadcastWriter.TickAdd(*confirmed);
 			}
-			gameState = STATE_SCORED;
-			ResetRound();
 		}
 	}
 
+	// Send our inputs, including any the other player hasn't said they got.
+	size = netSession.PacketWrite(packet, sizeof(packet));
+	netSocket.Send(packet, size);
+	netSocket.Update();
+	return events;
 }
 
-// This function resets the ball, and paddles, and sets the game state back to playing. This is called whenever someone scores.
-void MainGame::ResetRound(){
-	ball->Init();
-	paddle->SetPosition(rightPaddlePosition);
-	aiPaddle->SetPosition(leftPaddlePosition);
-	//gameState = STATE_PLAYING;
+// Starts an online match. Whichever copy of the game gets NET_PORT hosts, and
+// the other joins it.
+void MainGame::NetStart(){
+	if (replaying){
+		replayReader.Close();
+		replaying = false;
+	}
+	replayWriter.Close();
+
+	JSONValue* netConsts = (theConsts && theConsts->ObjectCheck()) ? theConsts->Get("Net") : NULL;
+	const char* peerAddress = ConstsStringGet(netConsts, "PeerAddress", NET_PEER_ADDRESS);
+	const char* role = ConstsStringGet(netConsts, "Role", NET_ROLE);
+	unsigned short port = (unsigned short)ConstsIntGet(netConsts, "Port", NET_PORT);
+
+	// Host if asked to, or on "auto" if nobody else on this machine has the
+	// port yet.
+	bool host = strcmp(role, "join") != 0 && netSocket.Init(port);
+	if (!host && (!strcmp(role, "host") || !netSocket.Init(port + 1))){
+		DebugPrintf("Unable to listen on port %d or %d as %s\n", port, port + 1, role);
+		ReplayStop();
+		return;
+	}
+	if (!netSocket.PeerSet(peerAddress, host ? port + 1 : port)){
+		DebugPrintf("Bad peer address %s\n", peerAddress);
+		netSocket.Deinit();
+		ReplayStop();
+		return;
+	}
+
+	// The match starts once the other player is there. Until then, the game
+	// just waits.
+	netSession.Init(&sim, sim.ConfigGet(), host ? PONG_PADDLE_RIGHT : PONG_PADDLE_LEFT, host, theClock->RandomSeedGet());
+	netMode = true;
+	broadcastTick = 0;
 }
 
-// Resets the game after the max score has been reached.
-void MainGame::ResetGame(){
-	playerScore1 = 0;
-	playerScore2 = 0;
+// Leaves the online match, and starts a new recorded one against the AI.
+void MainGame::NetStop(){
+	netSession.Deinit();
+	netSocket.Deinit();
+	netMode = false;
+
+	PongConfig config = sim.ConfigGet();
+	config.aiControlled[PONG_PADDLE_LEFT] = true;
+	config.aiControlled[PONG_PADDLE_RIGHT] = false;
+	unsigned int seed = theClock->RandomSeedGet();
+	MatchStart(config, seed);
+	replayWriter.Open(REPLAY_PATH, config, seed);
+	ResetGame();
+	OverlayUpdate();
+}
 
-	InitializeScores(rightPaddlePosition, leftPaddlePosition);
+// Shows whatever the relay is sending, a little behind, in place of running the
+// match here. The sim just holds the tick being drawn, and previousState the
+// one before it, so Draw goes between them as usual. The relay doesn't send
+// events, so a goal is worked out from the scores changing.
+unsigned int MainGame::StepSpectatorSimulation(unsigned int dt){
+	unsigned int events = PONG_EVENT_NONE;
+
+	// Take in everything the relay has sent, and keep asking it for more.
+	broadcastSocket.Update();
+	unsigned char packet[PONG_BROADCAST_PACKET_SIZE_MAX];
+	int size;
+	while ((size = broadcastSocket.Receive(packet, sizeof(packet))) > 0){
+		broadcastViewer.PacketRead(packet, size);
+	}
+	broadcastViewer.Update((float)dt / 1000.0f);
+	while ((size = broadcastViewer.PacketWrite(packet, sizeof(packet))) > 0){
+		broadcastSocket.Send(packet, size);
+	}
+	broadcastSocket.Update();
 
-	powerUpState = PWR_UP_STATE_NONE;
+	PongSnapshot previous;
+	PongSnapshot current;
+	float alpha;
+	if (!broadcastViewer.PlaybackGet(&previous, &current, &alpha)){
+		return events;
+	}
 
-	endGameText = NULL;
+	const PongState& shown = sim.StateGet();
+	PongState state = spectatorState;
+	PongSnapshotCoder::Apply(current, &state);
+	if (state.playerScore1 != shown.playerScore1 || state.playerScore2 != shown.playerScore2){
+		events |= PONG_EVENT_GOAL;
+	}
+
+	previousState = spectatorState;
+	PongSnapshotCoder::Apply(previous, &previousState);
+	sim.StateSet(state);
+	simAccumulator = alpha / PONG_TICK_RATE;
+	return events;
+}
+
+// Starts sending every step of the match to the relay, for anyone to watch.
+void MainGame::BroadcastStart(){
+	if (!broadcastSocket.Init(0)){
+		DebugPrintf("Unable to open a socket to broadcast from\n");
+		return;
+	}
+	broadcastSocket.PeerSet(BROADCAST_RELAY_ADDRESS, BROADCAST_RELAY_PORT);
+	broadcastWriter.Init();
+	broadcasting = true;
+	if (netMode){
+		broadcastTick = netSession.ConfirmedTickGet();
+	}
+}
+
+// Stops sending the match to the relay.
+void MainGame::BroadcastStop(){
+	broadcastWriter.Deinit();
+	broadcastSocket.Deinit();
+	broadcasting = false;
+}
+
+// Sends the relay every step taken since the last frame.
+void MainGame::BroadcastSend(){
+	unsigned char packet[PONG_BROADCAST_PACKET_SIZE_MAX];
+	int size;
+	while ((size = broadcastWriter.PacketWrite(packet, sizeof(packet))) > 0){
+		broadcastSocket.Send(packet, size);
+	}
+	broadcastSocket.Update();
+}
 
-	ResetRound();
+// Stops playing, and starts watching whatever match the relay is sending.
+void MainGame::SpectateStart(){
+	if (netMode){
+		NetStop();
+	}
+	if (broadcasting){
+		BroadcastStop();
+	}
+	if (replaying){
+		replayReader.Close();
+		replaying = false;
+	}
+	replayWriter.Close();
+
+	if (!broadcastSocket.Init(0)){
+		DebugPrintf("Unable to open a socket to watch from\n");
+		ReplayStop();
+		return;
+	}
+	broadcastSocket.PeerSet(BROADCAST_RELAY_ADDRESS, BROADCAST_RELAY_PORT);
+	broadcastViewer.Init();
+
+	// Everything the relay doesn't send, like where the paddles are across the
+	// screen, is as a new match has it.
+	MatchStart(sim.ConfigGet(), theClock->RandomSeedGet());
+	spectatorState = sim.StateGet();
+	spectating = true;
+	ResetGame();
+	OverlayUpdate();
+}
+
+// Stops watching, and starts a new recorded match.
+void MainGame::SpectateStop(){
+	unsigned char packet[PONG_BROADCAST_PACKET_SIZE_MAX];
+	int size = PongBroadcastViewer::UnsubscribePacketWrite(packet, sizeof(packet));
+	broadcastSocket.Send(packet, size);
+	broadcastSocket.Update();
+	broadcastViewer.Deinit();
+	broadcastSocket.Deinit();
+	spectating = false;
+	ReplayStop();
+}
+
+// This function updates the score sprites to match the scores kept by the
+// simulation.
+void MainGame::UpdateScores(){
+	const PongState& state = sim.StateGet();
+	p1ScoreSprite.FrameSet(state.playerScore1);
+	p2ScoreSprite.FrameSet(state.playerScore2);
+	if (DEBUG_MODE){
+		DebugPrintf("Goal! \nP1: %d | P2: %d\n", state.playerScore1, state.playerScore2);
+	}
+}
+
+// Resets the sprites after the simulation has started a new game.
+void MainGame::ResetGame(){
+	const PongVector* paddleStart = sim.ConfigGet().paddleStart;
+	InitializeScores(Point2F::Create(paddleStart[PONG_PADDLE_RIGHT].x, paddleStart[PONG_PADDLE_RIGHT].y),
+		Point2F::Create(paddleStart[PONG_PADDLE_LEFT].x, paddleStart[PONG_PADDLE_LEFT].y));
+}
+
+// Queues every Duane in the Duane Storm to be drawn from the atlas.
+void MainGame::DrawDuaneStorm(){
+	const float* positionX = duaneStorm.PositionXGet();
+	const float* positionY = duaneStorm.PositionYGet();
+	const float* scale = duaneStorm.ScaleGet();
+	int count = duaneStorm.CountGet();
+	for (int i = 0; i < count; i++){
+		renderQueue.AtlasFrameAdd(RENDER_LAYER_DUANE_STORM, spritesAtlas, TextureAtlas::FrameGet(duaneAnimation, duaneStorm.AnimationTimeGet(i)),
+			Point2F::Create(positionX[i], positionY[i]), Point2F::Create(scale[i], scale[i]));
+	}
 }
 
 // This function will draw the goals of both players. It will only do so if DEBUG_MODE is true.
 void MainGame::DebugDrawGoals(){
 	if (DEBUG_MODE){
-		theScreen->LineDraw(Point2F::Create(leftGoal, 0.0f), Point2F::Create(leftGoal, theScreen->HeightGet()), COLOR_RGBA8_RED);
-		theScreen->LineDraw(Point2F::Create(rightGoal, 0.0f), Point2F::Create(rightGoal, theScreen->HeightGet()), COLOR_RGBA8_BLUE);
+		const PongConfig& config = sim.ConfigGet();
+		theScreen->LineDraw(Point2F::Create(config.leftGoal, 0.0f), Point2F::Create(config.leftGoal, theScreen->HeightGet()), COLOR_RGBA8_RED);
+		theScreen->LineDraw(Point2F::Create(config.rightGoal, 0.0f), Point2F::Create(config.rightGoal, theScreen->HeightGet()), COLOR_RGBA8_BLUE);
 	}
 }
 
-// This function handles the collision detection between a passed-in paddle, and the ball.
-// This function must be called per-paddle.
-void MainGame::CheckCollision(Paddle *p){
-	float halfBallSize = ball->GetImage()->SizeGet().x / 2;
+// Gets the input for this frame. The player's paddle follows W/S or the arrow
+// keys, any of which also put the ball into play. Once the game is over, R
+// resets the scores and the positions of the balls/paddles.
+void MainGame::GetInput(PongInput* input){
+	input->paddleDirection[PONG_PADDLE_LEFT] = 0;
+	input->paddleDirection[PONG_PADDLE_RIGHT] = 0;
 
-	if (((ball->GetPosition().x - halfBallSize <= p->GetCollisionBox().WidthGet() && ball->GetPosition().x + halfBallSize >= p->GetCollisionBox().x) && (ball->GetPosition().y >= p->GetCollisionBox().y && ball->GetPosition().y <= p->GetCollisionBox().HeightGet())))
-	{
-		if ((p->GetPlayerNumber() == 0 && ball->GetVelocity().x < 0.0f) || (p->GetPlayerNumber() == 1 && ball->GetVelocity().x > 0.0f)){
-			ball->SetVelocity(ball->GetVelocity().x * -1.0f, ball->GetVelocity().y);
-			if (p->GetYVelocity() > 0.8f || p->GetYVelocity() < -0.8f){
-				ball->SetVelocity(ball->GetVelocity() * 1.5f);
-			}
-			else {
-				ball->SetVelocity(ball->GetVelocity() / 1.5f);
-			}
-		}
+	if (theKeyboard->KeyPressed(KEY_S) || theKeyboard->KeyPressed(KEY_DOWN)){
+		input->paddleDirection[PONG_PADDLE_RIGHT] = 1;
+	}
+
+	if (theKeyboard->KeyPressed(KEY_W) || theKeyboard->KeyPressed(KEY_UP)){
+		input->paddleDirection[PONG_PADDLE_RIGHT] = -1;
 	}
+
+	input->serve = theKeyboard->KeyJustPressed(KEY_W) || theKeyboard->KeyJustPressed(KEY_S) || theKeyboard->KeyJustPressed(KEY_UP) || theKeyboard->KeyJustPressed(KEY_DOWN);
+	input->restart = theKeyboard->KeyJustPressed(KEY_R);
 }
 
-// Gets the input. Currently the only purpose is to check if the game is over, and if it is, to reset the scores and the positions of the balls/paddles when the player hits R.
-void MainGame::GetInput(){
-	if (gameState == STATE_END){
-		if (theKeyboard->KeyJustPressed(KEY_R)){
-			ResetGame();
-			gameState = STATE_PLAYING;
+// Turns on chaos mode, with the balls spread out between the paddles, the
+// obstacles around the middle and the pickups scattered about.
+void MainGame::ChaosStart(){
+	const PongConfig& config = sim.ConfigGet();
+	chaos.Init(config, CHAOS_BALL_COUNT, theClock->RandomSeedGet());
+
+	// The obstacles are the size of a paddle, a quarter of the way in from each
+	// corner of the middle.
+	const PongVector& obstacleSize = config.paddleSize[PONG_PADDLE_LEFT];
+	for (int i = 0; i < CHAOS_OBSTACLE_COUNT; i++){
+		float x = config.screenWidth * ((i % 2) ? 0.625f : 0.375f) - obstacleSize.x / 2;
+		float y = config.screenHeight * ((i / 2) ? 0.75f : 0.25f) - obstacleSize.y / 2;
+		PongBox box = {x, y, x + obstacleSize.x, y + obstacleSize.y};
+		chaos.ColliderAdd(PONG_COLLIDER_OBSTACLE, box);
+	}
+
+	const AtlasFrame& duaneFrame = duaneAnimation->frames[0];
+	float pickupWidth = duaneFrame.sourceWidth * CHAOS_PICKUP_SCALE;
+	float pickupHeight = duaneFrame.sourceHeight * CHAOS_PICKUP_SCALE;
+	for (int i = 0; i < CHAOS_PICKUP_COUNT; i++){
+		float x = config.screenWidth * (0.25f + 0.5f * FrogMath::RandomF()) - pickupWidth / 2;
+		float y = (config.screenHeight - pickupHeight) * FrogMath::RandomF();
+		PongBox box = {x, y, x + pickupWidth, y + pickupHeight};
+		chaos.ColliderAdd(PONG_COLLIDER_PICKUP, box);
+	}
+
+	chaosMode = true;
+}
+
+// Turns off chaos mode.
+void MainGame::ChaosStop(){
+	chaos.Deinit();
+	chaosMode = false;
+}
+
+// Queues the balls, obstacles and pickups of chaos mode. The balls are drawn
+// 'alpha' of the way through the last step, like the main ball.
+void MainGame::DrawChaos(float alpha){
+	Image* ballImage = ball->GetImage();
+	Point2F ballOffset = Point2F::Create(ballImage->SizeGet()) / 2.0f;
+	const float* previousX = chaos.PreviousXGet();
+	const float* previousY = chaos.PreviousYGet();
+	const float* positionX = chaos.PositionXGet();
+	const float* positionY = chaos.PositionYGet();
+	int ballCount = chaos.BallCountGet();
+	for (int i = 0; i < ballCount; i++){
+		Point2F position = Point2F::Create(previousX[i] + (positionX[i] - previousX[i]) * alpha, previousY[i] + (positionY[i] - previousY[i]) * alpha);
+		renderQueue.ImageAdd(RENDER_LAYER_BALL, ballImage, position - ballOffset);
+	}
+
+	// The paddles are already drawn.
+	const AtlasFrame* duaneFrame = &duaneAnimation->frames[0];
+	for (int i = 0; i < chaos.ColliderCountGet(); i++){
+		const PongCollider& collider = chaos.ColliderGet(i);
+		if (!collider.active){
+			continue;
+		}
+		if (collider.type == PONG_COLLIDER_OBSTACLE){
+			renderQueue.ImageAdd(RENDER_LAYER_PADDLES, aiPaddle->GetImage(), Point2F::Create(collider.box.minX, collider.box.minY));
+		}
+		else if (collider.type == PONG_COLLIDER_PICKUP){
+			Point2F center = Point2F::Create((collider.box.minX + collider.box.maxX) / 2, (collider.box.minY + collider.box.maxY) / 2);
+			renderQueue.AtlasFrameAdd(RENDER_LAYER_DUANE, spritesAtlas, duaneFrame, center, Point2F::Create(CHAOS_PICKUP_SCALE, CHAOS_PICKUP_SCALE));
 		}
 	}
 }
 
-void MainGame::CheckEndGame(){
-	if (playerScore1 >= 10 || playerScore2 >= 10){
-		powerUpState = PWR_UP_STATE_DUANE;
-		if (playerScore1 >= 10){
-			endGameText = theImages->Load("wintext");
+// Returns true if the Duane Storm is on, from a power-up in the match or a
+// pickup in chaos mode. Pickups don't change the match itself.
+bool MainGame::DuaneStormActiveCheck(){
+	return sim.StateGet().powerUpState == PWR_UP_STATE_DUANE || (chaosMode && chaos.PowerUpStateGet() == PWR_UP_STATE_DUANE);
+}
+
+// Picks which of the preloaded texts to show over the game. Called when the
+// game's state changes.
+void MainGame::OverlayUpdate(){
+	const PongState& state = sim.StateGet();
+	overlayState = state.gameState;
+	if (state.gameState == STATE_END){
+		// The player on the right wins with score 1. Online, the player here
+		// might be on the left.
+		bool won = state.playerScore1 >= sim.ConfigGet().winningScore;
+		if (netMode && netSession.LocalPaddleGet() == PONG_PADDLE_LEFT){
+			won = !won;
+		}
+		if (won){
+			endGameText = winText;
 		}
 		else {
-			endGameText = theImages->Load("losetext");
+			endGameText = loseText;
 		}
-		gameState = STATE_END;
+	}
+	else if (state.gameState == STATE_SCORED || state.gameState == STATE_PAUSED){
+		endGameText = readyText;
+	}
+	else {
+		endGameText = NULL;
 	}
 }
 
 // Initializes the scores. Passing in the paddle positions because we want to make certain the paddle positions exist, rather than assuming they've been defined.
 // We use the paddle positions to set the score sprites relative to the paddle locations.
 void MainGame::InitializeScores(Point2F rightPaddlePos, Point2F leftPaddlePos){
-	// Initialize and position the player score sprites
-	p1ScoreSprite->Init("Sprites/Sprites", "Numbers");
-	p2ScoreSprite->Init("Sprites/Sprites", "Numbers");
-
 	// Setting the sprites position relative to the paddles.
-	p1ScoreSprite->PositionSet((int)rightPaddlePos.x - (2 * GOAL_BUFFER), (2 * GOAL_BUFFER));
-	p2ScoreSprite->PositionSet((int)leftPaddlePos.x + (2 * GOAL_BUFFER) + 20, (2 * GOAL_BUFFER));
+	p1ScoreSprite.PositionSet(Point2F::Create((float)((int)rightPaddlePos.x - (2 * GOAL_BUFFER)), (float)(2 * GOAL_BUFFER)));
+	p2ScoreSprite.PositionSet(Point2F::Create((float)((int)leftPaddlePos.x + (2 * GOAL_BUFFER) + 20), (float)(2 * GOAL_BUFFER)));
 
-	// Have to do this for some reason otherwise the score wont count up immediately.
-	p1ScoreSprite->TimeSet(0);
-	p2ScoreSprite->TimeSet(0);
+	// Both scores start at 0, which is the first frame.
+	p1ScoreSprite.FrameSet(0);
+	p2ScoreSprite.FrameSet(0);
 }
 //==============================================================================
 
@@ -419,28 +1131,6 @@ void Ball::Init()
 	if (!image){
 		image = theImages->Load("Ball");
 	}
-
-	// Start the ball in the middle of the screen.
-	position = Point2F::Create(theScreen->SizeGet() / 2);
-
-	// Randomize a positive or negative value to the ball, so it doesn't always start going in the same direction.
-	float randomx = FrogMath::RandomF() - 0.5f;
-	float randomy = FrogMath::RandomF() - 0.5f;
-	randomx = randomx / std::abs(randomx);
-	randomy = randomy / std::abs(randomy);
-
-	// Randomize an acceleration value to apply to the velocity of the ball.
-	Point2F acceleration = Point2F::Create((FrogMath::RandomF() - 0.5f) * BALL_AXIS_SPEED, (FrogMath::RandomF() - 0.5f) * BALL_AXIS_SPEED);
-
-	// Apply the random direction to the acceleration.
-	acceleration.x = acceleration.x * randomx;
-	acceleration.y = acceleration.y * randomy;
-
-	// Set the ball's initial velocity.
-	velocity.Set(BALL_AXIS_SPEED * randomx, BALL_AXIS_SPEED * randomy);
-
-	// Add the acceleration calculated to the ball's velocity.
-	velocity += acceleration;
 }
 
 //------------------------------------------------------------------------------
@@ -457,82 +1147,22 @@ void Ball::Deinit()
 
 //------------------------------------------------------------------------------
 
-void Ball::Update(unsigned int dt)
+void Ball::Draw(RenderQueue* queue, const PongBall& previous, const PongBall& current, float alpha)
 {
-	// Get a floating point number for the duration of the last frame in seconds.
-	float dtSeconds = (float)dt / 1000.0f;
-
-	// Make sure the velocity never falls below a certain amount. Otherwise the ball goes too slow.
-	if (velocity.x < BALL_MIN_SPEED && velocity.x> 0.0f){
-		velocity.x = BALL_MIN_SPEED;
-	}
-	else if (velocity.x > -BALL_MIN_SPEED && velocity.x < 0.0f){
-		velocity.x = -BALL_MIN_SPEED;
-	}
-	if (velocity.y < BALL_MIN_SPEED && velocity.y > 0.0f){
-		velocity.y = BALL_MIN_SPEED;
-	}
-	else if (velocity.y > -BALL_MIN_SPEED && velocity.y < 0.0f){
-		velocity.y = -BALL_MIN_SPEED;
-	}
+   // The simulation runs at a fixed rate, so draw the ball between its last two
+   // steps.
+   PongVector position = PongSim::Lerp(previous.position, current.position, alpha);
 
-	// Make sure the ball never goes faster than a certain amount
-	if (velocity.x > BALL_MAX_SPEED && velocity.x > 0.0f){
-		velocity.x = BALL_MAX_SPEED;
-	}
-	else if (velocity.x < -BALL_MAX_SPEED && velocity.x < 0.0f){
-		velocity.x = -BALL_MAX_SPEED;
-	}
-	if (velocity.y > BALL_MAX_SPEED && velocity.y > 0.0f){
-		velocity.y = BALL_MAX_SPEED;
-	}
-	else if (velocity.y < -BALL_MAX_SPEED && velocity.y < 0.0f){
-		velocity.y = -BALL_MAX_SPEED;
-	}
-
-   // Update the position of the ball.
-   position += velocity * dtSeconds;
-
-   // The position of the ball corresponds to its center.  We want to keep the
-   // whole ball on-screen, so figure out the area within which the center must
-   // stay.
-   Point2F ballSize = Point2F::Create(image->SizeGet());
-   Point2F halfBallSize = ballSize / 2.0f;
-   Box2F ballArea = {halfBallSize.x, halfBallSize.y,
-      (float)theScreen->WidthGet() - ballSize.x,
-      (float)theScreen->HeightGet() - ballSize.y};
-
-   // If the ball has gone too far in any direction, make sure its velocity
-   // will bring it back.
-
-   // See if it's too far right.
-   if ((position.x > ballArea.MaxXGet()) && (velocity.x > 0.0f)){
-	   velocity.x *= -1.0f;
-   }
-
-   // See if it's too far left.
-   if ((position.x < ballArea.x) && (velocity.x < 0.0f)){
-	   velocity.x *= -1.0f;
-   }
-
-   // See if it's too far down.
-   if ((position.y > ballArea.MaxYGet()) && (velocity.y > 0.0f)){
-	   velocity.y *= -1.0f;
-   }
-
-   // See if it's too far up.
-   if ((position.y < ballArea.y) && (velocity.y < 0.0f)){
-	   velocity.y *= -1.0f;
-   }
-   
+   // The center of the ball is in the center of the image, so use an offset.
+   queue->ImageAdd(RENDER_LAYER_BALL, image, Point2F::Create(position.x, position.y) - (Point2F::Create(image->SizeGet()) / 2.0f));
 }
 
 //------------------------------------------------------------------------------
 
-void Ball::Draw()
+void Ball::DebugDraw(const PongBall& state)
 {
-   // The center of the ball is in the center of the image, so use an offset.
-   image->Draw(position - (Point2F::Create(image->SizeGet()) / 2.0f));
+   Point2F position = Point2F::Create(state.position.x, state.position.y);
+   Point2F velocity = Point2F::Create(state.velocity.x, state.velocity.y);
    if (DEBUG_MODE){
 	   theScreen->LineDraw(Point2F::Create(0.0f, 0.0f), position, COLOR_RGBA8_BLUE, 1.0f, 0.0f);
 	   theScreen->LineDraw(Point2F::Create(0.0f, 0.0f), position + velocity, COLOR_RGBA8_GREEN, 1.0f, 0.0f);
@@ -542,27 +1172,6 @@ void Ball::Draw()
 
 //------------------------------------------------------------------------------
 
-// Returns a Point2F of the ball's position.
-Point2F const Ball::GetPosition(){
-	return position;
-}
-
-// Returns a Point2F of the ball's velocity.
-Point2F const Ball::GetVelocity(){
-	return velocity;
-}
-
-// Sets the ball's velocity to a given x and y float value.
-void Ball::SetVelocity(float x, float y){
-	velocity.x = x;
-	velocity.y = y;
-}
-
-// Sets the ball's velocity to a given Point2F vector. 
-void Ball::SetVelocity(Point2F v){
-	velocity = v;
-}
-
 // Returns the ball's image.
 Image* const Ball::GetImage(){
 	return image;
@@ -571,12 +1180,10 @@ Image* const Ball::GetImage(){
 // ========================================================
 
 Duane::Duane(){
-	sprite = NULL;
+	scale = 1.0f;
 }
 
 void Duane::Init(){
-	sprite = frog_new Sprite();
-
 	position = Point2F::Create(theScreen->SizeGet().x * FrogMath::RandomF(),theScreen->SizeGet().y);
 	velocity = Point2F::Create(0.0f, -100.0f);
 
@@ -584,58 +1191,71 @@ void Duane::Init(){
 	
 	velocity.y /= scale;
 
-	sprite->Init("Sprites/Sprites", "Duane");
-	sprite->VisibleSet(true);
-	sprite->PositionSet(position);
-	sprite->ScaleSet(Point2F::Create(scale,scale));
+	// Every Duane shares the one copy of the animation in the cache.
+	sprite.Init(SPRITES_FILE, "Duane");
+	sprite.PositionSet(position);
+	sprite.ScaleSet(Point2F::Create(scale,scale));
 }
 
 void Duane::Deinit(){
-	sprite->Deinit();
-	frog_delete sprite;
-	sprite = NULL;
+	sprite.Deinit();
 }
 
 void Duane::Update(unsigned int dt){
 	float dtSeconds = (float)dt / 1000.0f;
 
-	sprite->Update(dt);
+	sprite.Update(dt);
 
 	if (position.y <= 0){
 		float pos = std::abs(FrogMath::RandomF() * theScreen->SizeGet().x);
 		scale = FrogMath::RandomF() * 2;
 		position = Point2F::Create(pos, theScreen->SizeGet().y);
-		sprite->ScaleSet(Point2F::Create(scale, scale));
+		sprite.ScaleSet(Point2F::Create(scale, scale));
 		velocity.y = -100.0f / scale;
 	}
 
 	position += velocity * dtSeconds;
 
-	sprite->PositionSet(position);
+	sprite.PositionSet(position);
 }
 
-void Duane::Draw(){
-	sprite->Draw();
+void Duane::Draw(RenderQueue* queue){
+	sprite.Draw(queue, RENDER_LAYER_DUANE);
 }
 
 // ========================================================
-// This feature may go unused.
-// Originally the "Duane Storm" was going to be summoned by the ball hitting a power up on the field. However, I figured it might not be fun, because it only impairs the player and not the AI.
+// The "Duane Storm" is summoned by the ball hitting a power up on the field.
+// The power ups themselves live in PongSim, in a pool of PONG_POWER_UP_MAX, so
+// this just draws whichever ones are out.
 DuanePowerUp::DuanePowerUp(){
-	sprite = NULL;
+	atlas = NULL;
+	animation = NULL;
+	animationTime = 0;
 }
 
-void DuanePowerUp::Draw(){
-	sprite->Draw();
+void DuanePowerUp::Init(TextureAtlas* _atlas, const AtlasAnimation* _animation){
+	atlas = _atlas;
+	animation = _animation;
+	animationTime = 0;
 }
 
-void DuanePowerUp::Update(unsigned int dt, Ball b){
-	
+void DuanePowerUp::Deinit(){
+	atlas = NULL;
+	animation = NULL;
 }
 
-int DuanePowerUp::CheckCollision(Ball b){
-	if ((b.GetPosition().x >= collisionBox.x && b.GetPosition().x <= collisionBox.MaxXGet()) && (b.GetPosition().y >= collisionBox.y && b.GetPosition().y <= collisionBox.MaxYGet())){
-		return 1;
+void DuanePowerUp::Update(unsigned int dt){
+	animationTime = (animationTime + dt) % TextureAtlas::DurationGet(animation);
+}
+
+void DuanePowerUp::Draw(RenderQueue* queue, const PongPowerUp* powerUps, int count){
+	const AtlasFrame* frame = TextureAtlas::FrameGet(animation, animationTime);
+	for (int i = 0; i < count; i++){
+		if (!powerUps[i].active){
+			continue;
+		}
+		const PongBox& box = powerUps[i].box;
+		Point2F center = Point2F::Create((box.minX + box.maxX) / 2, (box.minY + box.maxY) / 2);
+		queue->AtlasFrameAdd(RENDER_LAYER_DUANE, atlas, frame, center, Point2F::Create(POWER_UP_SCALE, POWER_UP_SCALE));
 	}
-	return 0;
 }
\ No newline at end of file
@@ -4,14 +4,22 @@
 #include "Frog.h"
 #include "Paddle.h"
 #include "MenuState.h"
+#include "PongSim.h"
+#include "DuaneStorm.h"
+#include "RenderQueue.h"
+#include "PongReplay.h"
+#include "PongChaos.h"
+#include "StreamingBackground.h"
+#include "AnimationCache.h"
+#include "AudioMixer.h"
+#include "PongNet.h"
+#include "PongBroadcast.h"
 
 namespace Webfoot {
 
-enum State {STATE_PAUSED=0, STATE_PLAYING, STATE_SCORED, STATE_END };
-enum PowerUpState {PWR_UP_STATE_NONE=0, PWR_UP_STATE_DUANE};
-
 class Ball;
 class Duane;
+class DuanePowerUp;
 
 //==============================================================================
 
@@ -31,54 +39,141 @@ public:
    /// Call this on every frame to draw the images.
    virtual void Draw();
 
+   /// Queue everything Init loads with the asset preloader, so it can be
+   /// loaded ahead of time.
+   static void AssetsPreload();
+
    void DebugDrawGoals();
+   void DrawDuaneStorm();
 
    void InitializeScores(Point2F, Point2F);
-   void CheckCollision(Paddle*);
-   void CheckGoal(unsigned int);
-   void CheckEndGame();
-   void ResetRound();
+   void MatchStart(const PongConfig&, unsigned int);
+   unsigned int StepSimulation(unsigned int);
+   unsigned int StepNetSimulation();
+   unsigned int StepSpectatorSimulation(unsigned int);
+   void ReplayStart();
+   void ReplayStop();
+   void ChaosStart();
+   void ChaosStop();
+   void NetStart();
+   void NetStop();
+   void BroadcastStart();
+   void BroadcastStop();
+   void BroadcastSend();
+   void SpectateStart();
+   void SpectateStop();
+   void DrawChaos(float);
+   bool DuaneStormActiveCheck();
+   void UpdateScores();
+   void OverlayUpdate();
    void ResetGame();
-   void GetInput();
+   void GetInput(PongInput*);
 
    static MainGame instance;
 protected:
    /// Returns the name of the GUI layer
    virtual const char* GUILayerNameGet();
+   /// Called when the GUI layer is set up.
+   virtual void OnGUILayerInit(LayerWidget* layer);
+
+   /// Show or hide the profiler's report.
+   void PerfHudToggle();
+
+   /// Draws the background through the render queue.
+   static void BackgroundDraw(void* background);
+
+   /// Everything drawn in a frame goes through here.
+   RenderQueue renderQueue;
+
+   /// The rules of the game.  Everything else here just draws it.
+   PongSim sim;
+   /// State of the simulation before its most recent step, for drawing in
+   /// between steps.
+   PongState previousState;
+   /// Time in seconds that has passed but not yet been simulated.
+   float simAccumulator;
+   /// Records the input for every step of the current match, so it can be
+   /// played back exactly.
+   PongReplayWriter replayWriter;
+   /// Plays back a recorded match in place of the keyboard.
+   PongReplayReader replayReader;
+   bool replaying;
+
+   /// Chaos mode, with hundreds of extra balls, obstacles and pickups.  It
+   /// runs alongside the match and doesn't change it.
+   PongChaos chaos;
+   bool chaosMode;
+
+   /// Online versus, against another copy of the game.  While it's on, the
+   /// session steps 'sim' and both paddles are played from the keyboard, one
+   /// on each side.
+   PongNetSocket netSocket;
+   PongNetSession netSession;
+   bool netMode;
+
+   /// Spectating.  While broadcasting, every step of the match is sent to a
+   /// relay, which sends it on to anyone watching.  While spectating, the
+   /// match comes from the relay instead of being played here, and the sim
+   /// is only used to hold what's drawn.  Both go through 'broadcastSocket'.
+   PongNetSocket broadcastSocket;
+   PongBroadcastWriter broadcastWriter;
+   PongBroadcastViewer broadcastViewer;
+   bool broadcasting;
+   bool spectating;
+   /// Last tick of an online match sent to the relay.
+   unsigned int broadcastTick;
+   /// What's drawn while spectating, apart from what comes from the relay.
+   PongState spectatorState;
+
+   /// Input waiting for the next simulation step.  Key presses are held here
+   /// until a step has seen them, in case a frame is too short to run one.
+   PongInput pendingInput;
 
    /// The ball that bounces around the screen.
    Ball* ball;
    Paddle* paddle;
    AiPaddle* aiPaddle;
-   Duane* duaneSprite[10];
+   /// Frames of the Duane and number animations, all on one texture.  This
+   /// comes from the AnimationCache along with 'duaneAnimation'.
+   TextureAtlas* spritesAtlas;
+
+   /// The Duanes that fill the screen when the game ends, and their animation
+   /// in the atlas.
+   DuaneStorm duaneStorm;
+   const AtlasAnimation* duaneAnimation;
    Duane* theDuane;
-   AnimatedBackground* background;
+   /// Draws the power-ups that bring on the Duane Storm.
+   DuanePowerUp* duanePowerUp;
+   /// The background, which only keeps the frames around the one on screen
+   /// decoded.
+   StreamingBackground* background;
+   /// Text shown over the game ("READY", "WIN" or "LOSE"), or NULL for none.
+   /// This always points at one of the images below.
    Image* endGameText;
-
-   float leftGoal;
-   float rightGoal;
-
-   int playerScore1;
-   int playerScore2;
-
-   Sprite* p1ScoreSprite;
-   Sprite* p2ScoreSprite;
-
-   Point2F leftPaddlePosition;
-   Point2F rightPaddlePosition;
-
-   State gameState;
-   
-   Sound* music;
-
-   PowerUpState powerUpState;
+   Image* readyText;
+   Image* winText;
+   Image* loseText;
+   /// Game state that endGameText was last chosen for.
+   State overlayState;
+
+   AnimationPlayhead p1ScoreSprite;
+   AnimationPlayhead p2ScoreSprite;
+
+   /// The music, as numbered by theAudioMixer.
+   int musicSound;
+
+   /// Label showing the profiler's report, and how long until it's next
+   /// refreshed.
+   LabelWidget* perfHud;
+   bool perfHudVisible;
+   int perfHudRefreshTime;
 };
 
 MainGame* const theMainGame = &MainGame::instance;
 
 //==============================================================================
 
-/// A bouncing ball
+/// Draws the ball.  Where it is and how it moves is up to PongSim.
 class Ball
 {
 public:
@@ -89,32 +184,17 @@ public:
    /// Clean up the ball
    void Deinit();
 
-   /// Make any changes for the given frame.  'dt' is the amount of time that
-   /// has passed since the last frame, in milliseconds.
-   void Update(unsigned int dt);
-   /// Draw the ball.
-   void Draw();
-
-   Point2F const GetPosition();
-   Point2F const GetVelocity();
-
-   void SetVelocity(float, float);
-   void SetVelocity(Point2F);
-
-   void IncrementSpeed(float);
+   /// Queue the ball to be drawn 'alpha' of the way from 'previous' to
+   /// 'current'.
+   void Draw(RenderQueue*, const PongBall& previous, const PongBall& current, float alpha);
+   /// Draw lines showing where the ball is and where it's going.
+   void DebugDraw(const PongBall&);
 
    Image* const GetImage();
 
-   int const LastPlayerHit();
-
 protected:
    /// Appearance of the ball.
    Image* image;
-   /// Current position of the ball.
-   Point2F position;
-   /// Current velocity of the ball.
-   Point2F velocity;
-   int playerHit;
 };
 
 //==============================================================================
@@ -125,26 +205,31 @@ public:
 	void Init();
 	void Deinit();
 	void Update(unsigned int);
-	void Draw();
+	void Draw(RenderQueue*);
 protected:
 	float scale;
-	Sprite* sprite;
+	AnimationPlayhead sprite;
 	Point2F position;
 	Point2F velocity;
 };
 
+/// Draws the power-ups on the field.  Where they are, when they appear and
+/// what happens when the ball touches one is up to PongSim.
 class DuanePowerUp{
 public:
 	DuanePowerUp();
-	void Init();
+	/// Draw the power-ups with 'animation' from 'atlas'.
+	void Init(TextureAtlas* atlas, const AtlasAnimation* animation);
 	void Deinit();
-	void Update(unsigned int, Ball);
-	int CheckCollision(Ball);
-	void Draw();
+	/// Advance the animation.
+	void Update(unsigned int);
+	/// Queue every active power-up in 'powerUps' to be drawn.
+	void Draw(RenderQueue*, const PongPowerUp* powerUps, int count);
 protected:
-	Sprite* sprite;
-	Point2F position;
-	Box2F collisionBox;
+	TextureAtlas* atlas;
+	const AtlasAnimation* animation;
+	/// Milliseconds into the animation.
+	unsigned int animationTime;
 };
 
 } //namespace Webfoot {
@@ -2,12 +2,19 @@
 #include "MainMenu.h"
 #include "MainGame.h"
 #include "MainUpdate.h"
+#include "AssetPreloader.h"
+#include "FramePacer.h"
 
 using namespace Webfoot;
 
 /// Which interface should be shown for this state.
 #define GUI_LAYER_NAME "MainMenu"
 
+/// Milliseconds per frame to spend preloading the game while the menu is idle.
+#define PRELOAD_IDLE_BUDGET 2
+/// Milliseconds per frame to spend preloading the game while fading out.
+#define PRELOAD_TRANSITION_BUDGET 8
+
 MainMenu MainMenu::instance;
 
 //-----------------------------------------------------------------------------
@@ -16,6 +23,10 @@ void MainMenu::Init()
 {
    Inherited::Init();
    exitingGame = false;
+
+   // Start loading the game in the background while the player looks at the
+   // menu.
+   MainGame::AssetsPreload();
 }
 
 //-----------------------------------------------------------------------------
@@ -39,6 +50,24 @@ void MainMenu::Deinit()
 
 //-----------------------------------------------------------------------------
 
+void MainMenu::Update()
+{
+   Inherited::Update();
+
+   // The menu only needs to keep up with the background and the cursor.  The
+   // GUI doesn't say when a button lights up or the cursor moves, so every
+   // frame at that rate is drawn.
+   theFramePacer->PolicySet(FRAME_PACE_MENU);
+   theFramePacer->RedrawRequest();
+
+   // Nothing much happens during the fade out, so get more preloading done
+   // then.
+   if(!theAssetPreloader->DoneCheck())
+      theAssetPreloader->Update(waitingForExitTransition ? PRELOAD_TRANSITION_BUDGET : PRELOAD_IDLE_BUDGET);
+}
+
+//-----------------------------------------------------------------------------
+
 const char* MainMenu::GUILayerNameGet()
 {
    return GUI_LAYER_NAME;
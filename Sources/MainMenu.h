@@ -19,6 +19,7 @@ public:
    virtual void Init();
    virtual void OnGUILayerInit(LayerWidget* layer);
    virtual void Deinit();
+   virtual void Update();
 
    static MainMenu instance;
 
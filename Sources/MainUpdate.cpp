@@ -1,6 +1,14 @@
+#include <cstdio>
 #include "Frog.h"
 #include "MainUpdate.h"
 #include "MainMenu.h"
+#include "AssetPreloader.h"
+#include "AudioMixer.h"
+#include "AnimationCache.h"
+#include "SpritesAtlas.h"
+#include "ResourceBlob.h"
+#include "Profiler.h"
+#include "FramePacer.h"
 
 using namespace Webfoot;
 
@@ -13,10 +21,30 @@ Font* font = NULL;
 
 JSONValue* Webfoot::theConsts;
 
+/// The JSON files, parsed ahead of time by Tools/ResourceCompiler.
+#define RESOURCE_BLOB_FILE "Resources.blob"
+
+//------------------------------------------------------------------------------
+
+const char* Webfoot::ConstsStringGet(JSONValue* object, const char* name, const char* defaultValue)
+{
+   JSONValue* value = (object && object->ObjectCheck()) ? object->Get(name) : NULL;
+   return (value && value->StringCheck()) ? value->StringGet() : defaultValue;
+}
+
+//------------------------------------------------------------------------------
+
+int Webfoot::ConstsIntGet(JSONValue* object, const char* name, int defaultValue)
+{
+   JSONValue* value = (object && object->ObjectCheck()) ? object->Get(name) : NULL;
+   return (value && value->NumberCheck()) ? (int)value->NumberGet() : defaultValue;
+}
+
 //------------------------------------------------------------------------------
 MainUpdate::MainUpdate()
 {
    isExiting = false;
+   snprintf(fileSystemRoot, sizeof(fileSystemRoot), "%s", FILE_SYSTEM_ROOT);
 }
 //------------------------------------------------------------------------------
 
@@ -25,6 +53,19 @@ void MainUpdate::ConstsInit()
    // Load constants that do not depend on the graphics path.
    JSONParser parser;
    theConsts = parser.Load(GAME_CONSTS_FILE);
+   snprintf(fileSystemRoot, sizeof(fileSystemRoot), "%s",
+      ConstsStringGet(theConsts, "FileSystemRoot", FILE_SYSTEM_ROOT));
+
+   // Map the JSON files that Tools/ResourceCompiler has already parsed.  The
+   // game reads the background's settings from here rather than parsing
+   // Sprites.json and background.json again.  If the blob is missing,
+   // whatever reads from it falls back on its defaults.  Opening it only maps
+   // the file and checks its offsets, so this adds next to nothing to
+   // starting up.  Check that it's up to date with "ResourceCompiler --check"
+   // rather than here.
+   char blobPath[512];
+   FilePathGet(RESOURCE_BLOB_FILE, blobPath, sizeof(blobPath));
+   theResources->Open(blobPath);
 }
 
 //------------------------------------------------------------------------------
@@ -32,6 +73,7 @@ void MainUpdate::ConstsInit()
 void MainUpdate::ConstsDeinit()
 {
    SmartDeinitDelete(theConsts);
+   theResources->Deinit();
 }
 
 //------------------------------------------------------------------------------
@@ -39,6 +81,8 @@ void MainUpdate::ConstsDeinit()
 void MainUpdate::Init()
 {
    isExiting = false;
+   theProfiler->Init();
+   theFramePacer->Init();
    theClock->LongLoopNotify();
    theText->Init();
    
@@ -48,12 +92,21 @@ void MainUpdate::Init()
 
    theSprites->Init();
 
+   // The packed sprite atlases, shared by everything that plays their
+   // animations.
+   theAnimationCache->Init();
+   theAnimationCache->AtlasAdd("Sprites/Sprites", &SpritesAtlas);
+
    // Fade in from black
    theFades->Init();
    theFades->ColorSet(COLOR_RGBA8_BLACK);
    theFades->FadeIn();
 
    theAnimatedBackgrounds->Init();
+   theAssetPreloader->Init();
+   // Everything the game does with sounds goes through the mixer's thread from
+   // here on.
+   theAudioMixer->Init();
 
 #if PLATFORM_IS_WINDOWS || PLATFORM_IS_MACOSX
    // Only have a cursor on the PC and Mac
@@ -76,7 +129,10 @@ void MainUpdate::Deinit()
 {
    theStates->Deinit();
    theGUI->Deinit();
+   // Nothing else may touch the sounds until the mixer's thread has stopped.
+   theAudioMixer->Deinit();
    theSounds->MusicStop();
+   theAssetPreloader->Deinit();
    theAnimatedBackgrounds->Deinit();
    SmartDeinitDelete(cursor);
    if(font)
@@ -84,8 +140,11 @@ void MainUpdate::Deinit()
       theFonts->Unload(font);
       font = NULL;
    }
+   theAnimationCache->Deinit();
    theSprites->Deinit();
    theText->Deinit();
+   theFramePacer->Deinit();
+   theProfiler->Deinit();
 }
 
 //------------------------------------------------------------------------------
@@ -102,27 +161,89 @@ void MainUpdate::Deinit()
 void MainUpdate::Update()
 {
    unsigned int dt = theClock->LoopDurationGet();
-   theStates->Update();
 
-   theFades->Update(dt);
-   theAnimatedBackgrounds->Update(dt);
+   // Each phase is timed separately so the profiler can show where the frame
+   // goes.
+   {
+      PROFILE_SCOPE("States");
+      theStates->Update();
+   }
 
-   theGUI->Update(dt);
-   theStates->StateUpdate();
+   {
+      PROFILE_SCOPE("Fades");
+      theFades->Update(dt);
+   }
+   {
+      PROFILE_SCOPE("Backgrounds");
+      theAnimatedBackgrounds->Update(dt);
+   }
 
-   theScreen->PreDraw();
+   {
+      PROFILE_SCOPE("GUI");
+      theGUI->Update(dt);
+   }
+   {
+      PROFILE_SCOPE("StateUpdate");
+      theStates->StateUpdate();
+   }
 
-   // Draw background
-   theAnimatedBackgrounds->Draw();
-   theStates->StateDraw();
-   theGUI->Draw();
+   // Anything in the middle of fading or sliding is changing every frame.
+   if(theFades->FadeActiveCheck() || theGUI->TransitioningCheck() || theStates->StateChangeCheck())
+      theFramePacer->RedrawRequest();
 
-   if(cursor)
-      cursor->Draw();
+   // Frames where nothing visible changed aren't drawn again.
+   if(theFramePacer->RedrawCheck())
+   {
+      {
+         PROFILE_SCOPE("PreDraw");
+         theScreen->PreDraw();
+      }
+
+      {
+         PROFILE_SCOPE("Draw");
+
+         // Draw background
+         theAnimatedBackgrounds->Draw();
+         {
+            PROFILE_SCOPE("StateDraw");
+            theStates->StateDraw();
+         }
+         {
+            PROFILE_SCOPE("GUIDraw");
+            theGUI->Draw();
+         }
+
+         if(cursor)
+            cursor->Draw();
+
+         theFades->Draw();
+      }
+
+      {
+         PROFILE_SCOPE("PostDraw");
+         theScreen->PostDraw();
+      }
+   }
 
-   theFades->Draw();
+   // Wait out the rest of the frame, at whatever rate the state on screen
+   // asked for.
+   {
+      PROFILE_SCOPE("FramePace");
+      theFramePacer->FrameEnd();
+   }
+   const FramePacerStats& paceStats = theFramePacer->StatsGet();
+   theProfiler->CounterSet("Pace Hz", FramePacer::RateGet(theFramePacer->PolicyGet()));
+   theProfiler->CounterSet("Drawn/s", (int)(paceStats.drawRate + 0.5f));
+   theProfiler->CounterSet("CPU %", (int)(paceStats.processCpu * 100.0f + 0.5f));
+
+   theProfiler->FrameEnd();
+}
 
-   theScreen->PostDraw();
+//------------------------------------------------------------------------------
+
+void MainUpdate::FilePathGet(const char* path, char* buffer, int bufferSize)
+{
+   snprintf(buffer, bufferSize, "%s/%s", fileSystemRoot, path);
 }
 
 //------------------------------------------------------------------------------
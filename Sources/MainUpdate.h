@@ -8,6 +8,18 @@ namespace Webfoot {
 /// Misc constants
 extern JSONValue* theConsts;
 
+/// Returns the string 'name' in 'object', which came from Consts.json, or
+/// 'defaultValue' if there isn't one.
+const char* ConstsStringGet(JSONValue* object, const char* name, const char* defaultValue);
+/// Returns the number 'name' in 'object', which came from Consts.json, or
+/// 'defaultValue' if there isn't one.
+int ConstsIntGet(JSONValue* object, const char* name, int defaultValue);
+
+/// Folder Frog's file system is in, relative to the working directory, unless
+/// "FileSystemRoot" in Consts.json says otherwise.  Only code that reads files
+/// itself rather than through Frog needs it.  See MainUpdate::FilePathGet.
+#define FILE_SYSTEM_ROOT "FileSystem"
+
 /// Key for the text to use for the window title and taskbar icon.
 #define WINDOW_TITLE_KEY "WindowTitle"
 
@@ -43,11 +55,19 @@ public:
    /// The platform-specific main loop should check this to see if it should stop looping. 
    bool ExitingCheck() { return isExiting; }
 
+   /// Write where 'path', a file in Frog's file system like
+   /// "Graphics/ball.png", is on disk to 'buffer'.  This is for code that
+   /// reads files itself, like the threads that read them ahead.  Anything
+   /// Frog loads should be loaded by name instead.
+   void FilePathGet(const char* path, char* buffer, int bufferSize);
+
    static MainUpdate instance;
 
 protected:
    /// True if the main loop should stop looping.
    bool isExiting;
+   /// See FILE_SYSTEM_ROOT.
+   char fileSystemRoot[256];
 };
 
 static MainUpdate * const theMainUpdate = &MainUpdate::instance;
@@ -2,42 +2,34 @@
 #define __PADDLE_H__
 
 #include "Frog.h"
+#include "PongSim.h"
+#include "RenderQueue.h"
 
 namespace Webfoot {
 	class AiPaddle;
 
+	/// Draws a paddle.  Where it is and how it moves is up to PongSim.
 	class Paddle {
 	public:
 		Paddle();
 		void Init(int, bool);
 		void Deinit();
-		virtual void Update(unsigned int);
-		void Draw();
-		void DebugDraw();
-		virtual void MovePaddle(unsigned int);
-		void UpdateCollisionBox();
-		bool CanMove(float, float);
+		/// Queue the paddle to be drawn 'alpha' of the way from 'previous' to
+		/// 'current'.
+		void Draw(RenderQueue*, const PongPaddle& previous, const PongPaddle& current, const PongConfig&, float alpha);
+		void DebugDraw(const PongPaddle&, const PongConfig&);
 
 		void SetPlayerNumber(int);
-		void SetPosition(float, float);
-		void SetPosition(Point2F);
 		void SetImage(Image*);
 
-		Box2F const GetCollisionBox();
-		Point2F const GetPosition();
-		float const GetYVelocity();
 		int const GetPlayerNumber();
 		Image* const GetImage();
 
 		bool debug;
 	protected:
-		Box2F collisionBox;
-		Point2F position;
 		Image* image;
 
-		int playerNumber; // 0 = right, 1 = left
-
-		float yVelocity;
+		int playerNumber; // 0 = left, 1 = right
 	};
 
 	class AiPaddle : public Paddle {
@@ -45,10 +37,7 @@ namespace Webfoot {
 		typedef Paddle Inherited;
 
 		AiPaddle();
-		virtual void MovePaddle(unsigned int, Point2F);
-		virtual void Update(unsigned int, Point2F, Point2F);
-		void Draw(Point2F, Point2F);
-		void Test(Point2F velocity, Point2F position);
+		void DebugDraw(const PongPaddle&, const PongConfig&, const PongAiPlan&);
 	};
 } // Namespace
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,494 @@
+#include <cmath>
+#include <cstring>
+#include "PongBroadcast.h"
+
+using namespace Webfoot;
+
+/// Bytes at the start of each frame: type, version, stream, sequence and the
+/// number of ticks.  Each tick follows as its size in a byte, then the
+/// snapshot.
+#define PONG_BROADCAST_FRAME_HEADER_SIZE 8
+/// Bytes in a subscribe, unsubscribe or keyframe request: type and version.
+#define PONG_BROADCAST_SUBSCRIBE_SIZE 2
+/// A tick in the buffer that's empty.
+#define PONG_BROADCAST_TICK_NONE 0xFFFFFFFFu
+/// How much faster or slower than real time playback goes to get back to
+/// PONG_BROADCAST_DELAY_TICKS behind, for each tick it's off by, and at most.
+#define PONG_BROADCAST_CATCH_UP_RATE 0.005
+#define PONG_BROADCAST_CATCH_UP_MAX 0.1
+/// Ticks playback can be off by before it just jumps to where it should be.
+#define PONG_BROADCAST_RESYNC_TICKS PONG_TICK_RATE
+
+/// Fields of a snapshot that move smoothly, so a missing tick can be drawn
+/// part of the way from one to the other.  The rest, including all of the
+/// power-ups', which never move, are taken from the tick before.
+static const bool fieldsContinuous[PONG_SNAPSHOT_POWER_UPS] =
+{
+   true, // PONG_SNAPSHOT_BALL_X
+   true, // PONG_SNAPSHOT_BALL_Y
+   true, // PONG_SNAPSHOT_BALL_VELOCITY_X
+   true, // PONG_SNAPSHOT_BALL_VELOCITY_Y
+   false, // PONG_SNAPSHOT_BALL_PLAYER_HIT
+   true, // PONG_SNAPSHOT_LEFT_PADDLE_Y
+   true, // PONG_SNAPSHOT_RIGHT_PADDLE_Y
+   true, // PONG_SNAPSHOT_LEFT_PADDLE_VELOCITY
+   true, // PONG_SNAPSHOT_RIGHT_PADDLE_VELOCITY
+   false, // PONG_SNAPSHOT_PLAYER_SCORE_1
+   false, // PONG_SNAPSHOT_PLAYER_SCORE_2
+   false, // PONG_SNAPSHOT_GAME_STATE
+   false // PONG_SNAPSHOT_POWER_UP_STATE
+};
+
+//------------------------------------------------------------------------------
+
+/// Write 'value' at 'data' with the low byte first.
+static void U32Write(unsigned char* data, unsigned int value)
+{
+   data[0] = (unsigned char)value;
+   data[1] = (unsigned char)(value >> 8);
+   data[2] = (unsigned char)(value >> 16);
+   data[3] = (unsigned char)(value >> 24);
+}
+
+//------------------------------------------------------------------------------
+
+static unsigned int U32Read(const unsigned char* data)
+{
+   return (unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16) |
+      ((unsigned int)data[3] << 24);
+}
+
+//==============================================================================
+
+PongBroadcastWriter::PongBroadcastWriter()
+{
+   pending = NULL;
+   pendingCount = 0;
+   memset(&keyframe, 0, sizeof(keyframe));
+   keyframeDue = true;
+   lastTick = 0;
+   tickAdded = false;
+   stream = 0;
+   sequence = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastWriter::Init()
+{
+   pending = new PongSnapshot[PONG_BROADCAST_PENDING_MAX];
+   pendingCount = 0;
+   keyframeDue = true;
+   tickAdded = false;
+   sequence = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastWriter::Deinit()
+{
+   delete[] pending;
+   pending = NULL;
+   pendingCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastWriter::TickAdd(const PongState& state)
+{
+   if(!pending)
+      return;
+
+   // If the ticks start again, so does the stream.  Anything not sent yet is
+   // from the old one, and is dropped.
+   if(tickAdded && state.tick != lastTick + 1)
+   {
+      stream++;
+      sequence = 0;
+      pendingCount = 0;
+      keyframeDue = true;
+   }
+   lastTick = state.tick;
+   tickAdded = true;
+
+   // If nothing's been sent in a long time, the viewers will have to start
+   // again anyway.
+   if(pendingCount >= PONG_BROADCAST_PENDING_MAX)
+   {
+      pendingCount = 0;
+      keyframeDue = true;
+   }
+   PongSnapshotCoder::Capture(state, &pending[pendingCount++]);
+}
+
+//------------------------------------------------------------------------------
+
+int PongBroadcastWriter::PacketWrite(unsigned char* buffer, int capacity)
+{
+   if(!pendingCount || capacity < PONG_BROADCAST_FRAME_HEADER_SIZE)
+      return 0;
+
+   int size = PONG_BROADCAST_FRAME_HEADER_SIZE;
+   int count = 0;
+   while(count < pendingCount && count < 255)
+   {
+      const PongSnapshot& snapshot = pending[count];
+      bool key = !count && (keyframeDue || snapshot.tick - keyframe.tick >= PONG_BROADCAST_KEYFRAME_INTERVAL);
+      unsigned char encoded[PONG_SNAPSHOT_SIZE_MAX];
+      int encodedSize = PongSnapshotCoder::Encode(key ? NULL : &keyframe, snapshot, encoded, sizeof(encoded));
+      if(!encodedSize || size + 1 + encodedSize > capacity)
+         break;
+      buffer[size] = (unsigned char)encodedSize;
+      memcpy(&buffer[size + 1], encoded, encodedSize);
+      size += 1 + encodedSize;
+      count++;
+      if(key)
+      {
+         keyframe = snapshot;
+         keyframeDue = false;
+      }
+   }
+   if(!count)
+      return 0;
+
+   buffer[0] = PONG_BROADCAST_PACKET_FRAME;
+   buffer[1] = PONG_BROADCAST_VERSION;
+   buffer[2] = stream;
+   U32Write(&buffer[3], sequence++);
+   buffer[7] = (unsigned char)count;
+
+   pendingCount -= count;
+   memmove(pending, &pending[count], pendingCount * sizeof(PongSnapshot));
+   return size;
+}
+
+//------------------------------------------------------------------------------
+
+int PongBroadcastWriter::PacketTypeGet(const unsigned char* data, int size)
+{
+   if(size < 2 || data[1] != PONG_BROADCAST_VERSION)
+      return 0;
+   if(data[0] == PONG_BROADCAST_PACKET_FRAME && size < PONG_BROADCAST_FRAME_HEADER_SIZE)
+      return 0;
+   return data[0];
+}
+
+//------------------------------------------------------------------------------
+
+bool PongBroadcastWriter::KeyframePacketCheck(const unsigned char* data, int size)
+{
+   if(PacketTypeGet(data, size) != PONG_BROADCAST_PACKET_FRAME || !data[7] || size < PONG_BROADCAST_FRAME_HEADER_SIZE + 1)
+      return false;
+   int encodedSize = data[PONG_BROADCAST_FRAME_HEADER_SIZE];
+   if(PONG_BROADCAST_FRAME_HEADER_SIZE + 1 + encodedSize > size)
+      return false;
+   return PongSnapshotCoder::KeyframeCheck(&data[PONG_BROADCAST_FRAME_HEADER_SIZE + 1], encodedSize);
+}
+
+//==============================================================================
+
+PongBroadcastViewer::PongBroadcastViewer()
+{
+   snapshots = NULL;
+   memset(&keyframe, 0, sizeof(keyframe));
+   keyframeReceived = false;
+   stream = 0;
+   sequenceNext = 0;
+   streamKnown = false;
+   started = false;
+   newestTick = 0;
+   playbackTick = 0.0;
+   subscribeElapsed = PONG_BROADCAST_SUBSCRIBE_INTERVAL;
+   keyframeWanted = false;
+   keyframeRequestElapsed = PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL;
+   memset(&stats, 0, sizeof(stats));
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastViewer::Init()
+{
+   snapshots = new PongSnapshot[PONG_BROADCAST_BUFFER_TICKS];
+   streamKnown = false;
+   subscribeElapsed = PONG_BROADCAST_SUBSCRIBE_INTERVAL;
+   keyframeRequestElapsed = PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL;
+   memset(&stats, 0, sizeof(stats));
+   Clear();
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastViewer::Deinit()
+{
+   delete[] snapshots;
+   snapshots = NULL;
+   started = false;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastViewer::Clear()
+{
+   for(int i = 0; i < PONG_BROADCAST_BUFFER_TICKS; i++)
+      snapshots[i].tick = PONG_BROADCAST_TICK_NONE;
+   keyframeReceived = false;
+   keyframeWanted = false;
+   started = false;
+   newestTick = 0;
+   playbackTick = 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastViewer::PacketRead(const unsigned char* data, int size)
+{
+   if(!snapshots || PongBroadcastWriter::PacketTypeGet(data, size) != PONG_BROADCAST_PACKET_FRAME)
+      return;
+   stats.packetsReceived++;
+
+   // A new stream can only be started from its keyframe.  Until that turns
+   // up, the old one keeps playing.
+   unsigned char packetStream = data[2];
+   unsigned int sequence = U32Read(&data[3]);
+   if(!streamKnown || packetStream != stream)
+   {
+      if(!PongBroadcastWriter::KeyframePacketCheck(data, size))
+      {
+         stats.ticksUndecodable += data[7];
+         keyframeWanted = true;
+         return;
+      }
+      if(streamKnown)
+         stats.resyncCount++;
+      Clear();
+      stream = packetStream;
+      sequenceNext = sequence;
+      streamKnown = true;
+   }
+
+   // A frame that's late may still fill in a gap, but it isn't counted twice.
+   // It may be a keyframe sent again, which is older than what came since.
+   bool late = sequence < sequenceNext;
+   if(!late)
+   {
+      stats.packetsLost += (int)(sequence - sequenceNext);
+      sequenceNext = sequence + 1;
+   }
+
+   int count = data[7];
+   int offset = PONG_BROADCAST_FRAME_HEADER_SIZE;
+   for(int i = 0; i < count; i++)
+   {
+      if(offset >= size)
+         break;
+      int encodedSize = data[offset];
+      const unsigned char* encoded = &data[offset + 1];
+      offset += 1 + encodedSize;
+      if(offset > size)
+         break;
+
+      // Everything but a keyframe is the difference from the last keyframe.
+      // If that was lost, the baseline won't match and it's refused, and the
+      // relay is asked for the keyframe again.  Ticks in a late frame are
+      // from before the keyframe there is, so they don't need asking for.
+      PongSnapshot snapshot;
+      bool key = PongSnapshotCoder::KeyframeCheck(encoded, encodedSize);
+      if((!key && !keyframeReceived) ||
+         !PongSnapshotCoder::Decode(key ? NULL : &keyframe, encoded, encodedSize, &snapshot))
+      {
+         stats.ticksUndecodable++;
+         if(!late)
+            keyframeWanted = true;
+         continue;
+      }
+      if(key)
+      {
+         // A keyframe nowhere near the ticks there are is from a match that
+         // started again without the stream changing, like when another
+         // match takes over the relay.
+         if(started && (snapshot.tick + PONG_BROADCAST_BUFFER_TICKS / 2 < newestTick ||
+            snapshot.tick > newestTick + PONG_BROADCAST_BUFFER_TICKS))
+         {
+            Clear();
+            stats.resyncCount++;
+         }
+         // A keyframe sent again can turn up after a newer one.  What comes
+         // next is the difference from the newer one, so that one stays.
+         if(!keyframeReceived || snapshot.tick >= keyframe.tick)
+         {
+            keyframe = snapshot;
+            keyframeReceived = true;
+            keyframeWanted = false;
+         }
+      }
+      stats.ticksDecoded++;
+
+      if(started && snapshot.tick + PONG_BROADCAST_BUFFER_TICKS <= newestTick)
+         continue;
+      snapshots[snapshot.tick & (PONG_BROADCAST_BUFFER_TICKS - 1)] = snapshot;
+      if(!started)
+      {
+         // Start as far back as there's anything to show.
+         started = true;
+         newestTick = snapshot.tick;
+         playbackTick = snapshot.tick;
+      }
+      else if(snapshot.tick > newestTick)
+      {
+         newestTick = snapshot.tick;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int PongBroadcastViewer::PacketWrite(unsigned char* buffer, int capacity)
+{
+   if(capacity < PONG_BROADCAST_SUBSCRIBE_SIZE)
+      return 0;
+   if(keyframeWanted && keyframeRequestElapsed >= PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL)
+   {
+      keyframeRequestElapsed = 0.0f;
+      stats.keyframesRequested++;
+      buffer[0] = PONG_BROADCAST_PACKET_KEYFRAME_REQUEST;
+      buffer[1] = PONG_BROADCAST_VERSION;
+      return PONG_BROADCAST_SUBSCRIBE_SIZE;
+   }
+   if(subscribeElapsed < PONG_BROADCAST_SUBSCRIBE_INTERVAL)
+      return 0;
+   subscribeElapsed = 0.0f;
+   buffer[0] = PONG_BROADCAST_PACKET_SUBSCRIBE;
+   buffer[1] = PONG_BROADCAST_VERSION;
+   return PONG_BROADCAST_SUBSCRIBE_SIZE;
+}
+
+//------------------------------------------------------------------------------
+
+int PongBroadcastViewer::UnsubscribePacketWrite(unsigned char* buffer, int capacity)
+{
+   if(capacity < PONG_BROADCAST_SUBSCRIBE_SIZE)
+      return 0;
+   buffer[0] = PONG_BROADCAST_PACKET_UNSUBSCRIBE;
+   buffer[1] = PONG_BROADCAST_VERSION;
+   return PONG_BROADCAST_SUBSCRIBE_SIZE;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastViewer::Update(float seconds)
+{
+   subscribeElapsed += seconds;
+   keyframeRequestElapsed += seconds;
+   if(!started)
+      return;
+
+   // Aim for a little behind the newest tick, speeding up or slowing down a
+   // bit to get there, unless it's so far off that it's better to jump.
+   double target = (double)newestTick - PONG_BROADCAST_DELAY_TICKS;
+   double error = target - playbackTick;
+   double previousTick = playbackTick;
+   if(fabs(error) > PONG_BROADCAST_RESYNC_TICKS)
+   {
+      playbackTick = target;
+      stats.resyncCount++;
+      return;
+   }
+   double rate = 1.0 + error * PONG_BROADCAST_CATCH_UP_RATE;
+   if(rate > 1.0 + PONG_BROADCAST_CATCH_UP_MAX)
+      rate = 1.0 + PONG_BROADCAST_CATCH_UP_MAX;
+   else if(rate < 1.0 - PONG_BROADCAST_CATCH_UP_MAX)
+      rate = 1.0 - PONG_BROADCAST_CATCH_UP_MAX;
+   playbackTick += seconds * PONG_TICK_RATE * rate;
+   if(playbackTick > newestTick)
+   {
+      playbackTick = newestTick;
+      stats.stallCount++;
+   }
+
+   for(unsigned int tickIndex = (unsigned int)previousTick + 1; tickIndex <= (unsigned int)playbackTick; tickIndex++)
+   {
+      if(!SnapshotGet(tickIndex))
+         stats.ticksFilled++;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool PongBroadcastViewer::PlaybackGet(PongSnapshot* previous, PongSnapshot* current, float* alpha) const
+{
+   if(!started)
+      return false;
+   unsigned int tickIndex = (unsigned int)playbackTick;
+   SnapshotAtGet(tickIndex, previous);
+   if(tickIndex < newestTick)
+   {
+      SnapshotAtGet(tickIndex + 1, current);
+      *alpha = (float)(playbackTick - tickIndex);
+   }
+   else
+   {
+      *current = *previous;
+      *alpha = 0.0f;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+const PongSnapshot* PongBroadcastViewer::SnapshotGet(unsigned int tickIndex) const
+{
+   if(!snapshots)
+      return NULL;
+   const PongSnapshot* snapshot = &snapshots[tickIndex & (PONG_BROADCAST_BUFFER_TICKS - 1)];
+   return snapshot->tick == tickIndex ? snapshot : NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void PongBroadcastViewer::SnapshotAtGet(unsigned int tickIndex, PongSnapshot* snapshot) const
+{
+   const PongSnapshot* exact = SnapshotGet(tickIndex);
+   if(exact)
+   {
+      *snapshot = *exact;
+      return;
+   }
+
+   // Find the nearest ticks there are on either side.
+   const PongSnapshot* before = NULL;
+   const PongSnapshot* after = NULL;
+   for(unsigned int i = 1; i <= PONG_BROADCAST_FILL_MAX && !before && i <= tickIndex; i++)
+      before = SnapshotGet(tickIndex - i);
+   for(unsigned int i = 1; i <= PONG_BROADCAST_FILL_MAX && !after && tickIndex + i <= newestTick; i++)
+      after = SnapshotGet(tickIndex + i);
+
+   if(!before)
+   {
+      // Nothing to go on but what comes next, if even that.
+      if(after)
+         *snapshot = *after;
+      else
+         memset(snapshot, 0, sizeof(*snapshot));
+      snapshot->tick = tickIndex;
+      return;
+   }
+
+   *snapshot = *before;
+   snapshot->tick = tickIndex;
+   // Drawing in between only makes sense if nothing jumped, like the ball
+   // going back to the middle after a goal.
+   if(!after || after->fields[PONG_SNAPSHOT_PLAYER_SCORE_1] != before->fields[PONG_SNAPSHOT_PLAYER_SCORE_1] ||
+      after->fields[PONG_SNAPSHOT_PLAYER_SCORE_2] != before->fields[PONG_SNAPSHOT_PLAYER_SCORE_2] ||
+      after->fields[PONG_SNAPSHOT_GAME_STATE] != before->fields[PONG_SNAPSHOT_GAME_STATE])
+   {
+      return;
+   }
+   float fraction = (float)(tickIndex - before->tick) / (float)(after->tick - before->tick);
+   for(int i = 0; i < PONG_SNAPSHOT_POWER_UPS; i++)
+   {
+      if(fieldsContinuous[i])
+         snapshot->fields[i] = before->fields[i] + (int)floorf((after->fields[i] - before->fields[i]) * fraction + 0.5f);
+   }
+}
+
+//==============================================================================
@@ -0,0 +1,192 @@
+#ifndef __PONGBROADCAST_H__
+#define __PONGBROADCAST_H__
+
+#include "PongNet.h"
+#include "PongSnapshot.h"
+
+namespace Webfoot {
+
+/// Changes whenever the packets do.  Packets from any other version are
+/// ignored.
+#define PONG_BROADCAST_VERSION 2
+/// Largest packet.  Small enough to go through a PongNetSocket.
+#define PONG_BROADCAST_PACKET_SIZE_MAX PONG_NET_PACKET_SIZE_MAX
+/// First byte of each packet.  Frames go from the match to the relay and
+/// from the relay to the viewers, unchanged.  Viewers send subscribes to the
+/// relay every PONG_BROADCAST_SUBSCRIBE_INTERVAL seconds for as long as
+/// they're watching, and an unsubscribe when they stop.  A viewer that gets
+/// ticks it can't decode because their keyframe was lost asks the relay to
+/// send the last keyframe again, at most every
+/// PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL seconds until it gets one.
+#define PONG_BROADCAST_PACKET_FRAME 1
+#define PONG_BROADCAST_PACKET_SUBSCRIBE 2
+#define PONG_BROADCAST_PACKET_UNSUBSCRIBE 3
+#define PONG_BROADCAST_PACKET_KEYFRAME_REQUEST 4
+#define PONG_BROADCAST_SUBSCRIBE_INTERVAL 1.0f
+#define PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL 0.05f
+/// Ticks between keyframes.  Every other tick is sent as the difference from
+/// the last keyframe, so a viewer that just turned up can start from the
+/// next one.  One that lost a keyframe asks for it again rather than wait.
+#define PONG_BROADCAST_KEYFRAME_INTERVAL (PONG_TICK_RATE / 2)
+/// Most ticks the writer holds on to between packets.
+#define PONG_BROADCAST_PENDING_MAX 64
+/// Ticks a viewer keeps.  Must be a power of 2.
+#define PONG_BROADCAST_BUFFER_TICKS 512
+/// Ticks a viewer shows behind the newest it has, so a late or lost packet
+/// doesn't make the match stop.  At PONG_TICK_RATE, 30 ticks is 125 ms.
+#define PONG_BROADCAST_DELAY_TICKS (PONG_TICK_RATE / 8)
+/// Most ticks a viewer draws in between on its own when some are missing.
+/// Past this, it holds the last one it has.
+#define PONG_BROADCAST_FILL_MAX (PONG_TICK_RATE / 4)
+
+//==============================================================================
+
+/// Turns a match, tick by tick, into frame packets for spectators.  Each
+/// tick is a PongSnapshot, encoded as the difference from the last keyframe,
+/// and a packet holds all of the ticks since the one before, usually the 4
+/// of one frame at 60 Hz.  A keyframe always starts a packet, so the relay
+/// can tell where a new viewer can start.  The match is never sent back
+/// into, so one writer can have any number of viewers.  This has no
+/// dependency on Frog.
+class PongBroadcastWriter
+{
+public:
+   PongBroadcastWriter();
+
+   void Init();
+   void Deinit();
+
+   /// Add the state after a step.  If it isn't the tick after the last one,
+   /// like when a new match starts, the viewers start again from it.
+   void TickAdd(const PongState& state);
+   /// Fill in 'buffer' with a frame holding as many of the ticks added since
+   /// the last one as fit.  Returns its size, or 0 if there aren't any.  Call
+   /// this until it returns 0 to send all of them.
+   int PacketWrite(unsigned char* buffer, int capacity);
+
+   /// Returns the type of the packet in 'data', or 0 if it isn't a broadcast
+   /// packet of this version.
+   static int PacketTypeGet(const unsigned char* data, int size);
+   /// Returns true if 'data' is a frame that starts with a keyframe, which a
+   /// new viewer can start from.
+   static bool KeyframePacketCheck(const unsigned char* data, int size);
+
+protected:
+   /// Ticks waiting for the next packet, oldest first.
+   PongSnapshot* pending;
+   int pendingCount;
+   /// The last keyframe, which everything else is sent as the difference
+   /// from, and whether it's time for another.
+   PongSnapshot keyframe;
+   bool keyframeDue;
+   /// The last tick added, if 'tickAdded'.
+   unsigned int lastTick;
+   bool tickAdded;
+   /// Changes when the ticks start again, so viewers know to as well.
+   unsigned char stream;
+   /// Packets written so far in this stream.
+   unsigned int sequence;
+};
+
+//==============================================================================
+
+/// What a PongBroadcastViewer has been up to, for seeing how well the
+/// stream is holding up.
+struct PongBroadcastStats
+{
+   /// Frames read, and frames that never turned up.
+   int packetsReceived;
+   int packetsLost;
+   /// Ticks decoded, and ticks thrown away because the keyframe they were
+   /// the difference from was lost.
+   int ticksDecoded;
+   int ticksUndecodable;
+   /// Ticks that were shown without having arrived, by drawing in between
+   /// the ones on either side.
+   int ticksFilled;
+   /// Times the last keyframe was asked for again.
+   int keyframesRequested;
+   /// Times the playback caught up to the newest tick and had to wait, and
+   /// times it was so far off that it jumped.
+   int stallCount;
+   int resyncCount;
+};
+
+/// Watches a match sent by a PongBroadcastWriter.  Ticks are kept as they
+/// arrive, and played back a little behind the newest, at whatever rate
+/// the frames are drawn at.  Playback speeds up or slows down a little to
+/// stay PONG_BROADCAST_DELAY_TICKS behind.  Ticks lost along the way are
+/// drawn in between the ones on either side.  This has no dependency on
+/// Frog.
+class PongBroadcastViewer
+{
+public:
+   PongBroadcastViewer();
+
+   void Init();
+   void Deinit();
+
+   /// Read a packet from the relay.
+   void PacketRead(const unsigned char* data, int size);
+   /// Fill in 'buffer' with a keyframe request or a subscribe, if it's time
+   /// to send one.  Returns its size, or 0 if not.  Call this until it
+   /// returns 0 to send everything that's due.
+   int PacketWrite(unsigned char* buffer, int capacity);
+   /// Fill in 'buffer' with an unsubscribe, to send when done watching.
+   /// Returns its size.
+   static int UnsubscribePacketWrite(unsigned char* buffer, int capacity);
+
+   /// Move the playback on by 'seconds'.
+   void Update(float seconds);
+   /// Fill in the ticks either side of the playback, and how far it is from
+   /// 'previous' to 'current'.  Returns false if there's nothing to show
+   /// yet.
+   bool PlaybackGet(PongSnapshot* previous, PongSnapshot* current, float* alpha) const;
+
+   /// Returns true once the first keyframe has arrived.
+   bool StartedCheck() const { return started; }
+   /// Returns the snapshot of 'tickIndex' as it arrived, or NULL if it
+   /// didn't or is too old.
+   const PongSnapshot* SnapshotGet(unsigned int tickIndex) const;
+   /// Returns the newest tick there is, and the tick being shown.
+   unsigned int NewestTickGet() const { return newestTick; }
+   double PlaybackTickGet() const { return playbackTick; }
+   const PongBroadcastStats& StatsGet() const { return stats; }
+
+protected:
+   /// Fill in 'snapshot' for 'tickIndex', drawing it in between the nearest
+   /// ticks there are if it didn't arrive.
+   void SnapshotAtGet(unsigned int tickIndex, PongSnapshot* snapshot) const;
+   /// Forget every tick, to start again from the next keyframe.
+   void Clear();
+
+   /// 'snapshots[t % PONG_BROADCAST_BUFFER_TICKS]' is tick 't', if its tick
+   /// says so.
+   PongSnapshot* snapshots;
+   /// The last keyframe.
+   PongSnapshot keyframe;
+   bool keyframeReceived;
+   /// The stream being watched, and the next frame expected from it.
+   unsigned char stream;
+   unsigned int sequenceNext;
+   bool streamKnown;
+
+   bool started;
+   unsigned int newestTick;
+   double playbackTick;
+   /// Seconds since the last subscribe, or a large number to send one right
+   /// away.
+   float subscribeElapsed;
+   /// Whether ticks have come in that need a keyframe that was lost, and
+   /// seconds since it was last asked for.
+   bool keyframeWanted;
+   float keyframeRequestElapsed;
+
+   PongBroadcastStats stats;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGBROADCAST_H__
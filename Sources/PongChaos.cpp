@@ -0,0 +1,496 @@
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "PongChaos.h"
+
+using namespace Webfoot;
+
+/// Smallest the cells of the grid can be, so tiny balls don't make for a
+/// huge grid.
+#define CHAOS_CELL_SIZE_MIN 16.0f
+/// Most things a ball can bounce off of in one step.
+#define CHAOS_BOUNCE_MAX 4
+/// Seconds a collected pickup stays gone.
+#define CHAOS_PICKUP_RESPAWN_TIME 2.0f
+/// Fraction of the width of the screen, around the middle, that pickups come
+/// back in.
+#define CHAOS_PICKUP_AREA 0.5f
+
+//------------------------------------------------------------------------------
+
+PongChaos::PongChaos()
+{
+   ballCount = 0;
+   positionX = NULL;
+   positionY = NULL;
+   velocityX = NULL;
+   velocityY = NULL;
+   previousX = NULL;
+   previousY = NULL;
+   ballCells = NULL;
+   colliderCount = 0;
+   cellSize = CHAOS_CELL_SIZE_MIN;
+   columnCount = 0;
+   rowCount = 0;
+   cellCount = 0;
+   cellBallStarts = NULL;
+   cellBalls = NULL;
+   cellColliderStarts = NULL;
+   cellColliders = NULL;
+   cellColliderCapacity = 0;
+   cellCursors = NULL;
+   memset(&stats, 0, sizeof(stats));
+   randomState = 1;
+   powerUpState = PWR_UP_STATE_NONE;
+   powerUpEffectRemaining = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::Init(const PongConfig& _config, int _ballCount, unsigned int seed)
+{
+   Deinit();
+
+   config = _config;
+   ballCount = _ballCount > 0 ? _ballCount : 0;
+   randomState = seed ? seed : 1;
+
+   positionX = new float[ballCount];
+   positionY = new float[ballCount];
+   velocityX = new float[ballCount];
+   velocityY = new float[ballCount];
+   previousX = new float[ballCount];
+   previousY = new float[ballCount];
+   ballCells = new int[ballCount];
+
+   // Balls only need to be checked against balls in the cells next to
+   // theirs, as long as a cell is at least as big as a ball.
+   cellSize = config.ballSize * 2.0f;
+   if(cellSize < CHAOS_CELL_SIZE_MIN)
+      cellSize = CHAOS_CELL_SIZE_MIN;
+   columnCount = (int)ceilf(config.screenWidth / cellSize);
+   rowCount = (int)ceilf(config.screenHeight / cellSize);
+   if(columnCount < 1)
+      columnCount = 1;
+   if(rowCount < 1)
+      rowCount = 1;
+   cellCount = columnCount * rowCount;
+   cellBallStarts = new int[cellCount + 1];
+   cellBalls = new int[ballCount];
+   cellColliderStarts = new int[cellCount + 1];
+   cellCursors = new int[cellCount];
+   cellColliderCapacity = 0;
+
+   for(int i = 0; i < ballCount; i++)
+   {
+      BallServe(i);
+      // Start them spread out between the paddles rather than all on top of
+      // each other.
+      positionX[i] = config.screenWidth * (0.25f + 0.5f * PongSim::RandomF(&randomState));
+      positionY[i] = config.screenHeight * PongSim::RandomF(&randomState);
+      previousX[i] = positionX[i];
+      previousY[i] = positionY[i];
+   }
+
+   colliderCount = 0;
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      PongCollider& collider = colliders[colliderCount++];
+      collider.box.minX = config.paddleStart[i].x;
+      collider.box.minY = config.paddleStart[i].y;
+      collider.box.maxX = config.paddleStart[i].x + config.paddleSize[i].x;
+      collider.box.maxY = config.paddleStart[i].y + config.paddleSize[i].y;
+      collider.type = PONG_COLLIDER_PADDLE;
+      collider.paddle = i;
+      collider.active = true;
+      collider.respawnRemaining = 0.0f;
+   }
+
+   memset(&stats, 0, sizeof(stats));
+   powerUpState = PWR_UP_STATE_NONE;
+   powerUpEffectRemaining = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::Deinit()
+{
+   delete[] positionX;
+   delete[] positionY;
+   delete[] velocityX;
+   delete[] velocityY;
+   delete[] previousX;
+   delete[] previousY;
+   delete[] ballCells;
+   delete[] cellBallStarts;
+   delete[] cellBalls;
+   delete[] cellColliderStarts;
+   delete[] cellColliders;
+   delete[] cellCursors;
+   positionX = NULL;
+   positionY = NULL;
+   velocityX = NULL;
+   velocityY = NULL;
+   previousX = NULL;
+   previousY = NULL;
+   ballCells = NULL;
+   cellBallStarts = NULL;
+   cellBalls = NULL;
+   cellColliderStarts = NULL;
+   cellColliders = NULL;
+   cellCursors = NULL;
+   cellColliderCapacity = 0;
+   ballCount = 0;
+   colliderCount = 0;
+   cellCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+int PongChaos::ColliderAdd(PongColliderType type, const PongBox& box)
+{
+   if(colliderCount >= PONG_CHAOS_COLLIDER_MAX)
+      return -1;
+
+   PongCollider& collider = colliders[colliderCount];
+   collider.box = box;
+   collider.type = type;
+   collider.paddle = -1;
+   collider.active = true;
+   collider.respawnRemaining = 0.0f;
+   return colliderCount++;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::Step(const PongPaddle* paddles, float dtSeconds)
+{
+   memset(&stats, 0, sizeof(stats));
+   memcpy(previousX, positionX, ballCount * sizeof(float));
+   memcpy(previousY, positionY, ballCount * sizeof(float));
+
+   for(int i = 0; i < colliderCount; i++)
+   {
+      if(colliders[i].type == PONG_COLLIDER_PADDLE)
+         colliders[i].box = PongSim::PaddleBoxGet(paddles[colliders[i].paddle], config);
+   }
+   PickupsUpdate(dtSeconds);
+
+   BallGridBuild();
+   BallsCollide();
+
+   // A ball can't get further than this from its center in a step, even if a
+   // paddle speeds it up along the way.
+   float margin = config.ballSize / 2 + config.ballMaxSpeed * PONG_PADDLE_HIT_SPEED_FACTOR * dtSeconds;
+   ColliderGridBuild(margin);
+   for(int i = 0; i < ballCount; i++)
+      BallMove(i, paddles, dtSeconds);
+}
+
+//------------------------------------------------------------------------------
+
+int PongChaos::CellGet(float x, float y) const
+{
+   int column = (int)(x / cellSize);
+   int row = (int)(y / cellSize);
+   column = column < 0 ? 0 : (column >= columnCount ? columnCount - 1 : column);
+   row = row < 0 ? 0 : (row >= rowCount ? rowCount - 1 : row);
+   return row * columnCount + column;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::BallGridBuild()
+{
+   // Count the balls in each cell, add the counts up to find where each
+   // cell's balls start, then put each ball in its place.
+   memset(cellBallStarts, 0, (cellCount + 1) * sizeof(int));
+   for(int i = 0; i < ballCount; i++)
+   {
+      ballCells[i] = CellGet(positionX[i], positionY[i]);
+      cellBallStarts[ballCells[i] + 1]++;
+   }
+   for(int cell = 0; cell < cellCount; cell++)
+      cellBallStarts[cell + 1] += cellBallStarts[cell];
+
+   memcpy(cellCursors, cellBallStarts, cellCount * sizeof(int));
+   for(int i = 0; i < ballCount; i++)
+      cellBalls[cellCursors[ballCells[i]]++] = i;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::ColliderGridBuild(float margin)
+{
+   // Same as BallGridBuild, except a collider goes in every cell it could
+   // reach a ball in, so each ball only has to look in its own cell.
+   memset(cellColliderStarts, 0, (cellCount + 1) * sizeof(int));
+   int entryCount = 0;
+   for(int pass = 0; pass < 2; pass++)
+   {
+      for(int i = 0; i < colliderCount; i++)
+      {
+         const PongCollider& collider = colliders[i];
+         if(!collider.active)
+            continue;
+         int first = CellGet(collider.box.minX - margin, collider.box.minY - margin);
+         int last = CellGet(collider.box.maxX + margin, collider.box.maxY + margin);
+         for(int row = first / columnCount; row <= last / columnCount; row++)
+         {
+            for(int column = first % columnCount; column <= last % columnCount; column++)
+            {
+               int cell = row * columnCount + column;
+               if(pass == 0)
+               {
+                  cellColliderStarts[cell + 1]++;
+                  entryCount++;
+               }
+               else
+                  cellColliders[cellCursors[cell]++] = i;
+            }
+         }
+      }
+
+      if(pass == 0)
+      {
+         for(int cell = 0; cell < cellCount; cell++)
+            cellColliderStarts[cell + 1] += cellColliderStarts[cell];
+         memcpy(cellCursors, cellColliderStarts, cellCount * sizeof(int));
+
+         // Only grows when colliders are added or pickups come back where
+         // they cover more cells, so not while the balls are just bouncing
+         // around.
+         if(entryCount > cellColliderCapacity)
+         {
+            delete[] cellColliders;
+            cellColliderCapacity = entryCount * 2;
+            cellColliders = new int[cellColliderCapacity];
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::BallsCollide()
+{
+   float minDistanceSquared = config.ballSize * config.ballSize;
+   for(int i = 0; i < ballCount; i++)
+   {
+      int column = ballCells[i] % columnCount;
+      int row = ballCells[i] / columnCount;
+      for(int neighborRow = row - 1; neighborRow <= row + 1; neighborRow++)
+      {
+         if(neighborRow < 0 || neighborRow >= rowCount)
+            continue;
+         for(int neighborColumn = column - 1; neighborColumn <= column + 1; neighborColumn++)
+         {
+            if(neighborColumn < 0 || neighborColumn >= columnCount)
+               continue;
+            int cell = neighborRow * columnCount + neighborColumn;
+            for(int entry = cellBallStarts[cell]; entry < cellBallStarts[cell + 1]; entry++)
+            {
+               // Only check each pair once.
+               int j = cellBalls[entry];
+               if(j <= i)
+                  continue;
+               stats.ballPairsChecked++;
+
+               float dx = positionX[j] - positionX[i];
+               float dy = positionY[j] - positionY[i];
+               float distanceSquared = dx * dx + dy * dy;
+               if(distanceSquared >= minDistanceSquared || distanceSquared == 0.0f)
+                  continue;
+
+               // Only bounce balls that are heading toward each other, so
+               // ones that overlap can get apart.
+               float along = (velocityX[j] - velocityX[i]) * dx + (velocityY[j] - velocityY[i]) * dy;
+               if(along >= 0.0f)
+                  continue;
+
+               // The balls all weigh the same, so they just trade the parts
+               // of their velocities along the line between them.
+               float impulse = along / distanceSquared;
+               velocityX[i] += impulse * dx;
+               velocityY[i] += impulse * dy;
+               velocityX[j] -= impulse * dx;
+               velocityY[j] -= impulse * dy;
+               stats.ballHits++;
+            }
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::BallMove(int index, const PongPaddle* paddles, float dtSeconds)
+{
+   PongBall ball;
+   ball.position.x = positionX[index];
+   ball.position.y = positionY[index];
+   ball.velocity.x = velocityX[index];
+   ball.velocity.y = velocityY[index];
+   ball.playerHit = -1;
+   PongSim::BallVelocityClamp(&ball.velocity, config);
+
+   // Move through the step, bouncing off the first thing touched each time,
+   // the same way PongSim::BallUpdate does.  Nothing is bounced off twice in
+   // a row, so a ball grazing a corner can't get stuck.
+   float halfBallSize = config.ballSize / 2;
+   float remaining = dtSeconds;
+   int cell = ballCells[index];
+   int lastHit = -1;
+   for(int bounce = 0; bounce < CHAOS_BOUNCE_MAX; bounce++)
+   {
+      int hit = -1;
+      PongContact first;
+      for(int entry = cellColliderStarts[cell]; entry < cellColliderStarts[cell + 1]; entry++)
+      {
+         int colliderIndex = cellColliders[entry];
+         const PongCollider& collider = colliders[colliderIndex];
+         // Pickups don't get in the ball's way, so they're checked after it
+         // moves.
+         if(colliderIndex == lastHit || !collider.active || collider.type == PONG_COLLIDER_PICKUP)
+            continue;
+         stats.collidersChecked++;
+
+         PongContact contact;
+         bool touched;
+         if(collider.type == PONG_COLLIDER_PADDLE)
+            touched = PongSim::Collide(ball, paddles[collider.paddle], config, remaining, &contact);
+         else
+         {
+            PongBox box = {collider.box.minX - halfBallSize, collider.box.minY - halfBallSize,
+               collider.box.maxX + halfBallSize, collider.box.maxY + halfBallSize};
+            PongVector delta = {ball.velocity.x * remaining, ball.velocity.y * remaining};
+            touched = PongSim::Sweep(ball.position, delta, box, &contact);
+            contact.time *= remaining;
+         }
+         if(touched && (hit < 0 || contact.time < first.time))
+         {
+            hit = colliderIndex;
+            first = contact;
+         }
+      }
+      if(hit < 0)
+         break;
+
+      lastHit = hit;
+      PongCollider& collider = colliders[hit];
+      ball.position.x += ball.velocity.x * first.time;
+      ball.position.y += ball.velocity.y * first.time;
+      remaining -= first.time;
+      if(collider.type == PONG_COLLIDER_PADDLE)
+         PongSim::Bounce(&ball, paddles[collider.paddle], first.normal);
+      else
+      {
+         if(first.normal.x != 0.0f)
+            ball.velocity.x *= -1.0f;
+         if(first.normal.y != 0.0f)
+            ball.velocity.y *= -1.0f;
+      }
+      stats.colliderHits++;
+   }
+   ball.position.x += ball.velocity.x * remaining;
+   ball.position.y += ball.velocity.y * remaining;
+
+   // Pickups are collected by whichever ball touches them first, with the
+   // same test PongSim uses for power-ups.  The ball can't have left the
+   // cells around a pickup in one step, so its cell is enough to check.
+   for(int entry = cellColliderStarts[cell]; entry < cellColliderStarts[cell + 1]; entry++)
+   {
+      int colliderIndex = cellColliders[entry];
+      const PongCollider& collider = colliders[colliderIndex];
+      if(collider.type != PONG_COLLIDER_PICKUP || !collider.active)
+         continue;
+      stats.collidersChecked++;
+      if(PongSim::BallTouchCheck(ball, collider.box, config))
+         PickupCollect(colliderIndex);
+   }
+
+   // Bounce off the top and bottom of the screen.
+   if((ball.position.y > config.screenHeight - halfBallSize && ball.velocity.y > 0.0f) ||
+      (ball.position.y < halfBallSize && ball.velocity.y < 0.0f))
+   {
+      ball.velocity.y *= -1.0f;
+   }
+
+   positionX[index] = ball.position.x;
+   positionY[index] = ball.position.y;
+   velocityX[index] = ball.velocity.x;
+   velocityY[index] = ball.velocity.y;
+
+   // A ball past a goal scores, and is served again.
+   if(ball.position.x < config.leftGoal)
+   {
+      stats.goals[PONG_PADDLE_RIGHT]++;
+      BallServe(index);
+   }
+   else if(ball.position.x > config.rightGoal)
+   {
+      stats.goals[PONG_PADDLE_LEFT]++;
+      BallServe(index);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::BallServe(int index)
+{
+   PongBall ball;
+   PongSim::BallServe(&ball, config, &randomState);
+   positionX[index] = ball.position.x;
+   positionY[index] = ball.position.y;
+   velocityX[index] = ball.velocity.x;
+   velocityY[index] = ball.velocity.y;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::PickupCollect(int index)
+{
+   PongCollider& collider = colliders[index];
+   collider.active = false;
+   collider.respawnRemaining = CHAOS_PICKUP_RESPAWN_TIME;
+   powerUpState = PWR_UP_STATE_DUANE;
+   powerUpEffectRemaining = config.powerUpEffectTime;
+   stats.pickupsCollected++;
+}
+
+//------------------------------------------------------------------------------
+
+void PongChaos::PickupsUpdate(float dtSeconds)
+{
+   if(powerUpEffectRemaining > 0.0f)
+   {
+      powerUpEffectRemaining -= dtSeconds;
+      if(powerUpEffectRemaining <= 0.0f)
+         powerUpState = PWR_UP_STATE_NONE;
+   }
+
+   for(int i = 0; i < colliderCount; i++)
+   {
+      PongCollider& collider = colliders[i];
+      // Pickups turned off with ColliderActiveSet stay off.
+      if(collider.type != PONG_COLLIDER_PICKUP || collider.active || collider.respawnRemaining <= 0.0f)
+         continue;
+
+      collider.respawnRemaining -= dtSeconds;
+      if(collider.respawnRemaining > 0.0f)
+         continue;
+
+      // Same size as before, somewhere else.
+      float width = collider.box.maxX - collider.box.minX;
+      float height = collider.box.maxY - collider.box.minY;
+      float areaWidth = config.screenWidth * CHAOS_PICKUP_AREA;
+      collider.box.minX = (config.screenWidth - areaWidth) / 2 + (areaWidth - width) * PongSim::RandomF(&randomState);
+      collider.box.minY = (config.screenHeight - height) * PongSim::RandomF(&randomState);
+      collider.box.maxX = collider.box.minX + width;
+      collider.box.maxY = collider.box.minY + height;
+      collider.active = true;
+      stats.pickupsRespawned++;
+   }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,184 @@
+#ifndef __PONGCHAOS_H__
+#define __PONGCHAOS_H__
+
+#include "PongSim.h"
+
+namespace Webfoot {
+
+/// Most obstacles, pickups and paddles chaos mode can have.
+#define PONG_CHAOS_COLLIDER_MAX 64
+
+//==============================================================================
+
+/// Kinds of things the balls in chaos mode can run into.
+enum PongColliderType
+{
+   /// One of the players' paddles.  Bounces the ball like in a normal match.
+   PONG_COLLIDER_PADDLE,
+   /// A box the ball bounces off of.
+   PONG_COLLIDER_OBSTACLE,
+   /// A box that's collected when a ball touches it, without bouncing it.
+   /// Collecting one sets off the same effect as a power-up in a match, and
+   /// it comes back somewhere else a little later.
+   PONG_COLLIDER_PICKUP
+};
+
+/// Something in chaos mode that balls collide with.
+struct PongCollider
+{
+   PongBox box;
+   PongColliderType type;
+   /// Index of the paddle, for PONG_COLLIDER_PADDLE.
+   int paddle;
+   /// Colliders that aren't active are ignored, like pickups that have been
+   /// collected.
+   bool active;
+   /// For a collected pickup, seconds until it comes back.
+   float respawnRemaining;
+};
+
+/// What happened in the most recent step of chaos mode.
+struct PongChaosStats
+{
+   /// Pairs of balls close enough to be checked against each other, and how
+   /// many of them actually touched.
+   int ballPairsChecked;
+   int ballHits;
+   /// Ball and collider pairs checked, and how many touched.
+   int collidersChecked;
+   int colliderHits;
+   int pickupsCollected;
+   int pickupsRespawned;
+   /// Goals scored by the player on the left and on the right.
+   int goals[PONG_PADDLE_COUNT];
+};
+
+//==============================================================================
+
+/// "Chaos" mode, where hundreds of balls bounce off each other, the paddles,
+/// obstacles and pickups at once.  Checking every ball against every other
+/// ball and every collider would grow with the square of the number of balls,
+/// so everything is first sorted into a uniform grid of cells, and each ball
+/// is only checked against what's in the cells around it.
+///
+/// The balls are kept in separate contiguous arrays, like the DuaneStorm, so
+/// the loops over them run straight through memory.  The grid is rebuilt
+/// every step with a counting sort, which takes time in proportion to the
+/// number of balls and cells and allocates nothing.  Balls are treated as
+/// circles when they hit each other, and as points against colliders grown by
+/// the ball's size, the same way PongSim treats the ball against the paddles.
+/// Pickups are kept in the same fixed pool of colliders whether or not
+/// they've been collected, and are touched the way PongSim's power-ups are.
+/// This has no dependency on Frog.
+class PongChaos
+{
+public:
+   PongChaos();
+
+   /// Set up 'ballCount' balls, all served from the middle of the screen
+   /// described by 'config'.  The paddles are added as the first
+   /// PONG_PADDLE_COUNT colliders.
+   void Init(const PongConfig& _config, int ballCount, unsigned int seed);
+   /// Clean up.
+   void Deinit();
+
+   /// Add an obstacle or pickup.  Returns its index, or -1 if there's no room.
+   int ColliderAdd(PongColliderType type, const PongBox& box);
+   /// Turn the given collider on or off.  A pickup turned off this way
+   /// doesn't come back on its own.
+   void ColliderActiveSet(int index, bool active)
+   {
+      colliders[index].active = active;
+      colliders[index].respawnRemaining = 0.0f;
+   }
+   int ColliderCountGet() const { return colliderCount; }
+   const PongCollider& ColliderGet(int index) const { return colliders[index]; }
+
+   /// Move every ball by 'dtSeconds', with the paddles where 'paddles' says
+   /// they are.
+   void Step(const PongPaddle* paddles, float dtSeconds);
+
+   /// Number of balls.
+   int BallCountGet() const { return ballCount; }
+   /// Positions of the centers of the balls, now and before the last step.
+   const float* PositionXGet() const { return positionX; }
+   const float* PositionYGet() const { return positionY; }
+   const float* PreviousXGet() const { return previousX; }
+   const float* PreviousYGet() const { return previousY; }
+   /// Returns what happened in the last step.
+   const PongChaosStats& StatsGet() const { return stats; }
+   /// Returns the effect of the last pickup collected, until it wears off
+   /// after the config's 'powerUpEffectTime'.
+   PowerUpState PowerUpStateGet() const { return powerUpState; }
+
+protected:
+   /// Returns the cell containing the given point.  Points off the grid go in
+   /// the nearest cell.
+   int CellGet(float x, float y) const;
+   /// Sort the balls into the grid by the cell their center is in.
+   void BallGridBuild();
+   /// Sort the active colliders into every cell they could touch a ball
+   /// centered in this step, given 'margin', the most a ball can reach past
+   /// its center in the step.
+   void ColliderGridBuild(float margin);
+   /// Bounce balls that are touching off each other.
+   void BallsCollide();
+   /// Move ball 'index' through the step, bouncing it off anything in its
+   /// cell and the edges of the screen.
+   void BallMove(int index, const PongPaddle* paddles, float dtSeconds);
+   /// Put ball 'index' back in the middle, heading in a random direction.
+   void BallServe(int index);
+   /// Collect pickup 'index' and start its effect.
+   void PickupCollect(int index);
+   /// Count down the collected pickups and the effect, and put back the
+   /// pickups whose time is up, each somewhere new between the paddles.
+   void PickupsUpdate(float dtSeconds);
+
+   PongConfig config;
+
+   int ballCount;
+   float* positionX;
+   float* positionY;
+   float* velocityX;
+   float* velocityY;
+   float* previousX;
+   float* previousY;
+   /// Cell each ball is in.
+   int* ballCells;
+
+   PongCollider colliders[PONG_CHAOS_COLLIDER_MAX];
+   int colliderCount;
+
+   /// Size of each cell of the grid, and how many there are across and down.
+   float cellSize;
+   int columnCount;
+   int rowCount;
+   int cellCount;
+   /// Where each cell's balls start in 'cellBalls', with one extra at the end
+   /// so cell 'i' runs up to cellBallStarts[i + 1].
+   int* cellBallStarts;
+   int* cellBalls;
+   /// Where each cell's colliders start in 'cellColliders'.
+   int* cellColliderStarts;
+   int* cellColliders;
+   /// Room in 'cellColliders'.  This only grows if colliders are added or
+   /// grow.
+   int cellColliderCapacity;
+   /// Where the next entry goes in each cell while sorting.
+   int* cellCursors;
+
+   PongChaosStats stats;
+
+   PowerUpState powerUpState;
+   /// Seconds until the effect of the last pickup wears off.
+   float powerUpEffectRemaining;
+
+   /// Random number generator state.
+   unsigned int randomState;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGCHAOS_H__
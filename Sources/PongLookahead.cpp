@@ -0,0 +1,205 @@
+#include <cfloat>
+#include <cmath>
+#include "PongLookahead.h"
+
+using namespace Webfoot;
+
+/// Number of spots on the paddle tried.  Each is tried swinging up and
+/// swinging down.
+#define LOOKAHEAD_OFFSET_COUNT (PONG_LOOKAHEAD_PLAN_COUNT / 2)
+/// Score lost per pixel the ball is hit away from the middle of the paddle,
+/// so that plans that are otherwise as good keep some room for error.
+#define LOOKAHEAD_EDGE_PENALTY 1.0f
+
+//------------------------------------------------------------------------------
+
+/// Returns 'value' limited to between 'low' and 'high'.  Unlike fminf and
+/// fmaxf, this is just a pair of compares, so the compiler can vectorize loops
+/// that use it.
+static inline float Clamp(float value, float low, float high)
+{
+   value = value < low ? low : value;
+   return value > high ? high : value;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongLookahead::PlanChoose(const PongBall& ball, const PongPaddle& paddle, const PongPaddle& opponent,
+   const PongConfig& config, float interceptY, float impactTime, float reactionTime, float error,
+   float* targetY, float* swingDirection)
+{
+   // Only try spots far enough from the ends of the paddle that the AI still
+   // hits the ball when it's off by as much as it can be.
+   float halfHeight = config.paddleSize[paddle.playerNumber].y / 2;
+   float maxOffset = halfHeight - error;
+   if(maxOffset < 0.0f)
+      maxOffset = 0.0f;
+
+   Arena arena;
+   ArenaInit(&arena, ball, paddle, config, interceptY, maxOffset);
+
+   // Play every plan out until the ball gets to the paddle.
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   float planeX = PongSim::AiPlaneXGet(paddle, config);
+   float impactRemaining = impactTime;
+   for(int tick = 0; tick < PONG_LOOKAHEAD_TICKS_MAX; tick++)
+   {
+      bool reacting = tick * tickSeconds < reactionTime;
+      if(!ArenaStep(&arena, config, planeX, halfHeight, impactRemaining, reacting, tickSeconds))
+         break;
+      impactRemaining -= tickSeconds;
+   }
+
+   int best = -1;
+   float bestScore = -FLT_MAX;
+   for(int i = 0; i < PONG_LOOKAHEAD_PLAN_COUNT; i++)
+   {
+      if(arena.returned[i] == 0.0f)
+         continue;
+      float score = PlanScore(arena, i, opponent, config);
+      if(score > bestScore)
+      {
+         best = i;
+         bestScore = score;
+      }
+   }
+   if(best < 0)
+      return false;
+
+   *targetY = arena.targetY[best];
+   *swingDirection = arena.swingDirection[best];
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongLookahead::ArenaInit(Arena* arena, const PongBall& ball, const PongPaddle& paddle,
+   const PongConfig& config, float interceptY, float maxOffset)
+{
+   PongVector velocity = ball.velocity;
+   PongSim::BallVelocityClamp(&velocity, config);
+   float paddleY = paddle.position.y + config.paddleSize[paddle.playerNumber].y / 2;
+
+   for(int i = 0; i < PONG_LOOKAHEAD_PLAN_COUNT; i++)
+   {
+      // Spots on the paddle, evenly spread from one side to the other.
+      int offsetIndex = i % LOOKAHEAD_OFFSET_COUNT;
+      float offset = maxOffset * (2.0f * offsetIndex / (LOOKAHEAD_OFFSET_COUNT - 1) - 1.0f);
+
+      arena->ballX[i] = ball.position.x;
+      arena->ballY[i] = ball.position.y;
+      arena->velocityX[i] = velocity.x;
+      arena->velocityY[i] = velocity.y;
+      arena->paddleY[i] = paddleY;
+      arena->paddleMovement[i] = 0.0f;
+      arena->targetY[i] = interceptY - offset;
+      arena->swingDirection[i] = i < LOOKAHEAD_OFFSET_COUNT ? -1.0f : 1.0f;
+      arena->active[i] = 1.0f;
+      arena->returned[i] = 0.0f;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int PongLookahead::ArenaStep(Arena* arena, const PongConfig& config, float planeX, float halfHeight,
+   float impactRemaining, bool reacting, float dtSeconds)
+{
+   // These follow PongSim::Step: the ball moves and bounces, then the AI
+   // moves its paddle the same way PongSim::AiPaddleMove does.  The loop runs
+   // across all of the plans without branching, so the compiler can
+   // vectorize it.  Rather than being skipped, plans that are finished are
+   // stepped by no time at all, which leaves them where they are.
+   float halfBallSize = config.ballSize / 2;
+   float minY = halfBallSize;
+   float maxY = config.screenHeight - halfBallSize;
+   float maxMovement = reacting ? 0.0f : config.paddleSpeed * dtSeconds;
+   float hitThreshold = PONG_PADDLE_HIT_SPEED_THRESHOLD * dtSeconds;
+   float minSpeed = config.ballMinSpeed;
+   float maxSpeed = config.ballMaxSpeed;
+   float maxPaddleY = config.screenHeight - halfHeight;
+   float swingDistance = impactRemaining <= PONG_AI_SWING_DISTANCE / 2 / config.paddleSpeed ?
+      PONG_AI_SWING_DISTANCE / 2 : -PONG_AI_SWING_DISTANCE / 2;
+   int activeCount = 0;
+
+   for(int i = 0; i < PONG_LOOKAHEAD_PLAN_COUNT; i++)
+   {
+      float active = arena->active[i];
+      bool going = active != 0.0f;
+      float step = active * dtSeconds;
+      float x = arena->ballX[i];
+      float y = arena->ballY[i];
+      float vx = arena->velocityX[i];
+      float vy = arena->velocityY[i];
+      float paddleY = arena->paddleY[i];
+      float nextX = x + vx * step;
+      float nextY = y + vy * step;
+
+      // Did the ball reach the front of the paddle this step, and was the
+      // paddle there?  The ball's speed is clamped, so it's always moving
+      // horizontally.
+      bool crossed = going & ((x - planeX) * (nextX - planeX) <= 0.0f);
+      float crossY = y + vy * (planeX - x) / vx;
+      bool hit = crossed & (fabsf(crossY - paddleY) <= halfHeight);
+
+      // A moving paddle speeds the ball up and a still one slows it down,
+      // then the speed is clamped on each axis.
+      bool moving = fabsf(arena->paddleMovement[i]) > hitThreshold;
+      float factor = moving ? PONG_PADDLE_HIT_SPEED_FACTOR : 1.0f / PONG_PADDLE_HIT_SPEED_FACTOR;
+      float hitVX = -vx * factor;
+      float hitVY = vy * factor;
+      float hitSpeedX = Clamp(fabsf(hitVX), minSpeed, maxSpeed);
+      float hitSpeedY = Clamp(fabsf(hitVY), minSpeed, maxSpeed);
+      hitVX = hitVX < 0.0f ? -hitSpeedX : hitSpeedX;
+      hitVY = hitVY < 0.0f ? -hitSpeedY : hitSpeedY;
+
+      // Bounce off the top and bottom.
+      bool wall = going & (((nextY > maxY) & (vy > 0.0f)) | ((nextY < minY) & (vy < 0.0f)));
+      float bounceVY = wall ? -vy : vy;
+
+      // Move the paddle toward its spot, swinging through it at the end.
+      float goalY = arena->targetY[i] + arena->swingDirection[i] * swingDistance;
+      float movement = Clamp(goalY - paddleY, -maxMovement * active, maxMovement * active);
+      float nextPaddleY = Clamp(paddleY + movement, halfHeight, maxPaddleY);
+
+      // Blending between the two outcomes, rather than picking one, keeps
+      // the compiler from turning these into stores that only sometimes
+      // happen, which it can't vectorize.
+      float hitMask = hit ? 1.0f : 0.0f;
+      arena->ballX[i] = nextX + (planeX - nextX) * hitMask;
+      arena->ballY[i] = nextY + (crossY - nextY) * hitMask;
+      arena->velocityX[i] = vx + (hitVX - vx) * hitMask;
+      arena->velocityY[i] = bounceVY + (hitVY - bounceVY) * hitMask;
+      arena->paddleMovement[i] = nextPaddleY - paddleY;
+      arena->paddleY[i] = nextPaddleY;
+      arena->returned[i] += hitMask;
+      arena->active[i] = (going & !crossed) ? 1.0f : 0.0f;
+      activeCount += (going & !crossed) ? 1 : 0;
+   }
+   return activeCount;
+}
+
+//------------------------------------------------------------------------------
+
+float PongLookahead::PlanScore(const Arena& arena, int index, const PongPaddle& opponent, const PongConfig& config)
+{
+   // See where the return reaches the opponent, and how fast they'd have to
+   // move to get there in time.
+   PongBall returned;
+   returned.position.x = arena.ballX[index];
+   returned.position.y = arena.ballY[index];
+   returned.velocity.x = arena.velocityX[index];
+   returned.velocity.y = arena.velocityY[index];
+   returned.playerHit = -1;
+
+   float y;
+   float time;
+   if(!PongSim::InterceptSolve(returned, config, PongSim::AiPlaneXGet(opponent, config), &y, &time) || time <= 0.0f)
+      return -FLT_MAX;
+   float opponentY = opponent.position.y + config.paddleSize[opponent.playerNumber].y / 2;
+   float speedNeeded = fabsf(y - opponentY) / time;
+
+   float offset = fabsf(arena.ballY[index] - arena.targetY[index]);
+   return speedNeeded - offset * LOOKAHEAD_EDGE_PENALTY;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,76 @@
+#ifndef __PONGLOOKAHEAD_H__
+#define __PONGLOOKAHEAD_H__
+
+#include "PongSim.h"
+
+namespace Webfoot {
+
+/// Number of ways of returning the ball the lookahead AI tries.  Each is a
+/// different spot on the paddle to hit the ball with and a direction to swing
+/// in.
+#define PONG_LOOKAHEAD_PLAN_COUNT 16
+/// Most steps to play each plan out for.
+#define PONG_LOOKAHEAD_TICKS_MAX (PONG_TICK_RATE * 3)
+
+//==============================================================================
+
+/// The hardest AI.  Rather than just getting in the way of the ball, it plays
+/// out several ways of returning it, all side by side, and picks the one that
+/// leaves the opponent the most ground to cover in the least time.  Since a
+/// moving paddle speeds the ball up and the ball's speed is clamped on each
+/// axis separately, how the ball is hit changes both how fast it comes back
+/// and at what angle.
+///
+/// The plans are kept in a fixed-size structure of arrays and stepped
+/// together, so there's no allocation and the inner loops run straight
+/// across the plans.  This has no dependency on Frog.
+class PongLookahead
+{
+public:
+   /// Decide how 'paddle' should return 'ball', which will reach it at
+   /// 'interceptY' in 'impactTime' seconds.  The paddle is taken to stay put
+   /// for 'reactionTime' seconds first, and to be off by up to 'error' pixels.
+   /// Fills in where the middle of the paddle should be when the ball arrives
+   /// and which way to swing.  Returns false if none of the plans return the
+   /// ball.
+   static bool PlanChoose(const PongBall& ball, const PongPaddle& paddle, const PongPaddle& opponent,
+      const PongConfig& config, float interceptY, float impactTime, float reactionTime, float error,
+      float* targetY, float* swingDirection);
+
+protected:
+   /// Everything about each plan as it's played out.
+   struct Arena
+   {
+      float ballX[PONG_LOOKAHEAD_PLAN_COUNT];
+      float ballY[PONG_LOOKAHEAD_PLAN_COUNT];
+      float velocityX[PONG_LOOKAHEAD_PLAN_COUNT];
+      float velocityY[PONG_LOOKAHEAD_PLAN_COUNT];
+      /// Middle of the paddle, and how far it moved in the last step.
+      float paddleY[PONG_LOOKAHEAD_PLAN_COUNT];
+      float paddleMovement[PONG_LOOKAHEAD_PLAN_COUNT];
+      /// Where the middle of the paddle is going to be at impact.
+      float targetY[PONG_LOOKAHEAD_PLAN_COUNT];
+      float swingDirection[PONG_LOOKAHEAD_PLAN_COUNT];
+      /// 1 while the ball hasn't reached the paddle yet, and 0 after.
+      float active[PONG_LOOKAHEAD_PLAN_COUNT];
+      /// 1 if the paddle returned the ball.
+      float returned[PONG_LOOKAHEAD_PLAN_COUNT];
+   };
+
+   /// Set up each plan from the starting state, hitting the ball up to
+   /// 'maxOffset' pixels from the middle of the paddle.
+   static void ArenaInit(Arena* arena, const PongBall& ball, const PongPaddle& paddle,
+      const PongConfig& config, float interceptY, float maxOffset);
+   /// Step every plan that's still going.  The paddles only move once
+   /// 'reacting' is false.  Returns the number of plans still going.
+   static int ArenaStep(Arena* arena, const PongConfig& config, float planeX, float halfHeight,
+      float impactRemaining, bool reacting, float dtSeconds);
+   /// Returns how good the given plan turned out to be.
+   static float PlanScore(const Arena& arena, int index, const PongPaddle& opponent, const PongConfig& config);
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGLOOKAHEAD_H__
@@ -0,0 +1,776 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include "PongNet.h"
+
+using namespace Webfoot;
+
+/// First byte of each packet.
+#define PONG_NET_PACKET_HELLO 1
+#define PONG_NET_PACKET_INPUT 2
+/// Bytes in each kind of packet, not counting the inputs.
+#define PONG_NET_HELLO_SIZE 11
+#define PONG_NET_INPUT_HEADER_SIZE 23
+
+/// Bits of a packed input.
+#define PONG_NET_INPUT_UP 1
+#define PONG_NET_INPUT_DOWN 2
+#define PONG_NET_INPUT_DIRECTION_MASK 3
+#define PONG_NET_INPUT_SERVE 4
+#define PONG_NET_INPUT_RESTART 8
+
+/// Seed used if the host is given 0, which is how the other side says it
+/// doesn't have one yet.
+#define PONG_NET_DEFAULT_SEED 0x9E3779B9u
+
+//------------------------------------------------------------------------------
+
+/// Write 'value' at 'data' with the low byte first.
+static void U32Write(unsigned char* data, unsigned int value)
+{
+   data[0] = (unsigned char)value;
+   data[1] = (unsigned char)(value >> 8);
+   data[2] = (unsigned char)(value >> 16);
+   data[3] = (unsigned char)(value >> 24);
+}
+
+//------------------------------------------------------------------------------
+
+static unsigned int U32Read(const unsigned char* data)
+{
+   return (unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16) |
+      ((unsigned int)data[3] << 24);
+}
+
+//------------------------------------------------------------------------------
+
+/// Mix 'value' into the FNV-1a hash 'hash'.
+static void HashAdd(unsigned int* hash, unsigned int value)
+{
+   for(int i = 0; i < 4; i++)
+   {
+      *hash ^= (value >> (i * 8)) & 0xFF;
+      *hash *= 16777619u;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+static void HashAdd(unsigned int* hash, float value)
+{
+   unsigned int bits;
+   memcpy(&bits, &value, sizeof(bits));
+   HashAdd(hash, bits);
+}
+
+//------------------------------------------------------------------------------
+
+static void HashAdd(unsigned int* hash, const PongVector& value)
+{
+   HashAdd(hash, value.x);
+   HashAdd(hash, value.y);
+}
+
+//------------------------------------------------------------------------------
+
+static void HashAdd(unsigned int* hash, const PongBox& value)
+{
+   HashAdd(hash, value.minX);
+   HashAdd(hash, value.minY);
+   HashAdd(hash, value.maxX);
+   HashAdd(hash, value.maxY);
+}
+
+//==============================================================================
+
+PongNetSocket::PongNetSocket()
+{
+   handle = -1;
+   peerAddress = 0;
+   peerPort = 0;
+   latency = 0;
+   jitter = 0;
+   lossPercent = 0;
+   randomState = PONG_NET_DEFAULT_SEED;
+   delayed = NULL;
+   delayedCount = 0;
+   startTime = 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongNetSocket::Init(unsigned short port)
+{
+#ifdef _WIN32
+   WSADATA wsaData;
+   if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+      return false;
+   SOCKET newHandle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   if(newHandle == INVALID_SOCKET)
+   {
+      WSACleanup();
+      return false;
+   }
+#else
+   int newHandle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   if(newHandle < 0)
+      return false;
+#endif
+   handle = (long long)newHandle;
+
+   sockaddr_in address;
+   memset(&address, 0, sizeof(address));
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(INADDR_ANY);
+   address.sin_port = htons(port);
+   bool ready = bind(newHandle, (const sockaddr*)&address, sizeof(address)) == 0;
+
+   // Never wait on the socket.  Receive just comes back empty.
+#ifdef _WIN32
+   u_long nonBlocking = 1;
+   ready = ready && ioctlsocket(newHandle, FIONBIO, &nonBlocking) == 0;
+#else
+   ready = ready && fcntl(newHandle, F_SETFL, fcntl(newHandle, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+   if(!ready)
+   {
+      Deinit();
+      return false;
+   }
+
+   delayed = new Delayed[PONG_NET_DELAYED_MAX];
+   delayedCount = 0;
+   startTime = 0.0;
+   startTime = TimeGet();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSocket::Deinit()
+{
+   if(handle != -1)
+   {
+#ifdef _WIN32
+      closesocket((SOCKET)handle);
+      WSACleanup();
+#else
+      close((int)handle);
+#endif
+      handle = -1;
+   }
+   if(delayed)
+   {
+      delete[] delayed;
+      delayed = NULL;
+   }
+   delayedCount = 0;
+   peerAddress = 0;
+   peerPort = 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongNetSocket::PeerSet(const char* address, unsigned short port)
+{
+   in_addr parsed;
+   if(inet_pton(AF_INET, address, &parsed) != 1)
+      return false;
+   peerAddress = parsed.s_addr;
+   peerPort = htons(port);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSocket::ConditionsSet(int _latency, int _jitter, int _lossPercent, unsigned int seed)
+{
+   latency = _latency;
+   jitter = _jitter;
+   lossPercent = _lossPercent;
+   randomState = seed ? seed : PONG_NET_DEFAULT_SEED;
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSocket::Send(const void* data, int size)
+{
+   if(size <= 0 || size > PONG_NET_PACKET_SIZE_MAX)
+      return;
+   if(lossPercent > 0 && PongSim::RandomF(&randomState) * 100.0f < (float)lossPercent)
+      return;
+   if(latency <= 0 && jitter <= 0)
+   {
+      SendNow(data, size);
+      return;
+   }
+
+   // With jitter, packets can overtake each other, as they can for real.
+   if(!delayed || delayedCount >= PONG_NET_DELAYED_MAX)
+      return;
+   Delayed* packet = &delayed[delayedCount++];
+   packet->sendTime = TimeGet() + latency + jitter * PongSim::RandomF(&randomState);
+   packet->size = size;
+   memcpy(packet->data, data, size);
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSocket::Update()
+{
+   double now = TimeGet();
+   int i = 0;
+   while(i < delayedCount)
+   {
+      if(delayed[i].sendTime <= now)
+      {
+         SendNow(delayed[i].data, delayed[i].size);
+         delayed[i] = delayed[--delayedCount];
+      }
+      else
+      {
+         i++;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int PongNetSocket::Receive(void* buffer, int capacity)
+{
+   if(handle == -1)
+      return 0;
+
+   for(;;)
+   {
+      sockaddr_in from;
+#ifdef _WIN32
+      int fromSize = sizeof(from);
+      int size = recvfrom((SOCKET)handle, (char*)buffer, capacity, 0, (sockaddr*)&from, &fromSize);
+#else
+      socklen_t fromSize = sizeof(from);
+      int size = (int)recvfrom((int)handle, buffer, capacity, 0, (sockaddr*)&from, &fromSize);
+#endif
+      if(size <= 0)
+         return 0;
+      // Anything from anyone else is ignored.
+      if(!peerPort || (from.sin_addr.s_addr == peerAddress && from.sin_port == peerPort))
+         return size;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSocket::SendNow(const void* data, int size)
+{
+   if(handle == -1 || !peerPort)
+      return;
+
+   sockaddr_in address;
+   memset(&address, 0, sizeof(address));
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = peerAddress;
+   address.sin_port = peerPort;
+   // If it doesn't go, it's as good as lost, and the session copes with that.
+#ifdef _WIN32
+   sendto((SOCKET)handle, (const char*)data, size, 0, (const sockaddr*)&address, sizeof(address));
+#else
+   sendto((int)handle, data, size, 0, (const sockaddr*)&address, sizeof(address));
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+double PongNetSocket::TimeGet() const
+{
+   std::chrono::duration<double, std::milli> now = std::chrono::steady_clock::now().time_since_epoch();
+   return now.count() - startTime;
+}
+
+//==============================================================================
+
+PongNetSession::PongNetSession()
+{
+   sim = NULL;
+   memset(&config, 0, sizeof(config));
+   seed = 0;
+   localPaddle = PONG_PADDLE_RIGHT;
+   host = false;
+   started = false;
+   mismatch = false;
+   tick = 0;
+   states = NULL;
+   localInputs = NULL;
+   remoteInputs = NULL;
+   remoteGuesses = NULL;
+   remoteTick = 0;
+   rollbackTick = UINT_MAX;
+   remoteAck = 0;
+   peerTick = 0;
+   peerAdvantage = 0;
+   syncWaitTick = 0;
+   peerChecksumTick = 0;
+   peerChecksum = 0;
+   peerChecksumPending = false;
+   memset(&stats, 0, sizeof(stats));
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSession::Init(PongSim* _sim, const PongConfig& _config, int _localPaddle, bool _host, unsigned int _seed)
+{
+   sim = _sim;
+   config = _config;
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+      config.aiControlled[i] = false;
+   localPaddle = _localPaddle;
+   host = _host;
+   seed = _seed;
+   if(host && !seed)
+      seed = PONG_NET_DEFAULT_SEED;
+   started = false;
+   mismatch = false;
+   memset(&stats, 0, sizeof(stats));
+
+   states = new PongState[PONG_NET_HISTORY];
+   localInputs = new unsigned char[PONG_NET_HISTORY];
+   remoteInputs = new unsigned char[PONG_NET_HISTORY];
+   remoteGuesses = new unsigned char[PONG_NET_HISTORY];
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSession::Deinit()
+{
+   if(states)
+   {
+      delete[] states;
+      states = NULL;
+   }
+   if(localInputs)
+   {
+      delete[] localInputs;
+      localInputs = NULL;
+   }
+   if(remoteInputs)
+   {
+      delete[] remoteInputs;
+      remoteInputs = NULL;
+   }
+   if(remoteGuesses)
+   {
+      delete[] remoteGuesses;
+      remoteGuesses = NULL;
+   }
+   sim = NULL;
+   started = false;
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSession::MatchStart()
+{
+   sim->Init(config, seed);
+   tick = 0;
+   states[0] = sim->StateGet();
+
+   // Both sides start out with PONG_NET_INPUT_DELAY ticks of doing nothing,
+   // so those are already known.
+   memset(localInputs, 0, PONG_NET_HISTORY);
+   memset(remoteInputs, 0, PONG_NET_HISTORY);
+   memset(remoteGuesses, 0, PONG_NET_HISTORY);
+   remoteTick = PONG_NET_INPUT_DELAY;
+   remoteAck = PONG_NET_INPUT_DELAY;
+   rollbackTick = UINT_MAX;
+
+   peerTick = 0;
+   peerAdvantage = 0;
+   syncWaitTick = 0;
+   peerChecksumPending = false;
+   started = true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSession::PacketRead(const unsigned char* data, int size)
+{
+   if(!sim || size < 1)
+      return;
+   stats.packetsReceived++;
+
+   if(data[0] == PONG_NET_PACKET_HELLO)
+   {
+      if(size < PONG_NET_HELLO_SIZE)
+         return;
+      int peerPaddle = data[2];
+      if(data[1] != PONG_NET_VERSION || U32Read(data + 7) != ConfigChecksumGet(config) || peerPaddle == localPaddle)
+      {
+         mismatch = true;
+         return;
+      }
+      // The other side plays with the host's seed.
+      if(!host && !started)
+      {
+         seed = U32Read(data + 3);
+         MatchStart();
+      }
+      return;
+   }
+
+   if(data[0] != PONG_NET_PACKET_INPUT || size < PONG_NET_INPUT_HEADER_SIZE)
+      return;
+   unsigned int packetTick = U32Read(data + 1);
+   int packetAdvantage = (signed char)data[5];
+   unsigned int ack = U32Read(data + 6);
+   unsigned int firstTick = U32Read(data + 10);
+   int count = data[14];
+   unsigned int checksumTick = U32Read(data + 15);
+   unsigned int checksum = U32Read(data + 19);
+   if(size < PONG_NET_INPUT_HEADER_SIZE + (count + 1) / 2)
+      return;
+
+   // The other side only sends inputs once it has the seed, so this means
+   // the match is on.
+   if(!started)
+   {
+      if(!host)
+         return;
+      MatchStart();
+   }
+
+   // Packets can arrive out of order, so only the newest says where the peer
+   // is.
+   if(packetTick >= peerTick)
+   {
+      peerTick = packetTick;
+      peerAdvantage = packetAdvantage;
+   }
+   if(ack > remoteAck && ack <= tick + PONG_NET_INPUT_DELAY)
+      remoteAck = ack;
+   if(!peerChecksumPending || checksumTick > peerChecksumTick)
+   {
+      peerChecksumTick = checksumTick;
+      peerChecksum = checksum;
+      peerChecksumPending = true;
+   }
+
+   const unsigned char* inputs = data + PONG_NET_INPUT_HEADER_SIZE;
+   for(int i = 0; i < count; i++)
+   {
+      unsigned int inputTick = firstTick + i;
+      if(inputTick < remoteTick)
+         continue;
+      // A packet that skips ahead means one before it was lost.  Its inputs
+      // will come again.
+      if(inputTick > remoteTick || inputTick >= tick + PONG_NET_HISTORY / 2)
+         break;
+
+      unsigned char input = (inputs[i / 2] >> ((i % 2) * 4)) & 0x0F;
+      remoteInputs[inputTick % PONG_NET_HISTORY] = input;
+      if(inputTick < tick && input != remoteGuesses[inputTick % PONG_NET_HISTORY] && inputTick < rollbackTick)
+         rollbackTick = inputTick;
+      remoteTick++;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int PongNetSession::PacketWrite(unsigned char* buffer, int capacity)
+{
+   if(!sim)
+      return 0;
+
+   // Keep saying hello until there's a match.  Each side checks the other's
+   // config, and the other side gets its seed from the host.
+   if(!started)
+   {
+      if(capacity < PONG_NET_HELLO_SIZE)
+         return 0;
+      buffer[0] = PONG_NET_PACKET_HELLO;
+      buffer[1] = PONG_NET_VERSION;
+      buffer[2] = (unsigned char)localPaddle;
+      U32Write(buffer + 3, host ? seed : 0);
+      U32Write(buffer + 7, ConfigChecksumGet(config));
+      stats.packetsSent++;
+      return PONG_NET_HELLO_SIZE;
+   }
+
+   // Send every input the peer hasn't said it has.
+   unsigned int firstTick = remoteAck;
+   int count = (int)(tick + PONG_NET_INPUT_DELAY - firstTick);
+   if(count > PONG_NET_PACKET_INPUTS_MAX)
+      count = PONG_NET_PACKET_INPUTS_MAX;
+   if(count > (capacity - PONG_NET_INPUT_HEADER_SIZE) * 2)
+      count = (capacity - PONG_NET_INPUT_HEADER_SIZE) * 2;
+   if(count < 0)
+      return 0;
+
+   int advantage = (int)tick - (int)peerTick;
+   if(advantage > SCHAR_MAX)
+      advantage = SCHAR_MAX;
+   if(advantage < -SCHAR_MAX)
+      advantage = -SCHAR_MAX;
+
+   // A state is only final once the inputs before it are, and any rollback
+   // to fix them has happened.
+   unsigned int checksumTick = ConfirmedTickGet();
+   if(rollbackTick < checksumTick)
+      checksumTick = rollbackTick;
+
+   buffer[0] = PONG_NET_PACKET_INPUT;
+   U32Write(buffer + 1, tick);
+   buffer[5] = (unsigned char)(signed char)advantage;
+   U32Write(buffer + 6, remoteTick);
+   U32Write(buffer + 10, firstTick);
+   buffer[14] = (unsigned char)count;
+   U32Write(buffer + 15, checksumTick);
+   U32Write(buffer + 19, StateChecksumGet(states[checksumTick % PONG_NET_HISTORY]));
+   unsigned char* inputs = buffer + PONG_NET_INPUT_HEADER_SIZE;
+   memset(inputs, 0, (count + 1) / 2);
+   for(int i = 0; i < count; i++)
+      inputs[i / 2] |= localInputs[(firstTick + i) % PONG_NET_HISTORY] << ((i % 2) * 4);
+
+   stats.packetsSent++;
+   return PONG_NET_INPUT_HEADER_SIZE + (count + 1) / 2;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongNetSession::Update()
+{
+   if(!started)
+      return false;
+
+   bool rolledBack = false;
+   if(rollbackTick != UINT_MAX)
+   {
+      // Go back to just before the first wrong guess, and step forward again
+      // with what the peer really did.
+      int depth = (int)(tick - rollbackTick);
+      sim->StateSet(states[rollbackTick % PONG_NET_HISTORY]);
+      for(unsigned int t = rollbackTick; t < tick; t++)
+         TickStep(t);
+      rollbackTick = UINT_MAX;
+      rolledBack = true;
+
+      stats.rollbackCount++;
+      stats.ticksResimulated += depth;
+      if(depth > stats.rollbackMax)
+         stats.rollbackMax = depth;
+   }
+
+   // Once we've got as far as the peer's checksum, both sides should have
+   // exactly the same state there.
+   if(peerChecksumPending && peerChecksumTick <= ConfirmedTickGet())
+   {
+      const PongState* state = StateAtGet(peerChecksumTick);
+      if(state && StateChecksumGet(*state) != peerChecksum)
+         stats.desyncCount++;
+      peerChecksumPending = false;
+   }
+   return rolledBack;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongNetSession::AdvanceCheck()
+{
+   if(!started)
+      return false;
+
+   // Guessing further ahead than this would make for long rollbacks, and
+   // our inputs the peer hasn't got all have to fit in a packet.
+   if((int)(tick - remoteTick) >= PONG_NET_PREDICTION_MAX ||
+      (int)(tick + PONG_NET_INPUT_DELAY - remoteAck) >= PONG_NET_PACKET_INPUTS_MAX)
+   {
+      stats.stallCount++;
+      return false;
+   }
+
+   // Both sides see the other a little late, by about the same amount, so
+   // half the difference in what each thinks is how far apart they really
+   // are.
+   int localAdvantage = (int)tick - (int)peerTick;
+   if((localAdvantage - peerAdvantage) / 2 >= PONG_NET_SYNC_AHEAD_MAX && tick >= syncWaitTick + PONG_NET_SYNC_INTERVAL)
+   {
+      syncWaitTick = tick;
+      stats.syncWaitCount++;
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongNetSession::Advance(const PongInput& localInput)
+{
+   localInputs[(tick + PONG_NET_INPUT_DELAY) % PONG_NET_HISTORY] = InputPack(localInput, localPaddle);
+   unsigned int events = TickStep(tick);
+   tick++;
+   return events;
+}
+
+//------------------------------------------------------------------------------
+
+const PongState& PongNetSession::PreviousStateGet() const
+{
+   return states[(tick ? tick - 1 : 0) % PONG_NET_HISTORY];
+}
+
+//------------------------------------------------------------------------------
+
+const PongState* PongNetSession::StateAtGet(unsigned int tickIndex) const
+{
+   if(!started || tickIndex > tick || tick - tickIndex >= PONG_NET_HISTORY)
+      return NULL;
+   return &states[tickIndex % PONG_NET_HISTORY];
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongNetSession::StateChecksumGet(const PongState& state)
+{
+   // Field by field, so padding doesn't get in.
+   unsigned int hash = 2166136261u;
+   HashAdd(&hash, state.ball.position);
+   HashAdd(&hash, state.ball.velocity);
+   HashAdd(&hash, (unsigned int)state.ball.playerHit);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      HashAdd(&hash, state.paddles[i].position);
+      HashAdd(&hash, state.paddles[i].yVelocity);
+      HashAdd(&hash, (unsigned int)state.paddles[i].playerNumber);
+      const PongAiPlan& plan = state.aiPlans[i];
+      HashAdd(&hash, plan.ballVelocity);
+      HashAdd(&hash, plan.targetY);
+      HashAdd(&hash, plan.nextTargetY);
+      HashAdd(&hash, plan.reactionRemaining);
+      HashAdd(&hash, plan.impactRemaining);
+      HashAdd(&hash, plan.swingDirection);
+   }
+   HashAdd(&hash, (unsigned int)state.playerScore1);
+   HashAdd(&hash, (unsigned int)state.playerScore2);
+   HashAdd(&hash, (unsigned int)state.gameState);
+   HashAdd(&hash, (unsigned int)state.powerUpState);
+   // Free slots of the pool are left as they were, so only the active
+   // power-ups count.
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+   {
+      HashAdd(&hash, (unsigned int)state.powerUps[i].active);
+      if(state.powerUps[i].active)
+      {
+         HashAdd(&hash, state.powerUps[i].box);
+         HashAdd(&hash, state.powerUps[i].timeRemaining);
+      }
+   }
+   HashAdd(&hash, state.powerUpSpawnRemaining);
+   HashAdd(&hash, state.powerUpEffectRemaining);
+   HashAdd(&hash, state.powerUpRandomState);
+   HashAdd(&hash, state.randomState);
+   HashAdd(&hash, state.tick);
+   return hash;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongNetSession::ConfigChecksumGet(const PongConfig& config)
+{
+   unsigned int hash = 2166136261u;
+   HashAdd(&hash, config.screenWidth);
+   HashAdd(&hash, config.screenHeight);
+   HashAdd(&hash, config.ballSize);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      HashAdd(&hash, config.paddleSize[i]);
+      HashAdd(&hash, config.paddleStart[i]);
+      HashAdd(&hash, (unsigned int)config.aiControlled[i]);
+      // The AI's settings don't matter for paddles it isn't playing, so the
+      // two players can have picked different difficulties.
+      if(!config.aiControlled[i])
+         continue;
+      HashAdd(&hash, config.aiReactionTime[i]);
+      HashAdd(&hash, config.aiError[i]);
+      HashAdd(&hash, (unsigned int)config.aiLookahead[i]);
+   }
+   HashAdd(&hash, config.leftGoal);
+   HashAdd(&hash, config.rightGoal);
+   HashAdd(&hash, config.ballAxisSpeed);
+   HashAdd(&hash, config.ballMinSpeed);
+   HashAdd(&hash, config.ballMaxSpeed);
+   HashAdd(&hash, config.paddleSpeed);
+   HashAdd(&hash, (unsigned int)config.winningScore);
+   HashAdd(&hash, (unsigned int)config.powerUpsEnabled);
+   HashAdd(&hash, config.powerUpSize);
+   HashAdd(&hash, config.powerUpSpawnInterval);
+   HashAdd(&hash, config.powerUpLifetime);
+   HashAdd(&hash, config.powerUpEffectTime);
+   return hash;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned char PongNetSession::InputPack(const PongInput& input, int paddle)
+{
+   unsigned char packed = 0;
+   if(input.paddleDirection[paddle] < 0)
+      packed |= PONG_NET_INPUT_UP;
+   else if(input.paddleDirection[paddle] > 0)
+      packed |= PONG_NET_INPUT_DOWN;
+   if(input.serve)
+      packed |= PONG_NET_INPUT_SERVE;
+   if(input.restart)
+      packed |= PONG_NET_INPUT_RESTART;
+   return packed;
+}
+
+//------------------------------------------------------------------------------
+
+void PongNetSession::InputUnpack(unsigned char packed, int paddle, PongInput* input)
+{
+   int direction = packed & PONG_NET_INPUT_DIRECTION_MASK;
+   input->paddleDirection[paddle] = (direction == PONG_NET_INPUT_UP) ? -1 : ((direction == PONG_NET_INPUT_DOWN) ? 1 : 0);
+   input->serve = input->serve || (packed & PONG_NET_INPUT_SERVE);
+   input->restart = input->restart || (packed & PONG_NET_INPUT_RESTART);
+}
+
+//------------------------------------------------------------------------------
+
+unsigned char PongNetSession::RemoteInputGet(unsigned int tickIndex) const
+{
+   if(tickIndex < remoteTick)
+      return remoteInputs[tickIndex % PONG_NET_HISTORY];
+   // Guess the peer is still holding whatever it last held.  Presses are a
+   // one-off, so they aren't repeated.
+   return remoteInputs[(remoteTick - 1) % PONG_NET_HISTORY] & PONG_NET_INPUT_DIRECTION_MASK;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongNetSession::TickStep(unsigned int tickIndex)
+{
+   PongInput input;
+   input.paddleDirection[PONG_PADDLE_LEFT] = 0;
+   input.paddleDirection[PONG_PADDLE_RIGHT] = 0;
+   input.serve = false;
+   input.restart = false;
+   InputUnpack(localInputs[tickIndex % PONG_NET_HISTORY], localPaddle, &input);
+   unsigned char remoteInput = RemoteInputGet(tickIndex);
+   remoteGuesses[tickIndex % PONG_NET_HISTORY] = remoteInput;
+   InputUnpack(remoteInput, PONG_PADDLE_COUNT - 1 - localPaddle, &input);
+
+   unsigned int events = sim->Step(input, 1.0f / PONG_TICK_RATE);
+   states[(tickIndex + 1) % PONG_NET_HISTORY] = sim->StateGet();
+   return events;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,248 @@
+#ifndef __PONGNET_H__
+#define __PONGNET_H__
+
+#include "PongSim.h"
+
+namespace Webfoot {
+
+/// Ticks of inputs and states kept for rolling back.  Must be a power of 2,
+/// and more than PONG_NET_PREDICTION_MAX.
+#define PONG_NET_HISTORY 256
+/// Most ticks a peer can run ahead of the last input it has from the other.
+/// Past this, it waits.  At PONG_TICK_RATE, 60 ticks is 250 ms.
+#define PONG_NET_PREDICTION_MAX 60
+/// Ticks between pressing a key and it taking effect.  A little delay means
+/// fewer rollbacks, since the input has a head start on getting to the peer.
+#define PONG_NET_INPUT_DELAY 6
+/// Largest packet either side sends.
+#define PONG_NET_PACKET_SIZE_MAX 256
+/// Most inputs in one packet.  Inputs are sent again until the peer says it
+/// has them, so a lost packet only costs the time until the next one.
+#define PONG_NET_PACKET_INPUTS_MAX 255
+/// Most packets held back at once to fake latency.
+#define PONG_NET_DELAYED_MAX 512
+/// Ticks each side tries to stay within of the other, which is a frame at
+/// 60 Hz.  A side that's further ahead than this waits a tick, at most once
+/// every PONG_NET_SYNC_INTERVAL ticks, to let the other catch up.
+#define PONG_NET_SYNC_AHEAD_MAX 4
+#define PONG_NET_SYNC_INTERVAL 8
+/// Changes whenever the packets or the way the match is stepped do.
+#define PONG_NET_VERSION 1
+
+//==============================================================================
+
+/// A UDP socket to one peer, with optional fake latency, jitter and packet
+/// loss on what it sends, for testing on one machine.  It never blocks.
+/// This has no dependency on Frog.
+class PongNetSocket
+{
+public:
+   PongNetSocket();
+
+   /// Listen on 'port'.  Returns false if the port is taken.
+   bool Init(unsigned short port);
+   void Deinit();
+
+   /// Send everything to 'address':'port'.  Returns false if the address
+   /// isn't an IPv4 address.
+   bool PeerSet(const char* address, unsigned short port);
+   /// Hold each packet sent back by 'latency' plus up to 'jitter'
+   /// milliseconds, and drop 'lossPercent' of them.
+   void ConditionsSet(int latency, int jitter, int lossPercent, unsigned int seed);
+
+   /// Send 'size' bytes to the peer, or queue them to be sent later.
+   void Send(const void* data, int size);
+   /// Send anything held back whose time has come.  Call this often.
+   void Update();
+   /// Read a packet from the peer into 'buffer'.  Returns its size, or 0 if
+   /// there isn't one.
+   int Receive(void* buffer, int capacity);
+
+protected:
+   /// A packet being held back.
+   struct Delayed
+   {
+      /// Milliseconds since Init at which to send it.
+      double sendTime;
+      int size;
+      unsigned char data[PONG_NET_PACKET_SIZE_MAX];
+   };
+
+   /// Actually send a packet.
+   void SendNow(const void* data, int size);
+   /// Milliseconds since Init.
+   double TimeGet() const;
+
+   /// The socket, or -1.
+   long long handle;
+   /// Where to send to, in network byte order, or 0 for nowhere yet.
+   unsigned int peerAddress;
+   unsigned short peerPort;
+
+   int latency;
+   int jitter;
+   int lossPercent;
+   unsigned int randomState;
+   /// Packets being held back, in no particular order.
+   Delayed* delayed;
+   int delayedCount;
+   double startTime;
+};
+
+//==============================================================================
+
+/// What a PongNetSession has been up to, for seeing how well the connection
+/// is holding up.
+struct PongNetStats
+{
+   /// Times the session went back to fix a wrong guess, the ticks it stepped
+   /// again to do it, and the most it ever went back at once.
+   int rollbackCount;
+   int ticksResimulated;
+   int rollbackMax;
+   /// Ticks the session waited because it had gone as far as it could
+   /// without hearing from the peer, and ticks it waited to let the peer
+   /// catch up.
+   int stallCount;
+   int syncWaitCount;
+   /// Packets sent and received.
+   int packetsSent;
+   int packetsReceived;
+   /// Times the two sides were found to have different states for the same
+   /// tick, which should never happen.
+   int desyncCount;
+};
+
+/// A match between two players on different machines, with rollback.  Each
+/// side sends its own inputs for each tick, and steps the match right away,
+/// guessing that the other player is still pressing whatever they last
+/// pressed.  When the other player's real input for a tick turns up and it
+/// isn't what was guessed, the session restores the state from that tick
+/// and steps forward again with the right inputs.  The state is a plain
+/// struct, so saving and restoring it is just a copy.
+///
+/// Each tick's input fits in 4 bits.  Every packet carries all of the inputs
+/// the peer hasn't confirmed yet, so packet loss only delays things.  Packets
+/// also carry a checksum of the state at a tick both sides agree on, to catch
+/// the two sides drifting apart.  This has no dependency on Frog.
+class PongNetSession
+{
+public:
+   PongNetSession();
+
+   /// Start a session for 'sim', playing 'localPaddle'.  The host picks the
+   /// 'seed' and 'config'.  The other side passes a 'seed' of 0 and waits for
+   /// the host's, then checks that their configs match.  Both paddles are
+   /// made keyboard paddles.
+   void Init(PongSim* _sim, const PongConfig& _config, int _localPaddle, bool _host, unsigned int _seed);
+   void Deinit();
+
+   /// Returns true once both sides have heard from each other and the match
+   /// has started.
+   bool StartedCheck() const { return started; }
+   /// Returns true if the peer's config didn't match.
+   bool MismatchCheck() const { return mismatch; }
+   /// Returns which paddle this side plays.
+   int LocalPaddleGet() const { return localPaddle; }
+
+   /// Read a packet from the peer.  Any inputs that weren't what was guessed
+   /// are fixed up on the next Update.
+   void PacketRead(const unsigned char* data, int size);
+   /// Fill in 'buffer' with a packet for the peer.  Returns its size.
+   int PacketWrite(unsigned char* buffer, int capacity);
+
+   /// Roll back and step forward again if an earlier guess was wrong.
+   /// Returns true if it did, in which case anything showing the state
+   /// should be updated.
+   bool Update();
+   /// Returns true if the session can take another step without getting too
+   /// far ahead of the peer.
+   bool AdvanceCheck();
+   /// Step the match forward one tick with 'localInput' for this player's
+   /// paddle, which takes effect PONG_NET_INPUT_DELAY ticks from now.
+   /// Returns what happened in the step.
+   unsigned int Advance(const PongInput& localInput);
+
+   /// Returns the state before the last step, for drawing between steps.
+   const PongState& PreviousStateGet() const;
+   /// Returns the state before 'tickIndex', or NULL if it's too old or hasn't
+   /// happened yet.  It's only final if 'tickIndex' is no later than
+   /// ConfirmedTickGet.
+   const PongState* StateAtGet(unsigned int tickIndex) const;
+   /// Returns the tick the match is up to, and the first tick whose input
+   /// from the peer hasn't arrived.
+   unsigned int TickGet() const { return tick; }
+   unsigned int RemoteTickGet() const { return remoteTick; }
+   /// Returns the last tick whose state both sides agree on.
+   unsigned int ConfirmedTickGet() const { return tick < remoteTick ? tick : remoteTick; }
+   /// Returns the first of our inputs the peer hasn't said it has.
+   unsigned int RemoteAckGet() const { return remoteAck; }
+   const PongNetStats& StatsGet() const { return stats; }
+
+   /// Returns a checksum of everything in 'state' that affects the match.
+   static unsigned int StateChecksumGet(const PongState& state);
+   /// Returns a checksum of 'config', to check both sides have the same one.
+   static unsigned int ConfigChecksumGet(const PongConfig& config);
+
+protected:
+   /// Returns what 'input' has for 'paddle' in 4 bits.  Unpacking sets the
+   /// direction of 'paddle' and adds the serve and restart to 'input'.
+   static unsigned char InputPack(const PongInput& input, int paddle);
+   static void InputUnpack(unsigned char packed, int paddle, PongInput* input);
+
+   /// Start the match from tick 0.
+   void MatchStart();
+   /// Returns the peer's input for 'tickIndex', or a guess if it hasn't
+   /// arrived.
+   unsigned char RemoteInputGet(unsigned int tickIndex) const;
+   /// Step the sim, which must be at the state before 'tickIndex', and save
+   /// the state after.  Returns what happened.
+   unsigned int TickStep(unsigned int tickIndex);
+
+   PongSim* sim;
+   PongConfig config;
+   unsigned int seed;
+   int localPaddle;
+   bool host;
+   bool started;
+   bool mismatch;
+
+   /// Ticks stepped so far.  'states[t % PONG_NET_HISTORY]' is the state
+   /// before tick 't'.
+   unsigned int tick;
+   PongState* states;
+   /// Inputs of each side for each tick, packed.  Local inputs are known up
+   /// to 'tick + PONG_NET_INPUT_DELAY', and remote ones up to 'remoteTick'.
+   unsigned char* localInputs;
+   unsigned char* remoteInputs;
+   /// What was guessed for the peer's input on each tick that was stepped.
+   unsigned char* remoteGuesses;
+   unsigned int remoteTick;
+   /// First tick whose guess turned out wrong, or UINT_MAX if none.
+   unsigned int rollbackTick;
+   /// First of our inputs the peer doesn't have yet.
+   unsigned int remoteAck;
+
+   /// The latest tick the peer said it was on, and how many ticks ahead of
+   /// us it said it was.  If we're further ahead of the peer than it is of
+   /// us, we wait a tick now and then, so neither side does all the
+   /// guessing.
+   unsigned int peerTick;
+   int peerAdvantage;
+   /// Tick we last waited on to let the peer catch up.
+   unsigned int syncWaitTick;
+
+   /// The latest checksum the peer sent, and the tick it's for.  It's
+   /// checked once we've got that far with the peer's inputs.
+   unsigned int peerChecksumTick;
+   unsigned int peerChecksum;
+   bool peerChecksumPending;
+
+   PongNetStats stats;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGNET_H__
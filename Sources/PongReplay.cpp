@@ -0,0 +1,362 @@
+#include <cstring>
+#include "PongReplay.h"
+
+using namespace Webfoot;
+
+/// Identifies a replay file.
+static const char replayMagic[4] = {'D', 'G', 'A', 'R'};
+
+//------------------------------------------------------------------------------
+
+/// Write 'value' as 4 little-endian bytes.
+static void UInt32Write(FILE* file, unsigned int value)
+{
+   unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8),
+      (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+   fwrite(bytes, 1, 4, file);
+}
+
+//------------------------------------------------------------------------------
+
+/// Read 4 little-endian bytes.  Returns false at the end of the file.
+static bool UInt32Read(FILE* file, unsigned int* value)
+{
+   unsigned char bytes[4];
+   if(fread(bytes, 1, 4, file) != 4)
+      return false;
+   *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write 'value' as the 4 little-endian bytes of its bits, so it reads back
+/// exactly.
+static void FloatWrite(FILE* file, float value)
+{
+   unsigned int bits;
+   memcpy(&bits, &value, sizeof(bits));
+   UInt32Write(file, bits);
+}
+
+//------------------------------------------------------------------------------
+
+/// Read a value written by FloatWrite.  Returns false at the end of the file.
+static bool FloatRead(FILE* file, float* value)
+{
+   unsigned int bits;
+   if(!UInt32Read(file, &bits))
+      return false;
+   memcpy(value, &bits, sizeof(bits));
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write 'value' as a byte.
+static void BoolWrite(FILE* file, bool value)
+{
+   fputc(value ? 1 : 0, file);
+}
+
+//------------------------------------------------------------------------------
+
+/// Read a value written by BoolWrite.  Returns false at the end of the file
+/// or if the byte isn't 0 or 1.
+static bool BoolRead(FILE* file, bool* value)
+{
+   int byte = fgetc(file);
+   if(byte != 0 && byte != 1)
+      return false;
+   *value = byte == 1;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write 'value' 7 bits at a time, low bits first, with the top bit of each
+/// byte set if more follow.
+static void VarIntWrite(FILE* file, unsigned int value)
+{
+   while(value >= 0x80)
+   {
+      fputc((int)((value & 0x7F) | 0x80), file);
+      value >>= 7;
+   }
+   fputc((int)value, file);
+}
+
+//------------------------------------------------------------------------------
+
+/// Read a value written by VarIntWrite.  Returns false at the end of the file.
+static bool VarIntRead(FILE* file, unsigned int* value)
+{
+   *value = 0;
+   for(int shift = 0; shift < 35; shift += 7)
+   {
+      int byte = fgetc(file);
+      if(byte == EOF)
+         return false;
+      *value |= (unsigned int)(byte & 0x7F) << shift;
+      if(!(byte & 0x80))
+         return true;
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write each field of 'config' in turn, in the order they're declared.
+static void ConfigWrite(FILE* file, const PongConfig& config)
+{
+   FloatWrite(file, config.screenWidth);
+   FloatWrite(file, config.screenHeight);
+   FloatWrite(file, config.ballSize);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      FloatWrite(file, config.paddleSize[i].x);
+      FloatWrite(file, config.paddleSize[i].y);
+      FloatWrite(file, config.paddleStart[i].x);
+      FloatWrite(file, config.paddleStart[i].y);
+      BoolWrite(file, config.aiControlled[i]);
+   }
+   FloatWrite(file, config.leftGoal);
+   FloatWrite(file, config.rightGoal);
+   FloatWrite(file, config.ballAxisSpeed);
+   FloatWrite(file, config.ballMinSpeed);
+   FloatWrite(file, config.ballMaxSpeed);
+   FloatWrite(file, config.paddleSpeed);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      FloatWrite(file, config.aiReactionTime[i]);
+      FloatWrite(file, config.aiError[i]);
+      BoolWrite(file, config.aiLookahead[i]);
+   }
+   UInt32Write(file, (unsigned int)config.winningScore);
+   BoolWrite(file, config.powerUpsEnabled);
+   FloatWrite(file, config.powerUpSize.x);
+   FloatWrite(file, config.powerUpSize.y);
+   FloatWrite(file, config.powerUpSpawnInterval);
+   FloatWrite(file, config.powerUpLifetime);
+   FloatWrite(file, config.powerUpEffectTime);
+}
+
+//------------------------------------------------------------------------------
+
+/// Read a config written by ConfigWrite.  Returns false if the file ends
+/// first.
+static bool ConfigRead(FILE* file, PongConfig* config)
+{
+   bool ok = FloatRead(file, &config->screenWidth) &&
+      FloatRead(file, &config->screenHeight) &&
+      FloatRead(file, &config->ballSize);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      ok = ok && FloatRead(file, &config->paddleSize[i].x) &&
+         FloatRead(file, &config->paddleSize[i].y) &&
+         FloatRead(file, &config->paddleStart[i].x) &&
+         FloatRead(file, &config->paddleStart[i].y) &&
+         BoolRead(file, &config->aiControlled[i]);
+   }
+   ok = ok && FloatRead(file, &config->leftGoal) &&
+      FloatRead(file, &config->rightGoal) &&
+      FloatRead(file, &config->ballAxisSpeed) &&
+      FloatRead(file, &config->ballMinSpeed) &&
+      FloatRead(file, &config->ballMaxSpeed) &&
+      FloatRead(file, &config->paddleSpeed);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      ok = ok && FloatRead(file, &config->aiReactionTime[i]) &&
+         FloatRead(file, &config->aiError[i]) &&
+         BoolRead(file, &config->aiLookahead[i]);
+   }
+   unsigned int winningScore = 0;
+   ok = ok && UInt32Read(file, &winningScore) &&
+      BoolRead(file, &config->powerUpsEnabled) &&
+      FloatRead(file, &config->powerUpSize.x) &&
+      FloatRead(file, &config->powerUpSize.y) &&
+      FloatRead(file, &config->powerUpSpawnInterval) &&
+      FloatRead(file, &config->powerUpLifetime) &&
+      FloatRead(file, &config->powerUpEffectTime);
+   config->winningScore = (int)winningScore;
+   return ok;
+}
+
+//==============================================================================
+
+unsigned char Webfoot::PongInputPack(const PongInput& input)
+{
+   // Two bits for each paddle's direction, then one each for serve and restart.
+   unsigned char packed = 0;
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      unsigned char direction = 0;
+      if(input.paddleDirection[i] > 0)
+         direction = 1;
+      else if(input.paddleDirection[i] < 0)
+         direction = 2;
+      packed |= direction << (i * 2);
+   }
+   if(input.serve)
+      packed |= 1 << 4;
+   if(input.restart)
+      packed |= 1 << 5;
+   return packed;
+}
+
+//------------------------------------------------------------------------------
+
+void Webfoot::PongInputUnpack(unsigned char packed, PongInput* input)
+{
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      unsigned char direction = (packed >> (i * 2)) & 3;
+      input->paddleDirection[i] = direction == 1 ? 1 : (direction == 2 ? -1 : 0);
+   }
+   input->serve = (packed & (1 << 4)) != 0;
+   input->restart = (packed & (1 << 5)) != 0;
+}
+
+//==============================================================================
+
+PongReplayWriter::PongReplayWriter()
+{
+   file = NULL;
+   runInput = 0;
+   runLength = 0;
+   flushTicks = 0;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongReplayWriter::Open(const char* path, const PongConfig& config, unsigned int seed)
+{
+   Close();
+   file = fopen(path, "wb");
+   if(!file)
+      return false;
+
+   fwrite(replayMagic, 1, sizeof(replayMagic), file);
+   UInt32Write(file, PONG_REPLAY_VERSION);
+   UInt32Write(file, PONG_TICK_RATE);
+   UInt32Write(file, seed);
+   ConfigWrite(file, config);
+
+   runLength = 0;
+   flushTicks = 0;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongReplayWriter::TickAdd(const PongInput& input)
+{
+   if(!file)
+      return;
+
+   unsigned char packed = PongInputPack(input);
+   if(runLength && packed != runInput)
+      RunFlush();
+   runInput = packed;
+   runLength++;
+
+   // Hand what's been recorded to the OS now and then, so a crash only
+   // loses the last few seconds of the match.
+   if(++flushTicks >= PONG_REPLAY_FLUSH_INTERVAL)
+   {
+      RunFlush();
+      fflush(file);
+      flushTicks = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongReplayWriter::Close()
+{
+   if(!file)
+      return;
+   RunFlush();
+   fclose(file);
+   file = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void PongReplayWriter::RunFlush()
+{
+   if(!runLength)
+      return;
+   fputc(runInput, file);
+   VarIntWrite(file, runLength);
+   runLength = 0;
+}
+
+//==============================================================================
+
+PongReplayReader::PongReplayReader()
+{
+   file = NULL;
+   seed = 0;
+   runInput = 0;
+   runLeft = 0;
+   memset(&config, 0, sizeof(config));
+}
+
+//------------------------------------------------------------------------------
+
+bool PongReplayReader::Open(const char* path)
+{
+   Close();
+   file = fopen(path, "rb");
+   if(!file)
+      return false;
+
+   char magic[sizeof(replayMagic)];
+   unsigned int version, tickRate;
+   if(fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, replayMagic, sizeof(magic)) ||
+      !UInt32Read(file, &version) || version != PONG_REPLAY_VERSION ||
+      !UInt32Read(file, &tickRate) || tickRate != PONG_TICK_RATE ||
+      !UInt32Read(file, &seed) ||
+      !ConfigRead(file, &config))
+   {
+      Close();
+      return false;
+   }
+
+   runLeft = 0;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongReplayReader::TickGet(PongInput* input)
+{
+   if(!file)
+      return false;
+
+   if(!runLeft)
+   {
+      int byte = fgetc(file);
+      if(byte == EOF || !VarIntRead(file, &runLeft) || !runLeft)
+         return false;
+      runInput = (unsigned char)byte;
+   }
+
+   PongInputUnpack(runInput, input);
+   runLeft--;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongReplayReader::Close()
+{
+   if(file)
+   {
+      fclose(file);
+      file = NULL;
+   }
+}
+
+//------------------------------------------------------------------------------
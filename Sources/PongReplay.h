@@ -0,0 +1,91 @@
+#ifndef __PONGREPLAY_H__
+#define __PONGREPLAY_H__
+
+#include <cstdio>
+#include "PongSim.h"
+
+namespace Webfoot {
+
+/// Version of the replay file format.  Bump this when the format or the
+/// rules of the game change in a way that would make old replays play out
+/// differently.
+#define PONG_REPLAY_VERSION 6
+/// Steps between writes of what's been recorded out to the file, 5 seconds'
+/// worth.
+#define PONG_REPLAY_FLUSH_INTERVAL (PONG_TICK_RATE * 5)
+
+// A replay file is a header holding the seed and each field of the PongConfig,
+// little-endian whatever the machine, followed by the input for every
+// simulation step.  Each step's input is packed into one byte, and runs of
+// steps with the same input are stored as the byte and the length of the run.
+// Feeding the same input to a PongSim started from the same config and seed
+// plays the match out exactly the same way.
+
+//==============================================================================
+
+/// Records the input for each step of a match to a file.
+class PongReplayWriter
+{
+public:
+   PongReplayWriter();
+
+   /// Start a new replay file.  Returns false if it couldn't be created.
+   bool Open(const char* path, const PongConfig& config, unsigned int seed);
+   /// Record the input for the next step.
+   void TickAdd(const PongInput& input);
+   /// Finish writing the file.
+   void Close();
+
+   bool OpenCheck() { return file != NULL; }
+
+protected:
+   /// Write out the run of identical input that's been building up.
+   void RunFlush();
+
+   FILE* file;
+   unsigned char runInput;
+   unsigned int runLength;
+   /// Steps recorded since the file was last flushed.
+   unsigned int flushTicks;
+};
+
+//==============================================================================
+
+/// Reads back a file written by PongReplayWriter.
+class PongReplayReader
+{
+public:
+   PongReplayReader();
+
+   /// Open a replay file.  Returns false if it couldn't be opened or isn't a
+   /// replay this version of the game can play.
+   bool Open(const char* path);
+   /// Get the input for the next step.  Returns false at the end of the
+   /// replay.
+   bool TickGet(PongInput* input);
+   void Close();
+
+   bool OpenCheck() { return file != NULL; }
+   const PongConfig& ConfigGet() { return config; }
+   unsigned int SeedGet() { return seed; }
+
+protected:
+   FILE* file;
+   PongConfig config;
+   unsigned int seed;
+   unsigned char runInput;
+   unsigned int runLeft;
+};
+
+//==============================================================================
+
+/// Pack the input for a step into a byte.
+unsigned char PongInputPack(const PongInput& input);
+/// Unpack a byte made by PongInputPack.
+void PongInputUnpack(unsigned char packed, PongInput* input);
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGREPLAY_H__
@@ -0,0 +1,43 @@
+#include <algorithm>
+#include "PongScript.h"
+
+using namespace Webfoot;
+
+//------------------------------------------------------------------------------
+
+void PongScript::Init(int _paddle, int _reactionTicks)
+{
+   paddle = _paddle;
+   reactionTicks = std::min(std::max(_reactionTicks, 0), PONG_SCRIPT_REACTION_TICKS_MAX - 1);
+   historyCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+int PongScript::DirectionGet(const PongState& state, const PongConfig& config)
+{
+   history[historyCount % PONG_SCRIPT_REACTION_TICKS_MAX] = state.ball;
+   historyCount++;
+   if(historyCount <= reactionTicks)
+      return 0;
+   const PongBall& seen = history[(historyCount - 1 - reactionTicks) % PONG_SCRIPT_REACTION_TICKS_MAX];
+
+   // Chase the ball while it's coming this way, guessing how far it has moved
+   // since it was seen, and drift back to the middle while it isn't.
+   const PongPaddle& own = state.paddles[paddle];
+   float center = own.position.y + config.paddleSize[paddle].y / 2;
+   float target = config.screenHeight / 2;
+   bool coming = paddle == PONG_PADDLE_RIGHT ? seen.velocity.x > 0.0f : seen.velocity.x < 0.0f;
+   if(coming)
+   {
+      target = seen.position.y + seen.velocity.y * reactionTicks / PONG_TICK_RATE;
+      target = std::min(std::max(target, 0.0f), config.screenHeight);
+   }
+   if(target < center - PONG_SCRIPT_DEAD_ZONE)
+      return -1;
+   if(target > center + PONG_SCRIPT_DEAD_ZONE)
+      return 1;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
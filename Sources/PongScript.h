@@ -0,0 +1,43 @@
+#ifndef __PONGSCRIPT_H__
+#define __PONGSCRIPT_H__
+
+#include "PongSim.h"
+
+namespace Webfoot {
+
+/// Most steps of reaction delay a PongScript supports.
+#define PONG_SCRIPT_REACTION_TICKS_MAX 256
+/// A PongScript doesn't move if the ball is this close to the middle of its
+/// paddle, so it doesn't jitter.
+#define PONG_SCRIPT_DEAD_ZONE 12.0f
+
+//==============================================================================
+
+/// Plays a paddle with the keyboard controls the way a person might, for the
+/// tools that play matches with no one at the keyboard.  It chases where it
+/// thinks the ball is from where it was a little while ago while the ball is
+/// coming its way, and drifts back to the middle while it isn't.  This has no
+/// dependency on Frog.
+class PongScript
+{
+public:
+   /// Play 'paddle', seeing the ball 'reactionTicks' steps late.
+   void Init(int paddle, int reactionTicks);
+
+   /// Returns the direction to move the paddle in for this step.  This should
+   /// be called once for every step of the match.
+   int DirectionGet(const PongState& state, const PongConfig& config);
+
+protected:
+   /// Where the ball was in the steps so far, going round.
+   PongBall history[PONG_SCRIPT_REACTION_TICKS_MAX];
+   int historyCount;
+   int reactionTicks;
+   int paddle;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGSCRIPT_H__
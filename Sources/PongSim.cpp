@@ -0,0 +1,779 @@
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "PongSim.h"
+#include "PongLookahead.h"
+
+using namespace Webfoot;
+
+/// Speed of the ball along a given axis in pixels per second.
+#define BALL_AXIS_SPEED 400.0f
+#define BALL_MIN_SPEED 300.0f
+#define BALL_MAX_SPEED 900.0f
+
+// Percentage of how far inward the goal is on the screen.
+#define LEFT_GOAL 0.02f
+#define RIGHT_GOAL 0.98f
+
+// A buffer to give the player some extra space when going for the ball.
+#define GOAL_BUFFER 40
+
+#define PADDLE_SPEED 800.0f
+// How quickly the AI reacts, and how far off it can be, unless the game
+// picks another difficulty.  See PongSim.h for the difficulties.  (No
+// reaction time and no error is literally impossible)
+#define AI_DIFFICULTY PONG_AI_MEDIUM
+
+// Keyboard paddles get a little extra speed on top of PADDLE_SPEED.
+#define PLAYER_PADDLE_SPEED_BONUS 200.0f
+
+// Score at which the match ends.
+#define WINNING_SCORE 10
+
+// Power-ups.  A new one appears every POWER_UP_SPAWN_INTERVAL seconds of play
+// if there's room, and stays for POWER_UP_LIFETIME seconds.  Picking one up
+// brings on the Duane Storm for POWER_UP_EFFECT_TIME seconds.
+#define POWER_UP_SIZE 64.0f
+#define POWER_UP_SPAWN_INTERVAL 8.0f
+#define POWER_UP_LIFETIME 6.0f
+#define POWER_UP_EFFECT_TIME 5.0f
+// Power-ups only appear in this fraction of the screen around the middle, so
+// they're out of the way of the paddles.
+#define POWER_UP_AREA 0.5f
+// Mixed into the seed of a match for the power-ups' random numbers.
+#define POWER_UP_SEED_MIX 0x85EBCA6Bu
+
+//==============================================================================
+
+PongSim::PongSim()
+{
+   PongVector paddleSizes[PONG_PADDLE_COUNT] = {{32.0f, 128.0f}, {32.0f, 128.0f}};
+   ConfigDefaultsSet(&config, 1024.0f, 768.0f, 32.0f, paddleSizes);
+   Init(config, 0);
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::ConfigDefaultsSet(PongConfig* config, float screenWidth,
+   float screenHeight, float ballSize, const PongVector* paddleSizes)
+{
+   config->screenWidth = screenWidth;
+   config->screenHeight = screenHeight;
+   config->ballSize = ballSize;
+
+   config->rightGoal = screenWidth * RIGHT_GOAL;
+   config->leftGoal = screenWidth * LEFT_GOAL;
+
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+      config->paddleSize[i] = paddleSizes[i];
+
+   // The paddles should be just in front of the goal, with enough space to
+   // give the player time to react if the ball has gone a little past the
+   // paddle.  (That's what the GOAL_BUFFER is for)
+   PongVector& right = config->paddleStart[PONG_PADDLE_RIGHT];
+   right.x = config->rightGoal - paddleSizes[PONG_PADDLE_RIGHT].x - GOAL_BUFFER;
+   right.y = (screenHeight / 2.0f) - (paddleSizes[PONG_PADDLE_RIGHT].y / 2);
+   PongVector& left = config->paddleStart[PONG_PADDLE_LEFT];
+   left.x = config->leftGoal + GOAL_BUFFER;
+   left.y = (screenHeight / 2.0f) - (paddleSizes[PONG_PADDLE_LEFT].y / 2);
+
+   config->aiControlled[PONG_PADDLE_LEFT] = true;
+   config->aiControlled[PONG_PADDLE_RIGHT] = false;
+
+   config->ballAxisSpeed = BALL_AXIS_SPEED;
+   config->ballMinSpeed = BALL_MIN_SPEED;
+   config->ballMaxSpeed = BALL_MAX_SPEED;
+
+   config->paddleSpeed = PADDLE_SPEED;
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+      DifficultySet(config, i, AI_DIFFICULTY);
+
+   config->winningScore = WINNING_SCORE;
+
+   config->powerUpsEnabled = true;
+   config->powerUpSize.x = POWER_UP_SIZE;
+   config->powerUpSize.y = POWER_UP_SIZE;
+   config->powerUpSpawnInterval = POWER_UP_SPAWN_INTERVAL;
+   config->powerUpLifetime = POWER_UP_LIFETIME;
+   config->powerUpEffectTime = POWER_UP_EFFECT_TIME;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::DifficultySet(PongConfig* config, int paddle, PongAiDifficulty difficulty)
+{
+   static const float reactionTimes[PONG_AI_DIFFICULTY_COUNT] = {PONG_AI_EASY_REACTION_TIME,
+      PONG_AI_MEDIUM_REACTION_TIME, PONG_AI_HARD_REACTION_TIME, PONG_AI_EXPERT_REACTION_TIME};
+   static const float errors[PONG_AI_DIFFICULTY_COUNT] = {PONG_AI_EASY_ERROR, PONG_AI_MEDIUM_ERROR,
+      PONG_AI_HARD_ERROR, PONG_AI_EXPERT_ERROR};
+   config->aiReactionTime[paddle] = reactionTimes[difficulty];
+   config->aiError[paddle] = errors[difficulty];
+   config->aiLookahead[paddle] = difficulty == PONG_AI_EXPERT;
+}
+
+//------------------------------------------------------------------------------
+
+PongAiDifficulty PongSim::DifficultyFind(const char* name, PongAiDifficulty defaultValue)
+{
+   static const char* const names[PONG_AI_DIFFICULTY_COUNT] = {"easy", "medium", "hard", "expert"};
+   for(int i = 0; name && i < PONG_AI_DIFFICULTY_COUNT; i++)
+   {
+      if(!strcmp(name, names[i]))
+         return (PongAiDifficulty)i;
+   }
+   return defaultValue;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::Init(const PongConfig& _config, unsigned int seed)
+{
+   config = _config;
+
+   // xorshift gets stuck at 0, so nudge it off.
+   state.randomState = seed ? seed : 0x9E3779B9u;
+   state.powerUpRandomState = state.randomState ^ POWER_UP_SEED_MIX;
+   if(!state.powerUpRandomState)
+      state.powerUpRandomState = POWER_UP_SEED_MIX;
+   state.tick = 0;
+
+   state.gameState = STATE_PAUSED;
+   state.powerUpState = PWR_UP_STATE_NONE;
+
+   state.paddles[PONG_PADDLE_LEFT].playerNumber = 0;
+   state.paddles[PONG_PADDLE_RIGHT].playerNumber = 1;
+
+   ResetGame();
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongSim::Step(const PongInput& input, float dtSeconds)
+{
+   unsigned int events = PONG_EVENT_NONE;
+   state.tick++;
+
+   // Check whether someone has reached the winning score.
+   if(state.playerScore1 >= config.winningScore || state.playerScore2 >= config.winningScore)
+   {
+      state.powerUpState = PWR_UP_STATE_DUANE;
+      if(state.gameState != STATE_END)
+         events |= PONG_EVENT_GAME_END;
+      state.gameState = STATE_END;
+   }
+
+   if((state.gameState == STATE_SCORED || state.gameState == STATE_PAUSED) && input.serve)
+   {
+      state.gameState = STATE_PLAYING;
+      events |= PONG_EVENT_SERVE;
+   }
+
+   // If we're currently playing the game...
+   if(state.gameState == STATE_PLAYING)
+   {
+      events |= BallUpdate(&state.ball, state.paddles, config, dtSeconds);
+      events |= PowerUpsUpdate(dtSeconds);
+
+      for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+      {
+         if(config.aiControlled[i])
+         {
+            AiPaddleMove(&state.paddles[i], &state.aiPlans[i], state.ball,
+               state.paddles[PONG_PADDLE_COUNT - 1 - i], config, &state.randomState, dtSeconds);
+         }
+      }
+
+      // Check to see if the ball has passed the goals.
+      if(state.playerScore1 < config.winningScore && state.playerScore2 < config.winningScore)
+      {
+         if(state.ball.position.x <= config.leftGoal)
+         {
+            state.playerScore1++;
+            state.gameState = STATE_SCORED;
+            events |= PONG_EVENT_GOAL;
+            ResetRound();
+         }
+
+         if(state.ball.position.x >= config.rightGoal)
+         {
+            state.playerScore2++;
+            state.gameState = STATE_SCORED;
+            events |= PONG_EVENT_GOAL;
+            ResetRound();
+         }
+      }
+   }
+
+   // Keyboard paddles are free to move unless the game is paused.  (They can
+   // move even when the state is scored or game over)
+   if(state.gameState != STATE_PAUSED)
+   {
+      for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+      {
+         if(!config.aiControlled[i])
+            PaddleMove(&state.paddles[i], config, input.paddleDirection[i], dtSeconds);
+      }
+   }
+
+   if(state.gameState == STATE_END && input.restart)
+   {
+      ResetGame();
+      state.gameState = STATE_PLAYING;
+      events |= PONG_EVENT_RESET;
+   }
+
+   return events;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::ResetRound()
+{
+   BallServe(&state.ball, config, &state.randomState);
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      state.paddles[i].position = config.paddleStart[i];
+      state.paddles[i].yVelocity = 0.0f;
+      AiPlanReset(&state.aiPlans[i], config);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::ResetGame()
+{
+   state.playerScore1 = 0;
+   state.playerScore2 = 0;
+   state.powerUpState = PWR_UP_STATE_NONE;
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+      state.powerUps[i].active = false;
+   state.powerUpSpawnRemaining = config.powerUpSpawnInterval;
+   state.powerUpEffectRemaining = 0.0f;
+   ResetRound();
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::BallServe(PongBall* ball, const PongConfig& config, unsigned int* randomState)
+{
+   // Start the ball in the middle of the screen.
+   ball->position.x = config.screenWidth / 2;
+   ball->position.y = config.screenHeight / 2;
+   ball->playerHit = -1;
+
+   // Randomize a positive or negative direction, so it doesn't always start
+   // going in the same direction.
+   float randomx = (RandomF(randomState) - 0.5f) < 0.0f ? -1.0f : 1.0f;
+   float randomy = (RandomF(randomState) - 0.5f) < 0.0f ? -1.0f : 1.0f;
+
+   // Randomize an acceleration value to apply to the velocity of the ball.
+   float accelerationX = (RandomF(randomState) - 0.5f) * config.ballAxisSpeed;
+   float accelerationY = (RandomF(randomState) - 0.5f) * config.ballAxisSpeed;
+
+   // Set the ball's initial velocity, plus the acceleration in the random
+   // direction.
+   ball->velocity.x = (config.ballAxisSpeed + accelerationX) * randomx;
+   ball->velocity.y = (config.ballAxisSpeed + accelerationY) * randomy;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongSim::BallUpdate(PongBall* ball, const PongPaddle* paddles, const PongConfig& config, float dtSeconds)
+{
+   PongVector& velocity = ball->velocity;
+   PongVector& position = ball->position;
+
+   BallVelocityClamp(&velocity, config);
+
+   // Move the ball through the step.  When it touches a paddle, move it to the
+   // point of contact, bounce it, and carry on with what's left of the step.
+   // Each paddle can only be hit once per step, so a ball grazing a corner
+   // can't get stuck.
+   unsigned int events = PONG_EVENT_NONE;
+   float remaining = dtSeconds;
+   bool bounced[PONG_PADDLE_COUNT] = {false, false};
+   for(;;)
+   {
+      int hitPaddle = -1;
+      PongContact first;
+      for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+      {
+         PongContact contact;
+         if(!bounced[i] && Collide(*ball, paddles[i], config, remaining, &contact) &&
+            (hitPaddle < 0 || contact.time < first.time))
+         {
+            hitPaddle = i;
+            first = contact;
+         }
+      }
+      if(hitPaddle < 0)
+         break;
+
+      position.x += velocity.x * first.time;
+      position.y += velocity.y * first.time;
+      remaining -= first.time;
+      Bounce(ball, paddles[hitPaddle], first.normal);
+      bounced[hitPaddle] = true;
+      events |= PONG_EVENT_PADDLE_HIT;
+   }
+   position.x += velocity.x * remaining;
+   position.y += velocity.y * remaining;
+
+   // The position of the ball corresponds to its center.  We want to keep the
+   // whole ball on-screen, so figure out the area within which the center must
+   // stay.
+   float halfBallSize = config.ballSize / 2.0f;
+   PongBox ballArea = {halfBallSize, halfBallSize,
+      config.screenWidth - halfBallSize, config.screenHeight - halfBallSize};
+
+   // If the ball has gone too far in any direction, make sure its velocity
+   // will bring it back.
+   if(((position.x > ballArea.maxX) && (velocity.x > 0.0f)) ||
+      ((position.x < ballArea.minX) && (velocity.x < 0.0f)))
+   {
+      velocity.x *= -1.0f;
+      events |= PONG_EVENT_WALL_BOUNCE;
+   }
+   if(((position.y > ballArea.maxY) && (velocity.y > 0.0f)) ||
+      ((position.y < ballArea.minY) && (velocity.y < 0.0f)))
+   {
+      velocity.y *= -1.0f;
+      events |= PONG_EVENT_WALL_BOUNCE;
+   }
+   return events;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int PongSim::PowerUpsUpdate(float dtSeconds)
+{
+   unsigned int events = PONG_EVENT_NONE;
+
+   // The effect wears off, unless the match is over, in which case the Duane
+   // Storm is there to stay.
+   if(state.powerUpEffectRemaining > 0.0f)
+   {
+      state.powerUpEffectRemaining -= dtSeconds;
+      if(state.powerUpEffectRemaining <= 0.0f && state.gameState != STATE_END)
+         state.powerUpState = PWR_UP_STATE_NONE;
+   }
+
+   if(!config.powerUpsEnabled)
+      return events;
+
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+   {
+      PongPowerUp& powerUp = state.powerUps[i];
+      if(!powerUp.active)
+         continue;
+
+      powerUp.timeRemaining -= dtSeconds;
+      if(powerUp.timeRemaining <= 0.0f)
+         powerUp.active = false;
+      else if(BallTouchCheck(state.ball, powerUp.box, config))
+      {
+         powerUp.active = false;
+         state.powerUpState = PWR_UP_STATE_DUANE;
+         state.powerUpEffectRemaining = config.powerUpEffectTime;
+         events |= PONG_EVENT_POWER_UP;
+      }
+   }
+
+   // Put a new one in the first free slot, if there is one.
+   state.powerUpSpawnRemaining -= dtSeconds;
+   if(state.powerUpSpawnRemaining <= 0.0f)
+   {
+      state.powerUpSpawnRemaining += config.powerUpSpawnInterval;
+      for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+      {
+         PongPowerUp& powerUp = state.powerUps[i];
+         if(powerUp.active)
+            continue;
+
+         float areaWidth = config.screenWidth * POWER_UP_AREA;
+         float x = (config.screenWidth - areaWidth) / 2 +
+            (areaWidth - config.powerUpSize.x) * RandomF(&state.powerUpRandomState);
+         float y = (config.screenHeight - config.powerUpSize.y) * RandomF(&state.powerUpRandomState);
+         powerUp.box.minX = x;
+         powerUp.box.minY = y;
+         powerUp.box.maxX = x + config.powerUpSize.x;
+         powerUp.box.maxY = y + config.powerUpSize.y;
+         powerUp.timeRemaining = config.powerUpLifetime;
+         powerUp.active = true;
+         events |= PONG_EVENT_POWER_UP_SPAWN;
+         break;
+      }
+   }
+   return events;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSim::BallTouchCheck(const PongBall& ball, const PongBox& box, const PongConfig& config)
+{
+   float halfBallSize = config.ballSize / 2;
+   return ball.position.x + halfBallSize >= box.minX && ball.position.x - halfBallSize <= box.maxX &&
+      ball.position.y + halfBallSize >= box.minY && ball.position.y - halfBallSize <= box.maxY;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::BallVelocityClamp(PongVector* velocity, const PongConfig& config)
+{
+   // Make sure the velocity never falls below a certain amount. Otherwise the
+   // ball goes too slow.
+   if(velocity->x < config.ballMinSpeed && velocity->x > 0.0f)
+      velocity->x = config.ballMinSpeed;
+   else if(velocity->x > -config.ballMinSpeed && velocity->x < 0.0f)
+      velocity->x = -config.ballMinSpeed;
+   if(velocity->y < config.ballMinSpeed && velocity->y > 0.0f)
+      velocity->y = config.ballMinSpeed;
+   else if(velocity->y > -config.ballMinSpeed && velocity->y < 0.0f)
+      velocity->y = -config.ballMinSpeed;
+
+   // Make sure the ball never goes faster than a certain amount.
+   if(velocity->x > config.ballMaxSpeed)
+      velocity->x = config.ballMaxSpeed;
+   else if(velocity->x < -config.ballMaxSpeed)
+      velocity->x = -config.ballMaxSpeed;
+   if(velocity->y > config.ballMaxSpeed)
+      velocity->y = config.ballMaxSpeed;
+   else if(velocity->y < -config.ballMaxSpeed)
+      velocity->y = -config.ballMaxSpeed;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSim::Collide(const PongBall& ball, const PongPaddle& paddle, const PongConfig& config,
+   float dtSeconds, PongContact* contact)
+{
+   // Only bounce if the ball is heading toward this paddle's goal.
+   if(!((paddle.playerNumber == 0 && ball.velocity.x < 0.0f) ||
+      (paddle.playerNumber == 1 && ball.velocity.x > 0.0f)))
+   {
+      return false;
+   }
+
+   // Sweep the center of the ball against the paddle grown by half the ball's
+   // width.  Vertically, the center has to be within the paddle itself, as it
+   // always has.
+   float halfBallSize = config.ballSize / 2;
+   PongBox box = PaddleBoxGet(paddle, config);
+   box.minX -= halfBallSize;
+   box.maxX += halfBallSize;
+
+   PongVector delta = {ball.velocity.x * dtSeconds, ball.velocity.y * dtSeconds};
+   if(!Sweep(ball.position, delta, box, contact))
+      return false;
+   contact->time *= dtSeconds;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::Bounce(PongBall* ball, const PongPaddle& paddle, const PongVector& normal)
+{
+   if(normal.x != 0.0f)
+      ball->velocity.x *= -1.0f;
+   if(normal.y != 0.0f)
+      ball->velocity.y *= -1.0f;
+   ball->playerHit = paddle.playerNumber;
+
+   // A moving paddle speeds the ball up.  A still one slows it down.
+   float factor = 1.0f / PONG_PADDLE_HIT_SPEED_FACTOR;
+   if(paddle.yVelocity > PONG_PADDLE_HIT_SPEED_THRESHOLD || paddle.yVelocity < -PONG_PADDLE_HIT_SPEED_THRESHOLD)
+      factor = PONG_PADDLE_HIT_SPEED_FACTOR;
+   ball->velocity.x *= factor;
+   ball->velocity.y *= factor;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSim::Sweep(const PongVector& start, const PongVector& delta, const PongBox& box, PongContact* contact)
+{
+   // Slab test.  Find the range of times the point is within the box along
+   // each axis, and see if the ranges overlap.
+   float enter = -FLT_MAX;
+   float exit = FLT_MAX;
+   PongVector normal = {0.0f, 0.0f};
+
+   const float starts[2] = {start.x, start.y};
+   const float deltas[2] = {delta.x, delta.y};
+   const float mins[2] = {box.minX, box.minY};
+   const float maxes[2] = {box.maxX, box.maxY};
+   for(int axis = 0; axis < 2; axis++)
+   {
+      if(deltas[axis] == 0.0f)
+      {
+         // Not moving along this axis, so it has to be within the slab already.
+         if(starts[axis] < mins[axis] || starts[axis] > maxes[axis])
+            return false;
+         continue;
+      }
+
+      float inverse = 1.0f / deltas[axis];
+      float nearTime = (mins[axis] - starts[axis]) * inverse;
+      float farTime = (maxes[axis] - starts[axis]) * inverse;
+      float side = -1.0f;
+      if(nearTime > farTime)
+      {
+         float temp = nearTime;
+         nearTime = farTime;
+         farTime = temp;
+         side = 1.0f;
+      }
+
+      if(nearTime > enter)
+      {
+         enter = nearTime;
+         normal.x = axis == 0 ? side : 0.0f;
+         normal.y = axis == 1 ? side : 0.0f;
+      }
+      if(farTime < exit)
+         exit = farTime;
+   }
+
+   if(enter > exit || exit < 0.0f || enter > 1.0f)
+      return false;
+
+   if(enter < 0.0f)
+   {
+      // Already inside the box.  Treat it as touching the face it's moving
+      // away from, so the bounce sends it back out.
+      enter = 0.0f;
+      normal.x = delta.x > 0.0f ? -1.0f : 1.0f;
+      normal.y = 0.0f;
+   }
+
+   contact->time = enter;
+   contact->normal = normal;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::PaddleMove(PongPaddle* paddle, const PongConfig& config, int direction, float dtSeconds)
+{
+   float yVelocity = 0.0f;
+   if(direction > 0)
+      yVelocity = 1.0f;
+   else if(direction < 0)
+      yVelocity = -1.0f;
+   paddle->yVelocity = yVelocity;
+
+   float movement = ((config.paddleSpeed + PLAYER_PADDLE_SPEED_BONUS) * yVelocity) * dtSeconds;
+
+   // Don't let the paddle leave the screen.
+   float height = config.paddleSize[paddle->playerNumber].y;
+   float newY = paddle->position.y + movement;
+   if((newY > config.screenHeight - height && yVelocity > 0.0f) || (newY < 0.0f && yVelocity < 0.0f))
+      return;
+   paddle->position.y = newY;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::AiPaddleMove(PongPaddle* paddle, PongAiPlan* plan, const PongBall& ball, const PongPaddle& opponent,
+   const PongConfig& config, unsigned int* randomState, float dtSeconds)
+{
+   int player = paddle->playerNumber;
+
+   // The ball only changes speed or horizontal direction when something hits
+   // it, so that's when to make a new plan.  The velocity is clamped first,
+   // since the ball's speed is only clamped on its next step.
+   PongVector velocity = ball.velocity;
+   BallVelocityClamp(&velocity, config);
+   if(velocity.x != plan->ballVelocity.x ||
+      (velocity.y != plan->ballVelocity.y && velocity.y != -plan->ballVelocity.y))
+   {
+      plan->ballVelocity = velocity;
+
+      // Go for where the ball will cross the front of the paddle, give or
+      // take the error, and swing toward the middle of the screen.  The
+      // lookahead AI plays out other ways of returning it, and may pick a
+      // different spot on the paddle and way to swing.  If the ball is heading
+      // the other way, go back to the middle.
+      PongBall clamped = ball;
+      clamped.velocity = velocity;
+      float y;
+      if(InterceptSolve(clamped, config, AiPlaneXGet(*paddle, config), &y, &plan->impactRemaining))
+      {
+         plan->nextTargetY = y;
+         plan->swingDirection = y < config.screenHeight / 2 ? 1.0f : -1.0f;
+         if(config.aiLookahead[player])
+         {
+            PongLookahead::PlanChoose(clamped, *paddle, opponent, config, y, plan->impactRemaining,
+               config.aiReactionTime[player], config.aiError[player], &plan->nextTargetY, &plan->swingDirection);
+         }
+         plan->nextTargetY += (RandomF(randomState) * 2.0f - 1.0f) * config.aiError[player];
+      }
+      else
+      {
+         plan->nextTargetY = config.screenHeight / 2;
+         plan->impactRemaining = -1.0f;
+      }
+      plan->reactionRemaining = config.aiReactionTime[player];
+   }
+
+   // Keep going for the old target until the AI has reacted.
+   if(plan->reactionRemaining > 0.0f)
+      plan->reactionRemaining -= dtSeconds;
+   if(plan->reactionRemaining <= 0.0f)
+      plan->targetY = plan->nextTargetY;
+
+   // Wait a little to one side of the target, then swing through it, timed
+   // so the paddle is at full speed at the moment it hits.
+   float goalY = plan->targetY;
+   if(plan->reactionRemaining <= 0.0f && plan->impactRemaining >= 0.0f)
+   {
+      float swingTime = PONG_AI_SWING_DISTANCE / 2 / config.paddleSpeed;
+      if(plan->impactRemaining > swingTime)
+         goalY -= plan->swingDirection * PONG_AI_SWING_DISTANCE / 2;
+      else
+         goalY += plan->swingDirection * PONG_AI_SWING_DISTANCE / 2;
+   }
+   if(plan->impactRemaining >= 0.0f)
+      plan->impactRemaining -= dtSeconds;
+
+   // Head for the goal at full speed, and stop there.
+   float height = config.paddleSize[player].y;
+   float distance = goalY - (paddle->position.y + height / 2);
+   float maxMovement = config.paddleSpeed * dtSeconds;
+   float movement = distance;
+   if(movement > maxMovement)
+      movement = maxMovement;
+   else if(movement < -maxMovement)
+      movement = -maxMovement;
+   paddle->position.y += movement;
+
+   // Keep the paddle on screen.
+   if(paddle->position.y < 0.0f)
+      paddle->position.y = 0.0f;
+   else if(paddle->position.y + height > config.screenHeight)
+      paddle->position.y = config.screenHeight - height;
+
+   // AI paddles have always kept their velocity with the sign flipped.
+   paddle->yVelocity = dtSeconds > 0.0f ? -movement / dtSeconds : 0.0f;
+}
+
+//------------------------------------------------------------------------------
+
+void PongSim::AiPlanReset(PongAiPlan* plan, const PongConfig& config)
+{
+   plan->ballVelocity.x = 0.0f;
+   plan->ballVelocity.y = 0.0f;
+   plan->targetY = config.screenHeight / 2;
+   plan->nextTargetY = plan->targetY;
+   plan->reactionRemaining = 0.0f;
+   plan->impactRemaining = -1.0f;
+   plan->swingDirection = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+
+float PongSim::AiPlaneXGet(const PongPaddle& paddle, const PongConfig& config)
+{
+   // The left paddle is hit on its right side, and the right paddle on its
+   // left side.
+   float halfBallSize = config.ballSize / 2;
+   if(paddle.playerNumber == PONG_PADDLE_LEFT)
+      return paddle.position.x + config.paddleSize[paddle.playerNumber].x + halfBallSize;
+   return paddle.position.x - halfBallSize;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSim::InterceptSolve(const PongBall& ball, const PongConfig& config, float planeX, float* y, float* time)
+{
+   float dx = planeX - ball.position.x;
+   if(ball.velocity.x == 0.0f || (dx > 0.0f) != (ball.velocity.x > 0.0f))
+      return false;
+
+   // Follow the ball in a straight line as if there were no walls, then fold
+   // the result back into the area the center of the ball stays in.  Each
+   // bounce off a wall is a reflection, so the path repeats every two
+   // heights of that area.
+   *time = dx / ball.velocity.x;
+   float halfBallSize = config.ballSize / 2;
+   float minY = halfBallSize;
+   float range = config.screenHeight - config.ballSize;
+   if(range <= 0.0f)
+   {
+      *y = config.screenHeight / 2;
+      return true;
+   }
+
+   float offset = fmodf(ball.position.y + ball.velocity.y * *time - minY, 2.0f * range);
+   if(offset < 0.0f)
+      offset += 2.0f * range;
+   if(offset > range)
+      offset = 2.0f * range - offset;
+   *y = minY + offset;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+PongBox PongSim::PaddleBoxGet(const PongPaddle& paddle, const PongConfig& config)
+{
+   const PongVector& size = config.paddleSize[paddle.playerNumber];
+   PongBox box = {paddle.position.x, paddle.position.y,
+      paddle.position.x + size.x, paddle.position.y + size.y};
+   return box;
+}
+
+//------------------------------------------------------------------------------
+
+PongVector PongSim::Lerp(const PongVector& from, const PongVector& to, float alpha)
+{
+   PongVector result = {from.x + (to.x - from.x) * alpha, from.y + (to.y - from.y) * alpha};
+   return result;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSim::ContinuousCheck(const PongState& from, const PongState& to)
+{
+   // Goals and new games put the ball and paddles back where they started.
+   return from.gameState == to.gameState && from.playerScore1 == to.playerScore1 &&
+      from.playerScore2 == to.playerScore2;
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSim::VisibleChangeCheck(const PongState& from, const PongState& to)
+{
+   if(!ContinuousCheck(from, to) || from.powerUpState != to.powerUpState)
+      return true;
+   if(from.ball.position.x != to.ball.position.x || from.ball.position.y != to.ball.position.y)
+      return true;
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      if(from.paddles[i].position.x != to.paddles[i].position.x ||
+         from.paddles[i].position.y != to.paddles[i].position.y)
+         return true;
+   }
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+   {
+      if(from.powerUps[i].active != to.powerUps[i].active)
+         return true;
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+
+float PongSim::RandomF(unsigned int* randomState)
+{
+   // xorshift32
+   unsigned int x = *randomState;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   *randomState = x;
+
+   // Use the top 24 bits so the result is exactly representable.
+   return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,371 @@
+#ifndef __PONGSIM_H__
+#define __PONGSIM_H__
+
+// The simulation layer holds the rules of the game as plain data and free of
+// any Frog singletons, so it can be stepped without a screen, keyboard or
+// clock.  MainGame is a frontend that feeds it input and draws the results.
+
+namespace Webfoot {
+
+enum State {STATE_PAUSED=0, STATE_PLAYING, STATE_SCORED, STATE_END };
+enum PowerUpState {PWR_UP_STATE_NONE=0, PWR_UP_STATE_DUANE};
+
+/// How hard an AI paddle is to beat.  See the PONG_AI_* settings below.
+enum PongAiDifficulty
+{
+   PONG_AI_EASY,
+   PONG_AI_MEDIUM,
+   PONG_AI_HARD,
+   PONG_AI_EXPERT,
+   PONG_AI_DIFFICULTY_COUNT
+};
+
+/// Bit flags returned by PongSim::Step describing what happened in that step.
+enum PongEvent
+{
+   PONG_EVENT_NONE = 0,
+   /// The ball bounced off a paddle.
+   PONG_EVENT_PADDLE_HIT = 1 << 0,
+   /// The ball bounced off the edge of the screen.
+   PONG_EVENT_WALL_BOUNCE = 1 << 1,
+   /// Someone scored.
+   PONG_EVENT_GOAL = 1 << 2,
+   /// Someone reached the winning score.
+   PONG_EVENT_GAME_END = 1 << 3,
+   /// The ball was put back into play after a pause or a goal.
+   PONG_EVENT_SERVE = 1 << 4,
+   /// The scores were reset for a new game.
+   PONG_EVENT_RESET = 1 << 5,
+   /// A power-up appeared on the field.
+   PONG_EVENT_POWER_UP_SPAWN = 1 << 6,
+   /// The ball picked up a power-up.
+   PONG_EVENT_POWER_UP = 1 << 7
+};
+
+/// Index of the paddle on the left of the screen, normally the AI.
+#define PONG_PADDLE_LEFT 0
+/// Index of the paddle on the right of the screen, normally the player.
+#define PONG_PADDLE_RIGHT 1
+/// Number of paddles in a match.
+#define PONG_PADDLE_COUNT 2
+
+/// Number of simulation steps per second.  The simulation is always stepped
+/// by exactly 1 / PONG_TICK_RATE seconds, so the game plays the same at any
+/// frame rate.
+#define PONG_TICK_RATE 240
+/// Seconds AI paddles take to react, and pixels they can be off by, at each
+/// difficulty.
+#define PONG_AI_EASY_REACTION_TIME 0.35f
+#define PONG_AI_EASY_ERROR 110.0f
+#define PONG_AI_MEDIUM_REACTION_TIME 0.25f
+#define PONG_AI_MEDIUM_ERROR 90.0f
+#define PONG_AI_HARD_REACTION_TIME 0.12f
+#define PONG_AI_HARD_ERROR 80.0f
+/// The expert AI also looks ahead.  See PongConfig::aiLookahead.
+#define PONG_AI_EXPERT_REACTION_TIME 0.12f
+#define PONG_AI_EXPERT_ERROR 70.0f
+
+/// Pixels an AI paddle swings through the ball when it hits it, so that it's
+/// moving and speeds the ball up.
+#define PONG_AI_SWING_DISTANCE 80.0f
+
+/// Paddles moving faster than this speed the ball up by the factor when they
+/// hit it.  Anything slower slows it down by the factor.
+#define PONG_PADDLE_HIT_SPEED_THRESHOLD 0.8f
+#define PONG_PADDLE_HIT_SPEED_FACTOR 1.5f
+
+/// Most power-ups that can be on the field at once.
+#define PONG_POWER_UP_MAX 4
+
+/// Most steps to take for one frame.  After a very long frame, the rest of the
+/// time is dropped rather than letting the game fall further and further
+/// behind.
+#define PONG_MAX_TICKS_PER_FRAME 24
+
+//==============================================================================
+
+/// 2D vector used by the simulation in place of Point2F.
+struct PongVector
+{
+   float x;
+   float y;
+};
+
+/// Axis-aligned box given by its minimum and maximum corners.
+struct PongBox
+{
+   float minX;
+   float minY;
+   float maxX;
+   float maxY;
+};
+
+/// Where and when a moving point first touches a box.
+struct PongContact
+{
+   /// Time of impact.  Either a fraction of the sweep or seconds, depending
+   /// on who filled it in.
+   float time;
+   /// Direction the touched face of the box points in.
+   PongVector normal;
+};
+
+/// State of the ball.  The position is the center of the ball.
+struct PongBall
+{
+   PongVector position;
+   /// Velocity in pixels per second.
+   PongVector velocity;
+   /// Player number of the last paddle to hit the ball, or -1 for none.
+   int playerHit;
+};
+
+/// State of a paddle.  The position is the top-left corner of the paddle.
+struct PongPaddle
+{
+   PongVector position;
+   /// Keyboard paddles use -1, 0 or 1.  AI paddles use pixels per second with
+   /// the sign flipped, the way AiPaddle::MovePaddle always has.
+   float yVelocity;
+   int playerNumber;
+};
+
+/// What an AI paddle is going for.  The AI works out where the ball will
+/// cross its paddle once each time the ball is hit or served, rather than
+/// chasing the ball on every step.
+struct PongAiPlan
+{
+   /// Velocity of the ball, after clamping, when the plan was made.  Bounces
+   /// off the walls are part of the plan, so only a change in speed or in
+   /// horizontal direction calls for a new one.
+   PongVector ballVelocity;
+   /// Where the middle of the paddle is headed.
+   float targetY;
+   /// Where the middle of the paddle will head once the AI has reacted.
+   float nextTargetY;
+   /// Seconds until the AI reacts to the latest plan.
+   float reactionRemaining;
+   /// Seconds until the ball reaches the paddle, or less than 0 if it's
+   /// heading the other way.
+   float impactRemaining;
+   /// Which way to swing the paddle through the ball.  1 is down and -1 is up.
+   float swingDirection;
+};
+
+/// A power-up waiting on the field for the ball to pick it up.  Power-ups are
+/// kept in a fixed-size pool in PongState, so spawning one never allocates.
+struct PongPowerUp
+{
+   /// Where it is.  The ball picks it up by touching this.
+   PongBox box;
+   /// Seconds until it disappears if the ball doesn't get it.
+   float timeRemaining;
+   /// False if this slot of the pool is free.
+   bool active;
+};
+
+/// Everything about a match that changes from step to step.  This is plain
+/// data, so it can be copied to take a snapshot of the match.
+struct PongState
+{
+   PongBall ball;
+   PongPaddle paddles[PONG_PADDLE_COUNT];
+   /// Plans of the AI paddles.  Unused for keyboard paddles.
+   PongAiPlan aiPlans[PONG_PADDLE_COUNT];
+
+   /// Score of the player on the right.  Goes up when the ball passes the
+   /// left goal.
+   int playerScore1;
+   /// Score of the player on the left.  Goes up when the ball passes the
+   /// right goal.
+   int playerScore2;
+
+   State gameState;
+   PowerUpState powerUpState;
+
+   /// Pool of power-ups.  Only the active ones are on the field.
+   PongPowerUp powerUps[PONG_POWER_UP_MAX];
+   /// Seconds until the next power-up appears.
+   float powerUpSpawnRemaining;
+   /// Seconds until the effect of the last power-up picked up wears off.
+   float powerUpEffectRemaining;
+   /// Random number generator state for power-ups.  This is kept apart from
+   /// 'randomState' so turning power-ups on or off doesn't change how the AI
+   /// plays.
+   unsigned int powerUpRandomState;
+
+   /// Random number generator state, so matches are repeatable from a seed.
+   unsigned int randomState;
+   /// Number of steps taken since PongSim::Init.
+   unsigned int tick;
+};
+
+/// Everything about a match that stays the same from step to step.
+struct PongConfig
+{
+   float screenWidth;
+   float screenHeight;
+
+   /// Width and height of the ball.
+   float ballSize;
+   /// Width and height of each paddle.
+   PongVector paddleSize[PONG_PADDLE_COUNT];
+   /// Where each paddle returns to after a goal.
+   PongVector paddleStart[PONG_PADDLE_COUNT];
+   /// True if the paddle chases the ball on its own rather than following
+   /// PongInput::paddleDirection.
+   bool aiControlled[PONG_PADDLE_COUNT];
+
+   /// Ball passing this x coordinate scores for the player on the right.
+   float leftGoal;
+   /// Ball passing this x coordinate scores for the player on the left.
+   float rightGoal;
+
+   /// Speed of the ball along a given axis in pixels per second.
+   float ballAxisSpeed;
+   float ballMinSpeed;
+   float ballMaxSpeed;
+
+   float paddleSpeed;
+   /// Seconds each AI paddle takes to react to the ball being hit or served.
+   /// Higher is easier to beat.
+   float aiReactionTime[PONG_PADDLE_COUNT];
+   /// Most pixels each AI paddle can misjudge where the ball will be by.
+   /// Higher is easier to beat.
+   float aiError[PONG_PADDLE_COUNT];
+   /// True if the AI paddle plays out several ways of returning the ball and
+   /// picks the best, rather than just getting in the way of it.  See
+   /// PongLookahead.
+   bool aiLookahead[PONG_PADDLE_COUNT];
+
+   /// Score at which the match ends.
+   int winningScore;
+
+   /// True if power-ups appear during play.
+   bool powerUpsEnabled;
+   /// Width and height of each power-up.
+   PongVector powerUpSize;
+   /// Seconds between power-ups appearing, how long each stays on the field,
+   /// and how long its effect lasts once the ball picks it up.
+   float powerUpSpawnInterval;
+   float powerUpLifetime;
+   float powerUpEffectTime;
+};
+
+/// Input for a single step.
+struct PongInput
+{
+   /// -1 to move up, 1 to move down, 0 to stay.  Ignored for AI paddles.
+   int paddleDirection[PONG_PADDLE_COUNT];
+   /// True if the player asked to put the ball into play.
+   bool serve;
+   /// True if the player asked to start a new game after the match ended.
+   bool restart;
+};
+
+//==============================================================================
+
+/// The rules of the game, with no rendering, input or timing of its own.
+class PongSim
+{
+public:
+   PongSim();
+
+   /// Fill in 'config' with the game's usual settings for a screen of the
+   /// given size and the given ball and paddle sizes.
+   static void ConfigDefaultsSet(PongConfig* config, float screenWidth,
+      float screenHeight, float ballSize, const PongVector* paddleSizes);
+   /// Set the AI settings of 'paddle' in 'config' to those of 'difficulty'.
+   static void DifficultySet(PongConfig* config, int paddle, PongAiDifficulty difficulty);
+   /// Returns the difficulty called 'name', like "hard", or 'defaultValue'
+   /// if there isn't one by that name.
+   static PongAiDifficulty DifficultyFind(const char* name, PongAiDifficulty defaultValue);
+
+   /// Start a new match.  'seed' determines every random choice made in it.
+   void Init(const PongConfig& _config, unsigned int seed);
+
+   /// Advance the match by 'dtSeconds'.  Returns a combination of PongEvent
+   /// flags.
+   unsigned int Step(const PongInput& input, float dtSeconds);
+
+   /// Put the ball back in the middle and the paddles at their start.
+   void ResetRound();
+   /// Reset the scores and start a new round.
+   void ResetGame();
+
+   const PongState& StateGet() const { return state; }
+   /// Replace the state, for example to restore a snapshot.
+   void StateSet(const PongState& _state) { state = _state; }
+   const PongConfig& ConfigGet() const { return config; }
+
+   /// Set the ball moving from the center of the screen in a random direction.
+   static void BallServe(PongBall* ball, const PongConfig& config, unsigned int* randomState);
+   /// Clamp the ball's speed and move it, bouncing off any of the
+   /// PONG_PADDLE_COUNT 'paddles' it touches along the way and off the edges
+   /// of the screen.  Returns PONG_EVENT_PADDLE_HIT and/or
+   /// PONG_EVENT_WALL_BOUNCE.
+   static unsigned int BallUpdate(PongBall* ball, const PongPaddle* paddles, const PongConfig& config, float dtSeconds);
+   /// Find when the ball, moving for 'dtSeconds', first touches the given
+   /// paddle while heading toward that paddle's goal.  Returns true and fills
+   /// in 'contact' with the time in seconds if it does.
+   static bool Collide(const PongBall& ball, const PongPaddle& paddle, const PongConfig& config,
+      float dtSeconds, PongContact* contact);
+   /// Bounce the ball off 'paddle', given the normal of the face it hit.
+   static void Bounce(PongBall* ball, const PongPaddle& paddle, const PongVector& normal);
+   /// Find when the point 'start', moving by 'delta', first touches 'box'.
+   /// Returns true and fills in 'contact' with the time as a fraction of
+   /// 'delta' if it does.  A point that starts inside the box touches it at
+   /// time 0 on the face it is moving away from.
+   static bool Sweep(const PongVector& start, const PongVector& delta, const PongBox& box, PongContact* contact);
+   /// Move a keyboard paddle in 'direction', as long as it stays on screen.
+   static void PaddleMove(PongPaddle* paddle, const PongConfig& config, int direction, float dtSeconds);
+   /// Make a new plan if the ball's velocity has changed since the last one,
+   /// then move an AI paddle toward its target.
+   static void AiPaddleMove(PongPaddle* paddle, PongAiPlan* plan, const PongBall& ball, const PongPaddle& opponent,
+      const PongConfig& config, unsigned int* randomState, float dtSeconds);
+   /// Reset 'plan' so the AI makes a new one on its next step.
+   static void AiPlanReset(PongAiPlan* plan, const PongConfig& config);
+   /// Returns the x coordinate the center of the ball is at when it touches
+   /// the front of 'paddle'.
+   static float AiPlaneXGet(const PongPaddle& paddle, const PongConfig& config);
+   /// Find where and in how many seconds the center of the ball, moving with
+   /// its current velocity, crosses 'planeX', bouncing off the top and bottom
+   /// of the screen on the way.  Returns false if the ball is moving away from
+   /// 'planeX'.
+   static bool InterceptSolve(const PongBall& ball, const PongConfig& config, float planeX, float* y, float* time);
+   /// Returns true if any part of the ball is touching 'box'.  This is the
+   /// collision test for anything the ball passes through rather than
+   /// bouncing off of, like power-ups.
+   static bool BallTouchCheck(const PongBall& ball, const PongBox& box, const PongConfig& config);
+   /// Keep 'velocity' within the ball's minimum and maximum speeds.
+   static void BallVelocityClamp(PongVector* velocity, const PongConfig& config);
+   /// Returns the collision box of the given paddle.
+   static PongBox PaddleBoxGet(const PongPaddle& paddle, const PongConfig& config);
+
+   /// Returns the point 'alpha' of the way from 'from' to 'to'.
+   static PongVector Lerp(const PongVector& from, const PongVector& to, float alpha);
+   /// Returns true if 'to' follows on from 'from' without anything being put
+   /// back at its start, so it makes sense to draw positions in between.
+   static bool ContinuousCheck(const PongState& from, const PongState& to);
+   /// Returns true if anything that gets drawn is different in 'to' than in
+   /// 'from'.
+   static bool VisibleChangeCheck(const PongState& from, const PongState& to);
+
+   /// Returns a random number in [0, 1) and advances 'randomState'.
+   static float RandomF(unsigned int* randomState);
+
+protected:
+   /// Count down the power-ups and their effect, spawn new ones, and let the
+   /// ball pick them up.  Returns PONG_EVENT_POWER_UP_SPAWN and/or
+   /// PONG_EVENT_POWER_UP.
+   unsigned int PowerUpsUpdate(float dtSeconds);
+
+   PongConfig config;
+   PongState state;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGSIM_H__
@@ -0,0 +1,297 @@
+#include <cmath>
+#include <cstring>
+#include "PongSnapshot.h"
+
+using namespace Webfoot;
+
+/// Bits for the version at the start of every snapshot.
+#define VERSION_BITS 4
+/// Bits of the baseline's tick a difference carries, to tell whether the
+/// decoder has the right baseline.
+#define BASELINE_TAG_BITS 8
+/// Sizes a number can be written at.  Each number is preceded by 2 bits
+/// saying which.
+static const int valueBits[4] = {4, 8, 16, 32};
+
+//==============================================================================
+
+/// Writes numbers of any number of bits one after the other, low bits first.
+/// Bits are gathered 64 at a time and written out a byte at a time.
+class BitWriter
+{
+public:
+   BitWriter(unsigned char* _data, int _capacity)
+   {
+      data = _data;
+      capacity = _capacity;
+      size = 0;
+      scratch = 0;
+      scratchBits = 0;
+      overflow = false;
+   }
+
+   /// Write the low 'bits' bits of 'value'.
+   void Write(unsigned int value, int bits)
+   {
+      if(bits < 32)
+         value &= (1u << bits) - 1;
+      scratch |= (unsigned long long)value << scratchBits;
+      scratchBits += bits;
+      while(scratchBits >= 8)
+         ByteWrite();
+   }
+
+   /// Write 'value' in the smallest of the sizes that fits.  Small numbers
+   /// either side of 0 come out smallest.
+   void SignedWrite(int value)
+   {
+      // Zigzag, so -1 is 1, 1 is 2, -2 is 3 and so on.
+      unsigned int zigzag = ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+      int sizeIndex = 0;
+      while(sizeIndex < 3 && (zigzag >> valueBits[sizeIndex]))
+         sizeIndex++;
+      Write((unsigned int)sizeIndex, 2);
+      Write(zigzag, valueBits[sizeIndex]);
+   }
+
+   /// Write out any bits left over.  Returns the bytes written, or 0 if they
+   /// didn't all fit.
+   int Finish()
+   {
+      if(scratchBits > 0)
+         ByteWrite();
+      scratchBits = 0;
+      return overflow ? 0 : size;
+   }
+
+protected:
+   void ByteWrite()
+   {
+      if(size < capacity)
+         data[size++] = (unsigned char)scratch;
+      else
+         overflow = true;
+      scratch >>= 8;
+      scratchBits -= 8;
+   }
+
+   unsigned char* data;
+   int capacity;
+   int size;
+   unsigned long long scratch;
+   int scratchBits;
+   bool overflow;
+};
+
+//------------------------------------------------------------------------------
+
+/// Reads what a BitWriter wrote.
+class BitReader
+{
+public:
+   BitReader(const unsigned char* _data, int _size)
+   {
+      data = _data;
+      size = _size;
+      position = 0;
+      scratch = 0;
+      scratchBits = 0;
+      overflow = false;
+   }
+
+   unsigned int Read(int bits)
+   {
+      while(scratchBits < bits)
+      {
+         if(position >= size)
+         {
+            overflow = true;
+            return 0;
+         }
+         scratch |= (unsigned long long)data[position++] << scratchBits;
+         scratchBits += 8;
+      }
+      unsigned int value = (unsigned int)(scratch & ((1ull << bits) - 1));
+      scratch >>= bits;
+      scratchBits -= bits;
+      return value;
+   }
+
+   int SignedRead()
+   {
+      unsigned int zigzag = Read(valueBits[Read(2)]);
+      return (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+   }
+
+   /// Returns true if anything was read past the end.
+   bool OverflowCheck() const { return overflow; }
+
+protected:
+   const unsigned char* data;
+   int size;
+   int position;
+   unsigned long long scratch;
+   int scratchBits;
+   bool overflow;
+};
+
+//------------------------------------------------------------------------------
+
+/// Returns 'value' times 'scale', to the nearest whole number.
+static int Quantize(float value, float scale)
+{
+   return (int)floorf(value * scale + 0.5f);
+}
+
+//==============================================================================
+
+void PongSnapshotCoder::Capture(const PongState& state, PongSnapshot* snapshot)
+{
+   int* fields = snapshot->fields;
+   snapshot->tick = state.tick;
+   fields[PONG_SNAPSHOT_BALL_X] = Quantize(state.ball.position.x, PONG_SNAPSHOT_POSITION_SCALE);
+   fields[PONG_SNAPSHOT_BALL_Y] = Quantize(state.ball.position.y, PONG_SNAPSHOT_POSITION_SCALE);
+   fields[PONG_SNAPSHOT_BALL_VELOCITY_X] = Quantize(state.ball.velocity.x, PONG_SNAPSHOT_VELOCITY_SCALE);
+   fields[PONG_SNAPSHOT_BALL_VELOCITY_Y] = Quantize(state.ball.velocity.y, PONG_SNAPSHOT_VELOCITY_SCALE);
+   fields[PONG_SNAPSHOT_BALL_PLAYER_HIT] = state.ball.playerHit;
+   fields[PONG_SNAPSHOT_LEFT_PADDLE_Y] = Quantize(state.paddles[PONG_PADDLE_LEFT].position.y, PONG_SNAPSHOT_POSITION_SCALE);
+   fields[PONG_SNAPSHOT_RIGHT_PADDLE_Y] = Quantize(state.paddles[PONG_PADDLE_RIGHT].position.y, PONG_SNAPSHOT_POSITION_SCALE);
+   fields[PONG_SNAPSHOT_LEFT_PADDLE_VELOCITY] = Quantize(state.paddles[PONG_PADDLE_LEFT].yVelocity, PONG_SNAPSHOT_VELOCITY_SCALE);
+   fields[PONG_SNAPSHOT_RIGHT_PADDLE_VELOCITY] = Quantize(state.paddles[PONG_PADDLE_RIGHT].yVelocity, PONG_SNAPSHOT_VELOCITY_SCALE);
+   fields[PONG_SNAPSHOT_PLAYER_SCORE_1] = state.playerScore1;
+   fields[PONG_SNAPSHOT_PLAYER_SCORE_2] = state.playerScore2;
+   fields[PONG_SNAPSHOT_GAME_STATE] = (int)state.gameState;
+   fields[PONG_SNAPSHOT_POWER_UP_STATE] = (int)state.powerUpState;
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+   {
+      const PongPowerUp& powerUp = state.powerUps[i];
+      int* powerUpFields = &fields[PONG_SNAPSHOT_POWER_UPS + i * PONG_SNAPSHOT_POWER_UP_FIELD_COUNT];
+      powerUpFields[PONG_SNAPSHOT_POWER_UP_ACTIVE] = powerUp.active ? 1 : 0;
+      powerUpFields[PONG_SNAPSHOT_POWER_UP_MIN_X] = Quantize(powerUp.box.minX, PONG_SNAPSHOT_POSITION_SCALE);
+      powerUpFields[PONG_SNAPSHOT_POWER_UP_MIN_Y] = Quantize(powerUp.box.minY, PONG_SNAPSHOT_POSITION_SCALE);
+      powerUpFields[PONG_SNAPSHOT_POWER_UP_MAX_X] = Quantize(powerUp.box.maxX, PONG_SNAPSHOT_POSITION_SCALE);
+      powerUpFields[PONG_SNAPSHOT_POWER_UP_MAX_Y] = Quantize(powerUp.box.maxY, PONG_SNAPSHOT_POSITION_SCALE);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void PongSnapshotCoder::Apply(const PongSnapshot& snapshot, PongState* state)
+{
+   const int* fields = snapshot.fields;
+   state->tick = snapshot.tick;
+   state->ball.position.x = fields[PONG_SNAPSHOT_BALL_X] / PONG_SNAPSHOT_POSITION_SCALE;
+   state->ball.position.y = fields[PONG_SNAPSHOT_BALL_Y] / PONG_SNAPSHOT_POSITION_SCALE;
+   state->ball.velocity.x = fields[PONG_SNAPSHOT_BALL_VELOCITY_X] / PONG_SNAPSHOT_VELOCITY_SCALE;
+   state->ball.velocity.y = fields[PONG_SNAPSHOT_BALL_VELOCITY_Y] / PONG_SNAPSHOT_VELOCITY_SCALE;
+   state->ball.playerHit = fields[PONG_SNAPSHOT_BALL_PLAYER_HIT];
+   state->paddles[PONG_PADDLE_LEFT].position.y = fields[PONG_SNAPSHOT_LEFT_PADDLE_Y] / PONG_SNAPSHOT_POSITION_SCALE;
+   state->paddles[PONG_PADDLE_RIGHT].position.y = fields[PONG_SNAPSHOT_RIGHT_PADDLE_Y] / PONG_SNAPSHOT_POSITION_SCALE;
+   state->paddles[PONG_PADDLE_LEFT].yVelocity = fields[PONG_SNAPSHOT_LEFT_PADDLE_VELOCITY] / PONG_SNAPSHOT_VELOCITY_SCALE;
+   state->paddles[PONG_PADDLE_RIGHT].yVelocity = fields[PONG_SNAPSHOT_RIGHT_PADDLE_VELOCITY] / PONG_SNAPSHOT_VELOCITY_SCALE;
+   state->playerScore1 = fields[PONG_SNAPSHOT_PLAYER_SCORE_1];
+   state->playerScore2 = fields[PONG_SNAPSHOT_PLAYER_SCORE_2];
+   state->gameState = (State)fields[PONG_SNAPSHOT_GAME_STATE];
+   state->powerUpState = (PowerUpState)fields[PONG_SNAPSHOT_POWER_UP_STATE];
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+   {
+      PongPowerUp& powerUp = state->powerUps[i];
+      const int* powerUpFields = &fields[PONG_SNAPSHOT_POWER_UPS + i * PONG_SNAPSHOT_POWER_UP_FIELD_COUNT];
+      powerUp.active = powerUpFields[PONG_SNAPSHOT_POWER_UP_ACTIVE] != 0;
+      powerUp.box.minX = powerUpFields[PONG_SNAPSHOT_POWER_UP_MIN_X] / PONG_SNAPSHOT_POSITION_SCALE;
+      powerUp.box.minY = powerUpFields[PONG_SNAPSHOT_POWER_UP_MIN_Y] / PONG_SNAPSHOT_POSITION_SCALE;
+      powerUp.box.maxX = powerUpFields[PONG_SNAPSHOT_POWER_UP_MAX_X] / PONG_SNAPSHOT_POSITION_SCALE;
+      powerUp.box.maxY = powerUpFields[PONG_SNAPSHOT_POWER_UP_MAX_Y] / PONG_SNAPSHOT_POSITION_SCALE;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+int PongSnapshotCoder::Encode(const PongSnapshot* baseline, const PongSnapshot& snapshot, unsigned char* buffer, int capacity)
+{
+   BitWriter writer(buffer, capacity);
+   writer.Write(PONG_SNAPSHOT_VERSION, VERSION_BITS);
+   writer.Write(baseline ? 0 : 1, 1);
+
+   // A keyframe is the difference from all zeros.
+   PongSnapshot zero;
+   if(!baseline)
+   {
+      memset(&zero, 0, sizeof(zero));
+      baseline = &zero;
+      writer.Write(snapshot.tick, 32);
+   }
+   else
+   {
+      writer.Write(baseline->tick, BASELINE_TAG_BITS);
+      writer.SignedWrite((int)(snapshot.tick - baseline->tick));
+   }
+
+   for(int i = 0; i < PONG_SNAPSHOT_FIELD_COUNT; i++)
+   {
+      int difference = snapshot.fields[i] - baseline->fields[i];
+      writer.Write(difference ? 1 : 0, 1);
+      if(difference)
+         writer.SignedWrite(difference);
+   }
+   return writer.Finish();
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSnapshotCoder::Decode(const PongSnapshot* baseline, const unsigned char* data, int size, PongSnapshot* snapshot)
+{
+   BitReader reader(data, size);
+   if(reader.Read(VERSION_BITS) != PONG_SNAPSHOT_VERSION)
+      return false;
+
+   PongSnapshot zero;
+   if(reader.Read(1))
+   {
+      memset(&zero, 0, sizeof(zero));
+      baseline = &zero;
+      snapshot->tick = reader.Read(32);
+   }
+   else
+   {
+      unsigned int tag = reader.Read(BASELINE_TAG_BITS);
+      if(!baseline || tag != (baseline->tick & ((1u << BASELINE_TAG_BITS) - 1)))
+         return false;
+      snapshot->tick = baseline->tick + (unsigned int)reader.SignedRead();
+   }
+
+   for(int i = 0; i < PONG_SNAPSHOT_FIELD_COUNT; i++)
+   {
+      int difference = 0;
+      if(reader.Read(1))
+         difference = reader.SignedRead();
+      snapshot->fields[i] = baseline->fields[i] + difference;
+   }
+   return !reader.OverflowCheck();
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSnapshotCoder::KeyframeCheck(const unsigned char* data, int size)
+{
+   BitReader reader(data, size);
+   if(reader.Read(VERSION_BITS) != PONG_SNAPSHOT_VERSION)
+      return false;
+   return reader.Read(1) && !reader.OverflowCheck();
+}
+
+//------------------------------------------------------------------------------
+
+bool PongSnapshotCoder::EqualCheck(const PongSnapshot& a, const PongSnapshot& b)
+{
+   if(a.tick != b.tick)
+      return false;
+   for(int i = 0; i < PONG_SNAPSHOT_FIELD_COUNT; i++)
+   {
+      if(a.fields[i] != b.fields[i])
+         return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
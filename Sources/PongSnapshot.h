@@ -0,0 +1,105 @@
+#ifndef __PONGSNAPSHOT_H__
+#define __PONGSNAPSHOT_H__
+
+#include "PongSim.h"
+
+namespace Webfoot {
+
+/// Changes whenever the encoding does.  Snapshots from any other version
+/// aren't decoded.
+#define PONG_SNAPSHOT_VERSION 2
+/// Positions are kept to the nearest 1 / PONG_SNAPSHOT_POSITION_SCALE of a
+/// pixel, and velocities to the nearest 1 / PONG_SNAPSHOT_VELOCITY_SCALE of a
+/// pixel per second.
+#define PONG_SNAPSHOT_POSITION_SCALE 8.0f
+#define PONG_SNAPSHOT_VELOCITY_SCALE 4.0f
+/// Most bytes an encoded snapshot can take.
+#define PONG_SNAPSHOT_SIZE_MAX 128
+
+//==============================================================================
+
+/// Fields of each power-up in a PongSnapshot.
+enum PongSnapshotPowerUpField
+{
+   /// 1 if the power-up is on the field, or 0.
+   PONG_SNAPSHOT_POWER_UP_ACTIVE,
+   PONG_SNAPSHOT_POWER_UP_MIN_X,
+   PONG_SNAPSHOT_POWER_UP_MIN_Y,
+   PONG_SNAPSHOT_POWER_UP_MAX_X,
+   PONG_SNAPSHOT_POWER_UP_MAX_Y,
+   PONG_SNAPSHOT_POWER_UP_FIELD_COUNT
+};
+
+/// Fields of a PongSnapshot.
+enum PongSnapshotField
+{
+   PONG_SNAPSHOT_BALL_X,
+   PONG_SNAPSHOT_BALL_Y,
+   PONG_SNAPSHOT_BALL_VELOCITY_X,
+   PONG_SNAPSHOT_BALL_VELOCITY_Y,
+   PONG_SNAPSHOT_BALL_PLAYER_HIT,
+   PONG_SNAPSHOT_LEFT_PADDLE_Y,
+   PONG_SNAPSHOT_RIGHT_PADDLE_Y,
+   PONG_SNAPSHOT_LEFT_PADDLE_VELOCITY,
+   PONG_SNAPSHOT_RIGHT_PADDLE_VELOCITY,
+   PONG_SNAPSHOT_PLAYER_SCORE_1,
+   PONG_SNAPSHOT_PLAYER_SCORE_2,
+   PONG_SNAPSHOT_GAME_STATE,
+   PONG_SNAPSHOT_POWER_UP_STATE,
+   /// Where the fields of the power-ups start.  Power-up 'i' has its
+   /// PongSnapshotPowerUpField 'f' at PONG_SNAPSHOT_POWER_UPS +
+   /// i * PONG_SNAPSHOT_POWER_UP_FIELD_COUNT + f.
+   PONG_SNAPSHOT_POWER_UPS,
+   PONG_SNAPSHOT_FIELD_COUNT = PONG_SNAPSHOT_POWER_UPS + PONG_POWER_UP_MAX * PONG_SNAPSHOT_POWER_UP_FIELD_COUNT
+};
+
+/// The part of a PongState that's needed to show a match, rounded to whole
+/// numbers, including the power-ups on the field.  Everything needed to keep
+/// stepping the match, like the AI's plans, the random number generators and
+/// how long the power-ups have left, is left out, so this is for
+/// sending a match to something that only draws it.  Rollback copies the
+/// whole PongState instead.
+struct PongSnapshot
+{
+   unsigned int tick;
+   int fields[PONG_SNAPSHOT_FIELD_COUNT];
+};
+
+//==============================================================================
+
+/// Turns PongSnapshots into as few bytes as possible and back.  A snapshot is
+/// encoded as the difference from an earlier one, the baseline, that the
+/// other end already has.  Fields that didn't change take 1 bit, and fields
+/// that did take a few more for how much they changed by, so a typical tick
+/// takes a handful of bytes.  A snapshot encoded without a baseline is a
+/// keyframe, which can be decoded on its own.  This has no dependency on
+/// Frog.
+class PongSnapshotCoder
+{
+public:
+   /// Fill in 'snapshot' from 'state'.
+   static void Capture(const PongState& state, PongSnapshot* snapshot);
+   /// Set the fields of 'state' that 'snapshot' has.  The rest of 'state',
+   /// like the x positions of the paddles, is left as it was.
+   static void Apply(const PongSnapshot& snapshot, PongState* state);
+
+   /// Write 'snapshot' to 'buffer' as the difference from 'baseline', or as
+   /// a keyframe if 'baseline' is NULL.  Returns the size, or 0 if it didn't
+   /// fit in 'capacity' bytes.
+   static int Encode(const PongSnapshot* baseline, const PongSnapshot& snapshot, unsigned char* buffer, int capacity);
+   /// Read a snapshot from 'data'.  Returns false if it's from another
+   /// version, is cut short, or is the difference from some baseline other
+   /// than 'baseline'.
+   static bool Decode(const PongSnapshot* baseline, const unsigned char* data, int size, PongSnapshot* snapshot);
+   /// Returns true if 'data' holds a keyframe.
+   static bool KeyframeCheck(const unsigned char* data, int size);
+
+   /// Returns true if the two snapshots are the same.
+   static bool EqualCheck(const PongSnapshot& a, const PongSnapshot& b);
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PONGSNAPSHOT_H__
@@ -0,0 +1,305 @@
+#include <cstdio>
+#include "Profiler.h"
+
+using namespace Webfoot;
+
+/// Thread ID of the main thread.
+#define PROFILER_MAIN_THREAD 0
+
+Profiler Profiler::instance;
+std::atomic<unsigned short> Profiler::nextThreadID(0);
+thread_local int ProfileScope::depth = 0;
+
+/// Name of the zone covering each whole frame.  Zones are told apart by the
+/// address of their name, so this has to be one array rather than a literal
+/// repeated.
+static const char frameZoneName[] = "Frame";
+
+//------------------------------------------------------------------------------
+
+/// Write 'text' to 'file' as a JSON string, quotes included.
+static void JsonStringWrite(FILE* file, const char* text)
+{
+   fputc('"', file);
+   for(const unsigned char* c = (const unsigned char*)text; *c; c++)
+   {
+      if(*c == '"' || *c == '\\')
+         fprintf(file, "\\%c", *c);
+      else if(*c < 0x20)
+         fprintf(file, "\\u%04x", *c);
+      else
+         fputc(*c, file);
+   }
+   fputc('"', file);
+}
+
+//------------------------------------------------------------------------------
+
+Profiler::Profiler()
+{
+   enabled = false;
+   frameStart = 0;
+   writeIndex = 0;
+   readIndex = 0;
+   zoneCount = 0;
+   reportFrameCount = 0;
+   counterCount = 0;
+   for(int i = 0; i < PROFILER_SAMPLE_CAPACITY; i++)
+      slots[i].sequence = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::Init()
+{
+   // Make sure the thread calling Init is the main thread.
+   ThreadIDGet();
+
+   startTime = std::chrono::steady_clock::now();
+   frameStart = 0;
+   writeIndex = 0;
+   readIndex = 0;
+   for(int i = 0; i < PROFILER_SAMPLE_CAPACITY; i++)
+      slots[i].sequence = 0;
+
+   // Always list the whole frame first.
+   zoneCount = 0;
+   ZoneStatsGet(frameZoneName, -1);
+   reportFrameCount = 0;
+   counterCount = 0;
+
+   enabled = true;
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::Deinit()
+{
+   enabled = false;
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::FrameEnd()
+{
+   if(!EnabledCheck())
+      return;
+
+   SampleAdd(frameZoneName, frameStart, -1);
+   frameStart = TimeGet();
+
+   // If the ring has lapped us, what was missed is gone.
+   unsigned int end = writeIndex.load(std::memory_order_acquire);
+   if(end - readIndex > PROFILER_SAMPLE_CAPACITY)
+      readIndex = end - PROFILER_SAMPLE_CAPACITY;
+
+   // Sum up this frame's time in each zone on the main thread.
+   for(; readIndex != end; readIndex++)
+   {
+      Sample sample;
+      if(!SampleRead(readIndex, &sample) || sample.thread != PROFILER_MAIN_THREAD)
+         continue;
+      ZoneStats* zone = ZoneStatsGet(sample.name, (short)sample.depth);
+      if(!zone)
+         continue;
+      zone->frameTotal += sample.duration;
+      if(zone->frameStart < 0 || sample.start < zone->frameStart)
+         zone->frameStart = sample.start;
+   }
+   ZonesSort();
+
+   for(int i = 0; i < zoneCount; i++)
+   {
+      ZoneStats& zone = zones[i];
+      zone.reportTotal += zone.frameTotal;
+      if(zone.frameTotal > zone.reportWorst)
+         zone.reportWorst = zone.frameTotal;
+      zone.frameTotal = 0;
+      zone.frameStart = -1;
+   }
+   reportFrameCount++;
+}
+
+//------------------------------------------------------------------------------
+
+long long Profiler::TimeGet()
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - startTime).count();
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::SampleAdd(const char* name, long long start, int depth)
+{
+   long long end = TimeGet();
+
+   // Claim a slot, and mark it as being written until it's filled in.
+   unsigned int index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+   Slot& slot = slots[index & (PROFILER_SAMPLE_CAPACITY - 1)];
+   slot.sequence.store(0, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+
+   slot.sample.name = name;
+   slot.sample.start = start;
+   slot.sample.duration = (unsigned int)(end - start);
+   slot.sample.thread = ThreadIDGet();
+   slot.sample.depth = (unsigned short)depth;
+
+   slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------
+
+bool Profiler::SampleRead(unsigned int index, Sample* sample)
+{
+   Slot& slot = slots[index & (PROFILER_SAMPLE_CAPACITY - 1)];
+   if(slot.sequence.load(std::memory_order_acquire) != index + 1)
+      return false;
+   *sample = slot.sample;
+
+   // Make sure nobody started writing over it while it was being copied.
+   std::atomic_thread_fence(std::memory_order_acquire);
+   return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::CounterSet(const char* name, int value)
+{
+   for(int i = 0; i < counterCount; i++)
+   {
+      if(counters[i].name == name)
+      {
+         counters[i].value = value;
+         return;
+      }
+   }
+
+   if(counterCount < PROFILER_COUNTER_MAX)
+   {
+      counters[counterCount].name = name;
+      counters[counterCount].value = value;
+      counterCount++;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::ReportWrite(char* buffer, int bufferSize)
+{
+   if(bufferSize <= 0)
+      return;
+   buffer[0] = '\0';
+
+   int length = 0;
+   int frameCount = reportFrameCount ? reportFrameCount : 1;
+   for(int i = 0; i < zoneCount && length < bufferSize; i++)
+   {
+      ZoneStats& zone = zones[i];
+      float average = (float)zone.reportTotal / frameCount / 1000.0f;
+      float worst = (float)zone.reportWorst / 1000.0f;
+      length += snprintf(buffer + length, bufferSize - length, "%*s%s %.2f ms (%.2f)\n",
+         (zone.depth + 1) * 2, "", zone.name, average, worst);
+
+      zone.reportTotal = 0;
+      zone.reportWorst = 0;
+   }
+   reportFrameCount = 0;
+
+   for(int i = 0; i < counterCount && length < bufferSize; i++)
+      length += snprintf(buffer + length, bufferSize - length, "%s %d\n", counters[i].name, counters[i].value);
+}
+
+//------------------------------------------------------------------------------
+
+bool Profiler::TraceWrite(const char* path)
+{
+   FILE* file = fopen(path, "w");
+   if(!file)
+      return false;
+
+   fprintf(file, "{\"traceEvents\":[\n");
+
+   unsigned int end = writeIndex.load(std::memory_order_acquire);
+   unsigned int begin = end > PROFILER_SAMPLE_CAPACITY ? end - PROFILER_SAMPLE_CAPACITY : 0;
+   bool first = true;
+   for(unsigned int i = begin; i != end; i++)
+   {
+      Sample sample;
+      if(!SampleRead(i, &sample))
+         continue;
+      fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+      JsonStringWrite(file, sample.name);
+      fprintf(file, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%u,\"pid\":1,\"tid\":%u}",
+         sample.start, sample.duration, (unsigned int)sample.thread);
+      first = false;
+   }
+
+   fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+   return fclose(file) == 0;
+}
+
+//------------------------------------------------------------------------------
+
+Profiler::ZoneStats* Profiler::ZoneStatsGet(const char* name, int depth)
+{
+   // Names are string literals, so the same zone always has the same pointer.
+   for(int i = 0; i < zoneCount; i++)
+   {
+      if(zones[i].name == name)
+         return &zones[i];
+   }
+
+   if(zoneCount >= PROFILER_ZONE_MAX)
+      return NULL;
+
+   ZoneStats& zone = zones[zoneCount++];
+   zone.name = name;
+   zone.depth = depth;
+   zone.frameTotal = 0;
+   zone.frameStart = -1;
+   zone.reportTotal = 0;
+   zone.reportWorst = 0;
+   return &zone;
+}
+
+//------------------------------------------------------------------------------
+
+void Profiler::ZonesSort()
+{
+   // The whole frame always stays first.  There are only a few zones, and
+   // they're usually in order already, so an insertion sort is plenty.
+   for(int i = 2; i < zoneCount; i++)
+   {
+      ZoneStats zone = zones[i];
+      int j = i;
+      while(j > 1 && ZoneBeforeCheck(zone, zones[j - 1]))
+      {
+         zones[j] = zones[j - 1];
+         j--;
+      }
+      zones[j] = zone;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool Profiler::ZoneBeforeCheck(const ZoneStats& a, const ZoneStats& b)
+{
+   if(a.frameStart < 0)
+      return false;
+   return b.frameStart < 0 || a.frameStart < b.frameStart;
+}
+
+//------------------------------------------------------------------------------
+
+unsigned short Profiler::ThreadIDGet()
+{
+   static thread_local int threadID = -1;
+   if(threadID < 0)
+      threadID = nextThreadID.fetch_add(1);
+   return (unsigned short)threadID;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,185 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace Webfoot {
+
+/// Number of timings kept for exporting.  Must be a power of 2.
+#define PROFILER_SAMPLE_CAPACITY 16384
+/// Most distinct zones shown in the report.  Zones past this are still
+/// exported, just not reported.
+#define PROFILER_ZONE_MAX 32
+/// Most distinct counters shown in the report.
+#define PROFILER_COUNTER_MAX 8
+
+/// Time the rest of the enclosing block under 'name', which must be a string
+/// literal.
+#define PROFILE_SCOPE(name) ProfileScope _profileScope(name)
+
+//==============================================================================
+
+/// Times zones of code with very little overhead, so we can see where the
+/// frame goes.  Timings go into a lock-free ring buffer that any thread can
+/// add to.  Once a frame, the main thread sums its own timings into a running
+/// report for the HUD, and the whole ring can be written out in Chrome's
+/// trace format (load it at chrome://tracing).  This has no dependency on
+/// Frog.
+class Profiler
+{
+public:
+   Profiler();
+
+   void Init();
+   void Deinit();
+
+   /// Turn timing on or off.  Zones started while off aren't recorded.  Safe
+   /// to call from any thread, as is EnabledCheck.
+   void EnabledSet(bool _enabled) { enabled.store(_enabled, std::memory_order_relaxed); }
+   bool EnabledCheck() { return enabled.load(std::memory_order_relaxed); }
+
+   /// Call this from the main thread at the end of every frame.  Records the
+   /// whole frame as a zone and updates the report.
+   void FrameEnd();
+
+   /// Returns the current time in microseconds since Init.
+   long long TimeGet();
+   /// Record that the zone 'name' ran from 'start' until now.  'depth' is how
+   /// many zones it's inside of on its thread.
+   void SampleAdd(const char* name, long long start, int depth);
+
+   /// Show 'value' in the report under 'name', which must be a string
+   /// literal.
+   void CounterSet(const char* name, int value);
+
+   /// Write a report of the average and worst time of each zone on the main
+   /// thread since the last report, and the counters, to 'buffer'.
+   void ReportWrite(char* buffer, int bufferSize);
+   /// Write everything in the ring buffer to 'path' as a Chrome trace.
+   /// Returns true if successful.
+   bool TraceWrite(const char* path);
+
+   static Profiler instance;
+
+protected:
+   struct Sample
+   {
+      const char* name;
+      /// Start time in microseconds since Init.
+      long long start;
+      /// Duration in microseconds.
+      unsigned int duration;
+      unsigned short thread;
+      unsigned short depth;
+   };
+
+   struct Slot
+   {
+      Sample sample;
+      /// Index + 1 of the sample last written here, or 0 while it's being
+      /// written.  Readers use this to skip slots that are mid-write or have
+      /// been lapped.
+      std::atomic<unsigned int> sequence;
+   };
+
+   struct ZoneStats
+   {
+      const char* name;
+      int depth;
+      /// Time spent in the zone so far this frame.
+      unsigned int frameTotal;
+      /// When the zone was first entered this frame, or -1 if it hasn't been.
+      long long frameStart;
+      /// Sum and worst of the frame totals since the last report.
+      unsigned int reportTotal;
+      unsigned int reportWorst;
+   };
+
+   struct Counter
+   {
+      const char* name;
+      int value;
+   };
+
+   /// Copy the sample with the given index out of the ring.  Returns false if
+   /// it's being written or has already been overwritten.
+   bool SampleRead(unsigned int index, Sample* sample);
+   /// Returns the stats for the zone 'name', adding it if there's room.
+   ZoneStats* ZoneStatsGet(const char* name, int depth);
+   /// Put the zones in the order they were entered this frame, so children
+   /// come right after their parents.  Zones that weren't entered go last.
+   void ZonesSort();
+   /// Returns true if 'a' goes before 'b' when sorting zones.
+   static bool ZoneBeforeCheck(const ZoneStats& a, const ZoneStats& b);
+   /// Returns a small number identifying the calling thread.  The main thread
+   /// is whichever gets here first.
+   static unsigned short ThreadIDGet();
+
+   /// Read by every thread that opens a zone, so it's atomic.  Nothing else
+   /// is published through it, so relaxed is enough.
+   std::atomic<bool> enabled;
+   std::chrono::steady_clock::time_point startTime;
+   /// End of the last frame, in microseconds since Init.
+   long long frameStart;
+
+   Slot slots[PROFILER_SAMPLE_CAPACITY];
+   /// Index of the next sample to write.
+   std::atomic<unsigned int> writeIndex;
+   /// Index of the next sample for FrameEnd to look at.
+   unsigned int readIndex;
+
+   ZoneStats zones[PROFILER_ZONE_MAX];
+   int zoneCount;
+   /// Number of frames since the last report.
+   int reportFrameCount;
+
+   Counter counters[PROFILER_COUNTER_MAX];
+   int counterCount;
+
+   static std::atomic<unsigned short> nextThreadID;
+};
+
+Profiler* const theProfiler = &Profiler::instance;
+
+//==============================================================================
+
+/// Times from construction to destruction.  Use PROFILE_SCOPE rather than
+/// making these directly.
+class ProfileScope
+{
+public:
+   ProfileScope(const char* _name)
+   {
+      name = NULL;
+      start = 0;
+      if(theProfiler->EnabledCheck())
+      {
+         name = _name;
+         start = theProfiler->TimeGet();
+         depth++;
+      }
+   }
+
+   ~ProfileScope()
+   {
+      if(name)
+      {
+         depth--;
+         theProfiler->SampleAdd(name, start, depth);
+      }
+   }
+
+protected:
+   const char* name;
+   long long start;
+   /// Number of zones open on this thread.
+   static thread_local int depth;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __PROFILER_H__
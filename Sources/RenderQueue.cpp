@@ -0,0 +1,165 @@
+#include <algorithm>
+#include "Frog.h"
+#include "RenderQueue.h"
+
+using namespace Webfoot;
+
+//------------------------------------------------------------------------------
+
+RenderQueue::RenderQueue()
+{
+   drawCount = 0;
+   batchCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::Init(int capacity)
+{
+   items.clear();
+   items.reserve(capacity);
+   drawCount = 0;
+   batchCount = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::Deinit()
+{
+   // Swap with an empty vector to actually release the memory.
+   std::vector<Item>().swap(items);
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::Begin()
+{
+   // clear keeps the capacity, so queueing doesn't allocate once it has
+   // grown to fit a frame.
+   items.clear();
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::ImageAdd(int layer, Image* image, const Point2F& position)
+{
+   Item* item = ItemAdd(layer, image, ITEM_IMAGE);
+   item->image = image;
+   item->position = position;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::SpriteAdd(int layer, Sprite* sprite)
+{
+   Item* item = ItemAdd(layer, sprite, ITEM_SPRITE);
+   item->sprite = sprite;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::SpriteAdd(int layer, Sprite* sprite, const Point2F& position,
+   const Point2F& scale, unsigned int time)
+{
+   Item* item = ItemAdd(layer, sprite, ITEM_SPRITE_PLACED);
+   item->sprite = sprite;
+   item->position = position;
+   item->scale = scale;
+   item->time = time;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::AtlasFrameAdd(int layer, TextureAtlas* atlas, const AtlasFrame* frame,
+   const Point2F& position, const Point2F& scale)
+{
+   // Frames on the same page share a texture.
+   Item* item = ItemAdd(layer, atlas->PageGet(frame->page), ITEM_ATLAS_FRAME);
+   item->atlas = atlas;
+   item->frame = frame;
+   item->position = position;
+   item->scale = scale;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::CallbackAdd(int layer, const void* texture, DrawCallback callback, void* userData)
+{
+   Item* item = ItemAdd(layer, texture, ITEM_CALLBACK);
+   item->callback = callback;
+   item->userData = userData;
+}
+
+//------------------------------------------------------------------------------
+
+void RenderQueue::Submit()
+{
+   // Every item has its own 'order', so a plain sort comes out the same as a
+   // stable one, without the buffer std::stable_sort would allocate.
+   std::sort(items.begin(), items.end(), ItemLess);
+
+   drawCount = 0;
+   batchCount = 0;
+   const void* lastTexture = NULL;
+   for(size_t i = 0; i < items.size(); i++)
+   {
+      Item& item = items[i];
+      if(i == 0 || item.texture != lastTexture)
+         batchCount++;
+      lastTexture = item.texture;
+      drawCount++;
+
+      switch(item.type)
+      {
+      case ITEM_IMAGE:
+         item.image->Draw(item.position);
+         break;
+      case ITEM_SPRITE:
+         item.sprite->Draw();
+         break;
+      case ITEM_SPRITE_PLACED:
+         item.sprite->PositionSet(item.position);
+         item.sprite->ScaleSet(item.scale);
+         item.sprite->TimeSet(item.time);
+         item.sprite->Draw();
+         break;
+      case ITEM_ATLAS_FRAME:
+         item.atlas->FrameDraw(item.frame, item.position, item.scale);
+         break;
+      case ITEM_CALLBACK:
+         item.callback(item.userData);
+         break;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+bool RenderQueue::ItemLess(const Item& a, const Item& b)
+{
+   if(a.layer != b.layer)
+      return a.layer < b.layer;
+   return a.order < b.order;
+}
+
+//------------------------------------------------------------------------------
+
+RenderQueue::Item* RenderQueue::ItemAdd(int layer, const void* texture, ItemType type)
+{
+   Item item;
+   item.layer = layer;
+   item.texture = texture;
+   item.order = (int)items.size();
+   item.type = type;
+   item.image = NULL;
+   item.sprite = NULL;
+   item.atlas = NULL;
+   item.frame = NULL;
+   item.time = 0;
+   item.callback = NULL;
+   item.userData = NULL;
+   items.push_back(item);
+   return &items.back();
+}
+
+//------------------------------------------------------------------------------
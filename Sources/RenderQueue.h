@@ -0,0 +1,106 @@
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+#include <vector>
+#include "Frog.h"
+#include "TextureAtlas.h"
+
+namespace Webfoot {
+
+/// Layers of the MainGame screen, from back to front.
+enum RenderLayer
+{
+   RENDER_LAYER_BACKGROUND = 0,
+   RENDER_LAYER_DUANE_STORM,
+   RENDER_LAYER_DUANE,
+   RENDER_LAYER_SCORES,
+   RENDER_LAYER_PADDLES,
+   RENDER_LAYER_BALL,
+   RENDER_LAYER_OVERLAY
+};
+
+//==============================================================================
+
+/// Collects everything to be drawn in a frame, then draws it sorted by layer.
+/// Within a layer, things are drawn in the order they were queued, so
+/// overlapping sprites always come out the same way.  Draws that share a
+/// texture are only batched when they were queued back to back, so queue
+/// them together where the order doesn't matter.  It also counts draws and
+/// texture changes, to show where the frame's drawing costs go.
+class RenderQueue
+{
+public:
+   /// Signature of a function that draws something the queue can't describe
+   /// itself, like the background.
+   typedef void (*DrawCallback)(void* userData);
+
+   RenderQueue();
+
+   /// 'capacity' is how many draws to make room for up front.
+   void Init(int capacity);
+   void Deinit();
+
+   /// Forget everything queued for the previous frame.
+   void Begin();
+   /// Queue 'image' to be drawn with its top-left corner at 'position'.
+   void ImageAdd(int layer, Image* image, const Point2F& position);
+   /// Queue 'sprite' to be drawn as it is.
+   void SpriteAdd(int layer, Sprite* sprite);
+   /// Queue 'sprite' to be drawn at the given position, scale and animation
+   /// time.  Use this to draw many things with one shared sprite.
+   void SpriteAdd(int layer, Sprite* sprite, const Point2F& position,
+      const Point2F& scale, unsigned int time);
+   /// Queue 'frame' of 'atlas' to be drawn centered on 'position'.
+   void AtlasFrameAdd(int layer, TextureAtlas* atlas, const AtlasFrame* frame,
+      const Point2F& position, const Point2F& scale);
+   /// Queue a call to 'callback'.  'texture' identifies what it draws with,
+   /// for counting batches, and can be anything that's unique to it.
+   void CallbackAdd(int layer, const void* texture, DrawCallback callback, void* userData);
+   /// Sort and draw everything queued since Begin.
+   void Submit();
+
+   /// Number of draws made by the last Submit.
+   int DrawCountGet() { return drawCount; }
+   /// Number of runs of draws sharing the same texture in the last Submit.
+   /// Each run can be sent to the GPU as one batch.
+   int BatchCountGet() { return batchCount; }
+
+protected:
+   enum ItemType { ITEM_IMAGE, ITEM_SPRITE, ITEM_SPRITE_PLACED, ITEM_ATLAS_FRAME, ITEM_CALLBACK };
+
+   struct Item
+   {
+      /// What to sort by.  'order' is when the item was added, so the sort
+      /// is stable.
+      int layer;
+      int order;
+      /// What the item draws with, to tell where a batch ends.
+      const void* texture;
+
+      ItemType type;
+      Image* image;
+      Sprite* sprite;
+      TextureAtlas* atlas;
+      const AtlasFrame* frame;
+      Point2F position;
+      Point2F scale;
+      unsigned int time;
+      DrawCallback callback;
+      void* userData;
+   };
+
+   /// Returns true if 'a' should be drawn before 'b'.
+   static bool ItemLess(const Item& a, const Item& b);
+   /// Add a blank item and return it.
+   Item* ItemAdd(int layer, const void* texture, ItemType type);
+
+   std::vector<Item> items;
+   int drawCount;
+   int batchCount;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __RENDERQUEUE_H__
@@ -0,0 +1,298 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "ResourceBlob.h"
+
+using namespace Webfoot;
+
+ResourceBlob ResourceBlob::instance;
+
+//------------------------------------------------------------------------------
+
+ResourceBlob::ResourceBlob()
+{
+   header = NULL;
+   files = NULL;
+   nodes = NULL;
+   strings = NULL;
+   mapping = NULL;
+   mappingSize = 0;
+#ifdef _WIN32
+   fileHandle = NULL;
+   mappingHandle = NULL;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+bool ResourceBlob::Open(const char* path)
+{
+   Deinit();
+
+#ifdef _WIN32
+   HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if(file == INVALID_HANDLE_VALUE)
+      return false;
+   LARGE_INTEGER fileSize;
+   HANDLE fileMapping = NULL;
+   if(GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+      fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+   if(!fileMapping)
+   {
+      CloseHandle(file);
+      return false;
+   }
+   fileHandle = file;
+   mappingHandle = fileMapping;
+   mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+   mappingSize = (size_t)fileSize.QuadPart;
+#else
+   int file = open(path, O_RDONLY);
+   if(file < 0)
+      return false;
+   struct stat status;
+   if(fstat(file, &status) != 0 || status.st_size <= 0)
+   {
+      close(file);
+      return false;
+   }
+   mappingSize = (size_t)status.st_size;
+   mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+   // The mapping stays valid after the file is closed.
+   close(file);
+   if(mapping == MAP_FAILED)
+      mapping = NULL;
+#endif
+
+   if(!mapping || !Init(mapping, mappingSize))
+   {
+      Deinit();
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool ResourceBlob::Init(const void* data, size_t size)
+{
+   header = NULL;
+   if(size < sizeof(ResourceBlobHeader))
+      return false;
+
+   const ResourceBlobHeader* candidate = (const ResourceBlobHeader*)data;
+   if(candidate->magic != RESOURCE_BLOB_MAGIC || candidate->version != RESOURCE_BLOB_VERSION ||
+      candidate->size > size)
+   {
+      return false;
+   }
+
+   const char* bytes = (const char*)data;
+   header = candidate;
+   files = (const ResourceBlobFile*)(bytes + sizeof(ResourceBlobHeader));
+   nodes = (const ResourceBlobNode*)(bytes + header->nodesOffset);
+   strings = bytes + header->stringsOffset;
+   if(!ValidateCheck())
+   {
+      header = NULL;
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+void ResourceBlob::Deinit()
+{
+   header = NULL;
+   files = NULL;
+   nodes = NULL;
+   strings = NULL;
+
+#ifdef _WIN32
+   if(mapping)
+      UnmapViewOfFile(mapping);
+   if(mappingHandle)
+      CloseHandle((HANDLE)mappingHandle);
+   if(fileHandle)
+      CloseHandle((HANDLE)fileHandle);
+   mappingHandle = NULL;
+   fileHandle = NULL;
+#else
+   if(mapping)
+      munmap(mapping, mappingSize);
+#endif
+   mapping = NULL;
+   mappingSize = 0;
+}
+
+//------------------------------------------------------------------------------
+
+ResourceNode ResourceBlob::FileGet(const char* path) const
+{
+   if(!header)
+      return ResourceNode();
+   for(uint32_t i = 0; i < header->fileCount; i++)
+   {
+      if(!strcmp(strings + files[i].path, path))
+         return ResourceNode(this, &nodes[files[i].root]);
+   }
+   return ResourceNode();
+}
+
+//------------------------------------------------------------------------------
+
+bool ResourceBlob::ValidateCheck() const
+{
+   // Each table has to fit in the blob in order, with the nodes aligned.
+   uint64_t filesEnd = sizeof(ResourceBlobHeader) + (uint64_t)header->fileCount * sizeof(ResourceBlobFile);
+   uint64_t nodesEnd = header->nodesOffset + (uint64_t)header->nodeCount * sizeof(ResourceBlobNode);
+   uint64_t stringsEnd = header->stringsOffset + (uint64_t)header->stringsSize;
+   if(header->nodesOffset < filesEnd || header->nodesOffset % 8 || header->stringsOffset < nodesEnd ||
+      stringsEnd > header->size || header->stringsSize == 0 || strings[header->stringsSize - 1] != '\0')
+   {
+      return false;
+   }
+
+   // Since the strings end with a NUL, any offset within them is a valid
+   // string.
+   for(uint32_t i = 0; i < header->fileCount; i++)
+   {
+      if(files[i].path >= header->stringsSize || files[i].root >= header->nodeCount)
+         return false;
+   }
+
+   for(uint32_t i = 0; i < header->nodeCount; i++)
+   {
+      const ResourceBlobNode& node = nodes[i];
+      if(node.name != RESOURCE_BLOB_NO_NAME && node.name >= header->stringsSize)
+         return false;
+      switch(node.type)
+      {
+         case RESOURCE_NODE_NULL:
+         case RESOURCE_NODE_BOOL:
+         case RESOURCE_NODE_NUMBER:
+            break;
+         case RESOURCE_NODE_STRING:
+            if((uint64_t)node.first + node.count >= header->stringsSize)
+               return false;
+            break;
+         case RESOURCE_NODE_ARRAY:
+         case RESOURCE_NODE_OBJECT:
+            if((uint64_t)node.first + node.count > header->nodeCount)
+               return false;
+            break;
+         default:
+            return false;
+      }
+   }
+   return true;
+}
+
+//==============================================================================
+
+const char* ResourceNode::NameGet() const
+{
+   if(!node || node->name == RESOURCE_BLOB_NO_NAME)
+      return NULL;
+   return blob->StringGet(node->name);
+}
+
+//------------------------------------------------------------------------------
+
+int ResourceNode::ChildCountGet() const
+{
+   if(!node || (node->type != RESOURCE_NODE_ARRAY && node->type != RESOURCE_NODE_OBJECT))
+      return 0;
+   return (int)node->count;
+}
+
+//------------------------------------------------------------------------------
+
+ResourceNode ResourceNode::ChildGet(int index) const
+{
+   if(index < 0 || index >= ChildCountGet())
+      return ResourceNode();
+   return ResourceNode(blob, blob->NodeGet(node->first + index));
+}
+
+//------------------------------------------------------------------------------
+
+ResourceNode ResourceNode::ChildGet(const char* name) const
+{
+   if(!node || node->type != RESOURCE_NODE_OBJECT)
+      return ResourceNode();
+   for(uint32_t i = 0; i < node->count; i++)
+   {
+      const ResourceBlobNode* child = blob->NodeGet(node->first + i);
+      if(child->name != RESOURCE_BLOB_NO_NAME && !strcmp(blob->StringGet(child->name), name))
+         return ResourceNode(blob, child);
+   }
+   return ResourceNode();
+}
+
+//------------------------------------------------------------------------------
+
+double ResourceNode::NumberGet(double defaultValue) const
+{
+   if(!node || node->type != RESOURCE_NODE_NUMBER)
+      return defaultValue;
+   return node->number;
+}
+
+//------------------------------------------------------------------------------
+
+int ResourceNode::IntGet(int defaultValue) const
+{
+   if(!node || node->type != RESOURCE_NODE_NUMBER)
+      return defaultValue;
+   return (int)node->number;
+}
+
+//------------------------------------------------------------------------------
+
+bool ResourceNode::BoolGet(bool defaultValue) const
+{
+   if(!node || node->type != RESOURCE_NODE_BOOL)
+      return defaultValue;
+   return node->number != 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+const char* ResourceNode::StringGet(const char* defaultValue) const
+{
+   if(!node || node->type != RESOURCE_NODE_STRING)
+      return defaultValue;
+   return blob->StringGet(node->first);
+}
+
+//------------------------------------------------------------------------------
+
+bool ResourceNode::PointGet(float* x, float* y) const
+{
+   const char* text = StringGet(NULL);
+   if(!text)
+      return false;
+   char* end;
+   float pointX = strtof(text, &end);
+   if(end == text || *end != '|')
+      return false;
+   const char* yText = end + 1;
+   float pointY = strtof(yText, &end);
+   if(end == yText)
+      return false;
+   *x = pointX;
+   *y = pointY;
+   return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,178 @@
+#ifndef __RESOURCEBLOB_H__
+#define __RESOURCEBLOB_H__
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace Webfoot {
+
+/// First four bytes of a resource blob, "RBLB" in a little-endian file.
+#define RESOURCE_BLOB_MAGIC 0x424C4252u
+/// Version of the resource blob format.  Bump this whenever the layout below
+/// changes, and compile the blob again.
+#define RESOURCE_BLOB_VERSION 1
+/// Name offset of nodes that don't have a name, like the items of an array.
+#define RESOURCE_BLOB_NO_NAME 0xFFFFFFFFu
+
+// A resource blob holds JSON files that Tools/ResourceCompiler has already
+// parsed, so they can be read in place without parsing or allocating.  Only the
+// game's own lookups go through it; Frog still parses the files it reads
+// itself.  Nothing checks the blob against the JSON at runtime, so run
+// "ResourceCompiler --check" as part of the build to catch a blob that's out of
+// date.  It's a ResourceBlobHeader, then the table of files, then every node of
+// every file, then all the strings, NUL-terminated.  Offsets of strings are
+// from the start of the strings.  The children of an object or array are
+// stored next to each other, so a node only needs the index of its first child
+// and how many there are.  Everything is little-endian, and the nodes start on
+// an 8 byte boundary.
+
+/// Kinds of JSON values.
+enum ResourceNodeType
+{
+   RESOURCE_NODE_NULL = 0,
+   RESOURCE_NODE_BOOL,
+   RESOURCE_NODE_NUMBER,
+   RESOURCE_NODE_STRING,
+   RESOURCE_NODE_ARRAY,
+   RESOURCE_NODE_OBJECT
+};
+
+struct ResourceBlobHeader
+{
+   uint32_t magic;
+   uint32_t version;
+   /// Size of the whole blob in bytes.
+   uint32_t size;
+   uint32_t fileCount;
+   uint32_t nodeCount;
+   /// Where the nodes and strings start, from the start of the blob.
+   uint32_t nodesOffset;
+   uint32_t stringsOffset;
+   uint32_t stringsSize;
+};
+
+struct ResourceBlobFile
+{
+   /// Path of the JSON file this came from, relative to the FileSystem folder.
+   uint32_t path;
+   /// Index of the file's outermost value.
+   uint32_t root;
+   /// FNV-1a hash of the JSON text, for "ResourceCompiler --check" to tell
+   /// whether the blob is out of date.
+   uint32_t sourceHash;
+   uint32_t reserved;
+};
+
+struct ResourceBlobNode
+{
+   /// A ResourceNodeType.
+   uint32_t type;
+   /// Key of this value in its parent object, or RESOURCE_BLOB_NO_NAME.
+   uint32_t name;
+   /// For arrays and objects, the index of the first child and how many there
+   /// are.  For strings, the offset of the string and its length.
+   uint32_t first;
+   uint32_t count;
+   /// For numbers, the number.  For bools, 1 or 0.
+   double number;
+};
+
+class ResourceBlob;
+
+//==============================================================================
+
+/// One value in a ResourceBlob.  These are just a pointer into the blob, so
+/// they're cheap to copy around.  Looking up something that isn't there gives
+/// a node that isn't valid, and reading from one of those gives the default.
+class ResourceNode
+{
+public:
+   ResourceNode() { blob = NULL; node = NULL; }
+   ResourceNode(const ResourceBlob* _blob, const ResourceBlobNode* _node) { blob = _blob; node = _node; }
+
+   /// Returns true if this node exists.
+   bool ValidCheck() const { return node != NULL; }
+   ResourceNodeType TypeGet() const { return node ? (ResourceNodeType)node->type : RESOURCE_NODE_NULL; }
+   /// Returns the key of this value in its parent object, or NULL.
+   const char* NameGet() const;
+
+   /// Returns the number of items in an array or object.
+   int ChildCountGet() const;
+   /// Returns item 'index' of an array or object.
+   ResourceNode ChildGet(int index) const;
+   /// Returns the value of 'name' in an object.
+   ResourceNode ChildGet(const char* name) const;
+
+   double NumberGet(double defaultValue) const;
+   int IntGet(int defaultValue) const;
+   bool BoolGet(bool defaultValue) const;
+   const char* StringGet(const char* defaultValue) const;
+   /// Reads a point written as a "x|y" string, the way the JSON files write
+   /// positions and scales.  Returns false and leaves 'x' and 'y' alone if
+   /// this isn't one.
+   bool PointGet(float* x, float* y) const;
+
+protected:
+   const ResourceBlob* blob;
+   const ResourceBlobNode* node;
+};
+
+//==============================================================================
+
+/// Reads the blob written by Tools/ResourceCompiler.  The file is mapped into
+/// memory rather than read, and everything is read from it in place, so
+/// opening it is quick and nothing is allocated.  This has no dependency on
+/// Frog.
+class ResourceBlob
+{
+public:
+   ResourceBlob();
+
+   /// Map the blob at 'path'.  Returns false if it's missing, from a
+   /// different version, or damaged.
+   bool Open(const char* path);
+   /// Read a blob that's already in memory.  'data' must stay valid until
+   /// Deinit.
+   bool Init(const void* data, size_t size);
+   /// Stop reading the blob, unmapping it if Open mapped it.
+   void Deinit();
+
+   /// Returns true if a blob is open.
+   bool OpenCheck() const { return header != NULL; }
+   /// Returns the outermost value of the JSON file at 'path', relative to the
+   /// FileSystem folder, like "Graphics/Sprites/Sprites.json".
+   ResourceNode FileGet(const char* path) const;
+
+   /// Returns the node at 'index', or NULL if there's no such node.
+   const ResourceBlobNode* NodeGet(uint32_t index) const { return index < header->nodeCount ? &nodes[index] : NULL; }
+   /// Returns the string at 'offset'.
+   const char* StringGet(uint32_t offset) const { return strings + offset; }
+
+   static ResourceBlob instance;
+
+protected:
+   /// Check that every offset and index in the blob is in bounds, so the
+   /// accessors don't have to.
+   bool ValidateCheck() const;
+
+   const ResourceBlobHeader* header;
+   const ResourceBlobFile* files;
+   const ResourceBlobNode* nodes;
+   const char* strings;
+
+   /// The mapping made by Open, if any.
+   void* mapping;
+   size_t mappingSize;
+#ifdef _WIN32
+   void* fileHandle;
+   void* mappingHandle;
+#endif
+};
+
+ResourceBlob* const theResources = &ResourceBlob::instance;
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __RESOURCEBLOB_H__
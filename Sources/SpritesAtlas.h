@@ -0,0 +1,80 @@
+// Generated by Tools/AtlasPacker.  Do not edit.
+//    AtlasPacker FileSystem/Graphics Atlases/Sprites Sources/SpritesAtlas.h Sprites 2048 Duane=Sprites/duane:28:20 Numbers=Sprites/numbers:11:0
+
+#ifndef __SPRITESATLAS_H__
+#define __SPRITESATLAS_H__
+
+#include "TextureAtlas.h"
+
+namespace Webfoot {
+
+static const char* const SpritesAtlasPages[] =
+{
+   "Atlases/Sprites_0",
+};
+
+static const AtlasFrame SpritesAtlasDuaneFrames[] =
+{
+   // page, x, y, width, height, offsetX, offsetY, sourceWidth, sourceHeight
+   {0, 559, 0, 384, 288, 0, 0, 384, 288},
+   {0, 944, 0, 327, 288, 0, 0, 327, 288},
+   {0, 0, 0, 279, 296, 0, 0, 279, 296},
+   {0, 280, 0, 278, 291, 0, 0, 278, 291},
+   {0, 1657, 0, 237, 270, 0, 0, 237, 270},
+   {0, 820, 297, 258, 253, 0, 0, 258, 253},
+   {0, 1569, 297, 243, 222, 0, 0, 243, 222},
+   {0, 480, 560, 260, 203, 0, 0, 260, 203},
+   {0, 0, 560, 243, 207, 0, 0, 243, 207},
+   {0, 1321, 297, 247, 222, 0, 0, 247, 222},
+   {0, 1079, 297, 241, 241, 0, 0, 241, 241},
+   {0, 545, 297, 274, 256, 0, 0, 274, 256},
+   {0, 0, 297, 271, 262, 0, 0, 271, 262},
+   {0, 272, 297, 272, 260, 0, 0, 272, 260},
+   {0, 545, 297, 274, 256, 0, 0, 274, 256},
+   {0, 1079, 297, 241, 241, 0, 0, 241, 241},
+   {0, 1321, 297, 247, 222, 0, 0, 247, 222},
+   {0, 0, 560, 243, 207, 0, 0, 243, 207},
+   {0, 480, 560, 260, 203, 0, 0, 260, 203},
+   {0, 244, 560, 235, 206, 0, 0, 235, 206},
+   {0, 1569, 297, 243, 222, 0, 0, 243, 222},
+   {0, 820, 297, 258, 253, 0, 0, 258, 253},
+   {0, 1657, 0, 237, 270, 0, 0, 237, 270},
+   {0, 280, 0, 278, 291, 0, 0, 278, 291},
+   {0, 0, 0, 279, 296, 0, 0, 279, 296},
+   {0, 944, 0, 327, 288, 0, 0, 327, 288},
+   {0, 559, 0, 384, 288, 0, 0, 384, 288},
+   {0, 1272, 0, 384, 285, 0, 0, 384, 285},
+};
+
+static const AtlasFrame SpritesAtlasNumbersFrames[] =
+{
+   // page, x, y, width, height, offsetX, offsetY, sourceWidth, sourceHeight
+   {0, 864, 560, 53, 53, 8, 9, 64, 64},
+   {0, 1216, 560, 38, 53, 16, 9, 64, 64},
+   {0, 806, 560, 57, 53, 6, 9, 64, 64},
+   {0, 918, 560, 53, 53, 8, 9, 64, 64},
+   {0, 1024, 560, 49, 53, 10, 9, 64, 64},
+   {0, 741, 560, 64, 53, 0, 9, 64, 64},
+   {0, 1124, 560, 45, 53, 12, 9, 64, 64},
+   {0, 1170, 560, 45, 53, 12, 9, 64, 64},
+   {0, 972, 560, 51, 53, 9, 9, 64, 64},
+   {0, 1074, 560, 49, 53, 12, 9, 64, 64},
+   {0, 1255, 560, 64, 50, 0, 7, 64, 64},
+};
+
+static const AtlasAnimation SpritesAtlasAnimations[] =
+{
+   // name, frame count, frame rate, frames
+   {"Duane", 28, 20, SpritesAtlasDuaneFrames},
+   {"Numbers", 11, 0, SpritesAtlasNumbersFrames},
+};
+
+static const AtlasDefinition SpritesAtlas =
+{
+   SpritesAtlasPages, 1,
+   SpritesAtlasAnimations, 2
+};
+
+} //namespace Webfoot {
+
+#endif //#ifndef __SPRITESATLAS_H__
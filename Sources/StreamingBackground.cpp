@@ -0,0 +1,194 @@
+#include <cstdio>
+#include "Frog.h"
+#include "StreamingBackground.h"
+#include "Profiler.h"
+
+using namespace Webfoot;
+
+/// Priority of reading ahead.  There's only ever a few frames queued, so this
+/// doesn't matter much.
+#define STREAMING_BACKGROUND_PREFETCH_PRIORITY 0
+
+//------------------------------------------------------------------------------
+
+StreamingBackground::StreamingBackground()
+{
+   folder[0] = '\0';
+   path[0] = '\0';
+   frameCount = 0;
+   frameRate = 0;
+   ringSize = 0;
+   time = 0;
+   tickets = NULL;
+   for(int i = 0; i < STREAMING_BACKGROUND_RING_MAX; i++)
+   {
+      slots[i].frame = -1;
+      slots[i].image = NULL;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void StreamingBackground::Init(const char* _folder, const char* _path, int _frameCount, int _frameRate,
+   int _ringSize, const Point2F& _offset, const Point2F& _scale)
+{
+   snprintf(folder, sizeof(folder), "%s", _folder);
+   snprintf(path, sizeof(path), "%s", _path);
+   frameCount = _frameCount;
+   frameRate = _frameRate;
+   ringSize = _ringSize < STREAMING_BACKGROUND_RING_MAX ? _ringSize : STREAMING_BACKGROUND_RING_MAX;
+   offset = _offset;
+   scale = _scale;
+   time = 0;
+
+   tickets = new int[frameCount];
+   for(int i = 0; i < frameCount; i++)
+      tickets[i] = -1;
+
+   // One thread is plenty, since it only ever has a few small files to read.
+   prefetcher.Init(1);
+
+   // Fill the ring before the first frame is drawn.
+   for(int i = 0; i < ringSize; i++)
+   {
+      int frame = FrameAtStepGet(i);
+      if(SlotFind(frame) < 0)
+         FrameLoad(frame, 0);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void StreamingBackground::Deinit()
+{
+   prefetcher.Deinit();
+   for(int i = 0; i < STREAMING_BACKGROUND_RING_MAX; i++)
+   {
+      if(slots[i].image)
+         theImages->Unload(slots[i].image);
+      slots[i].frame = -1;
+      slots[i].image = NULL;
+   }
+   delete[] tickets;
+   tickets = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void StreamingBackground::Update(unsigned int dt)
+{
+   PROFILE_SCOPE("StreamingBackground::Update");
+
+   // Wrap around after a whole number of trips back and forth, so the time
+   // never gets big enough to overflow when it's turned into a step.
+   time += dt;
+   if(frameCount >= 2)
+      time %= 2 * (frameCount - 1) * 1000;
+   unsigned int step = time * frameRate / 1000;
+
+   // The frame on screen has to be there now, even if that means waiting on
+   // the disk.  This only happens if updates are very far apart.
+   int current = FrameAtStepGet(step);
+   if(SlotFind(current) < 0)
+      FrameLoad(current, step);
+
+   // Read the files for the frames coming up, and load the first one that's
+   // been read.  Loading one at most per update keeps any one frame from
+   // taking much longer than the rest.
+   bool loaded = false;
+   for(int i = 1; i < ringSize; i++)
+   {
+      int frame = FrameAtStepGet(step + i);
+      if(SlotFind(frame) >= 0)
+         continue;
+
+      if(tickets[frame] < 0)
+      {
+         char filePath[640];
+         snprintf(filePath, sizeof(filePath), "%s/%03d.png", path, frame + 1);
+         tickets[frame] = prefetcher.Request(filePath, STREAMING_BACKGROUND_PREFETCH_PRIORITY);
+      }
+      else if(!loaded && prefetcher.DoneCheck(tickets[frame]))
+      {
+         FrameLoad(frame, step);
+         loaded = true;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+
+void StreamingBackground::Draw()
+{
+   int slot = SlotFind(FrameGet());
+   if(slot < 0 || !slots[slot].image)
+      return;
+
+   Image* image = slots[slot].image;
+   Box2F source = Box2F::Create(0.0f, 0.0f, (float)image->WidthGet(), (float)image->HeightGet());
+   image->Draw(Point2F::Create(offset.x * scale.x, offset.y * scale.y), source, scale);
+}
+
+//------------------------------------------------------------------------------
+
+int StreamingBackground::FrameAtStepGet(unsigned int step)
+{
+   // Going forward through every frame and then back, without showing the
+   // first and last frames twice in a row.
+   if(frameCount < 2)
+      return 0;
+   unsigned int period = 2 * (frameCount - 1);
+   int position = (int)(step % period);
+   return position < frameCount ? position : (int)period - position;
+}
+
+//------------------------------------------------------------------------------
+
+int StreamingBackground::SlotFind(int frame)
+{
+   for(int i = 0; i < ringSize; i++)
+   {
+      if(slots[i].frame == frame)
+         return i;
+   }
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+
+int StreamingBackground::FrameLoad(int frame, unsigned int step)
+{
+   PROFILE_SCOPE("StreamingBackground::FrameLoad");
+
+   // Use an empty slot, or else one holding a frame that isn't coming up.
+   int slot = -1;
+   for(int i = 0; i < ringSize && slot < 0; i++)
+   {
+      if(slots[i].frame < 0)
+         slot = i;
+   }
+   for(int i = 0; i < ringSize && slot < 0; i++)
+   {
+      bool needed = false;
+      for(int j = 0; j < ringSize && !needed; j++)
+         needed = slots[i].frame == FrameAtStepGet(step + j);
+      if(!needed)
+         slot = i;
+   }
+   // The ring is never smaller than the frames it has to hold, but just in
+   // case, reuse the first slot.
+   if(slot < 0)
+      slot = 0;
+
+   if(slots[slot].image)
+      theImages->Unload(slots[slot].image);
+
+   char name[256];
+   snprintf(name, sizeof(name), "%s/%03d", folder, frame + 1);
+   slots[slot].frame = frame;
+   slots[slot].image = theImages->Load(name);
+   tickets[frame] = -1;
+   return slot;
+}
+
+//------------------------------------------------------------------------------
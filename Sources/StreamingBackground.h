@@ -0,0 +1,83 @@
+#ifndef __STREAMINGBACKGROUND_H__
+#define __STREAMINGBACKGROUND_H__
+
+#include "Frog.h"
+#include "FilePrefetcher.h"
+
+namespace Webfoot {
+
+/// Most decoded frames a StreamingBackground keeps at once.
+#define STREAMING_BACKGROUND_RING_MAX 8
+
+//==============================================================================
+
+/// Plays a full-screen animation back and forth, like an AnimatedBackground
+/// with a PingPongLoop sprite, without keeping every frame decoded.  The
+/// frames stay compressed on disk as PNGs.  A worker thread reads the files
+/// for the next few frames ahead of the playhead, so they're in the file
+/// cache, and the main thread loads at most one of them per update through
+/// theImages into a small ring.  Frames behind the playhead are unloaded to
+/// make room.
+class StreamingBackground
+{
+public:
+   StreamingBackground();
+
+   /// Start playing the images named "<folder>/001" through
+   /// "<folder>/<frameCount>".  Their files are read ahead from 'path' on
+   /// disk, which MainUpdate::FilePathGet gives for 'folder'.  'ringSize' is
+   /// how many frames to keep loaded, counting the one on screen.  'offset'
+   /// is where the top left of the first frame goes before scaling.
+   void Init(const char* _folder, const char* _path, int _frameCount, int _frameRate, int _ringSize,
+      const Point2F& _offset, const Point2F& _scale);
+   void Deinit();
+
+   /// Advance the playhead by 'dt' milliseconds and keep the frames after it
+   /// coming.
+   void Update(unsigned int dt);
+   /// Draw the frame at the playhead.
+   void Draw();
+   /// Returns the frame at the playhead.
+   int FrameGet() { return FrameAtStepGet(time * frameRate / 1000); }
+
+protected:
+   /// A loaded frame.
+   struct Slot
+   {
+      /// Which frame this is, or -1 if the slot is empty.
+      int frame;
+      Image* image;
+   };
+
+   /// Returns the frame shown 'step' frames into the animation, going back
+   /// and forth.
+   int FrameAtStepGet(unsigned int step);
+   /// Returns the slot holding 'frame', or -1 if it isn't loaded.
+   int SlotFind(int frame);
+   /// Load 'frame' into a slot whose frame isn't among the next 'ringSize'
+   /// frames starting at 'step'.  Returns the slot.
+   int FrameLoad(int frame, unsigned int step);
+
+   FilePrefetcher prefetcher;
+   /// Image names and file paths of the frames.
+   char folder[128];
+   char path[512];
+   int frameCount;
+   int frameRate;
+   int ringSize;
+   Point2F offset;
+   Point2F scale;
+
+   /// Milliseconds into the animation.
+   unsigned int time;
+   Slot slots[STREAMING_BACKGROUND_RING_MAX];
+   /// FilePrefetcher ticket for each frame, or -1 if it hasn't been asked
+   /// for since it was last loaded.
+   int* tickets;
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __STREAMINGBACKGROUND_H__
@@ -0,0 +1,84 @@
+#include <cstring>
+#include "Frog.h"
+#include "TextureAtlas.h"
+
+using namespace Webfoot;
+
+//------------------------------------------------------------------------------
+
+TextureAtlas::TextureAtlas()
+{
+   definition = NULL;
+   for(int i = 0; i < TEXTURE_ATLAS_PAGES_MAX; i++)
+      pages[i] = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void TextureAtlas::Init(const AtlasDefinition* _definition)
+{
+   definition = _definition;
+   for(int i = 0; i < definition->pageCount && i < TEXTURE_ATLAS_PAGES_MAX; i++)
+      pages[i] = theImages->Load(definition->pageNames[i]);
+}
+
+//------------------------------------------------------------------------------
+
+void TextureAtlas::Deinit()
+{
+   for(int i = 0; i < TEXTURE_ATLAS_PAGES_MAX; i++)
+   {
+      if(pages[i])
+      {
+         theImages->Unload(pages[i]);
+         pages[i] = NULL;
+      }
+   }
+   definition = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+const AtlasAnimation* TextureAtlas::AnimationGet(const char* name)
+{
+   for(int i = 0; i < definition->animationCount; i++)
+   {
+      if(!strcmp(definition->animations[i].name, name))
+         return &definition->animations[i];
+   }
+   return NULL;
+}
+
+//------------------------------------------------------------------------------
+
+const AtlasFrame* TextureAtlas::FrameGet(const AtlasAnimation* animation, unsigned int time)
+{
+   if(!animation->frameRate)
+      return &animation->frames[0];
+   unsigned int frame = (time * animation->frameRate / 1000) % animation->frameCount;
+   return &animation->frames[frame];
+}
+
+//------------------------------------------------------------------------------
+
+unsigned int TextureAtlas::DurationGet(const AtlasAnimation* animation)
+{
+   if(!animation->frameRate)
+      return 1;
+   return animation->frameCount * 1000 / animation->frameRate;
+}
+
+//------------------------------------------------------------------------------
+
+void TextureAtlas::FrameDraw(const AtlasFrame* frame, const Point2F& position, const Point2F& scale)
+{
+   // Put the center of the original image on 'position', then move over to
+   // where the trimmed part was within it.
+   Point2F topLeft = Point2F::Create(
+      position.x + (frame->offsetX - frame->sourceWidth / 2.0f) * scale.x,
+      position.y + (frame->offsetY - frame->sourceHeight / 2.0f) * scale.y);
+   Box2F source = Box2F::Create((float)frame->x, (float)frame->y, (float)frame->width, (float)frame->height);
+   pages[frame->page]->Draw(topLeft, source, scale);
+}
+
+//------------------------------------------------------------------------------
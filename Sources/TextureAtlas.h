@@ -0,0 +1,86 @@
+#ifndef __TEXTUREATLAS_H__
+#define __TEXTUREATLAS_H__
+
+#include "Frog.h"
+
+namespace Webfoot {
+
+/// Most pages an atlas can have.
+#define TEXTURE_ATLAS_PAGES_MAX 8
+
+/// Where one frame of an animation is in an atlas.  Frames have their
+/// transparent borders trimmed off when they're packed.
+struct AtlasFrame
+{
+   /// Which page the frame is on.
+   int page;
+   /// Where the trimmed frame is on the page.
+   int x;
+   int y;
+   int width;
+   int height;
+   /// Where the trimmed frame was in the original image.
+   int offsetX;
+   int offsetY;
+   /// Size of the original image.
+   int sourceWidth;
+   int sourceHeight;
+};
+
+/// A sequence of frames in an atlas.
+struct AtlasAnimation
+{
+   const char* name;
+   int frameCount;
+   /// Frames per second, or 0 if the frames are picked by hand.
+   int frameRate;
+   const AtlasFrame* frames;
+};
+
+/// Everything in an atlas, as written by Tools/AtlasPacker.
+struct AtlasDefinition
+{
+   /// Image names of the pages.
+   const char* const* pageNames;
+   int pageCount;
+   const AtlasAnimation* animations;
+   int animationCount;
+};
+
+//==============================================================================
+
+/// Animation frames packed together onto a few large images, so that drawing
+/// different frames doesn't mean switching textures.
+class TextureAtlas
+{
+public:
+   TextureAtlas();
+
+   /// Load the pages of the given atlas.
+   void Init(const AtlasDefinition* _definition);
+   void Deinit();
+
+   /// Returns the animation with the given name, or NULL if there isn't one.
+   const AtlasAnimation* AnimationGet(const char* name);
+   /// Returns the frame of a looping 'animation' to show 'time' milliseconds
+   /// in.
+   static const AtlasFrame* FrameGet(const AtlasAnimation* animation, unsigned int time);
+   /// Returns the length of 'animation' in milliseconds.
+   static unsigned int DurationGet(const AtlasAnimation* animation);
+
+   /// Returns the image for the given page.
+   Image* PageGet(int page) { return pages[page]; }
+
+   /// Draw 'frame' centered on 'position'.
+   void FrameDraw(const AtlasFrame* frame, const Point2F& position, const Point2F& scale);
+
+protected:
+   const AtlasDefinition* definition;
+   Image* pages[TEXTURE_ATLAS_PAGES_MAX];
+};
+
+//==============================================================================
+
+} //namespace Webfoot {
+
+#endif //#ifndef __TEXTUREATLAS_H__
@@ -0,0 +1,392 @@
+// AtlasPacker packs numbered PNG frame sequences into a few large atlas pages
+// and writes a C++ header describing where each frame ended up, for
+// TextureAtlas to load.
+//
+// Frames are trimmed of fully transparent borders, identical frames are
+// stored once, and frames are shelf-packed tallest first.
+//
+// Build (needs libpng):
+//    g++ -O2 -o AtlasPacker Tools/AtlasPacker/AtlasPacker.cpp -lpng
+//
+// Usage:
+//    AtlasPacker <graphics root> <page name> <header> <atlas name> <page size>
+//       <animation>=<folder>:<frame count>:<frame rate> ...
+//
+// Example, from the root of the repository:
+//    AtlasPacker FileSystem/Graphics Atlases/Sprites Sources/SpritesAtlas.h
+//       Sprites 2048 Duane=Sprites/duane:28:20 Numbers=Sprites/numbers:11:0
+
+#include <png.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/// Pixels between frames, so filtering never samples a neighbour.
+#define FRAME_PADDING 1
+
+//==============================================================================
+
+struct Frame
+{
+   /// Trimmed pixels, RGBA.
+   std::vector<unsigned char> pixels;
+   int width;
+   int height;
+   /// Where the trimmed pixels were in the original frame.
+   int offsetX;
+   int offsetY;
+   /// Size of the original frame.
+   int sourceWidth;
+   int sourceHeight;
+   /// Index of an earlier identical frame, or -1.
+   int duplicateOf;
+   /// Where the frame was packed.
+   int page;
+   int x;
+   int y;
+};
+
+struct Animation
+{
+   std::string name;
+   std::string folder;
+   int frameCount;
+   int frameRate;
+   /// Index of this animation's first frame in the list of all frames.
+   int firstFrame;
+};
+
+//------------------------------------------------------------------------------
+
+/// Load a PNG as RGBA.  Returns false on failure.
+static bool PngLoad(const std::string& path, std::vector<unsigned char>* pixels, int* width, int* height)
+{
+   png_image image;
+   memset(&image, 0, sizeof(image));
+   image.version = PNG_IMAGE_VERSION;
+   if(!png_image_begin_read_from_file(&image, path.c_str()))
+   {
+      fprintf(stderr, "Unable to read %s: %s\n", path.c_str(), image.message);
+      return false;
+   }
+   image.format = PNG_FORMAT_RGBA;
+   pixels->resize(PNG_IMAGE_SIZE(image));
+   if(!png_image_finish_read(&image, NULL, &(*pixels)[0], 0, NULL))
+   {
+      fprintf(stderr, "Unable to decode %s: %s\n", path.c_str(), image.message);
+      png_image_free(&image);
+      return false;
+   }
+   *width = (int)image.width;
+   *height = (int)image.height;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write RGBA pixels as a PNG.  Returns false on failure.
+static bool PngSave(const std::string& path, const std::vector<unsigned char>& pixels, int width, int height)
+{
+   png_image image;
+   memset(&image, 0, sizeof(image));
+   image.version = PNG_IMAGE_VERSION;
+   image.width = width;
+   image.height = height;
+   image.format = PNG_FORMAT_RGBA;
+   if(!png_image_write_to_file(&image, path.c_str(), 0, &pixels[0], 0, NULL))
+   {
+      fprintf(stderr, "Unable to write %s: %s\n", path.c_str(), image.message);
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Cut the fully transparent borders off a frame.
+static void FrameTrim(const std::vector<unsigned char>& pixels, int width, int height, Frame* frame)
+{
+   int minX = width, minY = height, maxX = -1, maxY = -1;
+   for(int y = 0; y < height; y++)
+   {
+      for(int x = 0; x < width; x++)
+      {
+         if(pixels[(y * width + x) * 4 + 3] != 0)
+         {
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+         }
+      }
+   }
+
+   // Keep a single pixel of a fully transparent frame, so it still has a size.
+   if(maxX < 0)
+   {
+      minX = maxX = 0;
+      minY = maxY = 0;
+   }
+
+   frame->offsetX = minX;
+   frame->offsetY = minY;
+   frame->width = maxX - minX + 1;
+   frame->height = maxY - minY + 1;
+   frame->pixels.resize(frame->width * frame->height * 4);
+   for(int y = 0; y < frame->height; y++)
+   {
+      memcpy(&frame->pixels[y * frame->width * 4],
+         &pixels[((y + minY) * width + minX) * 4], frame->width * 4);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+static bool FrameHeightGreater(const Frame* a, const Frame* b)
+{
+   if(a->height != b->height)
+      return a->height > b->height;
+   return a->width > b->width;
+}
+
+//------------------------------------------------------------------------------
+
+/// Shelf-pack the frames into pages of the given size.  Returns the number of
+/// pages, or 0 if a frame doesn't fit on a page.
+static int FramesPack(std::vector<Frame>& frames, int pageSize)
+{
+   std::vector<Frame*> order;
+   for(size_t i = 0; i < frames.size(); i++)
+   {
+      if(frames[i].duplicateOf < 0)
+         order.push_back(&frames[i]);
+   }
+   std::sort(order.begin(), order.end(), FrameHeightGreater);
+
+   int page = 0, x = 0, y = 0, shelfHeight = 0;
+   for(size_t i = 0; i < order.size(); i++)
+   {
+      Frame* frame = order[i];
+      int width = frame->width + FRAME_PADDING;
+      int height = frame->height + FRAME_PADDING;
+      if(width > pageSize || height > pageSize)
+      {
+         fprintf(stderr, "A %dx%d frame doesn't fit on a %d page.\n", frame->width, frame->height, pageSize);
+         return 0;
+      }
+
+      // Start a new shelf, or a new page, when this row is full.
+      if(x + width > pageSize)
+      {
+         x = 0;
+         y += shelfHeight;
+         shelfHeight = 0;
+      }
+      if(y + height > pageSize)
+      {
+         page++;
+         x = 0;
+         y = 0;
+         shelfHeight = 0;
+      }
+
+      frame->page = page;
+      frame->x = x;
+      frame->y = y;
+      x += width;
+      shelfHeight = std::max(shelfHeight, height);
+   }
+
+   for(size_t i = 0; i < frames.size(); i++)
+   {
+      if(frames[i].duplicateOf >= 0)
+      {
+         const Frame& original = frames[frames[i].duplicateOf];
+         frames[i].page = original.page;
+         frames[i].x = original.x;
+         frames[i].y = original.y;
+      }
+   }
+   return page + 1;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns the smallest power of two that's at least 'value'.
+static int PowerOfTwoCeiling(int value)
+{
+   int result = 1;
+   while(result < value)
+      result *= 2;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   if(argc < 7)
+   {
+      fprintf(stderr, "Usage: %s <graphics root> <page name> <header> <atlas name> <page size> "
+         "<animation>=<folder>:<frame count>:<frame rate> ...\n", argv[0]);
+      return 1;
+   }
+
+   std::string root = argv[1];
+   std::string pageName = argv[2];
+   std::string headerPath = argv[3];
+   std::string atlasName = argv[4];
+   int pageSize = atoi(argv[5]);
+
+   // Load every frame of every animation.
+   std::vector<Animation> animations;
+   std::vector<Frame> frames;
+   for(int arg = 6; arg < argc; arg++)
+   {
+      std::string spec = argv[arg];
+      size_t equals = spec.find('=');
+      size_t colon1 = spec.find(':', equals);
+      size_t colon2 = spec.find(':', colon1 + 1);
+      if(equals == std::string::npos || colon1 == std::string::npos || colon2 == std::string::npos)
+      {
+         fprintf(stderr, "Bad animation \"%s\"\n", spec.c_str());
+         return 1;
+      }
+
+      Animation animation;
+      animation.name = spec.substr(0, equals);
+      animation.folder = spec.substr(equals + 1, colon1 - equals - 1);
+      animation.frameCount = atoi(spec.substr(colon1 + 1, colon2 - colon1 - 1).c_str());
+      animation.frameRate = atoi(spec.substr(colon2 + 1).c_str());
+      animation.firstFrame = (int)frames.size();
+
+      for(int i = 0; i < animation.frameCount; i++)
+      {
+         char fileName[16];
+         sprintf(fileName, "/%03d.png", i + 1);
+         std::vector<unsigned char> pixels;
+         int width, height;
+         if(!PngLoad(root + "/" + animation.folder + fileName, &pixels, &width, &height))
+            return 1;
+         Frame frame;
+         FrameTrim(pixels, width, height, &frame);
+         frame.sourceWidth = width;
+         frame.sourceHeight = height;
+         frame.duplicateOf = -1;
+         for(size_t j = 0; j < frames.size(); j++)
+         {
+            if(frames[j].duplicateOf < 0 && frames[j].width == frame.width &&
+               frames[j].height == frame.height && frames[j].pixels == frame.pixels)
+            {
+               frame.duplicateOf = (int)j;
+               frame.pixels.clear();
+               break;
+            }
+         }
+         frames.push_back(frame);
+      }
+      animations.push_back(animation);
+   }
+
+   int pageCount = FramesPack(frames, pageSize);
+   if(!pageCount)
+      return 1;
+
+   // Copy the frames onto the pages.  Each page is cut down to the smallest
+   // power of two that holds what's on it.
+   for(int page = 0; page < pageCount; page++)
+   {
+      int width = 1, height = 1;
+      for(size_t i = 0; i < frames.size(); i++)
+      {
+         if(frames[i].page == page)
+         {
+            width = std::max(width, frames[i].x + frames[i].width);
+            height = std::max(height, frames[i].y + frames[i].height);
+         }
+      }
+      width = PowerOfTwoCeiling(width);
+      height = PowerOfTwoCeiling(height);
+
+      std::vector<unsigned char> pixels(width * height * 4, 0);
+      for(size_t i = 0; i < frames.size(); i++)
+      {
+         const Frame& frame = frames[i];
+         if(frame.page != page || frame.duplicateOf >= 0)
+            continue;
+         for(int y = 0; y < frame.height; y++)
+         {
+            memcpy(&pixels[((frame.y + y) * width + frame.x) * 4],
+               &frame.pixels[y * frame.width * 4], frame.width * 4);
+         }
+      }
+
+      char suffix[16];
+      sprintf(suffix, "_%d.png", page);
+      if(!PngSave(root + "/" + pageName + suffix, pixels, width, height))
+         return 1;
+      printf("Page %d: %dx%d\n", page, width, height);
+   }
+
+   // Write the header describing the frames.
+   FILE* header = fopen(headerPath.c_str(), "w");
+   if(!header)
+   {
+      fprintf(stderr, "Unable to write %s\n", headerPath.c_str());
+      return 1;
+   }
+
+   std::string guard = "__" + atlasName + "ATLAS_H__";
+   std::transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+   fprintf(header, "// Generated by Tools/AtlasPacker.  Do not edit.\n");
+   fprintf(header, "//    AtlasPacker");
+   for(int arg = 1; arg < argc; arg++)
+      fprintf(header, " %s", argv[arg]);
+   fprintf(header, "\n\n#ifndef %s\n#define %s\n\n#include \"TextureAtlas.h\"\n\nnamespace Webfoot {\n\n", guard.c_str(), guard.c_str());
+
+   fprintf(header, "static const char* const %sAtlasPages[] =\n{\n", atlasName.c_str());
+   for(int page = 0; page < pageCount; page++)
+      fprintf(header, "   \"%s_%d\",\n", pageName.c_str(), page);
+   fprintf(header, "};\n\n");
+
+   for(size_t a = 0; a < animations.size(); a++)
+   {
+      const Animation& animation = animations[a];
+      fprintf(header, "static const AtlasFrame %sAtlas%sFrames[] =\n{\n", atlasName.c_str(), animation.name.c_str());
+      fprintf(header, "   // page, x, y, width, height, offsetX, offsetY, sourceWidth, sourceHeight\n");
+      for(int i = 0; i < animation.frameCount; i++)
+      {
+         const Frame& frame = frames[animation.firstFrame + i];
+         fprintf(header, "   {%d, %d, %d, %d, %d, %d, %d, %d, %d},\n", frame.page, frame.x, frame.y,
+            frame.width, frame.height, frame.offsetX, frame.offsetY, frame.sourceWidth, frame.sourceHeight);
+      }
+      fprintf(header, "};\n\n");
+   }
+
+   fprintf(header, "static const AtlasAnimation %sAtlasAnimations[] =\n{\n", atlasName.c_str());
+   fprintf(header, "   // name, frame count, frame rate, frames\n");
+   for(size_t a = 0; a < animations.size(); a++)
+   {
+      const Animation& animation = animations[a];
+      fprintf(header, "   {\"%s\", %d, %d, %sAtlas%sFrames},\n", animation.name.c_str(),
+         animation.frameCount, animation.frameRate, atlasName.c_str(), animation.name.c_str());
+   }
+   fprintf(header, "};\n\n");
+
+   fprintf(header, "static const AtlasDefinition %sAtlas =\n{\n   %sAtlasPages, %d,\n   %sAtlasAnimations, %d\n};\n\n",
+      atlasName.c_str(), atlasName.c_str(), pageCount, atlasName.c_str(), (int)animations.size());
+   fprintf(header, "} //namespace Webfoot {\n\n#endif //#ifndef %s\n", guard.c_str());
+   fclose(header);
+
+   int uniqueCount = 0;
+   for(size_t i = 0; i < frames.size(); i++)
+   {
+      if(frames[i].duplicateOf < 0)
+         uniqueCount++;
+   }
+   printf("%d frames (%d unique) on %d pages\n", (int)frames.size(), uniqueCount, pageCount);
+   return 0;
+}
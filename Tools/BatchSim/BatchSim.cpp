@@ -0,0 +1,391 @@
+// BatchSim plays many matches of Pong with the same rules as the game, with
+// no screen, so the AI's difficulty can be tuned from numbers rather than by
+// playing one game at a time.
+//
+// Matches are split into small batches and spread across worker threads.  A
+// worker that runs out of batches steals from the others, so the work stays
+// even across cores however long each match takes.  Every match is seeded from
+// its own number, so the results are the same for any number of threads.
+//
+// The left paddle is always the AI being tuned.  The right paddle is either
+// another AI with a fixed difficulty ("ai" mode), or a script that
+// plays the way a person might, following the ball with the keyboard
+// controls after a reaction delay ("scripted" mode).
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -pthread -ISources -o BatchSim
+//       Tools/BatchSim/BatchSim.cpp Sources/PongSim.cpp
+//       Sources/PongLookahead.cpp Sources/PongScript.cpp
+//
+// Usage:
+//    BatchSim [options]
+//       --matches <n>          Matches for each difficulty.  (1000)
+//       --threads <n>          Worker threads.  (Number of cores)
+//       --mode <ai|scripted>   What plays the right paddle.  (scripted)
+//       --difficulty <ms>:<px>[:lookahead][,...]
+//                              AI reaction times and errors to try on the
+//                              left, and whether it looks ahead.
+//                              (350:110,250:90,120:80,120:70:lookahead)
+//       --opponent <ms>:<px>[:lookahead]
+//                              Difficulty of the right paddle in ai mode.
+//                              (250:90)
+//       --reaction <ms>        How late the script sees the ball.  (200)
+//       --seed <n>             Seed for the whole run.  (1)
+//
+// Example, sweeping the difficulty against the script:
+//    BatchSim --matches 5000 --difficulty 250:70,250:80,250:90,250:100,250:110
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PongScript.h"
+
+using namespace Webfoot;
+
+/// Matches in each batch handed to a worker.  Small enough that stealing
+/// evens out the work, big enough that the deques aren't touched much.
+#define MATCHES_PER_TASK 8
+/// A match still going after this many steps is given up on.  (30 minutes)
+#define MATCH_TICK_LIMIT (PONG_TICK_RATE * 60 * 30)
+
+//==============================================================================
+
+enum OpponentMode { OPPONENT_AI, OPPONENT_SCRIPTED };
+
+/// How good an AI paddle is.
+struct Difficulty
+{
+   /// Seconds to react to the ball being hit.
+   float reactionTime;
+   /// Most pixels it can misjudge where the ball is going by.
+   float error;
+   /// True if it plays out ways of returning the ball.
+   bool lookahead;
+};
+
+/// Everything that's the same for every match in a run.
+struct Settings
+{
+   int matchCount;
+   int threadCount;
+   OpponentMode mode;
+   std::vector<Difficulty> difficulties;
+   Difficulty opponent;
+   int reactionTicks;
+   unsigned int seed;
+};
+
+/// A batch of matches, all with the same difficulty.
+struct Task
+{
+   int difficultyIndex;
+   int firstMatch;
+   int matchCount;
+};
+
+/// Results for one difficulty.  Each worker keeps its own, and they're added up
+/// at the end.
+struct Results
+{
+   /// Matches won by the left (tuned AI) and right paddles, and given up on.
+   long long leftWins;
+   long long rightWins;
+   long long unfinished;
+   /// Points scored, paddle hits in all of them, and the most in one.
+   long long points;
+   long long rallyHits;
+   long long longestRally;
+   /// Steps taken in all the matches.
+   long long ticks;
+};
+
+/// A worker thread's batches and results.  Results are only added to once
+/// per match, so workers writing to their own don't get in each other's way.
+struct Worker
+{
+   std::mutex mutex;
+   std::deque<Task> tasks;
+   std::vector<Results> results;
+   std::thread thread;
+};
+
+//==============================================================================
+
+/// Returns a well mixed seed for the given match, so neighbouring matches
+/// don't play out alike.
+static unsigned int MatchSeedGet(unsigned int seed, int difficultyIndex, int match)
+{
+   unsigned int hash = seed ^ (0x9E3779B9u * (unsigned int)(difficultyIndex + 1)) ^ (0x85EBCA6Bu * (unsigned int)(match + 1));
+   hash ^= hash >> 16;
+   hash *= 0x7FEB352Du;
+   hash ^= hash >> 15;
+   hash *= 0x846CA68Bu;
+   hash ^= hash >> 16;
+   return hash;
+}
+
+//------------------------------------------------------------------------------
+
+/// Play a whole match and add how it went to 'results'.
+static void MatchPlay(const Settings& settings, int difficultyIndex, int match, Results* results)
+{
+   PongSim sim;
+   PongConfig config = sim.ConfigGet();
+   config.aiControlled[PONG_PADDLE_LEFT] = true;
+   config.aiControlled[PONG_PADDLE_RIGHT] = settings.mode == OPPONENT_AI;
+   const Difficulty& difficulty = settings.difficulties[difficultyIndex];
+   config.aiReactionTime[PONG_PADDLE_LEFT] = difficulty.reactionTime;
+   config.aiError[PONG_PADDLE_LEFT] = difficulty.error;
+   config.aiLookahead[PONG_PADDLE_LEFT] = difficulty.lookahead;
+   config.aiReactionTime[PONG_PADDLE_RIGHT] = settings.opponent.reactionTime;
+   config.aiError[PONG_PADDLE_RIGHT] = settings.opponent.error;
+   config.aiLookahead[PONG_PADDLE_RIGHT] = settings.opponent.lookahead;
+   sim.Init(config, MatchSeedGet(settings.seed, difficultyIndex, match));
+
+   PongScript script;
+   script.Init(PONG_PADDLE_RIGHT, settings.reactionTicks);
+
+   PongInput input;
+   input.paddleDirection[PONG_PADDLE_LEFT] = 0;
+   input.paddleDirection[PONG_PADDLE_RIGHT] = 0;
+   input.serve = true;
+   input.restart = false;
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   long long rally = 0;
+   int tick;
+   for(tick = 0; tick < MATCH_TICK_LIMIT && sim.StateGet().gameState != STATE_END; tick++)
+   {
+      if(settings.mode == OPPONENT_SCRIPTED)
+         input.paddleDirection[PONG_PADDLE_RIGHT] = script.DirectionGet(sim.StateGet(), config);
+
+      unsigned int events = sim.Step(input, tickSeconds);
+      if(events & PONG_EVENT_PADDLE_HIT)
+         rally++;
+      if(events & PONG_EVENT_GOAL)
+      {
+         results->points++;
+         results->rallyHits += rally;
+         results->longestRally = std::max(results->longestRally, rally);
+         rally = 0;
+      }
+   }
+   results->ticks += tick;
+
+   // playerScore1 belongs to the right paddle, and playerScore2 to the left.
+   const PongState& state = sim.StateGet();
+   if(state.gameState != STATE_END)
+      results->unfinished++;
+   else if(state.playerScore2 >= config.winningScore)
+      results->leftWins++;
+   else
+      results->rightWins++;
+}
+
+//------------------------------------------------------------------------------
+
+/// Take a task from the back of this worker's own deque, or failing that,
+/// from the front of someone else's.  Returns false once there's nothing
+/// left anywhere.
+static bool TaskGet(std::vector<Worker>& workers, int self, Task* task)
+{
+   {
+      Worker& worker = workers[self];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      if(!worker.tasks.empty())
+      {
+         *task = worker.tasks.back();
+         worker.tasks.pop_back();
+         return true;
+      }
+   }
+
+   // No task is ever added once the workers start, so if every deque is
+   // empty, we're done.
+   int workerCount = (int)workers.size();
+   for(int i = 1; i < workerCount; i++)
+   {
+      Worker& victim = workers[(self + i) % workerCount];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if(!victim.tasks.empty())
+      {
+         *task = victim.tasks.front();
+         victim.tasks.pop_front();
+         return true;
+      }
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+
+static void WorkerRun(const Settings& settings, std::vector<Worker>& workers, int self)
+{
+   std::vector<Results>& results = workers[self].results;
+   Task task;
+   while(TaskGet(workers, self, &task))
+   {
+      for(int i = 0; i < task.matchCount; i++)
+         MatchPlay(settings, task.difficultyIndex, task.firstMatch + i, &results[task.difficultyIndex]);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Split a comma separated list of <reaction ms>:<error px>[:lookahead].
+static std::vector<Difficulty> DifficultiesParse(const char* text)
+{
+   std::vector<Difficulty> difficulties;
+   std::string list = text;
+   size_t start = 0;
+   while(start <= list.size())
+   {
+      size_t comma = list.find(',', start);
+      if(comma == std::string::npos)
+         comma = list.size();
+      std::string item = list.substr(start, comma - start);
+      size_t colon = item.find(':');
+      if(colon != std::string::npos)
+      {
+         Difficulty difficulty;
+         difficulty.reactionTime = (float)atof(item.substr(0, colon).c_str()) / 1000.0f;
+         difficulty.error = (float)atof(item.substr(colon + 1).c_str());
+         difficulty.lookahead = item.find(":lookahead") != std::string::npos;
+         difficulties.push_back(difficulty);
+      }
+      start = comma + 1;
+   }
+   return difficulties;
+}
+
+//------------------------------------------------------------------------------
+
+static void UsagePrint(const char* program)
+{
+   fprintf(stderr, "Usage: %s [--matches <n>] [--threads <n>] [--mode <ai|scripted>] "
+      "[--difficulty <ms>:<px>[:lookahead][,...]] [--opponent <ms>:<px>[:lookahead]] "
+      "[--reaction <ms>] [--seed <n>]\n", program);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   Settings settings;
+   settings.matchCount = 1000;
+   settings.threadCount = (int)std::thread::hardware_concurrency();
+   settings.mode = OPPONENT_SCRIPTED;
+   settings.difficulties = DifficultiesParse("350:110,250:90,120:80,120:70:lookahead");
+   settings.opponent = settings.difficulties[1];
+   settings.reactionTicks = 200 * PONG_TICK_RATE / 1000;
+   settings.seed = 1;
+
+   for(int arg = 1; arg < argc; arg++)
+   {
+      const char* option = argv[arg];
+      if(arg + 1 >= argc)
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+      const char* value = argv[++arg];
+
+      if(!strcmp(option, "--matches"))
+         settings.matchCount = atoi(value);
+      else if(!strcmp(option, "--threads"))
+         settings.threadCount = atoi(value);
+      else if(!strcmp(option, "--mode") && !strcmp(value, "ai"))
+         settings.mode = OPPONENT_AI;
+      else if(!strcmp(option, "--mode") && !strcmp(value, "scripted"))
+         settings.mode = OPPONENT_SCRIPTED;
+      else if(!strcmp(option, "--difficulty"))
+         settings.difficulties = DifficultiesParse(value);
+      else if(!strcmp(option, "--opponent") && DifficultiesParse(value).size() == 1)
+         settings.opponent = DifficultiesParse(value)[0];
+      else if(!strcmp(option, "--reaction"))
+         settings.reactionTicks = atoi(value) * PONG_TICK_RATE / 1000;
+      else if(!strcmp(option, "--seed"))
+         settings.seed = (unsigned int)strtoul(value, NULL, 0);
+      else
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+   }
+   if(settings.threadCount < 1)
+      settings.threadCount = 1;
+   if(settings.matchCount < 1 || settings.difficulties.empty())
+   {
+      UsagePrint(argv[0]);
+      return 1;
+   }
+
+   // Deal the batches out to the workers in turn.
+   int difficultyCount = (int)settings.difficulties.size();
+   std::vector<Worker> workers(settings.threadCount);
+   for(int i = 0; i < settings.threadCount; i++)
+   {
+      Results empty = {0, 0, 0, 0, 0, 0, 0};
+      workers[i].results.assign(difficultyCount, empty);
+   }
+   int taskCount = 0;
+   for(int difficulty = 0; difficulty < difficultyCount; difficulty++)
+   {
+      for(int first = 0; first < settings.matchCount; first += MATCHES_PER_TASK)
+      {
+         Task task = {difficulty, first, std::min(MATCHES_PER_TASK, settings.matchCount - first)};
+         workers[taskCount % settings.threadCount].tasks.push_back(task);
+         taskCount++;
+      }
+   }
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   for(int i = 0; i < settings.threadCount; i++)
+      workers[i].thread = std::thread(WorkerRun, std::cref(settings), std::ref(workers), i);
+   for(int i = 0; i < settings.threadCount; i++)
+      workers[i].thread.join();
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   printf("%d matches per difficulty, %s opponent, %d threads\n\n", settings.matchCount,
+      settings.mode == OPPONENT_AI ? "AI" : "scripted", settings.threadCount);
+   printf("%10s %8s %8s %8s %10s %10s %10s\n", "difficulty", "AI wins", "opp wins", "unfinished",
+      "avg rally", "max rally", "avg match");
+
+   long long totalMatches = 0;
+   long long totalTicks = 0;
+   for(int difficulty = 0; difficulty < difficultyCount; difficulty++)
+   {
+      Results total = {0, 0, 0, 0, 0, 0, 0};
+      for(int i = 0; i < settings.threadCount; i++)
+      {
+         const Results& results = workers[i].results[difficulty];
+         total.leftWins += results.leftWins;
+         total.rightWins += results.rightWins;
+         total.unfinished += results.unfinished;
+         total.points += results.points;
+         total.rallyHits += results.rallyHits;
+         total.longestRally = std::max(total.longestRally, results.longestRally);
+         total.ticks += results.ticks;
+      }
+      totalMatches += settings.matchCount;
+      totalTicks += total.ticks;
+
+      double matches = (double)settings.matchCount;
+      const Difficulty& tried = settings.difficulties[difficulty];
+      printf("%6.0f:%-3.0f%c %6.1f%% %7.1f%% %9.1f%% %10.2f %10lld %9.1fs\n", tried.reactionTime * 1000.0f, tried.error, tried.lookahead ? '*' : ' ',
+         100.0 * total.leftWins / matches, 100.0 * total.rightWins / matches, 100.0 * total.unfinished / matches,
+         total.points ? (double)total.rallyHits / total.points : 0.0, total.longestRally,
+         (double)total.ticks / PONG_TICK_RATE / matches);
+   }
+
+   printf("\n%lld matches in %.2f s: %.0f matches/s, %.2f million steps/s\n", totalMatches, seconds,
+      totalMatches / seconds, totalTicks / seconds / 1000000.0);
+   return 0;
+}
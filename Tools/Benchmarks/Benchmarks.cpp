@@ -0,0 +1,749 @@
+// Benchmarks times the hot paths of the game's rules with no screen, so a
+// change that slows them down shows up as a number rather than as a feeling
+// that the game got choppier.
+//
+// Each benchmark runs its code in a loop, first growing the number of
+// iterations until one run takes at least the minimum time, then repeating
+// that run a few times.  The median run is reported, along with the fastest,
+// since the fastest is the least disturbed by whatever else the machine was
+// doing.  Setting up each run isn't timed.
+//
+// Results are written as JSON, so runs from before and after a change can be
+// compared by a script.  Progress goes to stderr.
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -pthread -ISources -o Benchmarks
+//       Tools/Benchmarks/Benchmarks.cpp Sources/PongSim.cpp
+//       Sources/PongLookahead.cpp Sources/DuaneStorm.cpp Sources/PongChaos.cpp
+//       Sources/AudioQueue.cpp Sources/PongSnapshot.cpp
+//
+// Usage:
+//    Benchmarks [options]
+//       --filter <text>        Only run benchmarks with <text> in their name.
+//       --min-time <ms>        Shortest a single run can be.  (250)
+//       --repetitions <n>      Timed runs of each benchmark.  (5)
+//       --output <path>        Write the JSON here rather than to stdout.
+//
+// Example, comparing two builds:
+//    Benchmarks --output Before.json
+//    Benchmarks --output After.json
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "AudioQueue.h"
+#include "DuaneStorm.h"
+#include "PongChaos.h"
+#include "PongLookahead.h"
+#include "PongSim.h"
+#include "PongSnapshot.h"
+
+using namespace Webfoot;
+
+/// Number of Duanes in the storm benchmarks.
+#define STORM_DUANE_COUNT 1000
+/// Length of the Duane animation, in milliseconds.
+#define STORM_ANIMATION_LENGTH 800
+/// Length of a frame at 60 frames per second, in milliseconds.
+#define FRAME_DURATION 16
+/// Size of the balls in the chaos benchmarks.  Smaller than the game's, so
+/// that even the biggest crowd fits on the screen.
+#define CHAOS_BALL_SIZE 8.0f
+/// Number of obstacles and pickups in the chaos benchmarks.
+#define CHAOS_OBSTACLE_COUNT 8
+#define CHAOS_PICKUP_COUNT 16
+/// Number of different velocities the clamp benchmark cycles through.  Must be
+/// a power of 2.
+#define CLAMP_VELOCITY_COUNT 256
+/// Ticks of a match the snapshot benchmarks go through, and how often one of
+/// them is a keyframe.
+#define SNAPSHOT_TICK_COUNT 4096
+#define SNAPSHOT_KEYFRAME_INTERVAL PONG_TICK_RATE
+/// Most iterations of any one run.
+#define ITERATIONS_MAX (1LL << 40)
+
+//==============================================================================
+
+/// Runs the benchmark's code 'iterations' times and returns the seconds it
+/// took, not counting any setup.
+typedef double (*BenchmarkRun)(long long iterations);
+
+struct Benchmark
+{
+   const char* name;
+   /// Things processed by each iteration, such as Duanes or steps.
+   int itemsPerIteration;
+   BenchmarkRun run;
+};
+
+/// Everything that's the same for every benchmark in a run.
+struct Settings
+{
+   const char* filter;
+   double minSeconds;
+   int repetitions;
+   const char* outputPath;
+};
+
+/// How one benchmark did.
+struct Result
+{
+   const Benchmark* benchmark;
+   long long iterations;
+   /// Median and fastest of the timed runs, in nanoseconds per iteration.
+   double medianNanoseconds;
+   double fastestNanoseconds;
+};
+
+/// Something for each benchmark to add its results to, so the compiler can't
+/// throw the work away as unused.
+static volatile float sink;
+
+//==============================================================================
+
+/// Measures time from construction.
+class Timer
+{
+public:
+   Timer() { start = std::chrono::steady_clock::now(); }
+
+   /// Returns the seconds since the timer was made.
+   double SecondsGet() const
+   {
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   }
+
+protected:
+   std::chrono::steady_clock::time_point start;
+};
+
+//------------------------------------------------------------------------------
+
+/// Returns the game's usual config, with both paddles played by the AI.
+static PongConfig ConfigGet()
+{
+   PongSim sim;
+   PongConfig config = sim.ConfigGet();
+   config.aiControlled[PONG_PADDLE_LEFT] = true;
+   config.aiControlled[PONG_PADDLE_RIGHT] = true;
+   return config;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns a ball in the middle of the screen, moving as fast as it can up and
+/// to the left.
+static PongBall MaxSpeedBallGet(const PongConfig& config)
+{
+   PongBall ball;
+   ball.position.x = config.screenWidth / 2;
+   ball.position.y = config.screenHeight / 2;
+   ball.velocity.x = -config.ballMaxSpeed;
+   ball.velocity.y = -config.ballMaxSpeed;
+   ball.playerHit = -1;
+   return ball;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns a match with both paddles played by AIs that never react late or
+/// misjudge the ball, so the ball is never missed.
+static PongSim* RallySimNew()
+{
+   PongConfig config = ConfigGet();
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      config.aiReactionTime[i] = 0.0f;
+      config.aiError[i] = 0.0f;
+   }
+   PongSim* sim = new PongSim();
+   sim->Init(config, 1);
+   return sim;
+}
+
+//------------------------------------------------------------------------------
+
+/// Step 'sim', restarting the match if the last one is over.
+static unsigned int RallyStep(PongSim* sim, const PongInput& input, float dtSeconds)
+{
+   if(sim->StateGet().gameState != STATE_END)
+      return sim->Step(input, dtSeconds);
+
+   // Restart the way a player does.  ResetGame on its own would leave the
+   // match over, and nothing would move from then on.
+   PongInput restartInput = input;
+   restartInput.restart = true;
+   return sim->Step(restartInput, dtSeconds);
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns input that serves whenever the ball isn't in play.
+static PongInput ServeInputGet()
+{
+   PongInput input;
+   input.paddleDirection[PONG_PADDLE_LEFT] = 0;
+   input.paddleDirection[PONG_PADDLE_RIGHT] = 0;
+   input.serve = true;
+   input.restart = false;
+   return input;
+}
+
+//==============================================================================
+
+/// The speed limits applied to the ball before every move, over velocities
+/// that are too slow, too fast and just right.
+static double BallVelocityClampRun(long long iterations)
+{
+   PongConfig config = ConfigGet();
+   PongVector velocities[CLAMP_VELOCITY_COUNT];
+   unsigned int randomState = 1;
+   for(int i = 0; i < CLAMP_VELOCITY_COUNT; i++)
+   {
+      velocities[i].x = (PongSim::RandomF(&randomState) * 2.0f - 1.0f) * config.ballMaxSpeed * 1.5f;
+      velocities[i].y = (PongSim::RandomF(&randomState) * 2.0f - 1.0f) * config.ballMaxSpeed * 1.5f;
+   }
+
+   float total = 0.0f;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      PongVector velocity = velocities[i & (CLAMP_VELOCITY_COUNT - 1)];
+      PongSim::BallVelocityClamp(&velocity, config);
+      total += velocity.x;
+   }
+   double seconds = timer.SecondsGet();
+   sink = total;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// One step of a ball going as fast as it can, bouncing off the walls and
+/// the paddles.
+static double BallUpdateMaxSpeedRun(long long iterations)
+{
+   PongConfig config = ConfigGet();
+   PongSim sim;
+   sim.Init(config, 1);
+   PongPaddle paddles[PONG_PADDLE_COUNT];
+   memcpy(paddles, sim.StateGet().paddles, sizeof(paddles));
+   PongBall start = MaxSpeedBallGet(config);
+   PongBall ball = start;
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   unsigned int events = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      events += PongSim::BallUpdate(&ball, paddles, config, tickSeconds);
+      // Put it back in the middle once it gets past a paddle.
+      if(ball.position.x < config.leftGoal || ball.position.x > config.rightGoal)
+         ball = start;
+   }
+   double seconds = timer.SecondsGet();
+   sink = ball.position.x + (float)events;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Checking a ball at full speed against a paddle it's about to hit.
+static double CollideHitRun(long long iterations)
+{
+   PongConfig config = ConfigGet();
+   PongSim sim;
+   sim.Init(config, 1);
+   const PongPaddle& paddle = sim.StateGet().paddles[PONG_PADDLE_LEFT];
+   PongBall ball = MaxSpeedBallGet(config);
+   ball.position.x = PongSim::AiPlaneXGet(paddle, config) + 2.0f;
+   ball.position.y = paddle.position.y + config.paddleSize[PONG_PADDLE_LEFT].y / 2;
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   int hits = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      PongContact contact;
+      hits += PongSim::Collide(ball, paddle, config, tickSeconds, &contact);
+   }
+   double seconds = timer.SecondsGet();
+   sink = (float)hits;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Checking a ball against a paddle it's nowhere near, which is what happens
+/// on most steps.
+static double CollideMissRun(long long iterations)
+{
+   PongConfig config = ConfigGet();
+   PongSim sim;
+   sim.Init(config, 1);
+   const PongPaddle& paddle = sim.StateGet().paddles[PONG_PADDLE_LEFT];
+   PongBall ball = MaxSpeedBallGet(config);
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   int hits = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      PongContact contact;
+      hits += PongSim::Collide(ball, paddle, config, tickSeconds, &contact);
+   }
+   double seconds = timer.SecondsGet();
+   sink = (float)hits;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Moving an AI paddle toward a plan it already has, which is what it does on
+/// most steps.
+static double AiPaddleMoveRun(long long iterations)
+{
+   PongConfig config = ConfigGet();
+   PongSim sim;
+   sim.Init(config, 1);
+   PongState state = sim.StateGet();
+   state.ball = MaxSpeedBallGet(config);
+   PongSim::AiPlanReset(&state.aiPlans[PONG_PADDLE_LEFT], config);
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      PongSim::AiPaddleMove(&state.paddles[PONG_PADDLE_LEFT], &state.aiPlans[PONG_PADDLE_LEFT], state.ball,
+         state.paddles[PONG_PADDLE_RIGHT], config, &state.randomState, tickSeconds);
+   }
+   double seconds = timer.SecondsGet();
+   sink = state.paddles[PONG_PADDLE_LEFT].position.y;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Making a new plan, which the AI does each time the ball is hit.
+static double AiPlanRun(bool lookahead, long long iterations)
+{
+   PongConfig config = ConfigGet();
+   config.aiLookahead[PONG_PADDLE_LEFT] = lookahead;
+   PongSim sim;
+   sim.Init(config, 1);
+   PongState state = sim.StateGet();
+   state.ball = MaxSpeedBallGet(config);
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      PongSim::AiPlanReset(&state.aiPlans[PONG_PADDLE_LEFT], config);
+      PongSim::AiPaddleMove(&state.paddles[PONG_PADDLE_LEFT], &state.aiPlans[PONG_PADDLE_LEFT], state.ball,
+         state.paddles[PONG_PADDLE_RIGHT], config, &state.randomState, tickSeconds);
+   }
+   double seconds = timer.SecondsGet();
+   sink = state.aiPlans[PONG_PADDLE_LEFT].targetY;
+   return seconds;
+}
+
+static double AiPlanPredictRun(long long iterations) { return AiPlanRun(false, iterations); }
+static double AiPlanLookaheadRun(long long iterations) { return AiPlanRun(true, iterations); }
+
+//------------------------------------------------------------------------------
+
+/// One frame's worth of moving the Duane storm.
+static double DuaneStormUpdateRun(long long iterations)
+{
+   DuaneStorm storm;
+   storm.Init(STORM_DUANE_COUNT, 1024.0f, 768.0f, STORM_ANIMATION_LENGTH, 1);
+
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+      storm.Update(FRAME_DURATION);
+   double seconds = timer.SecondsGet();
+   sink = storm.PositionYGet()[0];
+   storm.Deinit();
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// A whole step of a rally that never ends, between two AIs that never miss.
+static double LongRallyStepRun(long long iterations)
+{
+   PongSim* sim = RallySimNew();
+   PongInput input = ServeInputGet();
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   unsigned int events = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+      events |= RallyStep(sim, input, tickSeconds);
+   double seconds = timer.SecondsGet();
+   sink = sim->StateGet().ball.position.x + (float)events;
+   delete sim;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Everything MainGame::Update does for a 60 frame per second frame that
+/// doesn't draw or need Frog: the steps of the simulation that fit in the
+/// frame, the Duane storm, and working out where to draw the ball and
+/// paddles between the last two steps.
+static double FrameRun(long long iterations)
+{
+   PongSim* sim = RallySimNew();
+   PongInput input = ServeInputGet();
+   DuaneStorm storm;
+   storm.Init(STORM_DUANE_COUNT, sim->ConfigGet().screenWidth, sim->ConfigGet().screenHeight,
+      STORM_ANIMATION_LENGTH, 1);
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   float accumulator = 0.0f;
+   PongState previous = sim->StateGet();
+   float drawn = 0.0f;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      storm.Update(FRAME_DURATION);
+
+      accumulator += FRAME_DURATION / 1000.0f;
+      while(accumulator >= tickSeconds)
+      {
+         previous = sim->StateGet();
+         RallyStep(sim, input, tickSeconds);
+         accumulator -= tickSeconds;
+      }
+
+      const PongState& current = sim->StateGet();
+      float alpha = accumulator / tickSeconds;
+      drawn += PongSim::Lerp(previous.ball.position, current.ball.position, alpha).x;
+      for(int paddle = 0; paddle < PONG_PADDLE_COUNT; paddle++)
+         drawn += PongSim::Lerp(previous.paddles[paddle].position, current.paddles[paddle].position, alpha).y;
+   }
+   double seconds = timer.SecondsGet();
+   sink = drawn + storm.PositionYGet()[0];
+   storm.Deinit();
+   delete sim;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// A step of chaos mode with 'ballCount' balls, obstacles and pickups.  The
+/// time for each ball should only go up as much as the screen gets more
+/// crowded, rather than with the number of balls.
+static double ChaosStepRun(int ballCount, long long iterations)
+{
+   PongSim sim;
+   PongConfig config = ConfigGet();
+   config.ballSize = CHAOS_BALL_SIZE;
+   sim.Init(config, 1);
+   PongInput input = ServeInputGet();
+
+   PongChaos chaos;
+   chaos.Init(config, ballCount, 1);
+   unsigned int randomState = 1;
+   for(int i = 0; i < CHAOS_OBSTACLE_COUNT + CHAOS_PICKUP_COUNT; i++)
+   {
+      float x = config.screenWidth * (0.25f + 0.5f * PongSim::RandomF(&randomState));
+      float y = config.screenHeight * PongSim::RandomF(&randomState);
+      PongBox box = {x, y, x + 32.0f, y + 64.0f};
+      chaos.ColliderAdd(i < CHAOS_OBSTACLE_COUNT ? PONG_COLLIDER_OBSTACLE : PONG_COLLIDER_PICKUP, box);
+   }
+
+   // The match keeps the paddles moving.
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   int hits = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      RallyStep(&sim, input, tickSeconds);
+      chaos.Step(sim.StateGet().paddles, tickSeconds);
+      hits += chaos.StatsGet().ballHits;
+   }
+   double seconds = timer.SecondsGet();
+   sink = chaos.PositionXGet()[0] + (float)hits;
+   chaos.Deinit();
+   return seconds;
+}
+
+static double ChaosStep200Run(long long iterations) { return ChaosStepRun(200, iterations); }
+static double ChaosStep800Run(long long iterations) { return ChaosStepRun(800, iterations); }
+
+//------------------------------------------------------------------------------
+
+/// Posting a sound command while another thread takes them off the queue, the
+/// way the game thread and the mixer do.  Only the posting side is what the
+/// game pays for, but it shares cache lines with the other side.
+static double AudioQueuePushRun(long long iterations)
+{
+   AudioQueue* queue = new AudioQueue();
+   std::atomic<bool> stopping(false);
+   std::thread consumer([queue, &stopping]()
+   {
+      AudioCommand command;
+      while(!stopping.load(std::memory_order_acquire))
+      {
+         while(queue->Pop(&command))
+            sink = (float)command.volume;
+      }
+   });
+
+   AudioCommand command;
+   command.type = AUDIO_COMMAND_PLAY;
+   command.sound = 0;
+   command.loop = false;
+   long long dropped = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      command.volume = (int)(i & 127);
+      dropped += !queue->Push(command);
+   }
+   double seconds = timer.SecondsGet();
+
+   stopping.store(true, std::memory_order_release);
+   consumer.join();
+   sink += (float)dropped;
+   delete queue;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Fill in 'snapshots' with 'count' ticks of a match between two AIs that do
+/// miss now and then, so the scores change too.
+static void SnapshotsPlay(PongSnapshot* snapshots, int count)
+{
+   PongSim sim;
+   sim.Init(ConfigGet(), 1);
+   PongInput input = ServeInputGet();
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   for(int i = 0; i < count; i++)
+   {
+      RallyStep(&sim, input, tickSeconds);
+      PongSnapshotCoder::Capture(sim.StateGet(), &snapshots[i]);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Encoding each tick of a match as the difference from the last, with a
+/// keyframe every second, the way a match is sent to a spectator.
+static double SnapshotEncodeRun(long long iterations)
+{
+   PongSnapshot* snapshots = new PongSnapshot[SNAPSHOT_TICK_COUNT];
+   SnapshotsPlay(snapshots, SNAPSHOT_TICK_COUNT);
+
+   unsigned char buffer[PONG_SNAPSHOT_SIZE_MAX];
+   long long bytes = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      int index = (int)(i % SNAPSHOT_TICK_COUNT);
+      const PongSnapshot* baseline = (index % SNAPSHOT_KEYFRAME_INTERVAL) ? &snapshots[index - 1] : NULL;
+      bytes += PongSnapshotCoder::Encode(baseline, snapshots[index], buffer, sizeof(buffer));
+   }
+   double seconds = timer.SecondsGet();
+   sink = (float)bytes;
+   delete[] snapshots;
+   return seconds;
+}
+
+//------------------------------------------------------------------------------
+
+/// Decoding what SnapshotEncodeRun encodes, each tick from the one decoded
+/// before it.
+static double SnapshotDecodeRun(long long iterations)
+{
+   PongSnapshot* snapshots = new PongSnapshot[SNAPSHOT_TICK_COUNT];
+   SnapshotsPlay(snapshots, SNAPSHOT_TICK_COUNT);
+   unsigned char* encoded = new unsigned char[SNAPSHOT_TICK_COUNT * PONG_SNAPSHOT_SIZE_MAX];
+   int* sizes = new int[SNAPSHOT_TICK_COUNT];
+   for(int i = 0; i < SNAPSHOT_TICK_COUNT; i++)
+   {
+      const PongSnapshot* baseline = (i % SNAPSHOT_KEYFRAME_INTERVAL) ? &snapshots[i - 1] : NULL;
+      sizes[i] = PongSnapshotCoder::Encode(baseline, snapshots[i], &encoded[i * PONG_SNAPSHOT_SIZE_MAX],
+         PONG_SNAPSHOT_SIZE_MAX);
+   }
+
+   // Decode back and forth between two snapshots.  Going around to the start
+   // again lands on a keyframe, so the baseline left over from the end
+   // doesn't matter.
+   PongSnapshot decoded[2];
+   memset(decoded, 0, sizeof(decoded));
+   long long failures = 0;
+   Timer timer;
+   for(long long i = 0; i < iterations; i++)
+   {
+      int index = (int)(i % SNAPSHOT_TICK_COUNT);
+      failures += !PongSnapshotCoder::Decode(&decoded[(i + 1) & 1], &encoded[index * PONG_SNAPSHOT_SIZE_MAX],
+         sizes[index], &decoded[i & 1]);
+   }
+   double seconds = timer.SecondsGet();
+   sink = (float)(decoded[0].fields[PONG_SNAPSHOT_BALL_X] + failures);
+   delete[] sizes;
+   delete[] encoded;
+   delete[] snapshots;
+   return seconds;
+}
+
+//==============================================================================
+
+static const Benchmark benchmarks[] =
+{
+   {"BallVelocityClamp", 1, BallVelocityClampRun},
+   {"BallUpdate/MaxSpeed", 1, BallUpdateMaxSpeedRun},
+   {"Collide/Hit", 1, CollideHitRun},
+   {"Collide/Miss", 1, CollideMissRun},
+   {"AiPaddleMove/Track", 1, AiPaddleMoveRun},
+   {"AiPaddleMove/Plan", 1, AiPlanPredictRun},
+   {"AiPaddleMove/PlanLookahead", 1, AiPlanLookaheadRun},
+   {"DuaneStorm/Update1000", STORM_DUANE_COUNT, DuaneStormUpdateRun},
+   {"Step/LongRally", 1, LongRallyStepRun},
+   {"Frame/60fps", 1, FrameRun},
+   {"Chaos/Step200", 200, ChaosStep200Run},
+   {"Chaos/Step800", 800, ChaosStep800Run},
+   {"AudioQueue/Push", 1, AudioQueuePushRun},
+   {"Snapshot/Encode", 1, SnapshotEncodeRun},
+   {"Snapshot/Decode", 1, SnapshotDecodeRun},
+};
+
+//------------------------------------------------------------------------------
+
+/// Time 'benchmark' as described at the top of the file.
+static Result BenchmarkTime(const Benchmark& benchmark, const Settings& settings)
+{
+   // Grow the run until it's long enough to time well, guessing from the
+   // last run how many iterations that will take.
+   long long iterations = 1;
+   for(;;)
+   {
+      double seconds = benchmark.run(iterations);
+      if(seconds >= settings.minSeconds || iterations >= ITERATIONS_MAX)
+         break;
+      double scale = seconds > 0.0 ? settings.minSeconds * 1.2 / seconds : 100.0;
+      scale = std::min(std::max(scale, 2.0), 100.0);
+      iterations = std::min((long long)(iterations * scale), ITERATIONS_MAX);
+   }
+
+   std::vector<double> nanoseconds;
+   for(int i = 0; i < settings.repetitions; i++)
+      nanoseconds.push_back(benchmark.run(iterations) * 1e9 / iterations);
+   std::sort(nanoseconds.begin(), nanoseconds.end());
+
+   Result result;
+   result.benchmark = &benchmark;
+   result.iterations = iterations;
+   result.medianNanoseconds = nanoseconds[nanoseconds.size() / 2];
+   result.fastestNanoseconds = nanoseconds[0];
+   return result;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write the results to 'file' as JSON.
+static void ResultsWrite(FILE* file, const std::vector<Result>& results, const Settings& settings)
+{
+   fprintf(file, "{\n");
+   fprintf(file, "  \"minTimeMs\": %.0f,\n", settings.minSeconds * 1000.0);
+   fprintf(file, "  \"repetitions\": %d,\n", settings.repetitions);
+   fprintf(file, "  \"benchmarks\": [");
+   for(size_t i = 0; i < results.size(); i++)
+   {
+      const Result& result = results[i];
+      double itemsPerSecond = result.benchmark->itemsPerIteration * 1e9 / result.medianNanoseconds;
+      fprintf(file, "%s\n    {\"name\": \"%s\", \"iterations\": %lld, \"nsPerOp\": %.3f, "
+         "\"fastestNsPerOp\": %.3f, \"opsPerSecond\": %.0f, \"itemsPerOp\": %d, \"itemsPerSecond\": %.0f}",
+         i ? "," : "", result.benchmark->name, result.iterations, result.medianNanoseconds,
+         result.fastestNanoseconds, 1e9 / result.medianNanoseconds, result.benchmark->itemsPerIteration,
+         itemsPerSecond);
+   }
+   fprintf(file, "\n  ]\n}\n");
+}
+
+//------------------------------------------------------------------------------
+
+static void UsagePrint(const char* program)
+{
+   fprintf(stderr, "Usage: %s [--filter <text>] [--min-time <ms>] [--repetitions <n>] [--output <path>]\n", program);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   Settings settings;
+   settings.filter = "";
+   settings.minSeconds = 0.25;
+   settings.repetitions = 5;
+   settings.outputPath = NULL;
+
+   for(int arg = 1; arg < argc; arg++)
+   {
+      const char* option = argv[arg];
+      if(arg + 1 >= argc)
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+      const char* value = argv[++arg];
+
+      if(!strcmp(option, "--filter"))
+         settings.filter = value;
+      else if(!strcmp(option, "--min-time"))
+         settings.minSeconds = atof(value) / 1000.0;
+      else if(!strcmp(option, "--repetitions"))
+         settings.repetitions = atoi(value);
+      else if(!strcmp(option, "--output"))
+         settings.outputPath = value;
+      else
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+   }
+   if(settings.minSeconds <= 0.0 || settings.repetitions < 1)
+   {
+      UsagePrint(argv[0]);
+      return 1;
+   }
+
+   std::vector<Result> results;
+   int benchmarkCount = (int)(sizeof(benchmarks) / sizeof(benchmarks[0]));
+   for(int i = 0; i < benchmarkCount; i++)
+   {
+      if(!strstr(benchmarks[i].name, settings.filter))
+         continue;
+      Result result = BenchmarkTime(benchmarks[i], settings);
+      fprintf(stderr, "%-28s %12.1f ns/op %14lld iterations\n", benchmarks[i].name,
+         result.medianNanoseconds, result.iterations);
+      results.push_back(result);
+   }
+
+   FILE* file = stdout;
+   if(settings.outputPath)
+   {
+      file = fopen(settings.outputPath, "w");
+      if(!file)
+      {
+         fprintf(stderr, "Couldn't open %s for writing.\n", settings.outputPath);
+         return 1;
+      }
+   }
+   ResultsWrite(file, results, settings);
+   if(file != stdout && fclose(file) != 0)
+   {
+      fprintf(stderr, "Couldn't write %s.\n", settings.outputPath);
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,832 @@
+// BroadcastRelay sends one live match of Pong on to as many spectators as
+// want to watch it.  The match sends its frames to the relay, and spectators
+// subscribe to the relay, which sends every frame on to every one of them.
+//
+// Frames are kept in a ring, and each spectator is just an address and how
+// far through the ring it has been sent.  Each frame is copied into the ring
+// once as it comes in, and every send of it after that points straight at
+// the ring rather than at a copy, so all of the sends for a frame go out in
+// as few sendmmsg calls as fit.  A spectator that subscribes is started from
+// the last keyframe in the ring, so it has something to show straight away.
+// One that lost a keyframe can ask for it, and is sent that frame again, at
+// most every PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL seconds.
+// Spectators that stop sending subscribes are dropped after
+// SUBSCRIBER_TIMEOUT seconds.
+//
+// The same program can also play a match with two AIs and send it to a
+// relay, and act as lots of spectators at once, each with its own socket and
+// PongBroadcastViewer.  By default it does all three, so the whole thing can
+// be tried on one machine.  The spectators check every tick they get against
+// the one the match sent, and the run fails if any of them is different, or
+// if any spectator never saw the match.
+//
+// This only builds on Linux, since it uses recvmmsg and sendmmsg.
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -pthread -ISources -o BroadcastRelay
+//       Tools/BroadcastRelay/BroadcastRelay.cpp Sources/PongBroadcast.cpp
+//       Sources/PongSnapshot.cpp Sources/PongSim.cpp Sources/PongLookahead.cpp
+//
+// Usage:
+//    BroadcastRelay [options]
+//       --role <relay|match|watch|all>  What to do.  "all" runs a relay, a
+//                              match and the spectators together.  (all)
+//       --port <n>             Port the relay listens on.  (7790)
+//       --address <ip>         Where the relay is, for the match and the
+//                              spectators.  (127.0.0.1)
+//       --spectators <n>       Spectators to act as.  (500)
+//       --loss <percent>       Packets each spectator drops at random as
+//                              they come in.  (0)
+//       --report <s>           Seconds between reports from the relay.  (5)
+//       --seconds <s>          Stop after this long, or 0 to run until
+//                              interrupted.  (20 for "all", otherwise 0)
+//
+// Example, 500 spectators watching through a relay with 2% loss:
+//    BroadcastRelay --spectators 500 --loss 2
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "PongBroadcast.h"
+
+using namespace Webfoot;
+
+/// Frames per second the match and the spectators run at.
+#define FRAME_RATE 60
+/// Frames the relay keeps.  A spectator that falls further behind than this
+/// skips ahead to the last keyframe.
+#define RING_SLOTS 1024
+/// Seconds a spectator can go without subscribing again before it's
+/// dropped, and a match without sending before another can take over.
+#define SUBSCRIBER_TIMEOUT 5.0
+#define SOURCE_TIMEOUT 2.0
+/// Most packets handled by one recvmmsg or sendmmsg call.
+#define BATCH_SIZE 1024
+/// Bytes of socket buffer to ask for, so a frame's worth of sends fits.
+#define SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+/// Most spectators on one thread.  Each has its own socket.
+#define SPECTATORS_PER_THREAD 256
+/// Ticks of the match that are kept to check what the spectators get, a
+/// little over what fits in the longest run.
+#define TRUTH_MARGIN_TICKS (PONG_TICK_RATE * 10)
+
+//==============================================================================
+
+/// Everything that's the same for every part.
+struct Settings
+{
+   bool runRelay;
+   bool runMatch;
+   bool runWatch;
+   int port;
+   const char* address;
+   int spectatorCount;
+   int lossPercent;
+   int reportSeconds;
+   int seconds;
+};
+
+/// Everyone the relay is sending to.
+struct Subscriber
+{
+   sockaddr_in address;
+   /// Next frame to send, counting every frame the relay has been sent.
+   long long next;
+   std::chrono::steady_clock::time_point heard;
+   /// When the last keyframe was last sent again at its request.
+   std::chrono::steady_clock::time_point keyframeResent;
+};
+
+/// What the relay has been up to since the last report.
+struct RelayStats
+{
+   long long framesIn;
+   long long subscribesIn;
+   long long keyframesResent;
+   long long packetsOut;
+   long long bytesOut;
+   long long sendCalls;
+   long long sendsBlocked;
+   /// Nanoseconds spent working rather than waiting, and on sending alone.
+   long long busyTime;
+   long long sendTime;
+   /// Spectators right now.
+   int subscribers;
+};
+
+/// How one spectator got on.
+struct SpectatorResults
+{
+   bool started;
+   PongBroadcastStats stats;
+   /// Ticks checked against the match, and how many were different.
+   int ticksChecked;
+   int mismatches;
+   /// Ticks behind the newest the playback was, over all of the frames.
+   double lagTotal;
+   int lagFrames;
+};
+
+/// Set to stop everything.
+static std::atomic<bool> stopping(false);
+
+/// Every tick the match has sent, by tick, for checking what the spectators
+/// get.  Ticks before 'truthCount' are filled in.
+static std::vector<PongSnapshot> truth;
+static std::atomic<unsigned int> truthCount(0);
+
+/// The relay's numbers, which the reporter reads under 'relayMutex'.
+static std::mutex relayMutex;
+static RelayStats relayStats;
+
+typedef std::chrono::steady_clock Clock;
+
+//==============================================================================
+
+/// Returns a nonblocking UDP socket on 'port', or -1.  Port 0 picks any.
+static int SocketOpen(int port)
+{
+   int handle = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+   if(handle < 0)
+      return -1;
+   int bufferSize = SOCKET_BUFFER_SIZE;
+   setsockopt(handle, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+   setsockopt(handle, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+   sockaddr_in address;
+   memset(&address, 0, sizeof(address));
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(INADDR_ANY);
+   address.sin_port = htons((unsigned short)port);
+   if(bind(handle, (const sockaddr*)&address, sizeof(address)) != 0)
+   {
+      close(handle);
+      return -1;
+   }
+   return handle;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns 'address' as one number, for looking spectators up by.
+static unsigned long long AddressKeyGet(const sockaddr_in& address)
+{
+   return ((unsigned long long)address.sin_addr.s_addr << 16) | address.sin_port;
+}
+
+//==============================================================================
+
+/// Pass frames from the match on to every subscriber until it's time to
+/// stop.
+static void RelayRun(const Settings& settings, int handle)
+{
+   // The ring, and a vector pointing at each slot of it that every send of
+   // that frame shares.
+   std::vector<unsigned char> ring(RING_SLOTS * PONG_BROADCAST_PACKET_SIZE_MAX);
+   std::vector<iovec> ringVectors(RING_SLOTS);
+   for(int i = 0; i < RING_SLOTS; i++)
+   {
+      ringVectors[i].iov_base = &ring[i * PONG_BROADCAST_PACKET_SIZE_MAX];
+      ringVectors[i].iov_len = 0;
+   }
+   /// Frames put in the ring so far, and the last one that starts with a
+   /// keyframe, or -1.
+   long long written = 0;
+   long long keyframe = -1;
+
+   std::vector<Subscriber> subscribers;
+   std::unordered_map<unsigned long long, int> subscriberIndex;
+   sockaddr_in source;
+   memset(&source, 0, sizeof(source));
+   Clock::time_point sourceHeard;
+
+   std::vector<mmsghdr> inMessages(BATCH_SIZE);
+   std::vector<iovec> inVectors(BATCH_SIZE);
+   std::vector<sockaddr_in> inAddresses(BATCH_SIZE);
+   std::vector<unsigned char> inData(BATCH_SIZE * PONG_BROADCAST_PACKET_SIZE_MAX);
+   std::vector<mmsghdr> outMessages(BATCH_SIZE);
+   std::vector<int> outSubscribers(BATCH_SIZE);
+
+   RelayStats stats;
+   memset(&stats, 0, sizeof(stats));
+   bool blocked = false;
+   Clock::time_point lastSweep = Clock::now();
+   (void)settings;
+
+   while(!stopping.load(std::memory_order_relaxed))
+   {
+      // Wait for something to come in, or for room to send if the last sends
+      // didn't all go.
+      pollfd waitFor;
+      waitFor.fd = handle;
+      waitFor.events = POLLIN | (blocked ? POLLOUT : 0);
+      waitFor.revents = 0;
+      poll(&waitFor, 1, 100);
+      Clock::time_point busyStart = Clock::now();
+
+      // Read everything that has come in, a batch at a time.
+      for(;;)
+      {
+         for(int i = 0; i < BATCH_SIZE; i++)
+         {
+            inVectors[i].iov_base = &inData[i * PONG_BROADCAST_PACKET_SIZE_MAX];
+            inVectors[i].iov_len = PONG_BROADCAST_PACKET_SIZE_MAX;
+            memset(&inMessages[i].msg_hdr, 0, sizeof(inMessages[i].msg_hdr));
+            inMessages[i].msg_hdr.msg_iov = &inVectors[i];
+            inMessages[i].msg_hdr.msg_iovlen = 1;
+            inMessages[i].msg_hdr.msg_name = &inAddresses[i];
+            inMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+         }
+         int count = recvmmsg(handle, &inMessages[0], BATCH_SIZE, 0, NULL);
+         if(count <= 0)
+            break;
+
+         Clock::time_point now = Clock::now();
+         for(int i = 0; i < count; i++)
+         {
+            const unsigned char* data = &inData[i * PONG_BROADCAST_PACKET_SIZE_MAX];
+            int size = (int)inMessages[i].msg_len;
+            const sockaddr_in& from = inAddresses[i];
+            int type = PongBroadcastWriter::PacketTypeGet(data, size);
+            if(type == PONG_BROADCAST_PACKET_FRAME)
+            {
+               // Only one match at a time.  Another can take over once the
+               // last one has gone quiet.
+               bool fromSource = source.sin_port && AddressKeyGet(from) == AddressKeyGet(source);
+               if(!fromSource && source.sin_port &&
+                  std::chrono::duration<double>(now - sourceHeard).count() < SOURCE_TIMEOUT)
+               {
+                  continue;
+               }
+               source = from;
+               sourceHeard = now;
+
+               // This is the one copy of the frame there is.
+               int slot = (int)(written % RING_SLOTS);
+               memcpy(ringVectors[slot].iov_base, data, size);
+               ringVectors[slot].iov_len = size;
+               if(PongBroadcastWriter::KeyframePacketCheck(data, size))
+                  keyframe = written;
+               written++;
+               stats.framesIn++;
+            }
+            else if(type == PONG_BROADCAST_PACKET_SUBSCRIBE)
+            {
+               stats.subscribesIn++;
+               unsigned long long key = AddressKeyGet(from);
+               std::unordered_map<unsigned long long, int>::iterator found = subscriberIndex.find(key);
+               if(found != subscriberIndex.end())
+               {
+                  subscribers[found->second].heard = now;
+                  continue;
+               }
+               Subscriber subscriber;
+               subscriber.address = from;
+               subscriber.next = (keyframe >= 0 && written - keyframe <= RING_SLOTS) ? keyframe : written;
+               subscriber.heard = now;
+               subscriber.keyframeResent = now - std::chrono::seconds(1);
+               subscriberIndex[key] = (int)subscribers.size();
+               subscribers.push_back(subscriber);
+            }
+            else if(type == PONG_BROADCAST_PACKET_KEYFRAME_REQUEST)
+            {
+               // Only for spectators, and not so often that asking is a way to
+               // make the relay send more than it's asked with.
+               std::unordered_map<unsigned long long, int>::iterator found = subscriberIndex.find(AddressKeyGet(from));
+               if(found == subscriberIndex.end() || keyframe < 0 || written - keyframe > RING_SLOTS)
+                  continue;
+               Subscriber* to = &subscribers[found->second];
+               if(std::chrono::duration<double>(now - to->keyframeResent).count() < PONG_BROADCAST_KEYFRAME_REQUEST_INTERVAL)
+                  continue;
+               to->keyframeResent = now;
+               const iovec& frame = ringVectors[keyframe % RING_SLOTS];
+               if(sendto(handle, frame.iov_base, frame.iov_len, 0, (const sockaddr*)&to->address, sizeof(to->address)) > 0)
+               {
+                  stats.keyframesResent++;
+                  stats.packetsOut++;
+                  stats.bytesOut += frame.iov_len;
+               }
+            }
+            else if(type == PONG_BROADCAST_PACKET_UNSUBSCRIBE)
+            {
+               std::unordered_map<unsigned long long, int>::iterator found = subscriberIndex.find(AddressKeyGet(from));
+               if(found == subscriberIndex.end())
+                  continue;
+               int index = found->second;
+               subscriberIndex.erase(found);
+               if(index != (int)subscribers.size() - 1)
+               {
+                  subscribers[index] = subscribers.back();
+                  subscriberIndex[AddressKeyGet(subscribers[index].address)] = index;
+               }
+               subscribers.pop_back();
+            }
+         }
+         if(count < BATCH_SIZE)
+            break;
+      }
+
+      // Drop anyone who has stopped subscribing.
+      Clock::time_point now = Clock::now();
+      if(std::chrono::duration<double>(now - lastSweep).count() >= 1.0)
+      {
+         lastSweep = now;
+         for(int i = 0; i < (int)subscribers.size();)
+         {
+            if(std::chrono::duration<double>(now - subscribers[i].heard).count() < SUBSCRIBER_TIMEOUT)
+            {
+               i++;
+               continue;
+            }
+            subscriberIndex.erase(AddressKeyGet(subscribers[i].address));
+            if(i != (int)subscribers.size() - 1)
+            {
+               subscribers[i] = subscribers.back();
+               subscriberIndex[AddressKeyGet(subscribers[i].address)] = i;
+            }
+            subscribers.pop_back();
+         }
+      }
+
+      // Send every subscriber every frame it hasn't had, a batch at a time.
+      // Anyone that's fallen a whole ring behind goes on from the last
+      // keyframe.
+      Clock::time_point sendStart = Clock::now();
+      blocked = false;
+      int subscriber = 0;
+      while(!blocked && subscriber < (int)subscribers.size())
+      {
+         int messageCount = 0;
+         for(; subscriber < (int)subscribers.size() && messageCount < BATCH_SIZE; subscriber++)
+         {
+            Subscriber* to = &subscribers[subscriber];
+            if(written - to->next > RING_SLOTS)
+               to->next = keyframe >= 0 ? keyframe : written;
+            for(long long frame = to->next; frame < written && messageCount < BATCH_SIZE; frame++)
+            {
+               mmsghdr* message = &outMessages[messageCount];
+               memset(message, 0, sizeof(*message));
+               message->msg_hdr.msg_iov = &ringVectors[frame % RING_SLOTS];
+               message->msg_hdr.msg_iovlen = 1;
+               message->msg_hdr.msg_name = &to->address;
+               message->msg_hdr.msg_namelen = sizeof(sockaddr_in);
+               outSubscribers[messageCount++] = subscriber;
+            }
+            // If the batch filled up partway through this subscriber, the
+            // rest of its frames go in the next one.
+            if(messageCount >= BATCH_SIZE)
+               break;
+         }
+         if(!messageCount)
+            break;
+
+         int sent = sendmmsg(handle, &outMessages[0], messageCount, 0);
+         stats.sendCalls++;
+         if(sent < messageCount)
+         {
+            stats.sendsBlocked++;
+            blocked = true;
+         }
+         for(int i = 0; i < sent; i++)
+         {
+            subscribers[outSubscribers[i]].next++;
+            stats.bytesOut += outMessages[i].msg_hdr.msg_iov->iov_len;
+         }
+         if(sent > 0)
+            stats.packetsOut += sent;
+      }
+      Clock::time_point end = Clock::now();
+      stats.sendTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - sendStart).count();
+      stats.busyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - busyStart).count();
+      stats.subscribers = (int)subscribers.size();
+
+      // Hand the numbers over to the reporter.
+      std::lock_guard<std::mutex> lock(relayMutex);
+      relayStats.framesIn += stats.framesIn;
+      relayStats.subscribesIn += stats.subscribesIn;
+      relayStats.keyframesResent += stats.keyframesResent;
+      relayStats.packetsOut += stats.packetsOut;
+      relayStats.bytesOut += stats.bytesOut;
+      relayStats.sendCalls += stats.sendCalls;
+      relayStats.sendsBlocked += stats.sendsBlocked;
+      relayStats.busyTime += stats.busyTime;
+      relayStats.sendTime += stats.sendTime;
+      relayStats.subscribers = stats.subscribers;
+      memset(&stats, 0, sizeof(stats));
+   }
+}
+
+//------------------------------------------------------------------------------
+
+static void RelayReportPrint(double seconds)
+{
+   RelayStats stats;
+   {
+      std::lock_guard<std::mutex> lock(relayMutex);
+      stats = relayStats;
+      memset(&relayStats, 0, sizeof(relayStats));
+      relayStats.subscribers = stats.subscribers;
+   }
+   printf("relay: spectators %d, frames in %.0f/s, packets out %.0f/s (%.1f bytes each), send calls %.0f/s, "
+      "blocked %lld, keyframes sent again %.1f/s\n", stats.subscribers, stats.framesIn / seconds,
+      stats.packetsOut / seconds, stats.packetsOut ? (double)stats.bytesOut / stats.packetsOut : 0.0,
+      stats.sendCalls / seconds, stats.sendsBlocked, stats.keyframesResent / seconds);
+   printf("   busy %.1f%% of a core, %.0f ns per packet sent\n", stats.busyTime / (seconds * 1e9) * 100.0,
+      stats.packetsOut ? (double)stats.sendTime / stats.packetsOut : 0.0);
+   fflush(stdout);
+}
+
+//==============================================================================
+
+/// Returns where the relay is.
+static sockaddr_in RelayAddressGet(const Settings& settings)
+{
+   sockaddr_in address;
+   memset(&address, 0, sizeof(address));
+   address.sin_family = AF_INET;
+   address.sin_port = htons((unsigned short)settings.port);
+   inet_pton(AF_INET, settings.address, &address.sin_addr);
+   return address;
+}
+
+//------------------------------------------------------------------------------
+
+/// Play a match between two AIs at FRAME_RATE and send it to the relay.
+static void MatchRun(const Settings& settings)
+{
+   int handle = SocketOpen(0);
+   if(handle < 0)
+   {
+      fprintf(stderr, "Couldn't open a socket.\n");
+      return;
+   }
+   sockaddr_in relay = RelayAddressGet(settings);
+
+   PongSim sim;
+   PongConfig config = sim.ConfigGet();
+   config.aiControlled[PONG_PADDLE_LEFT] = true;
+   config.aiControlled[PONG_PADDLE_RIGHT] = true;
+   sim.Init(config, 1);
+   PongInput input;
+   input.paddleDirection[PONG_PADDLE_LEFT] = 0;
+   input.paddleDirection[PONG_PADDLE_RIGHT] = 0;
+   input.serve = true;
+   input.restart = false;
+   PongBroadcastWriter writer;
+   writer.Init();
+
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   const Clock::duration frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / FRAME_RATE));
+   Clock::time_point nextFrame = Clock::now();
+   while(!stopping.load(std::memory_order_relaxed))
+   {
+      for(int i = 0; i < PONG_TICK_RATE / FRAME_RATE; i++)
+      {
+         // Restart the match once it's over, the way a player does.
+         input.restart = sim.StateGet().gameState == STATE_END;
+         sim.Step(input, tickSeconds);
+         const PongState& state = sim.StateGet();
+         // Keep what's sent, if it's being checked, before it's sent.
+         if(state.tick < truth.size())
+         {
+            PongSnapshotCoder::Capture(state, &truth[state.tick]);
+            truthCount.store(state.tick + 1, std::memory_order_release);
+         }
+         writer.TickAdd(state);
+      }
+
+      unsigned char packet[PONG_BROADCAST_PACKET_SIZE_MAX];
+      int size;
+      while((size = writer.PacketWrite(packet, sizeof(packet))) > 0)
+         sendto(handle, packet, size, 0, (const sockaddr*)&relay, sizeof(relay));
+
+      nextFrame += frameDuration;
+      std::this_thread::sleep_until(nextFrame);
+   }
+   writer.Deinit();
+   close(handle);
+}
+
+//==============================================================================
+
+/// Act as 'count' spectators, each with its own socket, at FRAME_RATE.
+static void WatchRun(const Settings& settings, int firstSpectator, int count, SpectatorResults* results)
+{
+   sockaddr_in relay = RelayAddressGet(settings);
+   std::vector<int> handles(count, -1);
+   std::vector<PongBroadcastViewer> viewers(count);
+   std::vector<unsigned int> checkedTicks(count, 0);
+   for(int i = 0; i < count; i++)
+   {
+      memset(&results[i], 0, sizeof(results[i]));
+      handles[i] = SocketOpen(0);
+      if(handles[i] < 0)
+      {
+         fprintf(stderr, "Couldn't open a socket for spectator %d.\n", firstSpectator + i);
+         stopping.store(true);
+         break;
+      }
+      viewers[i].Init();
+   }
+
+   std::vector<mmsghdr> messages(BATCH_SIZE);
+   std::vector<iovec> vectors(BATCH_SIZE);
+   std::vector<unsigned char> data(BATCH_SIZE * PONG_BROADCAST_PACKET_SIZE_MAX);
+   unsigned int randomState = (unsigned int)firstSpectator * 2654435761u + 1;
+   const float frameSeconds = 1.0f / FRAME_RATE;
+   const Clock::duration frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frameSeconds));
+   Clock::time_point nextFrame = Clock::now();
+
+   while(!stopping.load(std::memory_order_relaxed))
+   {
+      for(int s = 0; s < count && handles[s] >= 0; s++)
+      {
+         PongBroadcastViewer* viewer = &viewers[s];
+         SpectatorResults* result = &results[s];
+
+         // Take in everything the relay has sent, losing some if asked to.
+         for(;;)
+         {
+            for(int i = 0; i < BATCH_SIZE; i++)
+            {
+               vectors[i].iov_base = &data[i * PONG_BROADCAST_PACKET_SIZE_MAX];
+               vectors[i].iov_len = PONG_BROADCAST_PACKET_SIZE_MAX;
+               memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+               messages[i].msg_hdr.msg_iov = &vectors[i];
+               messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            int received = recvmmsg(handles[s], &messages[0], BATCH_SIZE, 0, NULL);
+            if(received <= 0)
+               break;
+            for(int i = 0; i < received; i++)
+            {
+               if(settings.lossPercent > 0 && PongSim::RandomF(&randomState) * 100.0f < (float)settings.lossPercent)
+                  continue;
+               viewer->PacketRead(&data[i * PONG_BROADCAST_PACKET_SIZE_MAX], (int)messages[i].msg_len);
+            }
+            if(received < BATCH_SIZE)
+               break;
+         }
+
+         // Check every new tick that arrived against what the match sent.
+         unsigned int newest = viewer->NewestTickGet();
+         unsigned int known = truthCount.load(std::memory_order_acquire);
+         if(viewer->StartedCheck() && checkedTicks[s] + PONG_BROADCAST_BUFFER_TICKS < newest)
+            checkedTicks[s] = newest - PONG_BROADCAST_BUFFER_TICKS;
+         for(unsigned int tickIndex = checkedTicks[s] + 1; viewer->StartedCheck() && tickIndex <= newest; tickIndex++)
+         {
+            const PongSnapshot* snapshot = viewer->SnapshotGet(tickIndex);
+            if(!snapshot || tickIndex >= known)
+               continue;
+            result->ticksChecked++;
+            if(!PongSnapshotCoder::EqualCheck(*snapshot, truth[tickIndex]))
+               result->mismatches++;
+         }
+         if(viewer->StartedCheck())
+            checkedTicks[s] = newest;
+
+         // Show a frame, as far as a spectator with no screen can.
+         viewer->Update(frameSeconds);
+         PongSnapshot previous;
+         PongSnapshot current;
+         float alpha;
+         if(viewer->PlaybackGet(&previous, &current, &alpha))
+         {
+            result->lagTotal += viewer->NewestTickGet() - viewer->PlaybackTickGet();
+            result->lagFrames++;
+         }
+
+         unsigned char packet[PONG_BROADCAST_PACKET_SIZE_MAX];
+         int size;
+         while((size = viewer->PacketWrite(packet, sizeof(packet))) > 0)
+            sendto(handles[s], packet, size, 0, (const sockaddr*)&relay, sizeof(relay));
+      }
+
+      nextFrame += frameDuration;
+      std::this_thread::sleep_until(nextFrame);
+   }
+
+   // Say goodbye, so the relay stops sending straight away.
+   for(int s = 0; s < count && handles[s] >= 0; s++)
+   {
+      unsigned char packet[PONG_BROADCAST_PACKET_SIZE_MAX];
+      int size = PongBroadcastViewer::UnsubscribePacketWrite(packet, sizeof(packet));
+      sendto(handles[s], packet, size, 0, (const sockaddr*)&relay, sizeof(relay));
+      results[s].started = viewers[s].StartedCheck();
+      results[s].stats = viewers[s].StatsGet();
+      viewers[s].Deinit();
+      close(handles[s]);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Print how the spectators got on.  Returns true if they all saw the match
+/// and none of them got a tick wrong.
+static bool SpectatorResultsPrint(const std::vector<SpectatorResults>& results)
+{
+   int startedCount = 0;
+   long long ticksDecoded = 0;
+   long long ticksUndecodable = 0;
+   long long ticksFilled = 0;
+   long long keyframesRequested = 0;
+   long long ticksChecked = 0;
+   long long mismatches = 0;
+   long long packetsReceived = 0;
+   long long packetsLost = 0;
+   long long stalls = 0;
+   long long resyncs = 0;
+   double lagTotal = 0.0;
+   long long lagFrames = 0;
+   for(size_t i = 0; i < results.size(); i++)
+   {
+      const SpectatorResults& result = results[i];
+      startedCount += result.started ? 1 : 0;
+      ticksDecoded += result.stats.ticksDecoded;
+      ticksUndecodable += result.stats.ticksUndecodable;
+      ticksFilled += result.stats.ticksFilled;
+      keyframesRequested += result.stats.keyframesRequested;
+      ticksChecked += result.ticksChecked;
+      mismatches += result.mismatches;
+      packetsReceived += result.stats.packetsReceived;
+      packetsLost += result.stats.packetsLost;
+      stalls += result.stats.stallCount;
+      resyncs += result.stats.resyncCount;
+      lagTotal += result.lagTotal;
+      lagFrames += result.lagFrames;
+   }
+
+   int count = (int)results.size();
+   printf("\nspectators %d, watching %d\n", count, startedCount);
+   printf("   each: frames %.0f, lost %.1f, ticks decoded %.0f, undecodable %.1f, drawn in between %.1f\n",
+      (double)packetsReceived / count, (double)packetsLost / count, (double)ticksDecoded / count,
+      (double)ticksUndecodable / count, (double)ticksFilled / count);
+   printf("   each: keyframes asked for again %.1f, stalls %.1f, jumps %.1f, playback behind the newest tick by "
+      "%.1f ms on average\n", (double)keyframesRequested / count, (double)stalls / count, (double)resyncs / count,
+      lagFrames ? lagTotal / lagFrames * 1000.0 / PONG_TICK_RATE : 0.0);
+   printf("   ticks checked against the match %lld, different %lld\n", ticksChecked, mismatches);
+   return startedCount == count && ticksChecked > 0 && !mismatches;
+}
+
+//==============================================================================
+
+static void StopHandle(int)
+{
+   stopping.store(true);
+}
+
+//------------------------------------------------------------------------------
+
+static void UsagePrint(const char* program)
+{
+   fprintf(stderr, "Usage: %s [--role <relay|match|watch|all>] [--port <n>] [--address <ip>] [--spectators <n>] "
+      "[--loss <percent>] [--report <s>] [--seconds <s>]\n", program);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   Settings settings;
+   settings.runRelay = true;
+   settings.runMatch = true;
+   settings.runWatch = true;
+   settings.port = 7790;
+   settings.address = "127.0.0.1";
+   settings.spectatorCount = 500;
+   settings.lossPercent = 0;
+   settings.reportSeconds = 5;
+   settings.seconds = -1;
+
+   for(int arg = 1; arg < argc; arg++)
+   {
+      const char* option = argv[arg];
+      if(arg + 1 >= argc)
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+      const char* value = argv[++arg];
+
+      if(!strcmp(option, "--role") && (!strcmp(value, "relay") || !strcmp(value, "match") ||
+         !strcmp(value, "watch") || !strcmp(value, "all")))
+      {
+         bool all = !strcmp(value, "all");
+         settings.runRelay = all || !strcmp(value, "relay");
+         settings.runMatch = all || !strcmp(value, "match");
+         settings.runWatch = all || !strcmp(value, "watch");
+      }
+      else if(!strcmp(option, "--port"))
+         settings.port = atoi(value);
+      else if(!strcmp(option, "--address"))
+         settings.address = value;
+      else if(!strcmp(option, "--spectators"))
+         settings.spectatorCount = atoi(value);
+      else if(!strcmp(option, "--loss"))
+         settings.lossPercent = atoi(value);
+      else if(!strcmp(option, "--report"))
+         settings.reportSeconds = atoi(value);
+      else if(!strcmp(option, "--seconds"))
+         settings.seconds = atoi(value);
+      else
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+   }
+   bool all = settings.runRelay && settings.runMatch && settings.runWatch;
+   if(settings.seconds < 0)
+      settings.seconds = all ? 20 : 0;
+   if(settings.port < 1 || settings.port > 65535 || settings.spectatorCount < 1 || settings.reportSeconds < 1)
+   {
+      UsagePrint(argv[0]);
+      return 1;
+   }
+
+   signal(SIGINT, StopHandle);
+   signal(SIGTERM, StopHandle);
+
+   // Only a match in this process can be checked against.
+   if(settings.runMatch && settings.runWatch)
+      truth.resize((size_t)(settings.seconds > 0 ? settings.seconds : 60) * PONG_TICK_RATE + TRUTH_MARGIN_TICKS);
+
+   std::thread relayThread;
+   int relayHandle = -1;
+   if(settings.runRelay)
+   {
+      relayHandle = SocketOpen(settings.port);
+      if(relayHandle < 0)
+      {
+         fprintf(stderr, "Couldn't listen on port %d.\n", settings.port);
+         return 1;
+      }
+      printf("relay listening on port %d\n", settings.port);
+      fflush(stdout);
+      relayThread = std::thread(RelayRun, std::cref(settings), relayHandle);
+   }
+
+   std::vector<std::thread> watchThreads;
+   std::vector<SpectatorResults> results;
+   if(settings.runWatch)
+   {
+      results.resize(settings.spectatorCount);
+      for(int first = 0; first < settings.spectatorCount; first += SPECTATORS_PER_THREAD)
+      {
+         int count = std::min(SPECTATORS_PER_THREAD, settings.spectatorCount - first);
+         watchThreads.push_back(std::thread(WatchRun, std::cref(settings), first, count, &results[first]));
+      }
+   }
+
+   std::thread matchThread;
+   if(settings.runMatch)
+      matchThread = std::thread(MatchRun, std::cref(settings));
+
+   Clock::time_point start = Clock::now();
+   Clock::time_point lastReport = start;
+   while(!stopping.load())
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      Clock::time_point now = Clock::now();
+      if(settings.seconds > 0 && now - start >= std::chrono::seconds(settings.seconds))
+         stopping.store(true);
+      // The match that's being checked can't go on past what's kept of it.
+      if(!truth.empty() && truthCount.load() + TRUTH_MARGIN_TICKS / 2 >= truth.size())
+         stopping.store(true);
+      double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+      if(settings.runRelay && (sinceReport >= settings.reportSeconds || stopping.load()))
+      {
+         RelayReportPrint(sinceReport);
+         lastReport = now;
+      }
+   }
+
+   if(matchThread.joinable())
+      matchThread.join();
+   for(size_t i = 0; i < watchThreads.size(); i++)
+      watchThreads[i].join();
+   if(relayThread.joinable())
+   {
+      relayThread.join();
+      close(relayHandle);
+   }
+
+   if(!settings.runWatch)
+      return 0;
+   bool passed = SpectatorResultsPrint(results);
+   if(!settings.runMatch)
+      return 0;
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,983 @@
+// MatchServer hosts many online matches of Pong at once, with the same rules
+// as the game and no screen.  The server owns each match: players send their
+// inputs, and the server steps the match and sends back what happened.
+//
+// Rooms are split across worker threads by number.  Each worker has its own
+// UDP port, epoll loop and timer, and is the only thread that touches its
+// rooms, so the workers never wait on each other.  Room <n> is on the worker
+// listening on --port + (<n> % --workers).  On each beat of the timer, the
+// worker takes PONG_TICK_RATE / FRAME_RATE steps of every room, then sends
+// every player what changed since the last beat.  All of a beat's packets go
+// out in as few sendmmsg calls as fit, rather than one call each.
+//
+// The server prints how long stepping a room for a beat takes, how busy each
+// core is, and how many rooms a core could take at that rate.
+//
+// The same program can also act as lots of players at once, to load a
+// server up with --load.
+//
+// This only builds on Linux, since it uses epoll, timerfd and sendmmsg.
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -pthread -ISources -o MatchServer
+//       Tools/MatchServer/MatchServer.cpp Sources/PongSim.cpp
+//       Sources/PongLookahead.cpp
+//
+// Usage:
+//    MatchServer [options]
+//       --port <n>             First port.  Each worker listens on the next.
+//                              (7800)
+//       --workers <n>          Worker threads.  (Number of cores)
+//       --rooms <n>            Most rooms on each worker.  (4096)
+//       --report <s>           Seconds between reports.  (5)
+//       --seconds <s>          Stop after this long, or 0 to run until
+//                              interrupted.  (0)
+//       --load <n>             Rather than serving, play both sides of <n>
+//                              rooms on the server at --address.
+//       --address <ip>         Where the server is, for --load.  (127.0.0.1)
+//
+// Example, 2000 rooms on one machine, in two terminals:
+//    MatchServer --workers 2
+//    MatchServer --workers 2 --load 2000 --seconds 30
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "PongSim.h"
+
+using namespace Webfoot;
+
+/// Beats per second.  Each beat steps every room by PONG_TICK_RATE /
+/// FRAME_RATE ticks and sends one packet to each player.
+#define FRAME_RATE 60
+#define TICKS_PER_FRAME (PONG_TICK_RATE / FRAME_RATE)
+/// Most beats a worker that fell behind runs at once to catch up.  Any more
+/// are dropped.
+#define CATCH_UP_FRAMES_MAX 4
+/// Beats between packets with every field in them, so a player that lost
+/// some packets is back in step within a second.
+#define FULL_STATE_INTERVAL FRAME_RATE
+/// A room that hasn't heard from either player in this many beats is closed.
+#define ROOM_IDLE_FRAMES (FRAME_RATE * 10)
+/// Players made up by --load change what they're pressing about this often
+/// each beat, and send it again every LOAD_RESEND_FRAMES beats in case it was
+/// lost.
+#define LOAD_CHANGE_CHANCE 0.05f
+#define LOAD_RESEND_FRAMES (FRAME_RATE / 4)
+/// Largest packet either way.
+#define PACKET_SIZE_MAX 64
+/// Most packets handled by one recvmmsg or sendmmsg call.
+#define BATCH_SIZE 1024
+/// Bytes of socket buffer to ask for, so a beat's worth of packets fits.
+#define SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+/// Buckets of the room step time histogram.  Each doubling of time is split
+/// into 2 ^ HISTOGRAM_STEP_BITS even steps.
+#define HISTOGRAM_STEP_BITS 2
+#define HISTOGRAM_STEPS (1 << HISTOGRAM_STEP_BITS)
+#define HISTOGRAM_BUCKETS (40 * HISTOGRAM_STEPS)
+
+/// First byte of each packet.  Inputs and leaves start with the type, the
+/// room's number and the seat.  Inputs then have a sequence number, which
+/// goes up by one with each input a player sends, and the packed input.
+#define PACKET_INPUT 1
+#define PACKET_LEAVE 2
+#define PACKET_STATE 3
+#define PACKET_LEAVE_SIZE 6
+#define PACKET_INPUT_SIZE 11
+
+/// Bits of a packed input, the same as PongNetSession's.
+#define INPUT_UP 1
+#define INPUT_DOWN 2
+#define INPUT_DIRECTION_MASK 3
+#define INPUT_SERVE 4
+#define INPUT_RESTART 8
+
+/// Which fields a state packet has.
+#define STATE_BALL_POSITION (1 << 0)
+#define STATE_BALL_VELOCITY (1 << 1)
+#define STATE_PADDLE_LEFT (1 << 2)
+#define STATE_PADDLE_RIGHT (1 << 3)
+#define STATE_SCORES (1 << 4)
+#define STATE_GAME_STATE (1 << 5)
+#define STATE_ALL 0x3F
+
+//==============================================================================
+
+/// Everything that's the same for every worker.
+struct Settings
+{
+   int port;
+   int workerCount;
+   int roomsMax;
+   int reportSeconds;
+   int seconds;
+   int loadRooms;
+   const char* address;
+};
+
+/// One side of a room.
+struct Seat
+{
+   /// Where to send this player's packets.  The seat belongs to whoever
+   /// joined it from here until they leave or the room closes, and packets
+   /// for it from anywhere else are ignored.
+   sockaddr_in address;
+   bool joined;
+   /// Sequence number of the newest input.  Older inputs that arrive late
+   /// are ignored, rather than undoing newer ones.
+   unsigned int sequence;
+   /// Latest packed input.  Serves and restarts are held until a step sees
+   /// them.
+   unsigned char input;
+   bool serve;
+   bool restart;
+};
+
+struct Room
+{
+   unsigned int id;
+   bool active;
+   PongSim sim;
+   Seat seats[PONG_PADDLE_COUNT];
+   /// State as of the last packet sent, to send only what changed.
+   PongState sent;
+   /// Beats since the room opened, and since either player was heard from.
+   unsigned int frames;
+   unsigned int idleFrames;
+};
+
+/// What a worker has been up to since the last report.
+struct Stats
+{
+   long long frames;
+   /// Beats that started late enough that the timer had gone off again.
+   long long framesLate;
+   /// Nanoseconds spent working rather than waiting.
+   long long busyTime;
+   long long roomFrames;
+   long long roomFrameTimeMax;
+   long long histogram[HISTOGRAM_BUCKETS];
+   long long packetsIn;
+   long long packetsOut;
+   long long bytesOut;
+   long long sendsDropped;
+   /// Rooms and players right now.
+   int rooms;
+   int players;
+};
+
+/// A worker's rooms and socket.  Only its thread touches anything but
+/// 'stats', which the reporter reads under 'mutex'.
+struct Worker
+{
+   /// Which worker this is, out of how many.  It has the rooms whose numbers
+   /// give 'index' when divided by 'count'.
+   int index;
+   int count;
+   int socket;
+   int epoll;
+   int timer;
+   std::vector<Room> rooms;
+   std::vector<int> freeRooms;
+   std::unordered_map<unsigned int, int> roomIndex;
+   std::thread thread;
+
+   std::mutex mutex;
+   Stats stats;
+};
+
+/// Set to stop everything.
+static std::atomic<bool> stopping(false);
+
+typedef std::chrono::steady_clock Clock;
+
+//==============================================================================
+
+static void U32Write(unsigned char* data, unsigned int value)
+{
+   data[0] = (unsigned char)value;
+   data[1] = (unsigned char)(value >> 8);
+   data[2] = (unsigned char)(value >> 16);
+   data[3] = (unsigned char)(value >> 24);
+}
+
+//------------------------------------------------------------------------------
+
+static unsigned int U32Read(const unsigned char* data)
+{
+   return (unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16) |
+      ((unsigned int)data[3] << 24);
+}
+
+//------------------------------------------------------------------------------
+
+static unsigned char* FloatWrite(unsigned char* data, float value)
+{
+   unsigned int bits;
+   memcpy(&bits, &value, sizeof(bits));
+   U32Write(data, bits);
+   return data + 4;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns a nonblocking UDP socket on 'port', or -1.  Port 0 picks any.
+static int SocketOpen(int port)
+{
+   int handle = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+   if(handle < 0)
+      return -1;
+   int bufferSize = SOCKET_BUFFER_SIZE;
+   setsockopt(handle, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+   setsockopt(handle, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+   sockaddr_in address;
+   memset(&address, 0, sizeof(address));
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(INADDR_ANY);
+   address.sin_port = htons((unsigned short)port);
+   if(bind(handle, (const sockaddr*)&address, sizeof(address)) != 0)
+   {
+      close(handle);
+      return -1;
+   }
+   return handle;
+}
+
+//------------------------------------------------------------------------------
+
+/// Send the first 'count' of 'messages', as few calls as it takes.  Returns
+/// how many didn't go because the socket was full.
+static int BatchSend(int handle, mmsghdr* messages, int count)
+{
+   int sent = 0;
+   while(sent < count)
+   {
+      int result = sendmmsg(handle, messages + sent, std::min(count - sent, BATCH_SIZE), 0);
+      if(result <= 0)
+         return count - sent;
+      sent += result;
+   }
+   return 0;
+}
+
+//==============================================================================
+
+/// Returns the room with number 'id', opening it if there's room.  Returns
+/// NULL if the worker is full.
+static Room* RoomGet(Worker* worker, unsigned int id)
+{
+   std::unordered_map<unsigned int, int>::iterator found = worker->roomIndex.find(id);
+   if(found != worker->roomIndex.end())
+      return &worker->rooms[found->second];
+   if(worker->freeRooms.empty())
+      return NULL;
+
+   int index = worker->freeRooms.back();
+   worker->freeRooms.pop_back();
+   worker->roomIndex[id] = index;
+
+   // Both paddles are played by people.
+   Room* room = &worker->rooms[index];
+   PongConfig config = room->sim.ConfigGet();
+   config.aiControlled[PONG_PADDLE_LEFT] = false;
+   config.aiControlled[PONG_PADDLE_RIGHT] = false;
+   room->sim.Init(config, id * 0x9E3779B9u + 1);
+   room->id = id;
+   room->active = true;
+   memset(room->seats, 0, sizeof(room->seats));
+   room->frames = 0;
+   room->idleFrames = 0;
+   return room;
+}
+
+//------------------------------------------------------------------------------
+
+static void RoomClose(Worker* worker, Room* room)
+{
+   room->active = false;
+   worker->roomIndex.erase(room->id);
+   worker->freeRooms.push_back((int)(room - &worker->rooms[0]));
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns true if 'a' and 'b' are the same address and port.
+static bool AddressEqualCheck(const sockaddr_in& a, const sockaddr_in& b)
+{
+   return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+//------------------------------------------------------------------------------
+
+/// Handle a packet from a player.
+static void PacketRead(Worker* worker, const unsigned char* data, int size, const sockaddr_in& from)
+{
+   if(size < PACKET_LEAVE_SIZE)
+      return;
+   unsigned int id = U32Read(data + 1);
+   int seat = data[5];
+   if(seat >= PONG_PADDLE_COUNT || (int)(id % worker->count) != worker->index)
+      return;
+
+   if(data[0] == PACKET_INPUT && size >= PACKET_INPUT_SIZE)
+   {
+      Room* room = RoomGet(worker, id);
+      if(!room)
+         return;
+      Seat* player = &room->seats[seat];
+      unsigned int sequence = U32Read(data + 6);
+      if(player->joined)
+      {
+         if(!AddressEqualCheck(player->address, from) || (int)(sequence - player->sequence) <= 0)
+            return;
+      }
+      else
+      {
+         player->address = from;
+         player->joined = true;
+      }
+      player->sequence = sequence;
+      unsigned char input = data[10];
+      player->input = input;
+      player->serve = player->serve || (input & INPUT_SERVE);
+      player->restart = player->restart || (input & INPUT_RESTART);
+      room->idleFrames = 0;
+   }
+   else if(data[0] == PACKET_LEAVE)
+   {
+      std::unordered_map<unsigned int, int>::iterator found = worker->roomIndex.find(id);
+      if(found == worker->roomIndex.end())
+         return;
+      Room* room = &worker->rooms[found->second];
+      if(!room->seats[seat].joined || !AddressEqualCheck(room->seats[seat].address, from))
+         return;
+      room->seats[seat].joined = false;
+      if(!room->seats[PONG_PADDLE_LEFT].joined && !room->seats[PONG_PADDLE_RIGHT].joined)
+         RoomClose(worker, room);
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Step 'room' through a beat.
+static void RoomStep(Room* room)
+{
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   PongInput input;
+   input.serve = false;
+   input.restart = false;
+   for(int i = 0; i < PONG_PADDLE_COUNT; i++)
+   {
+      Seat* seat = &room->seats[i];
+      int direction = seat->input & INPUT_DIRECTION_MASK;
+      input.paddleDirection[i] = (direction == INPUT_UP) ? -1 : ((direction == INPUT_DOWN) ? 1 : 0);
+      input.serve = input.serve || seat->serve;
+      input.restart = input.restart || seat->restart;
+      seat->serve = false;
+      seat->restart = false;
+   }
+
+   for(int tick = 0; tick < TICKS_PER_FRAME; tick++)
+   {
+      room->sim.Step(input, tickSeconds);
+      // Presses only count once.
+      input.serve = false;
+      input.restart = false;
+   }
+   room->frames++;
+   room->idleFrames++;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write what changed in 'room' since the last packet into 'data'.  Returns
+/// the size.
+static int StateWrite(Room* room, unsigned char* data)
+{
+   const PongState& state = room->sim.StateGet();
+   const PongState& sent = room->sent;
+   unsigned int mask = 0;
+   if(room->frames % FULL_STATE_INTERVAL == 1)
+      mask = STATE_ALL;
+   if(state.ball.position.x != sent.ball.position.x || state.ball.position.y != sent.ball.position.y)
+      mask |= STATE_BALL_POSITION;
+   if(state.ball.velocity.x != sent.ball.velocity.x || state.ball.velocity.y != sent.ball.velocity.y)
+      mask |= STATE_BALL_VELOCITY;
+   if(state.paddles[PONG_PADDLE_LEFT].position.y != sent.paddles[PONG_PADDLE_LEFT].position.y)
+      mask |= STATE_PADDLE_LEFT;
+   if(state.paddles[PONG_PADDLE_RIGHT].position.y != sent.paddles[PONG_PADDLE_RIGHT].position.y)
+      mask |= STATE_PADDLE_RIGHT;
+   if(state.playerScore1 != sent.playerScore1 || state.playerScore2 != sent.playerScore2)
+      mask |= STATE_SCORES;
+   if(state.gameState != sent.gameState || state.powerUpState != sent.powerUpState)
+      mask |= STATE_GAME_STATE;
+
+   unsigned char* write = data;
+   *write++ = PACKET_STATE;
+   U32Write(write, room->id);
+   write += 4;
+   U32Write(write, state.tick);
+   write += 4;
+   *write++ = (unsigned char)mask;
+   if(mask & STATE_BALL_POSITION)
+   {
+      write = FloatWrite(write, state.ball.position.x);
+      write = FloatWrite(write, state.ball.position.y);
+   }
+   if(mask & STATE_BALL_VELOCITY)
+   {
+      write = FloatWrite(write, state.ball.velocity.x);
+      write = FloatWrite(write, state.ball.velocity.y);
+   }
+   if(mask & STATE_PADDLE_LEFT)
+      write = FloatWrite(write, state.paddles[PONG_PADDLE_LEFT].position.y);
+   if(mask & STATE_PADDLE_RIGHT)
+      write = FloatWrite(write, state.paddles[PONG_PADDLE_RIGHT].position.y);
+   if(mask & STATE_SCORES)
+   {
+      *write++ = (unsigned char)state.playerScore1;
+      *write++ = (unsigned char)state.playerScore2;
+   }
+   if(mask & STATE_GAME_STATE)
+      *write++ = (unsigned char)(state.gameState | (state.powerUpState << 4));
+
+   room->sent = state;
+   return (int)(write - data);
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns the histogram bucket for 'time' nanoseconds.
+static int HistogramBucketGet(long long time)
+{
+   if(time < 1)
+      return 0;
+   // Whole doublings, then the next few bits down for the step.
+   int doublings = 63 - __builtin_clzll((unsigned long long)time);
+   int step = (int)((((unsigned long long)time << HISTOGRAM_STEP_BITS) >> doublings) & (HISTOGRAM_STEPS - 1));
+   return std::min(doublings * HISTOGRAM_STEPS + step, HISTOGRAM_BUCKETS - 1);
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns the most nanoseconds a time in 'bucket' can be.
+static double HistogramBucketTimeGet(int bucket)
+{
+   return ldexp(1.0 + (double)(bucket % HISTOGRAM_STEPS + 1) / HISTOGRAM_STEPS, bucket / HISTOGRAM_STEPS);
+}
+
+//------------------------------------------------------------------------------
+
+static void WorkerRun(const Settings& settings, Worker* worker)
+{
+   const int roomsMax = settings.roomsMax;
+   std::vector<mmsghdr> inMessages(BATCH_SIZE);
+   std::vector<iovec> inVectors(BATCH_SIZE);
+   std::vector<sockaddr_in> inAddresses(BATCH_SIZE);
+   std::vector<unsigned char> inData(BATCH_SIZE * PACKET_SIZE_MAX);
+   std::vector<mmsghdr> outMessages(roomsMax * PONG_PADDLE_COUNT);
+   std::vector<iovec> outVectors(roomsMax);
+   std::vector<unsigned char> outData(roomsMax * PACKET_SIZE_MAX);
+
+   Stats stats;
+   memset(&stats, 0, sizeof(stats));
+   epoll_event events[2];
+
+   while(!stopping.load(std::memory_order_relaxed))
+   {
+      // Wake up now and then even with nothing to do, to see if it's time to
+      // stop.
+      int eventCount = epoll_wait(worker->epoll, events, 2, 100);
+      Clock::time_point busyStart = Clock::now();
+
+      for(int e = 0; e < eventCount; e++)
+      {
+         if(events[e].data.fd == worker->socket)
+         {
+            // Read everything that has come in, a batch at a time.
+            for(;;)
+            {
+               for(int i = 0; i < BATCH_SIZE; i++)
+               {
+                  inVectors[i].iov_base = &inData[i * PACKET_SIZE_MAX];
+                  inVectors[i].iov_len = PACKET_SIZE_MAX;
+                  memset(&inMessages[i].msg_hdr, 0, sizeof(inMessages[i].msg_hdr));
+                  inMessages[i].msg_hdr.msg_iov = &inVectors[i];
+                  inMessages[i].msg_hdr.msg_iovlen = 1;
+                  inMessages[i].msg_hdr.msg_name = &inAddresses[i];
+                  inMessages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+               }
+               int count = recvmmsg(worker->socket, &inMessages[0], BATCH_SIZE, 0, NULL);
+               if(count <= 0)
+                  break;
+               for(int i = 0; i < count; i++)
+                  PacketRead(worker, &inData[i * PACKET_SIZE_MAX], (int)inMessages[i].msg_len, inAddresses[i]);
+               stats.packetsIn += count;
+               if(count < BATCH_SIZE)
+                  break;
+            }
+         }
+         else if(events[e].data.fd == worker->timer)
+         {
+            unsigned long long expirations = 0;
+            if(read(worker->timer, &expirations, sizeof(expirations)) != sizeof(expirations) || !expirations)
+               continue;
+            if(expirations > 1)
+               stats.framesLate++;
+            int frames = (int)std::min<unsigned long long>(expirations, CATCH_UP_FRAMES_MAX);
+
+            // Step every room, timing each one.
+            for(int frame = 0; frame < frames; frame++)
+            {
+               for(int r = 0; r < roomsMax; r++)
+               {
+                  Room* room = &worker->rooms[r];
+                  if(!room->active)
+                     continue;
+                  Clock::time_point roomStart = Clock::now();
+                  RoomStep(room);
+                  long long roomTime = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - roomStart).count();
+                  stats.histogram[HistogramBucketGet(roomTime)]++;
+                  stats.roomFrameTimeMax = std::max(stats.roomFrameTimeMax, roomTime);
+                  stats.roomFrames++;
+               }
+               stats.frames++;
+            }
+
+            // Then tell every player what changed, all in one go.
+            int messageCount = 0;
+            int rooms = 0;
+            for(int r = 0; r < roomsMax; r++)
+            {
+               Room* room = &worker->rooms[r];
+               if(!room->active)
+                  continue;
+               if(room->idleFrames > ROOM_IDLE_FRAMES)
+               {
+                  RoomClose(worker, room);
+                  continue;
+               }
+               rooms++;
+
+               unsigned char* data = &outData[r * PACKET_SIZE_MAX];
+               outVectors[r].iov_base = data;
+               outVectors[r].iov_len = StateWrite(room, data);
+               for(int s = 0; s < PONG_PADDLE_COUNT; s++)
+               {
+                  if(!room->seats[s].joined)
+                     continue;
+                  mmsghdr* message = &outMessages[messageCount++];
+                  memset(message, 0, sizeof(*message));
+                  message->msg_hdr.msg_iov = &outVectors[r];
+                  message->msg_hdr.msg_iovlen = 1;
+                  message->msg_hdr.msg_name = &room->seats[s].address;
+                  message->msg_hdr.msg_namelen = sizeof(sockaddr_in);
+                  stats.bytesOut += outVectors[r].iov_len;
+               }
+            }
+            int dropped = BatchSend(worker->socket, &outMessages[0], messageCount);
+            stats.packetsOut += messageCount - dropped;
+            stats.sendsDropped += dropped;
+            stats.rooms = rooms;
+            stats.players = messageCount;
+         }
+      }
+
+      stats.busyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - busyStart).count();
+
+      // Hand the numbers over to the reporter.  This happens at most a few
+      // hundred times a second, so the lock is never fought over for long.
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      Stats& shared = worker->stats;
+      shared.frames += stats.frames;
+      shared.framesLate += stats.framesLate;
+      shared.busyTime += stats.busyTime;
+      shared.roomFrames += stats.roomFrames;
+      shared.roomFrameTimeMax = std::max(shared.roomFrameTimeMax, stats.roomFrameTimeMax);
+      for(int i = 0; i < HISTOGRAM_BUCKETS; i++)
+         shared.histogram[i] += stats.histogram[i];
+      shared.packetsIn += stats.packetsIn;
+      shared.packetsOut += stats.packetsOut;
+      shared.bytesOut += stats.bytesOut;
+      shared.sendsDropped += stats.sendsDropped;
+      shared.rooms = stats.rooms;
+      shared.players = stats.players;
+      int rooms = stats.rooms;
+      int players = stats.players;
+      memset(&stats, 0, sizeof(stats));
+      stats.rooms = rooms;
+      stats.players = players;
+   }
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns the time in nanoseconds that 'fraction' of the room beats in
+/// 'histogram' took no longer than.
+static double PercentileGet(const long long* histogram, long long total, double fraction)
+{
+   if(total <= 0)
+      return 0.0;
+   long long target = (long long)(total * fraction);
+   long long seen = 0;
+   for(int i = 0; i < HISTOGRAM_BUCKETS; i++)
+   {
+      seen += histogram[i];
+      if(seen > target)
+         return HistogramBucketTimeGet(i);
+   }
+   return HistogramBucketTimeGet(HISTOGRAM_BUCKETS - 1);
+}
+
+//------------------------------------------------------------------------------
+
+static void ReportPrint(std::vector<Worker*>& workers, double seconds)
+{
+   Stats total;
+   memset(&total, 0, sizeof(total));
+   for(size_t w = 0; w < workers.size(); w++)
+   {
+      std::lock_guard<std::mutex> lock(workers[w]->mutex);
+      const Stats& stats = workers[w]->stats;
+      total.frames += stats.frames;
+      total.framesLate += stats.framesLate;
+      total.busyTime += stats.busyTime;
+      total.roomFrames += stats.roomFrames;
+      total.roomFrameTimeMax = std::max(total.roomFrameTimeMax, stats.roomFrameTimeMax);
+      for(int i = 0; i < HISTOGRAM_BUCKETS; i++)
+         total.histogram[i] += stats.histogram[i];
+      total.packetsIn += stats.packetsIn;
+      total.packetsOut += stats.packetsOut;
+      total.bytesOut += stats.bytesOut;
+      total.sendsDropped += stats.sendsDropped;
+      total.rooms += stats.rooms;
+      total.players += stats.players;
+
+      int rooms = stats.rooms;
+      int players = stats.players;
+      memset(&workers[w]->stats, 0, sizeof(Stats));
+      workers[w]->stats.rooms = rooms;
+      workers[w]->stats.players = players;
+   }
+
+   // A core that's busy 'busy' of the time with 'roomsPerCore' rooms could
+   // take about 'roomsPerCore / busy' before it can't keep up.
+   int workerCount = (int)workers.size();
+   double busy = total.busyTime / (seconds * 1e9 * workerCount);
+   double roomsPerCore = (double)total.rooms / workerCount;
+   printf("rooms %d (%.0f per core), players %d, busy %.1f%%, capacity ~%.0f rooms per core\n", total.rooms,
+      roomsPerCore, total.players, busy * 100.0, busy > 0.0 ? roomsPerCore / busy : 0.0);
+   printf("   room beat p50 %.2f us, p99 %.2f us, max %.2f us, late beats %lld of %lld\n",
+      PercentileGet(total.histogram, total.roomFrames, 0.5) / 1000.0,
+      PercentileGet(total.histogram, total.roomFrames, 0.99) / 1000.0, total.roomFrameTimeMax / 1000.0,
+      total.framesLate, total.frames);
+   printf("   packets in %.0f/s, out %.0f/s (%.1f bytes each), dropped %lld\n", total.packetsIn / seconds,
+      total.packetsOut / seconds, total.packetsOut ? (double)total.bytesOut / total.packetsOut : 0.0,
+      total.sendsDropped);
+   fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+
+static void StopHandle(int)
+{
+   stopping.store(true);
+}
+
+//------------------------------------------------------------------------------
+
+/// Run the server until it's told to stop.  Returns the exit code.
+static int ServerRun(const Settings& settings)
+{
+   std::vector<Worker*> workers;
+   for(int w = 0; w < settings.workerCount; w++)
+   {
+      Worker* worker = new Worker;
+      worker->index = w;
+      worker->count = settings.workerCount;
+      memset(&worker->stats, 0, sizeof(worker->stats));
+      worker->rooms.resize(settings.roomsMax);
+      for(int r = settings.roomsMax - 1; r >= 0; r--)
+      {
+         worker->rooms[r].active = false;
+         worker->freeRooms.push_back(r);
+      }
+      worker->roomIndex.reserve(settings.roomsMax * 2);
+      workers.push_back(worker);
+
+      worker->socket = SocketOpen(settings.port + w);
+      worker->epoll = epoll_create1(0);
+      worker->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+      if(worker->socket < 0 || worker->epoll < 0 || worker->timer < 0)
+      {
+         fprintf(stderr, "Couldn't set up a worker on port %d.\n", settings.port + w);
+         return 1;
+      }
+
+      itimerspec interval;
+      interval.it_interval.tv_sec = 0;
+      interval.it_interval.tv_nsec = 1000000000 / FRAME_RATE;
+      interval.it_value = interval.it_interval;
+      timerfd_settime(worker->timer, 0, &interval, NULL);
+
+      epoll_event event;
+      event.events = EPOLLIN;
+      event.data.fd = worker->socket;
+      epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->socket, &event);
+      event.data.fd = worker->timer;
+      epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->timer, &event);
+   }
+
+   printf("%d workers on ports %d to %d, up to %d rooms each\n\n", settings.workerCount, settings.port,
+      settings.port + settings.workerCount - 1, settings.roomsMax);
+   fflush(stdout);
+   for(int w = 0; w < settings.workerCount; w++)
+      workers[w]->thread = std::thread(WorkerRun, std::cref(settings), workers[w]);
+
+   Clock::time_point start = Clock::now();
+   Clock::time_point lastReport = start;
+   while(!stopping.load())
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      Clock::time_point now = Clock::now();
+      if(settings.seconds > 0 && now - start >= std::chrono::seconds(settings.seconds))
+         stopping.store(true);
+      double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+      if(sinceReport >= settings.reportSeconds || stopping.load())
+      {
+         ReportPrint(workers, sinceReport);
+         lastReport = now;
+      }
+   }
+
+   for(int w = 0; w < settings.workerCount; w++)
+   {
+      workers[w]->thread.join();
+      close(workers[w]->timer);
+      close(workers[w]->epoll);
+      close(workers[w]->socket);
+      delete workers[w];
+   }
+   return 0;
+}
+
+//==============================================================================
+
+/// Play both sides of 'roomCount' rooms from one socket, at FRAME_RATE, and
+/// count the state packets that come back in 'received'.
+static void LoadRun(const Settings& settings, int firstRoom, int roomCount, long long* received)
+{
+   *received = 0;
+   int handle = SocketOpen(0);
+   if(handle < 0)
+   {
+      fprintf(stderr, "Couldn't open a socket.\n");
+      return;
+   }
+   std::vector<sockaddr_in> servers(settings.workerCount);
+   for(int w = 0; w < settings.workerCount; w++)
+   {
+      memset(&servers[w], 0, sizeof(servers[w]));
+      servers[w].sin_family = AF_INET;
+      servers[w].sin_port = htons((unsigned short)(settings.port + w));
+      inet_pton(AF_INET, settings.address, &servers[w].sin_addr);
+   }
+
+   int playerCount = roomCount * PONG_PADDLE_COUNT;
+   std::vector<mmsghdr> messages(playerCount);
+   std::vector<iovec> vectors(playerCount);
+   std::vector<unsigned char> data(playerCount * PACKET_SIZE_MAX);
+   std::vector<unsigned char> inputs(playerCount, 0);
+   std::vector<unsigned int> sequences(playerCount, 0);
+   std::vector<unsigned char> inData(PACKET_SIZE_MAX);
+   unsigned int randomState = (unsigned int)firstRoom * 2654435761u + 1;
+   unsigned int frame = 0;
+
+   Clock::time_point nextFrame = Clock::now();
+   const Clock::duration frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / FRAME_RATE));
+   while(!stopping.load(std::memory_order_relaxed))
+   {
+      // The players wander up and down and serve now and then, sending what
+      // they press when it changes.  What they do doesn't matter much, only
+      // that the server has something to step.
+      int messageCount = 0;
+      for(int i = 0; i < playerCount; i++)
+      {
+         bool resend = (frame + i) % LOAD_RESEND_FRAMES == 0;
+         float random = PongSim::RandomF(&randomState);
+         if(random >= LOAD_CHANGE_CHANCE && !resend)
+            continue;
+         if(random < LOAD_CHANGE_CHANCE)
+         {
+            random /= LOAD_CHANGE_CHANCE;
+            inputs[i] = (unsigned char)((random < 0.4f) ? INPUT_UP : ((random < 0.8f) ? INPUT_DOWN : 0));
+            if(random > 0.9f)
+               inputs[i] |= INPUT_SERVE | INPUT_RESTART;
+         }
+
+         unsigned int room = (unsigned int)(firstRoom + i / PONG_PADDLE_COUNT);
+         unsigned char* packet = &data[messageCount * PACKET_SIZE_MAX];
+         packet[0] = PACKET_INPUT;
+         U32Write(packet + 1, room);
+         packet[5] = (unsigned char)(i % PONG_PADDLE_COUNT);
+         U32Write(packet + 6, ++sequences[i]);
+         packet[10] = inputs[i];
+         vectors[messageCount].iov_base = packet;
+         vectors[messageCount].iov_len = PACKET_INPUT_SIZE;
+         mmsghdr* message = &messages[messageCount++];
+         memset(message, 0, sizeof(*message));
+         message->msg_hdr.msg_iov = &vectors[message - &messages[0]];
+         message->msg_hdr.msg_iovlen = 1;
+         message->msg_hdr.msg_name = &servers[room % settings.workerCount];
+         message->msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      }
+      BatchSend(handle, &messages[0], messageCount);
+      frame++;
+
+      while(recv(handle, &inData[0], PACKET_SIZE_MAX, 0) > 0)
+         (*received)++;
+
+      nextFrame += frameDuration;
+      std::this_thread::sleep_until(nextFrame);
+   }
+
+   // Say goodbye, so the rooms close straight away.
+   for(int i = 0; i < playerCount; i++)
+   {
+      unsigned int room = (unsigned int)(firstRoom + i / PONG_PADDLE_COUNT);
+      unsigned char* packet = &data[i * PACKET_SIZE_MAX];
+      packet[0] = PACKET_LEAVE;
+      U32Write(packet + 1, room);
+      packet[5] = (unsigned char)(i % PONG_PADDLE_COUNT);
+      vectors[i].iov_base = packet;
+      vectors[i].iov_len = PACKET_LEAVE_SIZE;
+      memset(&messages[i], 0, sizeof(messages[i]));
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+      messages[i].msg_hdr.msg_name = &servers[room % settings.workerCount];
+      messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+   }
+   BatchSend(handle, &messages[0], playerCount);
+   close(handle);
+}
+
+//------------------------------------------------------------------------------
+
+/// Load up a server with 'settings.loadRooms' rooms.  Returns the exit code.
+static int LoadGenerate(const Settings& settings)
+{
+   // A few threads, each playing its share of the rooms from its own socket.
+   int threadCount = std::max(1, std::min(4, settings.loadRooms / 256));
+   std::vector<std::thread> threads;
+   std::vector<long long> received(threadCount);
+   int roomsPerThread = (settings.loadRooms + threadCount - 1) / threadCount;
+   for(int t = 0; t < threadCount; t++)
+   {
+      int first = t * roomsPerThread;
+      int count = std::min(roomsPerThread, settings.loadRooms - first);
+      threads.push_back(std::thread(LoadRun, std::cref(settings), first, count, &received[t]));
+   }
+
+   Clock::time_point start = Clock::now();
+   while(!stopping.load())
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      if(settings.seconds > 0 && Clock::now() - start >= std::chrono::seconds(settings.seconds))
+         stopping.store(true);
+   }
+   long long total = 0;
+   for(int t = 0; t < threadCount; t++)
+   {
+      threads[t].join();
+      total += received[t];
+   }
+   double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+   printf("%d rooms, %d players, %.0f state packets/s back (%.0f%% of expected)\n", settings.loadRooms,
+      settings.loadRooms * PONG_PADDLE_COUNT, total / seconds,
+      100.0 * total / (seconds * FRAME_RATE * settings.loadRooms * PONG_PADDLE_COUNT));
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+
+static void UsagePrint(const char* program)
+{
+   fprintf(stderr, "Usage: %s [--port <n>] [--workers <n>] [--rooms <n>] [--report <s>] [--seconds <s>] "
+      "[--load <n>] [--address <ip>]\n", program);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   Settings settings;
+   settings.port = 7800;
+   settings.workerCount = (int)std::thread::hardware_concurrency();
+   settings.roomsMax = 4096;
+   settings.reportSeconds = 5;
+   settings.seconds = 0;
+   settings.loadRooms = 0;
+   settings.address = "127.0.0.1";
+
+   for(int arg = 1; arg < argc; arg++)
+   {
+      const char* option = argv[arg];
+      if(arg + 1 >= argc)
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+      const char* value = argv[++arg];
+
+      if(!strcmp(option, "--port"))
+         settings.port = atoi(value);
+      else if(!strcmp(option, "--workers"))
+         settings.workerCount = atoi(value);
+      else if(!strcmp(option, "--rooms"))
+         settings.roomsMax = atoi(value);
+      else if(!strcmp(option, "--report"))
+         settings.reportSeconds = atoi(value);
+      else if(!strcmp(option, "--seconds"))
+         settings.seconds = atoi(value);
+      else if(!strcmp(option, "--load"))
+         settings.loadRooms = atoi(value);
+      else if(!strcmp(option, "--address"))
+         settings.address = value;
+      else
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+   }
+   if(settings.workerCount < 1)
+      settings.workerCount = 1;
+   if(settings.port < 1 || settings.port + settings.workerCount > 65536 || settings.roomsMax < 1 ||
+      settings.reportSeconds < 1)
+   {
+      UsagePrint(argv[0]);
+      return 1;
+   }
+
+   signal(SIGINT, StopHandle);
+   signal(SIGTERM, StopHandle);
+   if(settings.loadRooms > 0)
+      return LoadGenerate(settings);
+   return ServerRun(settings);
+}
@@ -0,0 +1,327 @@
+// NetLoopback plays an online match of Pong between two scripted players over
+// UDP, with no screen, so the rollback in PongNetSession can be tried against
+// bad connections without two people and two machines.
+//
+// Each side runs the way the game does: 60 frames a second, with as many
+// steps of the match in each frame as fit in the time that has passed.  The
+// sockets can hold packets back and drop them, to act like a far away or
+// flaky connection.  The delay is added to what each side sends, so the
+// round trip is twice --latency.
+//
+// Both sides stop at the same tick, wait until they have all of each other's
+// inputs up to there, and print a checksum of the state at that tick.  The
+// two checksums have to match.  Each side also prints how often it rolled
+// back and how long its slowest frame took, which has to stay under the
+// 16.7 ms a frame has at 60 Hz.
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -pthread -ISources -o NetLoopback
+//       Tools/NetLoopback/NetLoopback.cpp Sources/PongNet.cpp
+//       Sources/PongSim.cpp Sources/PongLookahead.cpp Sources/PongScript.cpp
+//
+// Usage:
+//    NetLoopback [options]
+//       --player <host|join|both>  Which side to play.  "both" plays both
+//                                  sides, each on a thread of its own.  (both)
+//       --address <ip>         Where the other side is.  (127.0.0.1)
+//       --port <n>             Port the host listens on.  The other side
+//                              listens on the next one.  (7777)
+//       --latency <ms>         Delay added to each packet sent.  (0)
+//       --jitter <ms>          Most extra delay added at random.  (0)
+//       --loss <percent>       Packets to drop at random.  (0)
+//       --ticks <n>            Steps to play.  (14400, a minute)
+//       --seed <n>             Seed for the match and the scripts.  (1)
+//
+// Example, with a 150 ms round trip and 5% loss, in two terminals:
+//    NetLoopback --player host --latency 75 --jitter 10 --loss 5
+//    NetLoopback --player join --latency 75 --jitter 10 --loss 5
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "PongNet.h"
+#include "PongScript.h"
+
+using namespace Webfoot;
+
+/// Frames per second each side runs at.
+#define FRAME_RATE 60
+/// Seconds each side keeps sending once it's done, so the other side gets
+/// what it needs to finish too.
+#define LINGER_SECONDS 1.0
+
+//==============================================================================
+
+/// Everything that's the same for both sides.
+struct Settings
+{
+   bool playHost;
+   bool playJoin;
+   const char* address;
+   int port;
+   int latency;
+   int jitter;
+   int lossPercent;
+   unsigned int tickCount;
+   unsigned int seed;
+};
+
+/// How one side got on.
+struct Results
+{
+   bool finished;
+   PongNetStats stats;
+   /// Slowest frame, and all of them together, in milliseconds, not counting
+   /// time spent waiting for the next frame.
+   double frameMax;
+   double frameTotal;
+   int frameCount;
+   /// Checksum of the state at the last tick.
+   unsigned int checksum;
+};
+
+//==============================================================================
+
+/// Returns the input a player might give for 'paddle' in 'state': serving
+/// after a moment, moving the way 'script' says, and starting again once the
+/// match ends.
+static PongInput ScriptInputGet(const PongState& state, const PongConfig& config, int paddle, PongScript* script,
+   unsigned int* randomState)
+{
+   PongInput input;
+   input.paddleDirection[PONG_PADDLE_LEFT] = 0;
+   input.paddleDirection[PONG_PADDLE_RIGHT] = 0;
+   input.paddleDirection[paddle] = script->DirectionGet(state, config);
+   // Presses come at random times, so both sides' guesses about the other
+   // are sometimes wrong.
+   bool press = PongSim::RandomF(randomState) < 0.01f;
+   input.serve = (state.gameState == STATE_PAUSED || state.gameState == STATE_SCORED) && press;
+   input.restart = state.gameState == STATE_END && press;
+   return input;
+}
+
+//------------------------------------------------------------------------------
+
+/// Play one side of the match.
+static void SideRun(const Settings& settings, bool host, Results* results)
+{
+   memset(results, 0, sizeof(*results));
+
+   PongNetSocket socket;
+   unsigned short port = (unsigned short)(host ? settings.port : settings.port + 1);
+   unsigned short peerPort = (unsigned short)(host ? settings.port + 1 : settings.port);
+   if(!socket.Init(port))
+   {
+      fprintf(stderr, "Couldn't listen on port %d.\n", port);
+      return;
+   }
+   if(!socket.PeerSet(settings.address, peerPort))
+   {
+      fprintf(stderr, "%s isn't an IPv4 address.\n", settings.address);
+      socket.Deinit();
+      return;
+   }
+   socket.ConditionsSet(settings.latency, settings.jitter, settings.lossPercent, settings.seed * 2 + (host ? 1 : 0));
+
+   PongSim sim;
+   int paddle = host ? PONG_PADDLE_RIGHT : PONG_PADDLE_LEFT;
+   PongNetSession session;
+   session.Init(&sim, sim.ConfigGet(), paddle, host, host ? settings.seed : 0);
+   unsigned int randomState = settings.seed * 2 + (host ? 1 : 0) + 1;
+   PongScript script;
+   script.Init(paddle, 0);
+
+   typedef std::chrono::steady_clock Clock;
+   const double tickSeconds = 1.0 / PONG_TICK_RATE;
+   const Clock::duration frameDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / FRAME_RATE));
+   Clock::time_point start = Clock::now();
+   Clock::time_point deadline = start + std::chrono::seconds(10 + 3 * settings.tickCount / PONG_TICK_RATE);
+   Clock::time_point nextFrame = start;
+   Clock::time_point doneTime;
+   double accumulator = 0.0;
+   bool done = false;
+
+   for(;;)
+   {
+      Clock::time_point frameStart = Clock::now();
+      if(frameStart > deadline)
+         break;
+
+      // Take in whatever the peer has sent, and fix up any wrong guesses.
+      socket.Update();
+      unsigned char packet[PONG_NET_PACKET_SIZE_MAX];
+      int size;
+      while((size = socket.Receive(packet, sizeof(packet))) > 0)
+         session.PacketRead(packet, size);
+      if(session.MismatchCheck())
+      {
+         fprintf(stderr, "The two sides don't have the same rules.\n");
+         break;
+      }
+      session.Update();
+
+      // Step as far as the time allows, or as the peer lets us.
+      if(session.StartedCheck())
+      {
+         accumulator = std::min(accumulator + 1.0 / FRAME_RATE, tickSeconds * PONG_MAX_TICKS_PER_FRAME);
+         while(accumulator >= tickSeconds && session.TickGet() < settings.tickCount)
+         {
+            if(session.AdvanceCheck())
+            {
+               const PongState& state = sim.StateGet();
+               session.Advance(ScriptInputGet(state, sim.ConfigGet(), paddle, &script, &randomState));
+            }
+            accumulator -= tickSeconds;
+         }
+      }
+
+      size = session.PacketWrite(packet, sizeof(packet));
+      socket.Send(packet, size);
+      socket.Update();
+
+      double frameTime = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+      results->frameMax = std::max(results->frameMax, frameTime);
+      results->frameTotal += frameTime;
+      results->frameCount++;
+
+      // Done once everything up to the last tick is settled on both sides.
+      if(!done && session.TickGet() >= settings.tickCount && session.ConfirmedTickGet() >= settings.tickCount &&
+         session.RemoteAckGet() >= settings.tickCount)
+      {
+         done = true;
+         doneTime = Clock::now();
+      }
+      if(done && Clock::now() - doneTime > std::chrono::duration<double>(LINGER_SECONDS))
+         break;
+
+      nextFrame += frameDuration;
+      std::this_thread::sleep_until(nextFrame);
+   }
+
+   if(done)
+   {
+      results->finished = true;
+      results->checksum = PongNetSession::StateChecksumGet(*session.StateAtGet(settings.tickCount));
+   }
+   results->stats = session.StatsGet();
+   session.Deinit();
+   socket.Deinit();
+}
+
+//------------------------------------------------------------------------------
+
+static void ResultsPrint(const char* name, const Results& results)
+{
+   const PongNetStats& stats = results.stats;
+   printf("%s: %s", name, results.finished ? "finished" : "didn't finish");
+   if(results.finished)
+      printf(", state %08X", results.checksum);
+   printf("\n");
+   printf("   rollbacks %d, ticks resimulated %d, deepest %d, stalls %d, sync waits %d, desyncs %d\n",
+      stats.rollbackCount, stats.ticksResimulated, stats.rollbackMax, stats.stallCount, stats.syncWaitCount,
+      stats.desyncCount);
+   printf("   packets sent %d, received %d, frame time average %.3f ms, worst %.3f ms\n",
+      stats.packetsSent, stats.packetsReceived, results.frameCount ? results.frameTotal / results.frameCount : 0.0,
+      results.frameMax);
+}
+
+//------------------------------------------------------------------------------
+
+static void UsagePrint(const char* program)
+{
+   fprintf(stderr, "Usage: %s [--player <host|join|both>] [--address <ip>] [--port <n>] [--latency <ms>] "
+      "[--jitter <ms>] [--loss <percent>] [--ticks <n>] [--seed <n>]\n", program);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   Settings settings;
+   settings.playHost = true;
+   settings.playJoin = true;
+   settings.address = "127.0.0.1";
+   settings.port = 7777;
+   settings.latency = 0;
+   settings.jitter = 0;
+   settings.lossPercent = 0;
+   settings.tickCount = PONG_TICK_RATE * 60;
+   settings.seed = 1;
+
+   for(int arg = 1; arg < argc; arg++)
+   {
+      const char* option = argv[arg];
+      if(arg + 1 >= argc)
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+      const char* value = argv[++arg];
+
+      if(!strcmp(option, "--player") && !strcmp(value, "host"))
+         settings.playJoin = false;
+      else if(!strcmp(option, "--player") && !strcmp(value, "join"))
+         settings.playHost = false;
+      else if(!strcmp(option, "--player") && !strcmp(value, "both"))
+         settings.playHost = settings.playJoin = true;
+      else if(!strcmp(option, "--address"))
+         settings.address = value;
+      else if(!strcmp(option, "--port"))
+         settings.port = atoi(value);
+      else if(!strcmp(option, "--latency"))
+         settings.latency = atoi(value);
+      else if(!strcmp(option, "--jitter"))
+         settings.jitter = atoi(value);
+      else if(!strcmp(option, "--loss"))
+         settings.lossPercent = atoi(value);
+      else if(!strcmp(option, "--ticks"))
+         settings.tickCount = (unsigned int)strtoul(value, NULL, 0);
+      else if(!strcmp(option, "--seed"))
+         settings.seed = (unsigned int)strtoul(value, NULL, 0);
+      else
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+   }
+   if(settings.port < 1 || settings.port > 65534 || settings.tickCount < 1)
+   {
+      UsagePrint(argv[0]);
+      return 1;
+   }
+
+   Results hostResults;
+   Results joinResults;
+   std::thread hostThread;
+   if(settings.playHost && settings.playJoin)
+      hostThread = std::thread(SideRun, std::cref(settings), true, &hostResults);
+   else if(settings.playHost)
+      SideRun(settings, true, &hostResults);
+   if(settings.playJoin)
+      SideRun(settings, false, &joinResults);
+   if(hostThread.joinable())
+      hostThread.join();
+
+   printf("%u ticks, %d ms latency, %d ms jitter, %d%% loss\n\n", settings.tickCount, settings.latency,
+      settings.jitter, settings.lossPercent);
+   bool passed = true;
+   if(settings.playHost)
+   {
+      ResultsPrint("host", hostResults);
+      passed = passed && hostResults.finished && !hostResults.stats.desyncCount;
+   }
+   if(settings.playJoin)
+   {
+      ResultsPrint("join", joinResults);
+      passed = passed && joinResults.finished && !joinResults.stats.desyncCount;
+   }
+   if(settings.playHost && settings.playJoin && hostResults.checksum != joinResults.checksum)
+   {
+      printf("\nThe two sides ended up in different states.\n");
+      passed = false;
+   }
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,517 @@
+// ResourceCompiler parses JSON resource files ahead of time and writes them
+// all into one binary blob, which ResourceBlob maps into memory and reads in
+// place at runtime.  The JSON files stay the source; compile the blob again
+// whenever one of them changes.
+//
+// The JSON may have // and /* */ comments and trailing commas, like the files
+// Frog reads.  The layout of the blob is described in Sources/ResourceBlob.h.
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -ISources -o ResourceCompiler
+//       Tools/ResourceCompiler/ResourceCompiler.cpp
+//
+// Usage:
+//    ResourceCompiler <FileSystem folder> <output> <JSON file> ...
+//    ResourceCompiler --check <FileSystem folder> <blob>
+//
+// The JSON files are given relative to the FileSystem folder, which is how
+// they're looked up in the blob.  With --check, nothing is written.  Instead,
+// each file in the blob is compared with its JSON, and the ones that have
+// changed since the blob was compiled are listed.  The exit code is 1 if there
+// are any, so a build script can stop before shipping a blob that's out of
+// date.  The game doesn't check this itself.
+//
+// Example, from the root of the repository:
+//    ResourceCompiler FileSystem FileSystem/Resources.blob
+//       Graphics/Sprites/Sprites.json
+//       Graphics/AnimatedBackgrounds/background.json
+//       Scripts/Consts.json Text/English/Text.json
+//       Graphics/GUI/MainMenu/Widgets.json Graphics/GUI/MainMenu/Sprites.json
+//       Graphics/GUI/MainGame/Widgets.json Graphics/GUI/MainGame/Sprites.json
+//    ResourceCompiler --check FileSystem FileSystem/Resources.blob
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "ResourceBlob.h"
+
+using namespace Webfoot;
+
+//==============================================================================
+
+/// A parsed JSON value.
+struct Value
+{
+   ResourceNodeType type;
+   /// Key in the parent object, if the parent is an object.
+   std::string name;
+   bool hasName;
+   double number;
+   std::string text;
+   std::vector<Value> children;
+};
+
+/// Reads JSON text.  Errors are reported with the line they're on.
+struct Parser
+{
+   const char* path;
+   const char* text;
+   size_t position;
+   size_t length;
+   bool failed;
+
+   int LineGet() const
+   {
+      int line = 1;
+      for(size_t i = 0; i < position && i < length; i++)
+         line += text[i] == '\n';
+      return line;
+   }
+
+   void Fail(const char* message)
+   {
+      if(!failed)
+         fprintf(stderr, "%s(%d): %s\n", path, LineGet(), message);
+      failed = true;
+   }
+
+   /// Skip whitespace and comments.
+   void Skip()
+   {
+      while(position < length)
+      {
+         char c = text[position];
+         if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            position++;
+         else if(c == '/' && position + 1 < length && text[position + 1] == '/')
+         {
+            while(position < length && text[position] != '\n')
+               position++;
+         }
+         else if(c == '/' && position + 1 < length && text[position + 1] == '*')
+         {
+            const char* end = strstr(text + position + 2, "*/");
+            position = end ? (size_t)(end - text) + 2 : length;
+         }
+         else
+            break;
+      }
+   }
+
+   /// Skip to the next thing and return its first character, or 0 at the end.
+   char Peek()
+   {
+      Skip();
+      return position < length ? text[position] : 0;
+   }
+
+   bool Expect(char c)
+   {
+      if(Peek() != c)
+      {
+         char message[64];
+         snprintf(message, sizeof(message), "Expected '%c'.", c);
+         Fail(message);
+         return false;
+      }
+      position++;
+      return true;
+   }
+
+   /// Append 'codePoint' to 'out' as UTF-8.
+   static void Utf8Append(std::string* out, unsigned int codePoint)
+   {
+      if(codePoint < 0x80)
+         *out += (char)codePoint;
+      else if(codePoint < 0x800)
+      {
+         *out += (char)(0xC0 | (codePoint >> 6));
+         *out += (char)(0x80 | (codePoint & 0x3F));
+      }
+      else if(codePoint < 0x10000)
+      {
+         *out += (char)(0xE0 | (codePoint >> 12));
+         *out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+         *out += (char)(0x80 | (codePoint & 0x3F));
+      }
+      else
+      {
+         *out += (char)(0xF0 | (codePoint >> 18));
+         *out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+         *out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+         *out += (char)(0x80 | (codePoint & 0x3F));
+      }
+   }
+
+   /// Read 4 hex digits.
+   bool HexRead(unsigned int* value)
+   {
+      if(position + 4 > length)
+         return false;
+      char digits[5] = {text[position], text[position + 1], text[position + 2], text[position + 3], 0};
+      char* end;
+      *value = (unsigned int)strtoul(digits, &end, 16);
+      position += 4;
+      return end == digits + 4;
+   }
+
+   bool StringRead(std::string* out)
+   {
+      if(!Expect('"'))
+         return false;
+      while(position < length && text[position] != '"')
+      {
+         char c = text[position++];
+         if(c != '\\')
+         {
+            *out += c;
+            continue;
+         }
+         if(position >= length)
+            break;
+         char escape = text[position++];
+         switch(escape)
+         {
+            case '"': *out += '"'; break;
+            case '\\': *out += '\\'; break;
+            case '/': *out += '/'; break;
+            case 'b': *out += '\b'; break;
+            case 'f': *out += '\f'; break;
+            case 'n': *out += '\n'; break;
+            case 'r': *out += '\r'; break;
+            case 't': *out += '\t'; break;
+            case 'u':
+            {
+               unsigned int codePoint;
+               if(!HexRead(&codePoint))
+               {
+                  Fail("Bad \\u escape.");
+                  return false;
+               }
+               // Put surrogate pairs back together.
+               unsigned int low;
+               if(codePoint >= 0xD800 && codePoint < 0xDC00 && position + 1 < length &&
+                  text[position] == '\\' && text[position + 1] == 'u')
+               {
+                  position += 2;
+                  if(!HexRead(&low))
+                  {
+                     Fail("Bad \\u escape.");
+                     return false;
+                  }
+                  codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+               }
+               Utf8Append(out, codePoint);
+               break;
+            }
+            default:
+               Fail("Unknown escape in string.");
+               return false;
+         }
+      }
+      return Expect('"');
+   }
+
+   bool ValueRead(Value* value)
+   {
+      value->hasName = false;
+      value->number = 0.0;
+      char c = Peek();
+      if(c == '{' || c == '[')
+      {
+         bool isObject = c == '{';
+         char close = isObject ? '}' : ']';
+         value->type = isObject ? RESOURCE_NODE_OBJECT : RESOURCE_NODE_ARRAY;
+         position++;
+         while(!failed && Peek() != close)
+         {
+            Value child;
+            std::string name;
+            if(isObject && (!StringRead(&name) || !Expect(':')))
+               return false;
+            if(!ValueRead(&child))
+               return false;
+            child.name = name;
+            child.hasName = isObject;
+            value->children.push_back(child);
+
+            // Commas between items, and one after the last is fine too.
+            if(Peek() == ',')
+               position++;
+            else if(Peek() != close)
+            {
+               Fail("Expected ',' between items.");
+               return false;
+            }
+         }
+         return Expect(close);
+      }
+      else if(c == '"')
+      {
+         value->type = RESOURCE_NODE_STRING;
+         return StringRead(&value->text);
+      }
+      else if(!strncmp(text + position, "true", 4) || !strncmp(text + position, "false", 5))
+      {
+         value->type = RESOURCE_NODE_BOOL;
+         value->number = text[position] == 't' ? 1.0 : 0.0;
+         position += text[position] == 't' ? 4 : 5;
+         return true;
+      }
+      else if(!strncmp(text + position, "null", 4))
+      {
+         value->type = RESOURCE_NODE_NULL;
+         position += 4;
+         return true;
+      }
+
+      std::string number;
+      while(position < length && strchr("+-0123456789.eE", text[position]))
+         number += text[position++];
+      char* end;
+      value->type = RESOURCE_NODE_NUMBER;
+      value->number = strtod(number.c_str(), &end);
+      if(number.empty() || *end)
+      {
+         Fail("Expected a value.");
+         return false;
+      }
+      return true;
+   }
+};
+
+//==============================================================================
+
+/// Everything going into the blob.
+struct Blob
+{
+   std::vector<ResourceBlobFile> files;
+   std::vector<ResourceBlobNode> nodes;
+   std::string strings;
+   std::map<std::string, uint32_t> stringOffsets;
+
+   /// Returns the offset of 'text' in the strings, adding it if it's new.
+   uint32_t StringAdd(const std::string& text)
+   {
+      std::map<std::string, uint32_t>::iterator found = stringOffsets.find(text);
+      if(found != stringOffsets.end())
+         return found->second;
+      uint32_t offset = (uint32_t)strings.size();
+      strings += text;
+      strings += '\0';
+      stringOffsets[text] = offset;
+      return offset;
+   }
+
+   /// Fill in node 'index' from 'value', then add its children next to each
+   /// other at the end, then theirs.
+   void NodesWrite(const Value& value, uint32_t index)
+   {
+      ResourceBlobNode node;
+      node.type = value.type;
+      node.name = value.hasName ? StringAdd(value.name) : RESOURCE_BLOB_NO_NAME;
+      node.first = 0;
+      node.count = 0;
+      node.number = value.number;
+      if(value.type == RESOURCE_NODE_STRING)
+      {
+         node.first = StringAdd(value.text);
+         node.count = (uint32_t)value.text.size();
+      }
+      else if(value.type == RESOURCE_NODE_ARRAY || value.type == RESOURCE_NODE_OBJECT)
+      {
+         node.first = (uint32_t)nodes.size();
+         node.count = (uint32_t)value.children.size();
+         nodes.resize(nodes.size() + value.children.size());
+      }
+      nodes[index] = node;
+
+      for(size_t i = 0; i < value.children.size(); i++)
+         NodesWrite(value.children[i], node.first + (uint32_t)i);
+   }
+};
+
+//------------------------------------------------------------------------------
+
+static bool FileRead(const std::string& path, std::string* contents)
+{
+   FILE* file = fopen(path.c_str(), "rb");
+   if(!file)
+      return false;
+   char buffer[65536];
+   size_t count;
+   while((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      contents->append(buffer, count);
+   fclose(file);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+static uint32_t HashGet(const std::string& text)
+{
+   uint32_t hash = 2166136261u;
+   for(size_t i = 0; i < text.size(); i++)
+   {
+      hash ^= (unsigned char)text[i];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+//------------------------------------------------------------------------------
+
+/// Compare each file in the blob at 'blobPath' with its JSON under 'root', as
+/// described at the top of the file.  Returns the exit code.
+static int BlobCheck(const std::string& root, const char* blobPath)
+{
+   std::string data;
+   if(!FileRead(blobPath, &data))
+   {
+      fprintf(stderr, "Couldn't read %s\n", blobPath);
+      return 1;
+   }
+
+   // Only the header, the table of files and the strings are needed.
+   ResourceBlobHeader header;
+   if(data.size() < sizeof(header))
+   {
+      fprintf(stderr, "%s isn't a resource blob.\n", blobPath);
+      return 1;
+   }
+   memcpy(&header, data.data(), sizeof(header));
+   uint64_t filesEnd = sizeof(header) + (uint64_t)header.fileCount * sizeof(ResourceBlobFile);
+   if(header.magic != RESOURCE_BLOB_MAGIC || header.version != RESOURCE_BLOB_VERSION ||
+      header.size > data.size() || filesEnd > header.size || header.stringsSize == 0 ||
+      (uint64_t)header.stringsOffset + header.stringsSize > header.size ||
+      data[header.stringsOffset + header.stringsSize - 1] != '\0')
+   {
+      fprintf(stderr, "%s isn't a resource blob this version can read.  Compile it again.\n", blobPath);
+      return 1;
+   }
+
+   int staleCount = 0;
+   for(uint32_t i = 0; i < header.fileCount; i++)
+   {
+      ResourceBlobFile file;
+      memcpy(&file, &data[sizeof(header) + i * sizeof(ResourceBlobFile)], sizeof(file));
+      if(file.path >= header.stringsSize)
+      {
+         fprintf(stderr, "%s is damaged.  Compile it again.\n", blobPath);
+         return 1;
+      }
+      const char* path = &data[header.stringsOffset + file.path];
+      std::string text;
+      if(!FileRead(root + "/" + path, &text))
+      {
+         printf("%s: missing\n", path);
+         staleCount++;
+      }
+      else if(HashGet(text) != file.sourceHash)
+      {
+         printf("%s: changed since the blob was compiled\n", path);
+         staleCount++;
+      }
+   }
+
+   if(staleCount)
+   {
+      fprintf(stderr, "%d of %d files in %s are out of date.  Compile it again.\n", staleCount,
+         (int)header.fileCount, blobPath);
+      return 1;
+   }
+   printf("%d files, all up to date\n", (int)header.fileCount);
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   if(argc == 4 && !strcmp(argv[1], "--check"))
+      return BlobCheck(argv[2], argv[3]);
+   if(argc < 4)
+   {
+      fprintf(stderr, "Usage: %s <FileSystem folder> <output> <JSON file> ...\n", argv[0]);
+      fprintf(stderr, "       %s --check <FileSystem folder> <blob>\n", argv[0]);
+      return 1;
+   }
+   std::string root = argv[1];
+   const char* outputPath = argv[2];
+
+   Blob blob;
+   // Make sure there's always at least one string, so the strings always end
+   // with a NUL.
+   blob.StringAdd("");
+
+   for(int i = 3; i < argc; i++)
+   {
+      std::string path = root + "/" + argv[i];
+      std::string text;
+      if(!FileRead(path, &text))
+      {
+         fprintf(stderr, "Couldn't read %s\n", path.c_str());
+         return 1;
+      }
+
+      Parser parser;
+      parser.path = path.c_str();
+      parser.text = text.c_str();
+      parser.position = 0;
+      parser.length = text.size();
+      parser.failed = false;
+      Value value;
+      if(!parser.ValueRead(&value) || parser.failed)
+         return 1;
+      if(parser.Peek())
+      {
+         parser.Fail("Unexpected text after the end.");
+         return 1;
+      }
+
+      ResourceBlobFile file;
+      file.path = blob.StringAdd(argv[i]);
+      file.root = (uint32_t)blob.nodes.size();
+      file.sourceHash = HashGet(text);
+      file.reserved = 0;
+      blob.files.push_back(file);
+      blob.nodes.resize(blob.nodes.size() + 1);
+      blob.NodesWrite(value, file.root);
+   }
+
+   ResourceBlobHeader header;
+   header.magic = RESOURCE_BLOB_MAGIC;
+   header.version = RESOURCE_BLOB_VERSION;
+   header.fileCount = (uint32_t)blob.files.size();
+   header.nodeCount = (uint32_t)blob.nodes.size();
+   uint32_t filesEnd = (uint32_t)(sizeof(ResourceBlobHeader) + blob.files.size() * sizeof(ResourceBlobFile));
+   header.nodesOffset = (filesEnd + 7) & ~7u;
+   header.stringsOffset = header.nodesOffset + (uint32_t)(blob.nodes.size() * sizeof(ResourceBlobNode));
+   header.stringsSize = (uint32_t)blob.strings.size();
+   header.size = header.stringsOffset + header.stringsSize;
+
+   std::vector<char> output(header.size, 0);
+   memcpy(&output[0], &header, sizeof(header));
+   if(!blob.files.empty())
+      memcpy(&output[sizeof(header)], &blob.files[0], blob.files.size() * sizeof(ResourceBlobFile));
+   if(!blob.nodes.empty())
+      memcpy(&output[header.nodesOffset], &blob.nodes[0], blob.nodes.size() * sizeof(ResourceBlobNode));
+   memcpy(&output[header.stringsOffset], blob.strings.data(), blob.strings.size());
+
+   FILE* file = fopen(outputPath, "wb");
+   if(!file || fwrite(&output[0], 1, output.size(), file) != output.size())
+   {
+      fprintf(stderr, "Couldn't write %s\n", outputPath);
+      if(file)
+         fclose(file);
+      return 1;
+   }
+   fclose(file);
+
+   printf("%d files, %d nodes, %d bytes of strings, %d bytes in all\n", (int)header.fileCount,
+      (int)header.nodeCount, (int)header.stringsSize, (int)header.size);
+   return 0;
+}
@@ -0,0 +1,226 @@
+// SnapshotTest makes sure the snapshots a match is sent to spectators in
+// come back the same on the other end, with no screen, so a change to
+// PongSnapshotCoder that breaks the format fails here rather than as a
+// spectator watching the wrong game.
+//
+// A long match between two AIs is encoded tick by tick, with a keyframe every
+// second and the difference from the tick before otherwise, the way
+// PongBroadcast sends it.  Every snapshot has to decode to exactly what was
+// encoded, and the state it gives has to be within rounding of the real one,
+// power-ups included.  Each snapshot is also cut short, and each difference
+// is decoded against the wrong baseline, and both have to be refused.
+//
+// Prints how big the snapshots came out to stderr, and exits with 1 if
+// anything was wrong, so it can be run from a script.
+//
+// Build, from the root of the repository:
+//    g++ -std=c++11 -O2 -ISources -o SnapshotTest
+//       Tools/SnapshotTest/SnapshotTest.cpp Sources/PongSim.cpp
+//       Sources/PongLookahead.cpp Sources/PongSnapshot.cpp
+//
+// Usage:
+//    SnapshotTest [options]
+//       --ticks <n>            Ticks of the match to go through.  (72000,
+//                              five minutes)
+//       --seed <n>             Seed for the match.  (2)
+//
+// Example, going through an hour of a different match:
+//    SnapshotTest --ticks 864000 --seed 7
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "PongSim.h"
+#include "PongSnapshot.h"
+
+using namespace Webfoot;
+
+/// Ticks of the match to go through by default, five minutes' worth.
+#define SNAPSHOT_TEST_TICK_COUNT (PONG_TICK_RATE * 60 * 5)
+/// How often one of the ticks is a keyframe.
+#define SNAPSHOT_TEST_KEYFRAME_INTERVAL PONG_TICK_RATE
+
+//==============================================================================
+
+/// Returns the game's usual config, with both paddles played by the AI.
+static PongConfig ConfigGet()
+{
+   PongSim sim;
+   PongConfig config = sim.ConfigGet();
+   config.aiControlled[PONG_PADDLE_LEFT] = true;
+   config.aiControlled[PONG_PADDLE_RIGHT] = true;
+   return config;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns input that serves whenever the ball isn't in play.
+static PongInput ServeInputGet()
+{
+   PongInput input;
+   input.paddleDirection[PONG_PADDLE_LEFT] = 0;
+   input.paddleDirection[PONG_PADDLE_RIGHT] = 0;
+   input.serve = true;
+   input.restart = false;
+   return input;
+}
+
+//------------------------------------------------------------------------------
+
+/// Returns true if 'state', from a decoded snapshot, is within 'tolerance' of
+/// 'real' everywhere a snapshot covers.  Prints what's wrong otherwise.
+static bool StateCloseCheck(const PongState& state, const PongState& real, float tolerance, unsigned int tick)
+{
+   if(fabsf(state.ball.position.x - real.ball.position.x) > tolerance ||
+      fabsf(state.ball.position.y - real.ball.position.y) > tolerance ||
+      fabsf(state.paddles[PONG_PADDLE_LEFT].position.y - real.paddles[PONG_PADDLE_LEFT].position.y) > tolerance ||
+      fabsf(state.paddles[PONG_PADDLE_RIGHT].position.y - real.paddles[PONG_PADDLE_RIGHT].position.y) > tolerance ||
+      state.playerScore1 != real.playerScore1 || state.playerScore2 != real.playerScore2 ||
+      state.gameState != real.gameState || state.ball.playerHit != real.ball.playerHit)
+   {
+      fprintf(stderr, "The snapshot of tick %u is too far from the real state.\n", tick);
+      return false;
+   }
+   for(int i = 0; i < PONG_POWER_UP_MAX; i++)
+   {
+      const PongPowerUp& powerUp = state.powerUps[i];
+      const PongPowerUp& realPowerUp = real.powerUps[i];
+      if(powerUp.active != realPowerUp.active ||
+         fabsf(powerUp.box.minX - realPowerUp.box.minX) > tolerance ||
+         fabsf(powerUp.box.minY - realPowerUp.box.minY) > tolerance ||
+         fabsf(powerUp.box.maxX - realPowerUp.box.maxX) > tolerance ||
+         fabsf(powerUp.box.maxY - realPowerUp.box.maxY) > tolerance)
+      {
+         fprintf(stderr, "Power-up %d in the snapshot of tick %u is too far from the real one.\n", i, tick);
+         return false;
+      }
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+/// Go through 'tickCount' ticks of a match as described at the top of the
+/// file.  Returns false if anything was wrong.
+static bool SnapshotsTest(int tickCount, unsigned int seed)
+{
+   PongSim sim;
+   sim.Init(ConfigGet(), seed);
+   PongInput input = ServeInputGet();
+   const float tickSeconds = 1.0f / PONG_TICK_RATE;
+   const float positionTolerance = 0.5f / PONG_SNAPSHOT_POSITION_SCALE + 0.001f;
+
+   PongSnapshot sent;
+   PongSnapshot received;
+   memset(&sent, 0, sizeof(sent));
+   memset(&received, 0, sizeof(received));
+   long long deltaBytes = 0;
+   int deltaCount = 0;
+   int deltaMax = 0;
+   long long keyframeBytes = 0;
+   int keyframeCount = 0;
+   long long powerUpTicks = 0;
+   for(int i = 0; i < tickCount; i++)
+   {
+      // Restart the match once it's over, the way a player does.
+      input.restart = sim.StateGet().gameState == STATE_END;
+      sim.Step(input, tickSeconds);
+      const PongState& real = sim.StateGet();
+      PongSnapshot snapshot;
+      PongSnapshotCoder::Capture(real, &snapshot);
+
+      bool keyframe = (i % SNAPSHOT_TEST_KEYFRAME_INTERVAL) == 0;
+      unsigned char buffer[PONG_SNAPSHOT_SIZE_MAX];
+      int size = PongSnapshotCoder::Encode(keyframe ? NULL : &sent, snapshot, buffer, sizeof(buffer));
+      PongSnapshot decoded;
+      if(!size || PongSnapshotCoder::KeyframeCheck(buffer, size) != keyframe ||
+         !PongSnapshotCoder::Decode(&received, buffer, size, &decoded) ||
+         !PongSnapshotCoder::EqualCheck(decoded, snapshot))
+      {
+         fprintf(stderr, "The snapshot of tick %u didn't come back the same.\n", snapshot.tick);
+         return false;
+      }
+
+      PongSnapshot wrongBaseline = received;
+      wrongBaseline.tick++;
+      PongSnapshot refused;
+      if(PongSnapshotCoder::Decode(&received, buffer, size - 1, &refused) ||
+         (!keyframe && PongSnapshotCoder::Decode(&wrongBaseline, buffer, size, &refused)))
+      {
+         fprintf(stderr, "A bad snapshot of tick %u wasn't refused.\n", snapshot.tick);
+         return false;
+      }
+
+      PongState state = real;
+      PongSnapshotCoder::Apply(decoded, &state);
+      if(!StateCloseCheck(state, real, positionTolerance, snapshot.tick))
+         return false;
+      for(int j = 0; j < PONG_POWER_UP_MAX; j++)
+         powerUpTicks += real.powerUps[j].active ? 1 : 0;
+
+      if(keyframe)
+      {
+         keyframeBytes += size;
+         keyframeCount++;
+      }
+      else
+      {
+         deltaBytes += size;
+         deltaCount++;
+         deltaMax = std::max(deltaMax, size);
+      }
+      sent = snapshot;
+      received = decoded;
+   }
+
+   fprintf(stderr, "Snapshots of %d ticks came back the same: %.2f bytes per difference, %d at most, "
+      "%.2f per keyframe, with power-ups on the field for %lld ticks\n", tickCount,
+      deltaCount ? (double)deltaBytes / deltaCount : 0.0, deltaMax,
+      keyframeCount ? (double)keyframeBytes / keyframeCount : 0.0, powerUpTicks);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+
+static void UsagePrint(const char* program)
+{
+   fprintf(stderr, "Usage: %s [--ticks <n>] [--seed <n>]\n", program);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+   int tickCount = SNAPSHOT_TEST_TICK_COUNT;
+   unsigned int seed = 2;
+
+   for(int arg = 1; arg < argc; arg++)
+   {
+      const char* option = argv[arg];
+      if(arg + 1 >= argc)
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+      const char* value = argv[++arg];
+
+      if(!strcmp(option, "--ticks"))
+         tickCount = atoi(value);
+      else if(!strcmp(option, "--seed"))
+         seed = (unsigned int)strtoul(value, NULL, 10);
+      else
+      {
+         UsagePrint(argv[0]);
+         return 1;
+      }
+   }
+   if(tickCount < 1)
+   {
+      UsagePrint(argv[0]);
+      return 1;
+   }
+
+   return SnapshotsTest(tickCount, seed) ? 0 : 1;
+}